@@ -606,3 +606,231 @@ typedef struct _WsManClient {
      return wsmc_get_last_error($self);
    }
 }
+
+
+%rename(AsyncClient) _WsManAsync;
+%nodefault _WsManAsync;
+typedef struct _WsManAsync {
+} WsManAsync;
+
+%rename(AsyncRequest) _WsManAsyncRequest;
+%nodefault _WsManAsyncRequest;
+typedef struct _WsManAsyncRequest {
+} WsManAsyncRequest;
+
+/*
+ * Document-class: AsyncClient
+ *
+ * AsyncClient runs many requests, to one or more Clients, from a single
+ * thread. Requests are sent with submit, transferred by calling perform
+ * until nothing is pending and picked up with next_done.
+ *
+ */
+
+%extend _WsManAsync {
+  /*
+   * Create an AsyncClient
+   *
+   * call-seq:
+   *  AsyncClient.new(max_requests)
+   *
+   * max_requests limits the requests in flight, further ones are
+   * queued. 0 means no limit.
+   *
+   */
+  _WsManAsync(int max_requests = 0) {
+    return wsmc_async_create(max_requests);
+  }
+
+  /* destructor */
+  ~_WsManAsync() {
+    wsmc_async_release( $self );
+  }
+
+  /*
+   * Limit the connections to a single host
+   *
+   * call-seq:
+   *   async.host_limit(Integer) -> Integer
+   *
+   */
+  int host_limit(int max_connections) {
+    return wsmc_async_set_host_limit($self, max_connections);
+  }
+
+  /*
+   * Send a request document through client without waiting for the
+   * response. The client must be kept until the request is done.
+   * tag is handed back by AsyncRequest.tag.
+   *
+   * call-seq:
+   *   async.submit(client, XmlDoc, timeout = 0, tag = 0) -> Integer
+   *
+   * Returns 0 on success.
+   *
+   */
+  int submit(WsManClient *client, WsXmlDocH request,
+      unsigned long timeout = 0, long tag = 0) {
+    return wsmc_async_send($self, client, request, timeout, NULL,
+        (void *)tag) == NULL ? 1 : 0;
+  }
+
+  /*
+   * Transfer data, waiting at most timeout_ms milliseconds
+   *
+   * call-seq:
+   *   async.perform(timeout_ms) -> Integer
+   *
+   * Returns the number of unfinished requests, -1 on error
+   *
+   */
+  int perform(long timeout_ms = 0) {
+    return wsmc_async_perform($self, timeout_ms);
+  }
+
+  /*
+   * Number of unfinished requests
+   *
+   */
+  int pending() {
+    return wsmc_async_pending($self);
+  }
+
+  %newobject next_done;
+  /*
+   * Next finished request, nil if there is none
+   *
+   * call-seq:
+   *   async.next_done -> AsyncRequest
+   *
+   */
+  WsManAsyncRequest *next_done() {
+    return wsmc_async_next_done($self);
+  }
+}
+
+/*
+ * Document-class: AsyncRequest
+ *
+ * A finished request of an AsyncClient
+ *
+ */
+
+%extend _WsManAsyncRequest {
+  /* destructor */
+  ~_WsManAsyncRequest() {
+    wsmc_async_request_release( $self );
+  }
+
+  /*
+   * The response document, nil if there is none
+   *
+   * call-seq:
+   *   request.response -> XmlDoc
+   *
+   */
+  WsXmlDocH response() {
+    WsXmlDocH doc = wsmc_async_request_get_response($self);
+    return doc ? ws_xml_duplicate_doc(doc) : NULL;
+  }
+
+  /*
+   * HTTP response code
+   *
+   */
+  long response_code() {
+    return wsmc_async_request_get_response_code($self);
+  }
+
+  /*
+   * Transport error, see Client.last_error
+   *
+   */
+  int last_error() {
+    return wsmc_async_request_get_last_error($self);
+  }
+
+  /*
+   * Transport error as string
+   *
+   */
+  char *fault_string() {
+    return wsmc_async_request_get_fault_string($self);
+  }
+
+  /*
+   * Tag passed to AsyncClient.submit
+   *
+   */
+  long tag() {
+    return (long)wsmc_async_request_get_user_data($self);
+  }
+}
+
+
+%rename(PreparedRequest) _WsManPreparedRequest;
+%nodefault _WsManPreparedRequest;
+typedef struct _WsManPreparedRequest {
+} WsManPreparedRequest;
+
+/*
+ * Document-class: PreparedRequest
+ *
+ * A request built once and sent many times, only its MessageID and
+ * the EnumerationContext of a Pull or Release change. Polling loops
+ * save building and serializing the envelope on every call.
+ *
+ */
+
+%extend _WsManPreparedRequest {
+
+  /* Get */
+  %constant int TRANSFER_GET    = WSMAN_ACTION_TRANSFER_GET;
+  /* Put, the body is taken from the XmlDoc passed to new */
+  %constant int TRANSFER_PUT    = WSMAN_ACTION_TRANSFER_PUT;
+  /* Delete */
+  %constant int TRANSFER_DELETE = WSMAN_ACTION_TRANSFER_DELETE;
+  /* Enumerate */
+  %constant int ENUMERATION     = WSMAN_ACTION_ENUMERATION;
+  /* Pull, send takes the EnumerationContext */
+  %constant int PULL            = WSMAN_ACTION_PULL;
+  /* Release, send takes the EnumerationContext */
+  %constant int RELEASE         = WSMAN_ACTION_RELEASE;
+  /* Identify */
+  %constant int IDENTIFY        = WSMAN_ACTION_IDENTIFY;
+  /* Invoke method, or the custom action URI given as method */
+  %constant int CUSTOM          = WSMAN_ACTION_CUSTOM;
+
+  /*
+   * Prepare a request for client. The client must be kept as long as
+   * the request.
+   *
+   * call-seq:
+   *   PreparedRequest.new(client, options, filter, uri, PreparedRequest::PULL)
+   *   PreparedRequest.new(client, options, nil, uri, PreparedRequest::CUSTOM, "Method", XmlDoc)
+   *
+   */
+  _WsManPreparedRequest(WsManClient *client, client_opt_t *options,
+      filter_t *filter, const char *resource_uri, int action,
+      const char *method = NULL, WsXmlDocH body = NULL) {
+    return wsmc_prepare_request(client, resource_uri, options, filter,
+        (WsmanAction)action, method, body);
+  }
+
+  /* destructor */
+  ~_WsManPreparedRequest() {
+    wsmc_prepared_request_release( $self );
+  }
+
+  /*
+   * Send the request with a new MessageID
+   *
+   * call-seq:
+   *   request.send -> XmlDoc
+   *   request.send(context) -> XmlDoc
+   *
+   */
+  WsXmlDocH send(const char *context = NULL) {
+    return wsmc_prepared_request_send($self, context);
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef _U_LIBU_ARENA_H_
+#define _U_LIBU_ARENA_H_
+
+#include <sys/types.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* default size of a single arena chunk */
+#define U_ARENA_CHUNK_SIZE 4096
+
+struct u_arena_s;
+typedef struct u_arena_s u_arena_t;
+
+u_arena_t *u_arena_create(size_t chunk_size);
+void u_arena_destroy(u_arena_t *arena);
+void u_arena_reset(u_arena_t *arena);
+void *u_arena_alloc(u_arena_t *arena, size_t size);
+void *u_arena_zalloc(u_arena_t *arena, size_t size);
+char *u_arena_strdup(u_arena_t *arena, const char *str);
+char *u_arena_strdup_printf(u_arena_t *arena, const char *format, ...);
+char *u_arena_strdup_vprintf(u_arena_t *arena, const char *format, va_list ap);
+size_t u_arena_used(u_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_U_LIBU_ARENA_H_ */
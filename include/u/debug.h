@@ -61,8 +61,20 @@ debug_add_handler (debug_fn fn,
                       void* user_data);
 
 void debug_remove_handler (unsigned int id);
+void debug_set_handler_level (unsigned int id, debug_level_e level);
 void debug_destroy_handlers (void);
 
+/* whether a message of that level reaches any handler; messages which
+ * do not are dropped before they are formatted */
+int debug_level_enabled (debug_level_e level);
+
+/* hand messages to the handlers from a thread of its own, through a
+ * ring of 'slots' messages; when it is full, messages above
+ * DEBUG_LEVEL_WARNING are dropped */
+int debug_async_start (unsigned int slots);
+void debug_async_stop (void);
+unsigned long debug_async_dropped (void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
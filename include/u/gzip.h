@@ -0,0 +1,28 @@
+#ifndef _U_LIBU_GZIP_H_
+#define _U_LIBU_GZIP_H_
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* HTTP content codings */
+#define U_GZIP_IDENTITY 0
+#define U_GZIP_GZIP     1
+#define U_GZIP_DEFLATE  2
+
+int u_gzip_supported(void);
+int u_gzip_coding(const char *content_encoding);
+int u_gzip_accepted(const char *accept_encoding);
+const char *u_gzip_name(int coding);
+int u_gzip_compress(int coding, int level, const char *in, size_t len,
+		char **out, size_t *outlen);
+int u_gzip_uncompress(const char *in, size_t len, size_t max,
+		char **out, size_t *outlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_U_LIBU_GZIP_H_ */
@@ -13,6 +13,8 @@
 #include <u/log.h>
 #include <u/logprv.h>
 #include <u/memory.h>
+#include <u/arena.h>
+#include <u/gzip.h>
 #include <u/misc.h>
 #include <u/buf.h>
 #include <u/os.h>
@@ -48,6 +48,10 @@ extern "C" {
 #include "wsman-filter.h"
 #include "u/list.h"
 
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
 /**
  * @defgroup Client Client
  * @brief WS-Management Client
@@ -775,6 +779,11 @@ typedef enum {
         void wsmc_add_property_epr(client_opt_t * options,
                                    const char *key, const epr_t *value);
 
+	/* drop selectors or properties so options can be reused */
+	void wsmc_clear_selectors(client_opt_t * options);
+
+	void wsmc_clear_properties(client_opt_t * options);
+
         void wsmc_set_cim_ns(const char *delivery_uri, client_opt_t * options);
   
         void wsmc_set_fragment(const char *fragment, client_opt_t * options);
@@ -832,6 +841,290 @@ typedef enum {
 	void
 	wsmc_set_delivery_security_mode(WsManDeliverySecurityMode delivery_sec_mode, client_opt_t * options);
 
+#ifndef _WIN32
+	/* Asynchronous requests */
+
+	struct _WsManAsync;
+	typedef struct _WsManAsync WsManAsync;
+	struct _WsManAsyncRequest;
+	typedef struct _WsManAsyncRequest WsManAsyncRequest;
+
+	typedef void (*wsmc_async_callback_t)(WsManAsyncRequest *req,
+					      void *user_data);
+
+	/**
+	 * Create a driver running many requests from one thread
+	 * @param max_requests Requests in flight at the same time, 0 for
+	 *        no limit
+	 * @return driver
+	 */
+	WsManAsync *wsmc_async_create(unsigned int max_requests);
+
+	int wsmc_async_set_host_limit(WsManAsync *as,
+				      unsigned int max_connections);
+
+	void wsmc_async_release(WsManAsync *as);
+
+	/**
+	 * Send a request without waiting for the response
+	 * @param as Driver
+	 * @param cl Client handle providing endpoint and transport settings
+	 * @param request Request document, e.g. from wsmc_create_request()
+	 * @param timeout Timeout in seconds, 0 for the one of the client
+	 * @param callback Completion callback or NULL
+	 * @param user_data Passed to callback
+	 * @return request handle
+	 */
+	WsManAsyncRequest *wsmc_async_send(WsManAsync *as, WsManClient *cl,
+					   WsXmlDocH request,
+					   unsigned long timeout,
+					   wsmc_async_callback_t callback,
+					   void *user_data);
+
+	int wsmc_async_perform(WsManAsync *as, long timeout_ms);
+
+	int wsmc_async_fdset(WsManAsync *as, fd_set *read_fds,
+			     fd_set *write_fds, fd_set *exc_fds, int *max_fd);
+
+	long wsmc_async_timeout(WsManAsync *as);
+
+	int wsmc_async_pending(WsManAsync *as);
+
+	WsManAsyncRequest *wsmc_async_next_done(WsManAsync *as);
+
+	WsXmlDocH wsmc_async_request_get_response(WsManAsyncRequest *req);
+
+	const char *wsmc_async_request_get_data(WsManAsyncRequest *req,
+						size_t *size);
+
+	long wsmc_async_request_get_response_code(WsManAsyncRequest *req);
+
+	WS_LASTERR_Code wsmc_async_request_get_last_error(WsManAsyncRequest *req);
+
+	char *wsmc_async_request_get_fault_string(WsManAsyncRequest *req);
+
+	WsManClient *wsmc_async_request_get_client(WsManAsyncRequest *req);
+
+	void *wsmc_async_request_get_user_data(WsManAsyncRequest *req);
+
+	void wsmc_async_request_release(WsManAsyncRequest *req);
+
+	/* Streaming enumeration */
+
+	struct _WsManEnumStream;
+	typedef struct _WsManEnumStream WsManEnumStream;
+
+	typedef int (*WsmcItemCallback) (WsManClient *, WsXmlNodeH, void *);
+
+	/**
+	 * Start an enumeration whose items are read one at a time. The
+	 * next Pull is sent as soon as the EnumerationContext of a response
+	 * has been read, while the items of that response are still being
+	 * handed out, and no response is ever held as a whole tree.
+	 * @param cl Client handle
+	 * @param resource_uri Resource URI
+	 * @param options Request options and flags, used until the stream
+	 *        is closed
+	 * @param filter Filter or NULL, used until the stream is closed
+	 * @return stream or NULL, see wsmc_get_last_error()
+	 */
+	WsManEnumStream *wsmc_enum_stream_open(WsManClient * cl,
+					       const char *resource_uri,
+					       client_opt_t * options,
+					       filter_t * filter);
+
+	/**
+	 * Next item of the enumeration
+	 * @param s Stream
+	 * @return item, valid until the next call, or NULL once the
+	 *         enumeration is over or failed, see wsmc_enum_stream_failed()
+	 */
+	WsXmlNodeH wsmc_enum_stream_next(WsManEnumStream * s);
+
+	/**
+	 * Whether the enumeration ended on an error. Response code, last
+	 * error and fault of the client describe it; the fault response is
+	 * available through wsmc_build_envelope_from_response().
+	 */
+	int wsmc_enum_stream_failed(WsManEnumStream * s);
+
+	/**
+	 * Close a stream, releasing the enumeration on the server if it was
+	 * not read to the end
+	 */
+	void wsmc_enum_stream_close(WsManEnumStream * s);
+
+	/**
+	 * Enumerate and hand each item to callback as it is read, see
+	 * wsmc_enum_stream_open()
+	 * @param cl Client handle
+	 * @param resource_uri Resource URI
+	 * @param options Request options and flags
+	 * @param filter Filter or NULL
+	 * @param callback Called for each item, a non zero return value
+	 *        stops the enumeration
+	 * @param callback_data Pointer to callback data
+	 * @return success
+	 */
+	int wsmc_action_enumerate_and_pull_items(WsManClient * cl,
+						 const char *resource_uri,
+						 client_opt_t * options,
+						 filter_t * filter,
+						 WsmcItemCallback callback,
+						 void *callback_data);
+
+	/* Fleet requests */
+
+	struct _WsManFleet;
+	typedef struct _WsManFleet WsManFleet;
+
+	/* outcome of one request of a fleet run */
+	typedef struct {
+		unsigned int index;	/* of the endpoint in the fleet */
+		WsManClient *client;
+		void *user_data;	/* given when adding the endpoint */
+		WsXmlDocH response;	/* owned by the fleet, NULL on failure */
+		long response_code;
+		WS_LASTERR_Code last_error;
+		const char *fault_string;
+		unsigned int attempts;	/* 1 unless retried */
+		double latency;		/* seconds, of the last attempt */
+		int more;		/* more pages of an enumeration follow */
+	} WsManFleetResult;
+
+	typedef struct {
+		unsigned long requests;	/* sent, retries included */
+		unsigned long retries;
+		unsigned long failures;	/* endpoints which failed */
+		double elapsed;		/* seconds the run took */
+		double latency_avg;	/* seconds */
+		double latency_max;
+	} WsManFleetStats;
+
+	typedef void (*wsmc_fleet_callback_t)(const WsManFleetResult *result,
+					      void *data);
+
+	/**
+	 * Create an engine running one operation against many endpoints
+	 * from a single thread
+	 * @param max_requests Requests in flight at the same time, 0 for
+	 *        no limit
+	 * @param host_limit Connections to a single host, 0 for no limit
+	 * @return fleet or NULL
+	 */
+	WsManFleet *wsmc_fleet_create(unsigned int max_requests,
+				      unsigned int host_limit);
+
+	/**
+	 * Retry requests which could not connect, and Identify, Get and
+	 * Enumerate requests which got no answer or a 5xx status without
+	 * a SOAP envelope, after backoff_ms, doubling the delay up to
+	 * max_backoff_ms for each further attempt. Delays are jittered.
+	 * Pulls and writes are reported as failed instead, the server may
+	 * have acted on them. No retries by default.
+	 */
+	void wsmc_fleet_set_retry(WsManFleet *f, unsigned int retries,
+				  unsigned long backoff_ms,
+				  unsigned long max_backoff_ms);
+
+	/* Timeout of a request in seconds, 0 for the one of the client */
+	void wsmc_fleet_set_timeout(WsManFleet *f, unsigned long timeout);
+
+	/**
+	 * Add an endpoint given as URL, credentials may be part of it
+	 * @return index of the endpoint or -1
+	 */
+	int wsmc_fleet_add_endpoint(WsManFleet *f, const char *endpoint,
+				    void *user_data);
+
+	/**
+	 * Add an endpoint given as client, which must be kept as long as
+	 * the fleet and not be used meanwhile
+	 * @return index of the endpoint or -1
+	 */
+	int wsmc_fleet_add_client(WsManFleet *f, WsManClient *cl,
+				  void *user_data);
+
+	unsigned int wsmc_fleet_count(WsManFleet *f);
+
+	WsManClient *wsmc_fleet_get_client(WsManFleet *f, unsigned int index);
+
+	/**
+	 * Run a request against all endpoints and hand each response to
+	 * callback as it arrives. An Enumerate is followed by Pulls until
+	 * the end of the enumeration, every page is a result of its own.
+	 * @param f Fleet
+	 * @param resource_uri Resource URI
+	 * @param options Request options and flags
+	 * @param filter Filter or NULL
+	 * @param action Action of the request
+	 * @param method Custom or invoke action, see wsmc_create_request()
+	 * @param body Body for Put, Create and Invoke or NULL
+	 * @param callback Called for each result
+	 * @param data Passed to callback
+	 * @return number of endpoints which failed, -1 on error
+	 */
+	int wsmc_fleet_run(WsManFleet *f, const char *resource_uri,
+			   client_opt_t *options, filter_t *filter,
+			   WsmanAction action, const char *method,
+			   WsXmlDocH body, wsmc_fleet_callback_t callback,
+			   void *data);
+
+	/* Statistics of the last run */
+	void wsmc_fleet_get_stats(WsManFleet *f, WsManFleetStats *stats);
+
+	/* Mean latency in seconds of an endpoint in the last run */
+	double wsmc_fleet_get_latency(WsManFleet *f, unsigned int index);
+
+	void wsmc_fleet_release(WsManFleet *f);
+#endif
+
+	/* Prepared requests */
+
+	struct _WsManPreparedRequest;
+	typedef struct _WsManPreparedRequest WsManPreparedRequest;
+
+	/**
+	 * Build the envelope of a request once, to send it many times.
+	 * Sends differ in the MessageID only, and in the
+	 * EnumerationContext for Pull and Release; these are patched into
+	 * the serialized envelope, which is not built again.
+	 * @param cl Client handle, the request can only be sent through it
+	 * @param resource_uri Resource URI
+	 * @param options Request options and flags, not used after the call
+	 * @param filter Filter or NULL
+	 * @param action Action of the request
+	 * @param method Custom or invoke action, see wsmc_create_request()
+	 * @param body Body for Put, Create and Invoke or NULL, copied
+	 * @return prepared request or NULL
+	 */
+	WsManPreparedRequest *wsmc_prepare_request(WsManClient * cl,
+						   const char *resource_uri,
+						   client_opt_t * options,
+						   filter_t * filter,
+						   WsmanAction action,
+						   const char *method,
+						   WsXmlDocH body);
+
+	/**
+	 * Send a prepared request with a new MessageID
+	 * @param req Prepared request
+	 * @param context EnumerationContext of a Pull or Release, ignored
+	 *        for other actions
+	 * @return response document or NULL, as the wsmc_action functions
+	 */
+	WsXmlDocH wsmc_prepared_request_send(WsManPreparedRequest * req,
+					     const char *context);
+
+	/**
+	 * Serialized envelope of the last send, or of the template if
+	 * nothing was sent yet
+	 */
+	const char *wsmc_prepared_request_get_data(WsManPreparedRequest * req,
+						   size_t * size);
+
+	void wsmc_prepared_request_release(WsManPreparedRequest * req);
+
 /** @} */
 
 
@@ -62,6 +62,9 @@ extern "C" {
 
 int wsman_send_request(WsManClient *cl, WsXmlDocH request);
 
+/* send an envelope already serialized in the encoding of the client */
+int wsman_send_request_buf(WsManClient *cl, const char *buf, int len);
+
 /*
  * Set callback function to ask for username/password on authentication failure (http-401 returned)
  * If the callback returns an empty (or NULL) username, authentication is aborted.
@@ -104,6 +107,33 @@ char *wsman_transport_get_last_error_string(WS_LASTERR_Code err);
 extern void          wsman_transport_set_timeout(WsManClient *cl, unsigned long timeout);
 extern unsigned long wsman_transport_get_timeout(WsManClient *cl);
 
+/* HTTP responses received by the client, 401 challenges included */
+extern unsigned long wsman_transport_get_round_trips(WsManClient *cl);
+
+/* TLS connections set up by the client, and how many of them resumed
+ * an earlier session instead of a full handshake */
+extern unsigned long wsman_transport_get_tls_handshakes(WsManClient *cl);
+extern unsigned long wsman_transport_get_tls_resumptions(WsManClient *cl);
+
+/* charset in the Content-Type of the last response, NULL if it had none */
+extern const char *wsman_transport_get_response_charset(WsManClient *cl);
+
+/* 0 to only keep the parsed response, not its text */
+extern void wsman_transport_set_response_buffering(WsManClient *cl, unsigned int value);
+extern unsigned int  wsman_transport_get_response_buffering(WsManClient *cl);
+
+/* 0 to only keep the text of the response, not its parsed document */
+extern void wsman_transport_set_response_parsing(WsManClient *cl, unsigned int value);
+extern unsigned int  wsman_transport_get_response_parsing(WsManClient *cl);
+
+/* ask for gzip/deflate coded responses, on by default */
+extern void wsman_transport_set_accept_compression(WsManClient *cl, unsigned int value);
+extern unsigned int  wsman_transport_get_accept_compression(WsManClient *cl);
+
+/* gzip request bodies of at least 'size' bytes, 0 (default) never */
+extern void wsman_transport_set_request_compression(WsManClient *cl, unsigned long size);
+extern unsigned long wsman_transport_get_request_compression(WsManClient *cl);
+
 extern void wsman_transport_set_verify_peer(WsManClient *cl, unsigned int value);
 extern unsigned int  wsman_transport_get_verify_peer(WsManClient *cl);
 
@@ -52,6 +52,9 @@ extern "C" {
 	struct _WsManConnection {
 		u_buf_t *request;
 		u_buf_t *response;
+		WsXmlDocH response_doc;	/* parsed while it was received */
+		unsigned int unbuffered;	/* keep response_doc only */
+		unsigned int unparsed;		/* keep the text only */
 	};
 	typedef struct _WsManConnection WsManConnection;
 
@@ -66,6 +69,7 @@ extern "C" {
 		char *endpoint;
 		unsigned int auth_method;
 		long auth_set;
+		int auth_guessed;	/* auth_set not confirmed by the server */
 		int status;
 	} WsManClientData;
 
@@ -120,13 +124,19 @@ extern "C" {
 		char *content_encoding;
 		char *cim_ns;
 		unsigned long transport_timeout;
+		unsigned int accept_compression;	/* send Accept-Encoding */
+		unsigned long request_compression;	/* gzip bodies from this size on */
 		char * user_agent;
 		FILE *dumpfile;
 		long initialized;
 #ifndef _WIN32
 		char *client_config_file;
 #endif
-
+		unsigned long round_trips;	/* HTTP responses received */
+		unsigned long tls_handshakes;	/* TLS connections set up */
+		unsigned long tls_resumptions;	/* of these, resumed sessions */
+		int tls_reused;		/* the last connection resumed one */
+		char *response_charset;	/* of the last response, if given */
 	};
 
 
@@ -135,6 +145,10 @@ extern "C" {
 	int wsmc_lock(WsManClient * cl);
 	void wsmc_unlock(WsManClient * cl);
 
+#ifndef _WIN32
+	dictionary *wsmc_get_conf(WsManClient *cl);
+#endif
+
 
 #ifdef __cplusplus
 }
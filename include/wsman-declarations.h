@@ -91,6 +91,12 @@ extern "C" {
   { WS_DISP_TYPE_ENUMERATE, NULL, NULL, ENUM_ACTION_ENUMERATE, NULL, \
       t##_TypeInfo, (WsProcType)t##_Enumerate_EP, ns, NULL}
 
+/* an Enumerate endpoint which evaluates XPath filters */
+#define END_POINT_ENUMERATE_XPATH(t, ns)                             \
+  { WS_DISP_TYPE_ENUMERATE | WS_DISP_XPATH_FILTER, NULL, NULL,       \
+      ENUM_ACTION_ENUMERATE, NULL,                                   \
+      t##_TypeInfo, (WsProcType)t##_Enumerate_EP, ns, NULL}
+
 #define END_POINT_RELEASE(t, ns)                                  \
   { WS_DISP_TYPE_RELEASE, NULL, NULL, ENUM_ACTION_RELEASE, NULL,  \
       t##_TypeInfo, (WsProcType)t##_Release_EP, ns, NULL}
@@ -103,6 +109,10 @@ extern "C" {
   { WS_DISP_TYPE_DIRECT_PULL, NULL, NULL, ENUM_ACTION_PULL, NULL, \
       t##_TypeInfo, (WsProcType)t##_Pull_EP, ns, NULL}    
 
+#define END_POINT_STREAM_PULL(t, ns)                              \
+  { WS_DISP_TYPE_STREAM_PULL, NULL, NULL, ENUM_ACTION_PULL, NULL, \
+      t##_TypeInfo, (WsProcType)t##_PullStream_EP, ns, NULL}
+
 #define END_POINT_SUBSCRIBE(t,ns)	\
 {WS_DISP_TYPE_SUBSCRIBE,NULL,NULL,EVT_ACTION_SUBSCRIBE, NULL, \
  	t##_TypeInfo,(WsProcType)t##_Subscribe_EP,ns,NULL}
@@ -71,6 +71,10 @@ struct __op_t {
 	//not deleted on destroy
 	WsmanMessage *data;
 	list_t *processed_headers;
+	//request scoped allocations, released on destroy
+	u_arena_t *arena;
+	//response already written to data->response
+	int streamed;
 };
 typedef struct __op_t op_t;
 
@@ -82,6 +86,8 @@ SoapDispatchH wsman_dispatcher(WsContextH cntx, void *data, WsXmlDocH doc);
 
 void destroy_op_entry(op_t * entry);
 
+int dispatch_outbound_filters(op_t * op, void *opaqueData);
+
 op_t *create_op_entry(SoapH soap, SoapDispatchH dispatch,
 		      WsmanMessage * data);
 
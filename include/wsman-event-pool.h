@@ -83,6 +83,7 @@ struct __EventPoolOpSet {
 typedef struct __EventPoolOpSet *EventPoolOpSetH;
 
 EventPoolOpSetH wsman_get_eventpool_opset(void);
+long wsman_event_pool_depth(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#ifndef WSMAN_METRICS_H_
+#define WSMAN_METRICS_H_
+
+#include "u/buf.h"
+#include "wsman-soap.h"
+
+/*
+ * Operational counters of the server, in the Prometheus text format.
+ *
+ * Every thread counts into a block of its own, so counting takes no
+ * lock; only the first request of a thread for an Action and ResourceURI
+ * registers the pair. Collecting adds the blocks up and reads the
+ * gauges, without taking the lock of the SOAP runtime.
+ */
+
+typedef enum {
+	WSMAN_METRIC_COUNTER,
+	WSMAN_METRIC_GAUGE
+} WsmanMetricType;
+
+typedef double (*WsmanMetricFn) (void *data);
+
+int wsman_metrics_init(SoapH soap);
+int wsman_metrics_enabled(void);
+int wsman_metrics_add(const char *name, const char *help,
+		WsmanMetricType type, WsmanMetricFn fn, void *data);
+
+void wsman_metrics_request(WsmanFaultCodeType fault,
+		unsigned long long ns);
+void wsman_metrics_auth(int authorized);
+
+int wsman_metrics_collect(u_buf_t *buf);
+
+#endif /* WSMAN_METRICS_H_ */
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#ifndef WSMAN_PLUGIN_HOST_H_
+#define WSMAN_PLUGIN_HOST_H_
+
+#include "wsman-soap.h"
+#include "wsman-plugins.h"
+
+/*
+ * Runs the endpoints of selected plugins in child processes.
+ *
+ * The daemon still loads every plugin to learn its endpoints, but the
+ * requests for a hosted plugin are passed, as they came in, to one of
+ * its host processes through shared memory and answered from there.
+ * The hosts are forked from a supervisor process which restarts them
+ * when they die; a request a host does not answer in time gets the
+ * host killed. Enumerations stay with the host that started them.
+ *
+ * A request is forwarded on the thread that serves it, and wsmand
+ * serves all requests on the one thread of its shttpd_poll() loop. A
+ * crashing host costs one request, but a hanging one holds up every
+ * request, of any plugin, until plugin_host_timeout (5 seconds by
+ * default) kills it. For the same reason only one host of a plugin is
+ * busy at a time: more than one process per plugin spreads the
+ * enumerations over them, it does not run requests in parallel.
+ *
+ * The hosts are forked before the daemon sets up tracing and metrics
+ * and keep neither. The daemon counts a hosted request, with the fault
+ * the host answered, and traces the call to the host as its endpoint
+ * stage.
+ *
+ * [server]
+ * plugin_host = <plugin file>=<processes>,...
+ * plugin_host_timeout = <seconds>
+ * plugin_host_buffer = <KiB per process>
+ */
+
+int wsman_plugin_host_start(WsContextH cntx, WsManListenerH *listener);
+void wsman_plugin_host_stop(void);
+
+#endif /* WSMAN_PLUGIN_HOST_H_ */
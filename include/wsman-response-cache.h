@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#ifndef WSMAN_RESPONSE_CACHE_H_
+#define WSMAN_RESPONSE_CACHE_H_
+
+#include "wsman-xml-api.h"
+#include "wsman-soap-message.h"
+
+/*
+ * Cache of Get and Identify responses in the dispatcher.
+ *
+ * Caching is set up per ResourceURI, as "<ResourceURI>=<seconds>,..."
+ * in [server] response_cache; a URI ending in '*' matches all URIs it
+ * is the start of, "identify" stands for Identify requests. Responses
+ * are looked up by the ResourceURI, selectors, options, charset and
+ * FragmentTransfer of the request and the authenticated user. Only
+ * responses without a fault are kept, as the serialized envelope, and
+ * replayed with a new MessageID and the MessageID of the request in
+ * RelatesTo. Any other request to the same ResourceURI and selectors,
+ * a Put, Delete, Create or custom method, drops what is cached for
+ * them. Requests with a selector holding an EPR are not cached.
+ */
+
+typedef struct _WsmanResponseCacheMiss WsmanResponseCacheMiss;
+
+int wsman_response_cache_init(const char *spec, int size);
+int wsman_response_cache_enabled(void);
+void wsman_response_cache_shutdown(void);
+
+/*
+ * Answer the request from the cache into msg->response.
+ * @return 1 on a hit; otherwise 0 and in *miss what the dispatcher
+ * hands to wsman_response_cache_store() once the endpoint answered
+ */
+int wsman_response_cache_replay(WsXmlDocH in_doc, WsmanMessage *msg,
+		unsigned long maxsize, WsmanResponseCacheMiss **miss);
+/* keep the response in msg->response for miss; frees miss */
+void wsman_response_cache_store(WsmanResponseCacheMiss *miss,
+		WsmanMessage *msg, WsXmlDocH out_doc);
+
+void wsman_response_cache_flush(void);
+void wsman_response_cache_get_stats(unsigned long *hits,
+		unsigned long *misses);
+
+#endif /* WSMAN_RESPONSE_CACHE_H_ */
@@ -41,6 +41,7 @@ extern "C" {
 #include "u/buf.h"
 #include "u/hash.h"
 #include "wsman-faults.h"
+#include "wsman-trace.h"
 
 #define FLAG_IDENTIFY_REQUEST    1
 
@@ -68,6 +69,7 @@ struct _WsmanMessage {
   WsmanAuth           auth_data;
   unsigned int        flags;
   hash_t     *http_headers;
+  WsmanTrace          *trace;	/* owned by the listener */
 };
 typedef struct _WsmanMessage WsmanMessage;
 
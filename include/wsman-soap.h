@@ -40,6 +40,7 @@
 
 #include "u/hash.h"
 #include "u/list.h"
+#include "u/arena.h"
 #include "wsman-faults.h"
 #include "wsman-soap-message.h"
 #include "wsman-xml-api.h"
@@ -74,6 +75,7 @@
 #define WS_DISP_TYPE_IDENTIFY           17
 #define WS_DISP_TYPE_DIRECT_CREATE           18
 #define WS_DISP_TYPE_DIRECT_DELETE           19
+#define WS_DISP_TYPE_STREAM_PULL            20
 #define WS_DISP_TYPE_ENUM_REFINSTS           21
 #define WS_DISP_TYPE_SUBSCRIBE		22
 #define WS_DISP_TYPE_UNSUBSCRIBE		23
@@ -82,6 +84,9 @@
 #define WS_DISP_TYPE_ACK				26
 #define WS_DISP_TYPE_PRIVATE                0xfffe
 
+/* endpoint capabilities, above WS_DISP_TYPE_MASK */
+#define WS_DISP_XPATH_FILTER		0x10000
+
 
 
 struct __dispatch_t;
@@ -140,6 +145,8 @@ struct _WS_CONTEXT {
 	list_t         	*subscriptionMemList; //memory Repository of Subscriptions
 	/* to prevent user from destroying cntx he hasn't created */
 	int             owner;
+	/* request arena the context lives in, NULL for heap contexts */
+	u_arena_t       *arena;
 };
 
 typedef struct __WsSubscribeInfo WsSubscribeInfo;
@@ -218,6 +225,12 @@ typedef int     (*WsEndPointEnumerate) (WsContextH, WsEnumerateInfo *, WsmanStat
 
 typedef int     (*WsEndPointPull) (WsContextH, WsEnumerateInfo *, WsmanStatus *, void *);
 
+/* items of a streamed PullResponse, see wsman_pull_writer_add_item() */
+struct __WsPullWriter;
+typedef struct __WsPullWriter *WsPullWriterH;
+
+typedef int     (*WsEndPointPullStream) (WsContextH, WsEnumerateInfo *, WsPullWriterH, WsmanStatus *, void *);
+
 typedef int     (*WsEndPointRelease) (WsContextH, WsEnumerateInfo *, WsmanStatus *, void *);
 
 typedef int     (*WsEndPointPut) (WsContextH, void *, void **, WsmanStatus *, void *);
@@ -252,6 +265,8 @@ typedef int (*WsEndPointSubscriptionCancel) (WsEventThreadContextH);
 #define WSMAN_ENUMINFO_SELECTOR		  0x200000
 #define WSMAN_ENUMINFO_CIM_CONTEXT_CLEANUP 0x400000
 #define WSMAN_ENUMINFO_XPATH              0x800000
+/* the endpoint applies XPath filters itself, see WS_DISP_XPATH_FILTER */
+#define WSMAN_ENUMINFO_XPATH_CAPABLE      0x1000000
 
 struct __WsEnumerateInfo {
 	unsigned long flags;
@@ -405,6 +420,14 @@ int wsenum_pull_stub(SoapOpH op, void *appData, void *opaqueData);
 
 int wsenum_pull_direct_stub(SoapOpH op, void *appData, void *opaqueData);
 
+int wsenum_pull_stream_stub(SoapOpH op, void *appData, void *opaqueData);
+
+int wsman_pull_writer_add_item(WsPullWriterH writer, WsXmlNodeH item);
+
+int wsman_pull_writer_is_full(WsPullWriterH writer);
+
+int wsman_pull_writer_get_count(WsPullWriterH writer);
+
 int wsenum_release_stub(SoapOpH op, void *appData, void *opaqueData);
 
 int wse_subscribe_stub(SoapOpH op, void *appData, void *opaqueData);
@@ -425,6 +448,7 @@ soap_create_op(SoapH soap,
 	       unsigned long flags);
 void            soap_destroy_op(SoapOpH op);
 WsXmlDocH       soap_get_op_doc(SoapOpH op, int inbound);
+u_arena_t      *soap_get_op_arena(SoapOpH op);
 WsXmlDocH       soap_detach_op_doc(SoapOpH op, int inbound);
 int             soap_set_op_doc(SoapOpH op, WsXmlDocH doc, int inbound);
 SoapH           soap_get_op_soap(SoapOpH op);
@@ -439,6 +463,10 @@ WsContextH      ws_create_runtime(list_t * interfaces);
 
 WsContextH      ws_create_ep_context(SoapH soap, WsXmlDocH doc);
 
+WsContextH      ws_create_arena_context(SoapH soap, u_arena_t *arena);
+
+WsContextH      ws_create_op_context(SoapOpH op);
+
 WsContextH      ws_get_soap_context(SoapH soap);
 
 int             ws_destroy_context(WsContextH hCntx);
@@ -468,6 +496,8 @@ int             wsman_fault_occured(WsmanMessage * msg);
 WsmanKnownStatusCode wsman_find_httpcode_for_value(WsXmlDocH doc);
 
 WsmanKnownStatusCode wsman_find_httpcode_for_fault_code(WsmanFaultCodeType faultCode);
+const char *wsman_fault_name(WsmanFaultCodeType faultCode);
+WsmanFaultCodeType wsman_fault_code_for_name(const char *name);
 
 
 WsXmlDocH
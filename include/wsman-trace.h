@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#ifndef WSMAN_TRACE_H_
+#define WSMAN_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "wsman-xml-api.h"
+
+/*
+ * Timing of requests through the server.
+ *
+ * The listener starts a trace when a request comes in and hands it to the
+ * dispatcher on the WsmanMessage. Every stage adds the time it took to the
+ * trace; plugins find the trace of the request they are working on with
+ * wsman_trace_current(). When the response is sent the trace is added to
+ * the histogram of its ResourceURI and Action, logged, and, for a sample
+ * of requests, written to a trace event file which chrome://tracing or
+ * Perfetto can load.
+ *
+ * With tracing off all functions taking a trace accept NULL and return
+ * right away.
+ */
+
+typedef enum {
+	WSMAN_TRACE_RECEIVE = 0,	/* reading the HTTP request */
+	WSMAN_TRACE_PARSE,		/* building the inbound envelope */
+	WSMAN_TRACE_FILTERS_IN,		/* inbound filters */
+	WSMAN_TRACE_ENDPOINT,		/* plugin endpoint */
+	WSMAN_TRACE_CIMOM,		/* calls into the CIMOM, part of the endpoint */
+	WSMAN_TRACE_FILTERS_OUT,	/* outbound filters */
+	WSMAN_TRACE_SERIALIZE,		/* dumping the response document */
+	WSMAN_TRACE_SEND,		/* writing the HTTP response */
+	WSMAN_TRACE_STAGES
+} WsmanTraceStage;
+
+/* bucket i counts requests taking less than 2^i microseconds, the last
+ * one all slower requests */
+#define WSMAN_TRACE_BUCKETS 28
+
+typedef struct _WsmanTrace WsmanTrace;
+
+typedef struct _WsmanTraceHistogram {
+	const char *resource_uri;
+	const char *action;
+	unsigned long count;
+	unsigned long long total_ns;
+	unsigned long long max_ns;
+	unsigned long long stage_ns[WSMAN_TRACE_STAGES];
+	unsigned long buckets[WSMAN_TRACE_BUCKETS];
+} WsmanTraceHistogram;
+
+typedef void (*WsmanTraceHistogramFn) (const WsmanTraceHistogram *h,
+		void *user_data);
+
+int wsman_trace_init(int log_records, const char *trace_file,
+		int sample_rate);
+void wsman_trace_shutdown(void);
+int wsman_trace_enabled(void);
+
+unsigned long long wsman_trace_now(void);
+const char *wsman_trace_stage_name(WsmanTraceStage stage);
+
+WsmanTrace *wsman_trace_new(unsigned long long start);
+void wsman_trace_free(WsmanTrace *trace);
+void wsman_trace_set_request(WsmanTrace *trace, WsXmlDocH doc);
+unsigned long long wsman_trace_begin(WsmanTrace *trace);
+void wsman_trace_end(WsmanTrace *trace, WsmanTraceStage stage,
+		unsigned long long begin);
+void wsman_trace_finish(WsmanTrace *trace, int http_code);
+
+void wsman_trace_set_current(WsmanTrace *trace);
+WsmanTrace *wsman_trace_current(void);
+
+void wsman_trace_foreach_histogram(WsmanTraceHistogramFn fn,
+		void *user_data);
+unsigned long long wsman_trace_histogram_quantile(const WsmanTraceHistogram *h,
+		double q);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* WSMAN_TRACE_H_ */
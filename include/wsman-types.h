@@ -68,6 +68,15 @@ struct __WsXmlNs
 };
 typedef struct __WsXmlNs* WsXmlNsH;
 
+struct __WsXmlWriter;
+typedef struct __WsXmlWriter* WsXmlWriterH;
+
+struct __WsXmlReader;
+typedef struct __WsXmlReader* WsXmlReaderH;
+
+struct __WsXmlPushParser;
+typedef struct __WsXmlPushParser* WsXmlPushParserH;
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -41,6 +41,7 @@ extern "C" {
 
 #include <stdio.h>
 
+#include "u/buf.h"
 #include "wsman-types.h"
 
 
@@ -110,6 +111,48 @@ void ws_xml_dump_doc(FILE * f, WsXmlDocH doc);
 void ws_xml_dump_memory_enc(WsXmlDocH doc, char **buf, int *ptrSize,
 			    const char *encoding);
 
+	// Streaming output
+
+/* non-indented, written to out as it is produced */
+WsXmlWriterH ws_xml_writer_new(u_buf_t *out, const char *encoding);
+
+void ws_xml_writer_destroy(WsXmlWriterH w);
+
+int ws_xml_writer_start_node(WsXmlWriterH w, WsXmlNodeH node);
+
+int ws_xml_writer_end_node(WsXmlWriterH w);
+
+int ws_xml_writer_add_node(WsXmlWriterH w, WsXmlNodeH node, size_t limit);
+
+size_t ws_xml_writer_offset(WsXmlWriterH w);
+
+int ws_xml_writer_end(WsXmlWriterH w);
+
+	// Streaming input
+
+/* what ws_xml_reader_next() stopped at */
+#define WS_XML_READER_ITEM	1	/* child of Items */
+#define WS_XML_READER_CONTEXT	2	/* EnumerationContext */
+#define WS_XML_READER_END	3	/* EndOfSequence */
+
+WsXmlReaderH ws_xml_reader_new(const char *buf, size_t size,
+		const char *encoding);
+
+WsXmlNodeH ws_xml_reader_next(WsXmlReaderH r, int *what);
+
+void ws_xml_reader_destroy(WsXmlReaderH r);
+
+	// Incremental parsing
+
+WsXmlPushParserH ws_xml_push_parser_new(const char *encoding);
+
+int ws_xml_push_parser_feed(WsXmlPushParserH p, const char *buf,
+		size_t size);
+
+WsXmlDocH ws_xml_push_parser_finish(WsXmlPushParserH p);
+
+void ws_xml_push_parser_destroy(WsXmlPushParserH p);
+
 	// WSXmlDoc handling
 
 WsXmlNodeH ws_xml_get_doc_root(WsXmlDocH doc);
@@ -118,6 +161,11 @@ void ws_xml_destroy_doc(WsXmlDocH doc);
 
 char *ws_xml_get_xpath_value(WsXmlDocH doc, char *expression);
 
+int ws_xml_xpath_match(WsXmlNodeH node, WsXmlNodeH ns_node,
+		const char *expression);
+
+void ws_xml_xpath_cache_stats(unsigned long *hits, unsigned long *misses);
+
 WsXmlDocH ws_xml_create_soap_envelope(void);
 
 WsXmlNodeH ws_xml_get_soap_envelope(WsXmlDocH doc);
@@ -110,12 +110,46 @@ void xml_parser_doc_dump_memory_enc(WsXmlDocH doc, char **buf, int *ptrSize, con
 
 void xml_parser_element_dump(FILE * f, WsXmlDocH doc, WsXmlNodeH node);
 
+WsXmlWriterH xml_parser_writer_new(u_buf_t *out, const char *encoding);
+
+void xml_parser_writer_free(WsXmlWriterH w);
+
+int xml_parser_writer_start_node(WsXmlWriterH w, WsXmlNodeH node);
+
+int xml_parser_writer_end_node(WsXmlWriterH w);
+
+int xml_parser_writer_node(WsXmlWriterH w, WsXmlNodeH node, size_t limit);
+
+size_t xml_parser_writer_offset(WsXmlWriterH w);
+
+int xml_parser_writer_end_doc(WsXmlWriterH w);
+
+WsXmlReaderH xml_parser_reader_new(const char *buf, size_t size,
+		const char *encoding);
+
+WsXmlNodeH xml_parser_reader_next(WsXmlReaderH r, int *what);
+
+void xml_parser_reader_free(WsXmlReaderH r);
+
+WsXmlPushParserH xml_parser_push_new(const char *encoding);
+
+int xml_parser_push_chunk(WsXmlPushParserH p, const char *buf, size_t size);
+
+WsXmlDocH xml_parser_push_end(WsXmlPushParserH p);
+
+void xml_parser_push_free(WsXmlPushParserH p);
+
 int xml_parser_check_xpath(WsXmlDocH doc, const char *xpath_expr);
 
 int xml_parser_utf8_strlen(char *buf);
 
 char *xml_parser_get_xpath_value(WsXmlDocH doc, const char *expression);
 
+int xml_parser_xpath_match(WsXmlNodeH node, WsXmlNodeH ns_node,
+		const char *expression);
+
+void xml_parser_xpath_cache_stats(unsigned long *hits, unsigned long *misses);
+
 int xml_parser_create_doc_by_import(WsXmlDocH wsDoc, WsXmlNodeH node);
 
 void xml_parser_unlink_node(WsXmlNodeH node);
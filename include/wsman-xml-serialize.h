@@ -36,6 +36,7 @@
 #ifndef WS_XML_SERIALIZATION_H
 #define WS_XML_SERIALIZATION_H
 
+#include "u/arena.h"
 #include "wsman-xml-serializer.h"
 
 
@@ -86,6 +87,8 @@ typedef struct __NameAliase NameAliase;
 
 WsSerializerContextH ws_serializer_init(void);
 
+WsSerializerContextH ws_serializer_init_arena(u_arena_t *arena);
+
 int ws_serializer_cleanup(WsSerializerContextH serctx);
 
 void* ws_serializer_alloc(WsSerializerContextH serctx, int size);
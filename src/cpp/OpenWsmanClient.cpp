@@ -30,7 +30,7 @@ static string XmlDocToString(WsXmlDocH& doc);
 static client_opt_t *SetOptions(WsManClient* cl);
 static string GetSubscribeContext(WsXmlDocH& doc);
 static string ExtractPayload(WsXmlDocH& doc);
-static string ExtractItems(WsXmlDocH& doc);
+static void ExtractItems(WsmanDocument& page, vector<string> &enumRes);
 
 // Construct from params.
 
@@ -92,6 +92,16 @@ string OpenWsmanClient::Identify() const
 	return xml;
 }
 
+void OpenWsmanClient::Identify(WsmanDocument &response) const
+{
+	WsmanOptions options;
+	options.setNamespace(GetNamespace());
+
+	WsXmlDocH doc = wsmc_action_identify(cl, options);
+	CheckWsmanResponse(cl, doc);
+	response.Reset(doc);
+}
+
 string OpenWsmanClient::Create(const string &resourceUri, const string &data) const
 {
 	WsmanOptions options;
@@ -133,20 +143,19 @@ void OpenWsmanClient::Enumerate(
 	if(ResourceNotFound(cl, enum_response))
 		throw WsmanResourceNotFound(resourceUri.c_str());
 
+	// an optimized Enumerate response brings the first items along
+	WsmanDocument page(enum_response);
+	ExtractItems(page, enumRes);
 	enumContext = wsmc_get_enum_context(enum_response);
-	ws_xml_destroy_doc(enum_response);
 
 	while (enumContext != NULL && enumContext[0] != 0 ) {
 		doc = wsmc_action_pull(cl, resourceUri.c_str(), options, NULL, enumContext);
-		CheckWsmanResponse(cl, doc);
-		string payload = ExtractItems(doc);
-
-		if (payload.length() > 0)
-			enumRes.push_back(payload);
-
 		wsmc_free_enum_context(enumContext);
+		enumContext = NULL;
+		CheckWsmanResponse(cl, doc);
+		page.Reset(doc);
+		ExtractItems(page, enumRes);
 		enumContext = wsmc_get_enum_context(doc);
-		ws_xml_destroy_doc(doc);
 	}
 
 	wsmc_free_enum_context(enumContext);
@@ -175,6 +184,111 @@ void OpenWsmanClient::Enumerate(
 	Enumerate(resourceUri, enumRes, options, filter);
 }
 
+#ifndef _WIN32
+EnumerationItems::EnumerationItems(
+	const OpenWsmanClient &client,
+	const string &resourceUri,
+	const WsmanOptions &options)
+	: cl(client.cl), stream(NULL), current(NULL), xml(NULL), started(false)
+{
+	Open(resourceUri, options, NULL);
+}
+
+EnumerationItems::EnumerationItems(
+	const OpenWsmanClient &client,
+	const string &resourceUri,
+	const WsmanOptions &options,
+	const WsmanFilter &filter)
+	: cl(client.cl), stream(NULL), current(NULL), xml(NULL), started(false)
+{
+	Open(resourceUri, options, filter);
+}
+
+EnumerationItems::~EnumerationItems()
+{
+	wsmc_enum_stream_close(stream);
+	u_free(xml);
+}
+
+void EnumerationItems::Open(
+	const string &resourceUri,
+	const WsmanOptions &options,
+	filter_t *filter)
+{
+	stream = wsmc_enum_stream_open(cl, resourceUri.c_str(), options, filter);
+	if (!stream) {
+		WsXmlDocH doc = NULL;
+		CheckWsmanResponse(cl, doc);
+	}
+}
+
+void EnumerationItems::Next()
+{
+	started = true;
+	current = wsmc_enum_stream_next(stream);
+	if (!current && wsmc_enum_stream_failed(stream)) {
+		WsXmlDocH doc = wsmc_build_envelope_from_response(cl);
+		CheckWsmanResponse(cl, doc);
+		ws_xml_destroy_doc(doc);
+		throw WsmanClientException("Could not read the enumeration response.");
+	}
+}
+
+EnumerationItems::iterator EnumerationItems::begin()
+{
+	if (!started)
+		Next();
+	return iterator(current ? this : NULL);
+}
+
+EnumerationItems::iterator EnumerationItems::end()
+{
+	return iterator();
+}
+
+string EnumerationItems::iterator::operator *() const
+{
+	char *buf = NULL;
+	wsmc_node_to_buf(items->current, &buf);
+	string payload = string(buf);
+	u_free(buf);
+	return payload;
+}
+
+WsXmlNodeH EnumerationItems::iterator::node() const
+{
+	return items->current;
+}
+
+WsmanNode EnumerationItems::iterator::item() const
+{
+	return WsmanNode(items->current);
+}
+
+WsmanText EnumerationItems::iterator::xml() const
+{
+	return NodeToXml(items->current, &items->xml);
+}
+
+EnumerationItems::iterator& EnumerationItems::iterator::operator ++()
+{
+	items->Next();
+	if (!items->current)
+		items = NULL;
+	return *this;
+}
+
+bool EnumerationItems::iterator::operator ==(const iterator &rhs) const
+{
+	return items == rhs.items;
+}
+
+bool EnumerationItems::iterator::operator !=(const iterator &rhs) const
+{
+	return items != rhs.items;
+}
+#endif
+
 string OpenWsmanClient::Get(
 	const string &resourceUri,
 	const WsmanOptions &options) const
@@ -197,6 +311,16 @@ string OpenWsmanClient::Get(
 	return Get(resourceUri, options);
 }
 
+void OpenWsmanClient::Get(
+	const string &resourceUri,
+	const WsmanOptions &options,
+	WsmanDocument &response) const
+{
+	WsXmlDocH doc = wsmc_action_get(cl, resourceUri.c_str(), options);
+	CheckWsmanResponse(cl, doc);
+	response.Reset(doc);
+}
+
 string OpenWsmanClient::Put(
 	const string &resourceUri,
 	const string &content,
@@ -220,6 +344,24 @@ string OpenWsmanClient::Put(
 	return xml;
 }
 
+void OpenWsmanClient::Put(
+	const string &resourceUri,
+	const string &content,
+	const WsmanOptions &options,
+	WsmanDocument &response) const
+{
+	WsXmlDocH doc = wsmc_action_put_fromtext(
+		cl,
+		resourceUri.c_str(),
+		options,
+		content.c_str(),
+		content.length(),
+		WSMAN_ENCODING);
+
+	CheckWsmanResponse(cl, doc);
+	response.Reset(doc);
+}
+
 string OpenWsmanClient::Invoke(
 	const string &resourceUri,
 	const string &methodName,
@@ -272,6 +414,36 @@ string OpenWsmanClient::Invoke(
 	return Invoke(resourceUri, methodName, content, options);
 }
 
+void OpenWsmanClient::Invoke(
+	const string &resourceUri,
+	const string &methodName,
+	const string &content,
+	const WsmanOptions &options,
+	WsmanDocument &response) const
+{
+	WsXmlDocH doc;
+
+	if (content.empty())
+		doc = wsmc_action_invoke(
+			cl,
+			resourceUri.c_str(),
+			options,
+			methodName.c_str(),
+			NULL);
+	else
+		doc = wsmc_action_invoke_fromtext(
+			cl,
+			resourceUri.c_str(),
+			options,
+			const_cast<char*>(methodName.c_str()),
+			content.c_str(),
+			content.length(),
+			WSMAN_ENCODING);
+
+	CheckWsmanResponse(cl, doc);
+	response.Reset(doc);
+}
+
 string OpenWsmanClient::Subscribe(
 	const string &resourceUri,
 	const SubscribeInfo &info,
@@ -376,20 +548,13 @@ string ExtractPayload(WsXmlDocH& doc)
 	return payload;
 }
 
-string ExtractItems(WsXmlDocH& doc)
+void ExtractItems(WsmanDocument& page, vector<string> &enumRes)
 {
-	string payload;
-	WsXmlNodeH bodyNode = ws_xml_get_soap_body(doc);
-	WsXmlNodeH pullResponse = ws_xml_get_child(bodyNode, 0, XML_NS_ENUMERATION, WSENUM_PULL_RESP);
-	WsXmlNodeH itemsNode = ws_xml_get_child(pullResponse, 0, XML_NS_ENUMERATION, WSENUM_ITEMS);
-	WsXmlNodeH n = ws_xml_get_child(itemsNode, 0 , NULL, NULL );
-	if (n) {
-		char *buf = NULL;
-		wsmc_node_to_buf( n, &buf);
-		payload = string(buf);
-		u_free(buf);
-	}
-	return payload;
+	WsmanNodeRange items = page.Items();
+	WsmanNodeRange::iterator i;
+
+	for (i = items.begin(); i != items.end(); ++i)
+		enumRes.push_back(page.Xml(*i).str());
 }
 
 string XmlDocToString(WsXmlDocH& doc) {
@@ -12,11 +12,15 @@
 #ifndef __OPEN_WSMAN_CLIENT_H
 #define __OPEN_WSMAN_CLIENT_H
 
+#include <cstddef>
+#include <iterator>
 #include "WsmanClient.h"
+#include "WsmanDocument.h"
 
 struct _WsManClient;
 typedef struct _WsManClient WsManClient; // FW declaration of struct
 struct WsManClientData;
+struct _WsManEnumStream;
 
 namespace WsmanClientNamespace
 {
@@ -28,6 +32,7 @@ namespace WsmanClientNamespace
 			OpenWsmanClient(const OpenWsmanClient& cl);
 			// operator = is declared private
 			OpenWsmanClient& operator =(const OpenWsmanClient& cl);
+			friend class EnumerationItems;
 		public:
 			// Construct from params.
 			OpenWsmanClient(
@@ -65,13 +70,14 @@ namespace WsmanClientNamespace
 
 			// Identify.
 			string Identify() const;
+			void Identify(WsmanDocument &response) const;
 
 			// Delete a resource.
 			void Delete(
 				const string &resourceUri,
 				const NameValuePairs *s = NULL) const;
 
-			// Enumerate resource.
+			// Enumerate resource, one string per item.
 			void Enumerate(
 				const string &resourceUri,
 				vector<string> &enumRes,
@@ -93,12 +99,21 @@ namespace WsmanClientNamespace
 			string Get(
 				const string &resourceUri,
 				const NameValuePairs *s = NULL) const;
+			void Get(
+				const string &resourceUri,
+				const WsmanOptions &options,
+				WsmanDocument &response) const;
 
 			// Update a resource.
 			string Put(
 				const string &resourceUri,
 				const string &content,
 				const NameValuePairs *s = NULL) const;
+			void Put(
+				const string &resourceUri,
+				const string &content,
+				const WsmanOptions &options,
+				WsmanDocument &response) const;
 
 			// Invokes a method and returns the results of the method call.
 			string Invoke(
@@ -115,6 +130,12 @@ namespace WsmanClientNamespace
 				const string &methodName,
 				const string &content,
 				const NameValuePairs *s = NULL) const;
+			void Invoke(
+				const string &resourceUri,
+				const string &methodName,
+				const string &content,
+				const WsmanOptions &options,
+				WsmanDocument &response) const;
 
 			// Submit a subscription
 			string Subscribe(
@@ -175,5 +196,73 @@ namespace WsmanClientNamespace
 				const string &key);
 #endif
 	};
+
+#ifndef _WIN32
+	// Items of an enumeration, read one at a time while the next Pull is
+	// already on its way; the items of an optimized Enumerate response
+	// come first. options and filter must outlive the object.
+	//
+	//	EnumerationItems items(client, resourceUri, options);
+	//	for (EnumerationItems::iterator i = items.begin();
+	//	     i != items.end(); ++i)
+	//		use(*i);
+	class EnumerationItems
+	{
+		private:
+			WsManClient* cl;
+			struct _WsManEnumStream* stream;
+			WsXmlNodeH current;
+			char *xml;
+			bool started;
+			// Copy constructor is declared private
+			EnumerationItems(const EnumerationItems& items);
+			// operator = is declared private
+			EnumerationItems& operator =(const EnumerationItems& items);
+			void Open(const string &resourceUri,
+				const WsmanOptions &options, filter_t *filter);
+			void Next();
+		public:
+			class iterator
+			{
+				private:
+					EnumerationItems* items;
+				public:
+					typedef std::input_iterator_tag iterator_category;
+					typedef string value_type;
+					typedef ptrdiff_t difference_type;
+					typedef const string* pointer;
+					typedef string reference;
+
+					iterator(EnumerationItems* items = NULL) : items(items) {}
+					// Current item as XML text.
+					string operator *() const;
+					// Current item, valid until the iterator moves.
+					WsXmlNodeH node() const;
+					WsmanNode item() const;
+					// Current item as XML text, valid until the
+					// iterator moves.
+					WsmanText xml() const;
+					iterator& operator ++();
+					bool operator ==(const iterator &rhs) const;
+					bool operator !=(const iterator &rhs) const;
+			};
+
+			EnumerationItems(
+				const OpenWsmanClient &client,
+				const string &resourceUri,
+				const WsmanOptions &options);
+			EnumerationItems(
+				const OpenWsmanClient &client,
+				const string &resourceUri,
+				const WsmanOptions &options,
+				const WsmanFilter &filter);
+			// Releases the enumeration if it was not read to the end.
+			~EnumerationItems();
+
+			// Items can be iterated once.
+			iterator begin();
+			iterator end();
+	};
+#endif
 } // namespace WsmanClient
 #endif
@@ -0,0 +1,161 @@
+//----------------------------------------------------------------------------
+//
+//  Copyright (C) Red Hat, Inc., 2015.
+//
+//  File:       WsmanDocument.cpp
+//
+//  License:    BSD-3-Clause
+//
+//  Contents:   Read access to WS-Management responses without copying
+//
+//----------------------------------------------------------------------------
+
+#include "WsmanDocument.h"
+
+extern "C" {
+#include "u/libu.h"
+#include "wsman-api.h"
+#include "wsman-xml.h"
+#include "wsman-xml-binding.h"
+}
+
+using namespace WsmanClientNamespace;
+
+WsmanText WsmanNode::Name() const
+{
+	return WsmanText(node ? ws_xml_get_node_local_name(node) : NULL);
+}
+
+WsmanText WsmanNode::Namespace() const
+{
+	return WsmanText(node ? ws_xml_get_node_name_ns(node) : NULL);
+}
+
+WsmanText WsmanNode::Text() const
+{
+	// the text is kept with the node once it was asked for
+	return WsmanText(ws_xml_get_node_text(node));
+}
+
+WsmanText WsmanNode::Attribute(const char *name, const char *ns) const
+{
+	return WsmanText(node ? ws_xml_find_attr_value(node, ns, name) : NULL);
+}
+
+WsmanNode WsmanNode::Child(const char *name, const char *ns) const
+{
+	return WsmanNode(ws_xml_get_child(node, 0, ns, name));
+}
+
+WsmanNodeRange WsmanNode::Children() const
+{
+	return WsmanNodeRange(node ? xml_parser_get_first_child(node) : NULL);
+}
+
+WsmanNodeRange::iterator& WsmanNodeRange::iterator::operator ++()
+{
+	node = xml_parser_get_next_child(node);
+	return *this;
+}
+
+WsmanNodeRange::iterator WsmanNodeRange::iterator::operator ++(int)
+{
+	iterator old = *this;
+	++*this;
+	return old;
+}
+
+WsmanDocument::WsmanDocument(WsXmlDocH doc)
+	: doc(doc), xml(NULL)
+{
+}
+
+WsmanDocument::~WsmanDocument()
+{
+	Reset();
+}
+
+#if __cplusplus >= 201103L
+WsmanDocument::WsmanDocument(WsmanDocument &&other) noexcept
+	: doc(other.doc), xml(other.xml)
+{
+	other.doc = NULL;
+	other.xml = NULL;
+}
+
+WsmanDocument &WsmanDocument::operator =(WsmanDocument &&rhs) noexcept
+{
+	if (this != &rhs) {
+		Reset();
+		Swap(rhs);
+	}
+	return *this;
+}
+#endif
+
+void WsmanDocument::Reset(WsXmlDocH newDoc)
+{
+	u_free(xml);
+	xml = NULL;
+	if (doc && doc != newDoc)
+		ws_xml_destroy_doc(doc);
+	doc = newDoc;
+}
+
+WsXmlDocH WsmanDocument::Release()
+{
+	WsXmlDocH ret = doc;
+
+	doc = NULL;
+	Reset();
+	return ret;
+}
+
+void WsmanDocument::Swap(WsmanDocument &other)
+{
+	WsXmlDocH d = doc;
+	char *x = xml;
+
+	doc = other.doc;
+	xml = other.xml;
+	other.doc = d;
+	other.xml = x;
+}
+
+WsmanNode WsmanDocument::Header() const
+{
+	return WsmanNode(doc ? ws_xml_get_soap_header(doc) : NULL);
+}
+
+WsmanNode WsmanDocument::Body() const
+{
+	return WsmanNode(doc ? ws_xml_get_soap_body(doc) : NULL);
+}
+
+WsmanNode WsmanDocument::Payload() const
+{
+	return Body().Child();
+}
+
+WsmanNodeRange WsmanDocument::Items() const
+{
+	// wsen:Items of a Pull response, wsman:Items of an optimized
+	// Enumerate response
+	WsmanNode items = Body().Child().Child(WSENUM_ITEMS);
+
+	return items.Children();
+}
+
+WsmanText WsmanDocument::Xml(WsXmlNodeH node)
+{
+	return NodeToXml(node, &xml);
+}
+
+WsmanText WsmanClientNamespace::NodeToXml(WsXmlNodeH node, char **buf)
+{
+	u_free(*buf);
+	*buf = NULL;
+	if (node)
+		wsmc_node_to_buf(node, buf);
+	return WsmanText(*buf);
+}
@@ -0,0 +1,182 @@
+//----------------------------------------------------------------------------
+//
+//  Copyright (C) Red Hat, Inc., 2015.
+//
+//  File:       WsmanDocument.h
+//
+//  License:    BSD-3-Clause
+//
+//  Contents:   Read access to WS-Management responses without copying
+//
+//----------------------------------------------------------------------------
+
+#ifndef __WSMAN_DOCUMENT_H
+#define __WSMAN_DOCUMENT_H
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+extern "C" {
+#include "wsman-xml-api.h"
+}
+
+using namespace std;
+
+namespace WsmanClientNamespace {
+
+	// Characters owned by a document, valid as long as the document.
+	// data() is always '\0' terminated.
+	class WsmanText
+	{
+		private:
+			const char *ptr;
+			size_t len;
+
+		public:
+			WsmanText() : ptr(""), len(0) {}
+			WsmanText(const char *s)
+				: ptr(s ? s : ""), len(s ? strlen(s) : 0) {}
+
+			const char *data() const { return ptr; }
+			size_t size() const { return len; }
+			bool empty() const { return len == 0; }
+			const char *begin() const { return ptr; }
+			const char *end() const { return ptr + len; }
+
+			// Copy, for keeping the text past the document.
+			string str() const { return string(ptr, len); }
+
+			bool operator ==(const WsmanText &rhs) const
+			{
+				return len == rhs.len &&
+					memcmp(ptr, rhs.ptr, len) == 0;
+			}
+			bool operator !=(const WsmanText &rhs) const
+			{
+				return !(*this == rhs);
+			}
+#if __cplusplus >= 201703L
+			operator std::string_view() const
+			{
+				return std::string_view(ptr, len);
+			}
+#endif
+	};
+
+	class WsmanNodeRange;
+
+	// An element of a document, NULL if a lookup found nothing.
+	class WsmanNode
+	{
+		private:
+			WsXmlNodeH node;
+
+		public:
+			WsmanNode(WsXmlNodeH node = NULL) : node(node) {}
+
+			WsmanText Name() const;
+			WsmanText Namespace() const;
+			WsmanText Text() const;
+			WsmanText Attribute(const char *name,
+				const char *ns = NULL) const;
+
+			// First child with that name, any name if NULL.
+			WsmanNode Child(const char *name = NULL,
+				const char *ns = NULL) const;
+			WsmanNodeRange Children() const;
+
+			WsXmlNodeH getNode() const { return node; }
+			operator WsXmlNodeH() const { return node; }
+	};
+
+	// Element children of a node, walked as they are iterated.
+	class WsmanNodeRange
+	{
+		private:
+			WsXmlNodeH first;
+
+		public:
+			class iterator
+			{
+				private:
+					WsXmlNodeH node;
+				public:
+					typedef std::forward_iterator_tag iterator_category;
+					typedef WsmanNode value_type;
+					typedef ptrdiff_t difference_type;
+					typedef const WsmanNode* pointer;
+					typedef WsmanNode reference;
+
+					iterator(WsXmlNodeH node = NULL) : node(node) {}
+					WsmanNode operator *() const { return WsmanNode(node); }
+					iterator& operator ++();
+					iterator operator ++(int);
+					bool operator ==(const iterator &rhs) const
+					{
+						return node == rhs.node;
+					}
+					bool operator !=(const iterator &rhs) const
+					{
+						return node != rhs.node;
+					}
+			};
+
+			WsmanNodeRange(WsXmlNodeH first = NULL) : first(first) {}
+
+			iterator begin() const { return iterator(first); }
+			iterator end() const { return iterator(); }
+			bool empty() const { return first == NULL; }
+	};
+
+	// Owns a response document. Documents are not copied; with C++11
+	// they can be moved, otherwise handed over with Swap().
+	class WsmanDocument
+	{
+		private:
+			WsXmlDocH doc;
+			char *xml;
+
+			// Copy constructor is declared private
+			WsmanDocument(const WsmanDocument &copy);
+			// operator = is declared private
+			WsmanDocument &operator =(const WsmanDocument &rhs);
+
+		public:
+			explicit WsmanDocument(WsXmlDocH doc = NULL);
+			~WsmanDocument();
+#if __cplusplus >= 201103L
+			WsmanDocument(WsmanDocument &&other) noexcept;
+			WsmanDocument &operator =(WsmanDocument &&rhs) noexcept;
+#endif
+
+			// Take doc over, destroying the current document.
+			void Reset(WsXmlDocH doc = NULL);
+			// Give the document up to the caller.
+			WsXmlDocH Release();
+			void Swap(WsmanDocument &other);
+
+			WsXmlDocH getDocument() const { return doc; }
+			bool empty() const { return doc == NULL; }
+
+			WsmanNode Header() const;
+			WsmanNode Body() const;
+			// First child of the body.
+			WsmanNode Payload() const;
+			// Items of an Enumerate or Pull response.
+			WsmanNodeRange Items() const;
+
+			// Node as XML text, valid until the next call or until
+			// the document changes.
+			WsmanText Xml(WsXmlNodeH node);
+	};
+
+	// Serialize node into *buf, freeing what *buf held.
+	WsmanText NodeToXml(WsXmlNodeH node, char **buf);
+}
+
+#endif // __WSMAN_DOCUMENT_H
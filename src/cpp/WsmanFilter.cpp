@@ -21,6 +21,14 @@ WsmanFilter::WsmanFilter(const WsmanFilter &filter)
 {
 }
 
+#if __cplusplus >= 201103L
+WsmanFilter::WsmanFilter(WsmanFilter &&filter) noexcept
+	: filter(filter.filter)
+{
+	filter.filter = NULL;
+}
+#endif
+
 WsmanFilter::WsmanFilter(const string &dialect, const string &query)
 	: filter(filter_create_simple(dialect.c_str(), query.c_str()))
 {
@@ -25,6 +25,9 @@ namespace WsmanClientNamespace {
 
 		public:
 			WsmanFilter(const WsmanFilter &filter);
+#if __cplusplus >= 201103L
+			WsmanFilter(WsmanFilter &&filter) noexcept;
+#endif
 			WsmanFilter(const string &dialect, const string &query);
 			WsmanFilter(const NameValuePairs *s = NULL);
                         WsmanFilter(
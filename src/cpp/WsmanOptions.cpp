@@ -38,6 +38,25 @@ WsmanOptions::~WsmanOptions()
 	}
 }
 
+#if __cplusplus >= 201103L
+WsmanOptions::WsmanOptions(WsmanOptions &&other) noexcept
+	: options(other.options)
+{
+	other.options = NULL;
+}
+
+WsmanOptions &WsmanOptions::operator=(WsmanOptions &&rhs) noexcept
+{
+	if (this != &rhs) {
+		if (options)
+			wsmc_options_destroy(options);
+		options = rhs.options;
+		rhs.options = NULL;
+	}
+	return *this;
+}
+#endif
+
 void WsmanOptions::setNamespace(const char *namespace_)
 {
 	if (strlen(namespace_) == 0)
@@ -127,6 +146,16 @@ void WsmanOptions::addSelectors(const NameValuePairs *selectors)
 	addSelectors(*selectors);
 }
 
+void WsmanOptions::clearSelectors()
+{
+	wsmc_clear_selectors(options);
+}
+
+void WsmanOptions::clearProperties()
+{
+	wsmc_clear_properties(options);
+}
+
 void WsmanOptions::addFlag(unsigned long flag)
 {
 	options->flags |= flag;
@@ -37,6 +37,11 @@ namespace WsmanClientNamespace {
 			WsmanOptions();
 			WsmanOptions(unsigned long flags);
 			~WsmanOptions();
+#if __cplusplus >= 201103L
+			// The moved-from object must not be used any more.
+			WsmanOptions(WsmanOptions &&other) noexcept;
+			WsmanOptions &operator=(WsmanOptions &&rhs) noexcept;
+#endif
 
 			void setNamespace(const char *namespace_);
 			void setNamespace(const string &namespace_);
@@ -57,6 +62,11 @@ namespace WsmanClientNamespace {
 			void addSelectors(const NameValuePairs &selectors);
 			void addSelectors(const NameValuePairs *selectors);
 
+			// Options can be reused from request to request, with
+			// the selectors or properties of the next one.
+			void clearSelectors();
+			void clearProperties();
+
 			void addFlag(unsigned long flag);
 			void removeFlag(unsigned long flag);
 			unsigned long getFlags() const;
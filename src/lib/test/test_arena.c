@@ -0,0 +1,46 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+
+#include <u/libu.h>
+
+
+int
+main(int argc, char *argv[])
+{
+    int i;
+    char *s;
+    void *big;
+    u_arena_t *arena = u_arena_create(64);
+
+    if (arena == NULL)
+        return 1;
+
+    /* chain a few chunks */
+    for (i = 0; i < 100; i++) {
+        s = u_arena_strdup_printf(arena, "entry-%d", i);
+        if (s == NULL || strncmp(s, "entry-", 6) != 0)
+            return 1;
+        if (((size_t)s) % sizeof(void *) != 0)
+            return 1;
+    }
+    printf("used after strings: %lu\n", (unsigned long)u_arena_used(arena));
+
+    /* oversized allocation gets a chunk of its own */
+    big = u_arena_zalloc(arena, 1024);
+    if (big == NULL || ((char *)big)[1023] != 0)
+        return 1;
+
+    u_arena_reset(arena);
+    if (u_arena_used(arena) != 0)
+        return 1;
+
+    s = u_arena_strdup(arena, "after reset");
+    if (s == NULL || strcmp(s, "after reset") != 0)
+        return 1;
+    printf("%s: %lu\n", s, (unsigned long)u_arena_used(arena));
+
+    u_arena_destroy(arena);
+    return 0;
+}
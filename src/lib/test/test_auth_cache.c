@@ -0,0 +1,112 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <u/libu.h>
+#include "wsmand-daemon.h"
+#include "wsmand-auth-cache.h"
+
+/*
+ * Checks hits and misses of the basic authentication cache, that
+ * failed logins are cached too and that changing the password file
+ * flushes it.
+ */
+
+static int ttl;
+static int negative_ttl;
+static int calls;
+
+/* the options the cache reads, without a configuration file */
+int wsmand_options_get_auth_cache_ttl(void)
+{
+    return ttl;
+}
+
+int wsmand_options_get_auth_cache_negative_ttl(void)
+{
+    return negative_ttl;
+}
+
+int wsmand_options_get_auth_cache_size(void)
+{
+    return 4;
+}
+
+static int authorize(char *username, char *password)
+{
+    calls++;
+    return strcmp(username, "wsman") == 0 && strcmp(password, "secret") == 0;
+}
+
+/* asks the cache, returns -1 unless the result and the calls to the
+ * authenticator are as expected */
+static int check(char *username, char *password, int authorized, int expected)
+{
+    if (wsmand_auth_cache_authorize(username, password) != authorized)
+        return -1;
+    if (calls != expected) {
+        printf("%s: %d calls, expected %d\n", username, calls, expected);
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    char file[] = "/tmp/test_auth_cacheXXXXXX";
+    unsigned long hits, misses;
+    FILE *f;
+    int fd;
+
+    fd = mkstemp(file);
+    if (fd < 0)
+        return 1;
+    close(fd);
+
+    /* off unless a TTL is configured */
+    if (wsmand_auth_cache_init(authorize, file))
+        goto fail;
+
+    ttl = 60;
+    negative_ttl = 60;
+    if (!wsmand_auth_cache_init(authorize, file))
+        goto fail;
+
+    /* the first login asks, the same credentials again do not */
+    if (check("wsman", "secret", 1, 1) || check("wsman", "secret", 1, 1))
+        goto fail;
+    /* the password and the user are both part of the key */
+    if (check("wsman", "secreT", 0, 2) || check("wsman", "secreT", 0, 2))
+        goto fail;
+    if (check("other", "secret", 0, 3) || check("wsmanx", "ecret", 0, 4))
+        goto fail;
+    wsmand_auth_cache_get_stats(&hits, &misses);
+    if (hits != 2 || misses != 4)
+        goto fail;
+
+    wsmand_auth_cache_flush();
+    if (check("wsman", "secret", 1, 5) || check("wsman", "secret", 1, 5))
+        goto fail;
+
+    /* a new password file is noticed within a second */
+    f = fopen(file, "w");
+    if (f == NULL)
+        goto fail;
+    fputs("wsman:changed\n", f);
+    fclose(f);
+    sleep(1);
+    if (check("wsman", "secret", 1, 6) || check("wsman", "secreT", 0, 7) ||
+        check("wsman", "secreT", 0, 7))
+        goto fail;
+
+    unlink(file);
+    return 0;
+fail:
+    unlink(file);
+    return 1;
+}
@@ -0,0 +1,119 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <u/libu.h>
+
+/*
+ * Checks level filtering and asynchronous delivery of debug messages
+ * logged from several threads. tests/bench/wsman_microbench.c times
+ * them.
+ */
+
+#define THREADS 4
+#define CALLS 1000
+
+static int delivered = 0;
+static int fd = -1;
+static pthread_mutex_t count_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+handler(const char *str, debug_level_e level, void *user_data)
+{
+    /* what a log file handler does */
+    if (write(fd, str, strlen(str)) < 0)
+        return;
+    pthread_mutex_lock(&count_mutex);
+    delivered++;
+    pthread_mutex_unlock(&count_mutex);
+}
+
+static void *
+log_loop(void *arg)
+{
+    int i;
+
+    for (i = 0; i < CALLS; i++)
+        debug("request %d: %s for %s", i, "Enumerate",
+              "http://schemas.dmtf.org/wbem/wscim/1/cim-schema/2/CIM_ComputerSystem");
+    return NULL;
+}
+
+static void
+run(void)
+{
+    pthread_t threads[THREADS];
+    int i;
+
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, log_loop, NULL);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned int id;
+    int i;
+
+    fd = open("/dev/null", O_WRONLY);
+    if (fd < 0)
+        return 1;
+
+    /* no handler, and a handler below the level of the messages */
+    if (debug_level_enabled(DEBUG_LEVEL_ERROR))
+        return 1;
+    id = debug_add_handler(handler, DEBUG_LEVEL_WARNING, NULL);
+    if (!debug_level_enabled(DEBUG_LEVEL_ERROR) ||
+        debug_level_enabled(DEBUG_LEVEL_DEBUG))
+        return 1;
+    run();
+    error("error");
+    if (delivered != 1)
+        return 1;
+
+    /* a long message does not fit on the stack */
+    debug_set_handler_level(id, DEBUG_LEVEL_DEBUG);
+    delivered = 0;
+    debug("%0*d", 4000, 0);
+    if (delivered != 1)
+        return 1;
+
+    delivered = 0;
+    run();
+    if (delivered != THREADS * CALLS)
+        return 1;
+
+    /* a ring large enough for everything, so nothing is dropped */
+    delivered = 0;
+    if (debug_async_start(THREADS * CALLS))
+        return 1;
+    run();
+    for (i = 0; i < 10; i++)
+        debug("%0*d", 1000, i);
+    debug_async_stop();
+    if (delivered != THREADS * CALLS + 10 || debug_async_dropped())
+        return 1;
+
+    /* a small ring drops debug messages, but no errors */
+    delivered = 0;
+    if (debug_async_start(16))
+        return 1;
+    run();
+    for (i = 0; i < 100; i++)
+        error("error %d", i);
+    debug_async_stop();
+    if (delivered + debug_async_dropped() != THREADS * CALLS + 100)
+        return 1;
+
+    debug_destroy_handlers();
+    if (debug_level_enabled(DEBUG_LEVEL_ALWAYS))
+        return 1;
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+
+#include <u/libu.h>
+
+
+static int
+roundtrip(int coding, const char *text, size_t len)
+{
+    char *z, *plain;
+    size_t zlen, plen;
+
+    if (u_gzip_compress(coding, 6, text, len, &z, &zlen))
+        return 1;
+    printf("%s: %lu -> %lu\n", u_gzip_name(coding), (unsigned long)len,
+            (unsigned long)zlen);
+    if (u_gzip_uncompress(z, zlen, 0, &plain, &plen))
+        return 1;
+    if (plen != len || memcmp(plain, text, len) != 0 || plain[plen] != 0)
+        return 1;
+    u_free(plain);
+
+    /* too small a limit and truncated data are errors */
+    if (u_gzip_uncompress(z, zlen, len / 2, &plain, &plen) == 0)
+        return 1;
+    if (u_gzip_uncompress(z, zlen / 2, 0, &plain, &plen) == 0)
+        return 1;
+    u_free(z);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int i;
+    u_buf_t *buf;
+
+    if (u_gzip_coding(NULL) != U_GZIP_IDENTITY ||
+        u_gzip_coding("identity") != U_GZIP_IDENTITY)
+        return 1;
+    if (!u_gzip_supported()) {
+        printf("built without zlib\n");
+        return u_gzip_accepted("gzip") != U_GZIP_IDENTITY ||
+            u_gzip_coding("gzip") != -1;
+    }
+
+    if (u_gzip_coding(" gzip") != U_GZIP_GZIP ||
+        u_gzip_coding("x-gzip") != U_GZIP_GZIP ||
+        u_gzip_coding("DEFLATE") != U_GZIP_DEFLATE ||
+        u_gzip_coding("br") != -1)
+        return 1;
+
+    if (u_gzip_accepted(NULL) != U_GZIP_IDENTITY ||
+        u_gzip_accepted("") != U_GZIP_IDENTITY ||
+        u_gzip_accepted("deflate, gzip") != U_GZIP_GZIP ||
+        u_gzip_accepted("gzip;q=0, deflate") != U_GZIP_DEFLATE ||
+        u_gzip_accepted("gzip; q=0.0,deflate;q=0") != U_GZIP_IDENTITY ||
+        u_gzip_accepted("br, *") != U_GZIP_GZIP ||
+        u_gzip_accepted("*;q=0") != U_GZIP_IDENTITY ||
+        u_gzip_accepted("gzipped") != U_GZIP_IDENTITY)
+        return 1;
+
+    u_buf_create(&buf);
+    for (i = 0; i < 200; i++) {
+        char *item = u_strdup_printf("<p:CIM_ComputerSystem><p:Name>host%d"
+                "</p:Name></p:CIM_ComputerSystem>", i);
+        u_buf_append(buf, item, strlen(item));
+        u_free(item);
+    }
+    if (roundtrip(U_GZIP_GZIP, u_buf_ptr(buf), u_buf_len(buf)) ||
+        roundtrip(U_GZIP_DEFLATE, u_buf_ptr(buf), u_buf_len(buf)))
+        return 1;
+    u_buf_free(buf);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <u/libu.h>
+#include "wsman-xml.h"
+#include "wsman-soap-envelope.h"
+
+/*
+ * Checks that telling Identify requests from their text agrees with
+ * parsing them. tests/bench/wsman_microbench.c times both.
+ */
+
+#define ENVELOPE(header, body) \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsmid=\"http://schemas.dmtf.org/wbem/wsman/identity/1/" \
+    "wsmanidentity.xsd\">" header "<s:Body>" body "</s:Body></s:Envelope>"
+
+#define GET \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+    "xmlns:wsman=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+    "<s:Header><wsa:Action>" \
+    "http://schemas.xmlsoap.org/ws/2004/09/transfer/Get</wsa:Action>" \
+    "<wsman:ResourceURI>http://example.org/resource</wsman:ResourceURI>" \
+    "<wsa:MessageID>uuid:1</wsa:MessageID></s:Header>" \
+    "<s:Body/></s:Envelope>"
+
+static const struct {
+    const char *text;
+    int peek;       /* what wsman_peek_identify() tells */
+    int identify;
+} requests[] = {
+    { ENVELOPE("<s:Header/>", "<wsmid:Identify/>"), 1, 1 },
+    { ENVELOPE("", "\n  <wsmid:Identify>\n  </wsmid:Identify>\n"), 1, 1 },
+    /* the namespace declared on the element */
+    { "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\">"
+      "<s:Header/><s:Body><wsmid:Identify xmlns:wsmid=\"http://schemas."
+      "dmtf.org/wbem/wsman/identity/1/wsmanidentity.xsd\"/></s:Body>"
+      "</s:Envelope>", 1, 1 },
+    { "<Envelope xmlns=\"http://www.w3.org/2003/05/soap-envelope\">"
+      "<Body><Identify xmlns='http://schemas.dmtf.org/wbem/wsman/identity/"
+      "1/wsmanidentity.xsd'/></Body></Envelope>", 1, 1 },
+    { GET, 0, 0 },
+    /* left to the parser */
+    { ENVELOPE("", "<!-- probe --><wsmid:Identify/>"), -1, 1 },
+    { ENVELOPE("", "<wsmid:IdentifyResponse/>"), -1, 0 },
+    { ENVELOPE("", "<other:Identify xmlns:other=\"urn:other\"/>"), -1, 0 },
+    { ENVELOPE("", ""), -1, 0 },
+    { ENVELOPE("<s:Header><x:Body xmlns:x=\"urn:x\">1</x:Body></s:Header>",
+               "<wsmid:Identify/>"), -1, 1 },
+};
+
+static int
+parse(const char *text)
+{
+    WsXmlDocH doc = ws_xml_read_memory(text, strlen(text), "UTF-8", 0);
+    int identify;
+
+    if (doc == NULL)
+        return -1;
+    identify = wsman_is_identify_request(doc);
+    ws_xml_destroy_doc(doc);
+    return identify;
+}
+
+int
+main(void)
+{
+    WsmanMessage *msg;
+    size_t i;
+    int failed = 0, n, k;
+
+    for (i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        n = wsman_peek_identify(requests[i].text, strlen(requests[i].text));
+        k = parse(requests[i].text);
+        if (n != requests[i].peek || k != requests[i].identify ||
+            (n >= 0 && n != k)) {
+            printf("request %lu: peek %d, parse %d\n", (unsigned long) i,
+                   n, k);
+            failed++;
+        }
+    }
+
+    msg = wsman_soap_message_new();
+    msg->charset = u_strdup("UTF-8");
+    for (k = 0; k < 2; k++) {
+        const char *text = k ? GET : requests[0].text;
+
+        u_buf_set(msg->request, (char *) text, strlen(text));
+        if (wsman_check_identify(msg) != !k)
+            failed++;
+    }
+    wsman_soap_message_destroy(msg);
+    return failed != 0;
+}
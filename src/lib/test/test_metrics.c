@@ -0,0 +1,192 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <u/libu.h>
+#include "wsman-xml.h"
+#include "wsman-soap.h"
+#include "wsman-dispatcher.h"
+#include "wsman-metrics.h"
+
+/*
+ * Counts requests and authentications from several threads, twice so
+ * that the second round reuses the blocks of the first, and checks the
+ * sums collected. Then the series run out and two threads send the
+ * actions left over, which are counted as action "-".
+ * tests/bench/wsman_microbench.c times counting a request.
+ */
+
+#define THREADS 4
+#define REQUESTS 10000
+/* METRICS_SERIES_MAX of wsman-metrics.c, "- -" takes one */
+#define SERIES 256
+#define ACTIONS (SERIES + 44)
+
+#define REQUEST \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+    "xmlns:wsman=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+    "<s:Header><wsa:Action>http://example.org/action%d</wsa:Action>" \
+    "<wsman:ResourceURI>http://example.org/resource</wsman:ResourceURI>" \
+    "</s:Header><s:Body/></s:Envelope>"
+
+static callback_t *inbound;
+static op_t ops[ACTIONS];
+
+/* libwsman_server expects the daemon to provide it */
+int continue_working = 1;
+
+static void *
+worker(void *data)
+{
+    int i;
+
+    for (i = 0; i < REQUESTS; i++) {
+        /* one in ten ends with a fault, each takes 1ms */
+        wsman_metrics_request(i % 10 ? WSMAN_RC_OK :
+                              WSA_DESTINATION_UNREACHABLE, 1000000);
+        wsman_metrics_auth(i % 2);
+    }
+    return NULL;
+}
+
+static void
+request(int action)
+{
+    inbound->proc((SoapOpH) &ops[action], inbound->node.list_data, NULL);
+    wsman_metrics_request(WSMAN_RC_OK, 1000000);
+}
+
+/*
+ * the actions without a series of their own, twice, the second time
+ * from the cache of the thread
+ */
+static void *
+overflow_worker(void *data)
+{
+    int i;
+
+    for (i = 0; i < 2 * (ACTIONS - SERIES + 1); i++)
+        request(SERIES - 1 + i % (ACTIONS - SERIES + 1));
+    return NULL;
+}
+
+static int
+run(void *(*fn) (void *), int threads)
+{
+    pthread_t tids[THREADS];
+    int i;
+
+    for (i = 0; i < threads; i++)
+        if (pthread_create(&tids[i], NULL, fn, NULL))
+            return 1;
+    for (i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+    return 0;
+}
+
+static double
+constant(void *data)
+{
+    return 42;
+}
+
+static int
+contains(const char *text, const char *fmt, long n)
+{
+    char line[256];
+
+    snprintf(line, sizeof(line), fmt, n);
+    if (strstr(text, line))
+        return 1;
+    printf("missing: %s", line);
+    return 0;
+}
+
+int
+main(void)
+{
+    u_buf_t *buf;
+    const char *text;
+    long total = 2L * THREADS * REQUESTS;
+    char text_request[512];
+    SoapH soap;
+    int i;
+
+    if (wsman_fault_code_for_name("wsa:DestinationUnreachable") !=
+        WSA_DESTINATION_UNREACHABLE ||
+        wsman_fault_code_for_name("InvalidSelectors") !=
+        WSMAN_INVALID_SELECTORS ||
+        wsman_fault_code_for_name("nonsense") != WSMAN_UNKNOWN)
+        return 1;
+
+    /* nothing is counted before the metrics are started */
+    wsman_metrics_request(WSMAN_RC_OK, 0);
+    if (wsman_metrics_enabled() || wsman_metrics_init(NULL))
+        return 1;
+    wsman_metrics_add("test_constant", "A constant.", WSMAN_METRIC_GAUGE,
+                      constant, NULL);
+
+    if (run(worker, THREADS) || run(worker, THREADS))
+        return 1;
+
+    u_buf_create(&buf);
+    if (wsman_metrics_collect(buf))
+        return 1;
+    u_buf_append(buf, "", 1);
+    text = u_buf_ptr(buf);
+    if (!contains(text, "wsman_request_duration_seconds_count"
+                  "{action=\"-\",resource=\"-\"} %ld\n", total) ||
+        !contains(text, "wsman_request_duration_seconds_bucket"
+                  "{action=\"-\",resource=\"-\",le=\"0.0005\"} %ld\n", 0) ||
+        !contains(text, "wsman_request_duration_seconds_bucket"
+                  "{action=\"-\",resource=\"-\",le=\"0.001\"} %ld\n", total) ||
+        !contains(text, "wsman_faults_total"
+                  "{fault=\"DestinationUnreachable\"} %ld\n", total / 10) ||
+        !contains(text, "wsman_auth_total{result=\"success\"} %ld\n",
+                  total / 2) ||
+        !contains(text, "wsman_auth_total{result=\"failure\"} %ld\n",
+                  total / 2) ||
+        !contains(text, "test_constant %ld\n", 42))
+        return 1;
+
+    soap = ws_soap_initialize();
+    if (soap == NULL || wsman_metrics_init(soap) ||
+        (inbound = (callback_t *)
+         list_first(soap->inboundFilterList)) == NULL)
+        return 1;
+    for (i = 0; i < ACTIONS; i++) {
+        snprintf(text_request, sizeof(text_request), REQUEST, i);
+        ops[i].in_doc = ws_xml_read_memory(text_request,
+                                           strlen(text_request), "UTF-8", 0);
+        if (ops[i].in_doc == NULL)
+            return 1;
+    }
+    /* takes all series, the workers hardly any */
+    for (i = 0; i < SERIES - 1; i++)
+        request(i);
+    if (run(overflow_worker, 2))
+        return 1;
+
+    u_buf_clear(buf);
+    if (wsman_metrics_collect(buf))
+        return 1;
+    u_buf_append(buf, "", 1);
+    text = u_buf_ptr(buf);
+    if (!contains(text, "wsman_request_duration_seconds_count"
+                  "{action=\"-\",resource=\"-\"} %ld\n",
+                  total + 2 * 2 * (ACTIONS - SERIES + 1)) ||
+        !contains(text, "wsman_request_duration_seconds_count"
+                  "{action=\"http://example.org/action%ld\","
+                  "resource=\"http://example.org/resource\"} 1\n", 0))
+        return 1;
+    for (i = 0; i < ACTIONS; i++)
+        ws_xml_destroy_doc(ops[i].in_doc);
+    u_buf_free(buf);
+    return 0;
+}
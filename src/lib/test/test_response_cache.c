@@ -0,0 +1,210 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <u/libu.h>
+#include "wsman-xml.h"
+#include "wsman-soap-message.h"
+#include "wsman-response-cache.h"
+
+/*
+ * Stores a Get response, replays it with a new MessageID and RelatesTo,
+ * and checks what makes requests miss or drops what is cached.
+ * tests/bench/wsman_microbench.c times a hit.
+ */
+
+#define CALLS 1000
+
+#define RESOURCE "http://example.org/resource"
+
+#define REQUEST \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+    "xmlns:wsman=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+    "<s:Header><wsa:Action>%s</wsa:Action>" \
+    "<wsman:ResourceURI>%s</wsman:ResourceURI>" \
+    "<wsa:MessageID>uuid:%d</wsa:MessageID>" \
+    "<wsman:SelectorSet>%s</wsman:SelectorSet></s:Header>" \
+    "<s:Body/></s:Envelope>"
+
+#define RESPONSE \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\">" \
+    "<s:Header><wsa:MessageID>uuid:response</wsa:MessageID>" \
+    "<wsa:RelatesTo>uuid:%d</wsa:RelatesTo></s:Header>" \
+    "<s:Body><Value>42</Value></s:Body></s:Envelope>"
+
+/* the id of the request in a header before RelatesTo, left as it is */
+#define ECHO_RESPONSE \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+    "xmlns:x=\"http://example.org/x\">" \
+    "<s:Header><x:Echo>uuid:%d</x:Echo>" \
+    "<wsa:MessageID>uuid:response</wsa:MessageID>" \
+    "<wsa:RelatesTo>uuid:%d</wsa:RelatesTo></s:Header>" \
+    "<s:Body><Value>42</Value></s:Body></s:Envelope>"
+
+#define GET "http://schemas.xmlsoap.org/ws/2004/09/transfer/Get"
+#define PUT "http://schemas.xmlsoap.org/ws/2004/09/transfer/Put"
+
+#define SELECTORS \
+    "<wsman:Selector Name=\"A\">1</wsman:Selector>" \
+    "<wsman:Selector Name=\"B\">2</wsman:Selector>"
+/* the same selectors the other way round */
+#define SELECTORS_SWAPPED \
+    "<wsman:Selector Name=\"B\">2</wsman:Selector>" \
+    "<wsman:Selector Name=\"A\">1</wsman:Selector>"
+#define OTHER_SELECTORS \
+    "<wsman:Selector Name=\"A\">3</wsman:Selector>"
+
+static WsmanMessage *msg;
+
+/* replays the request, returns 1 on a hit */
+static int
+replay(const char *action, const char *uri, int id, const char *selectors,
+       WsmanResponseCacheMiss **miss)
+{
+    char buf[2048];
+    WsXmlDocH doc;
+    int hit;
+
+    snprintf(buf, sizeof(buf), REQUEST, action, uri, id, selectors);
+    doc = ws_xml_read_memory(buf, strlen(buf), "UTF-8", 0);
+    if (doc == NULL)
+        return -1;
+    u_buf_clear(msg->response);
+    hit = wsman_response_cache_replay(doc, msg, 0, miss);
+    ws_xml_destroy_doc(doc);
+    return hit;
+}
+
+/* what the dispatcher does once the endpoint answered request id */
+static void
+answer(WsmanResponseCacheMiss *miss, const char *response, int id)
+{
+    char buf[1024];
+    WsXmlDocH doc;
+
+    snprintf(buf, sizeof(buf), response, id, id);
+    doc = ws_xml_read_memory(buf, strlen(buf), "UTF-8", 0);
+    u_buf_set(msg->response, buf, strlen(buf));
+    msg->http_code = WSMAN_STATUS_OK;
+    wsman_response_cache_store(miss, msg, doc);
+    ws_xml_destroy_doc(doc);
+}
+
+/* a Get of the resource with id, answered if it missed */
+static int
+get(int id, const char *selectors)
+{
+    WsmanResponseCacheMiss *miss;
+    int hit = replay(GET, RESOURCE, id, selectors, &miss);
+
+    if (hit == 0) {
+        if (miss == NULL)
+            return -1;
+        answer(miss, RESPONSE, id);
+    }
+    return hit;
+}
+
+static int
+response_has(const char *text)
+{
+    u_buf_append(msg->response, "", 1);
+    return strstr(u_buf_ptr(msg->response), text) != NULL;
+}
+
+int
+main(void)
+{
+    WsmanResponseCacheMiss *miss, *late;
+    unsigned long hits, misses;
+    int i;
+
+    if (wsman_response_cache_init("nonsense", 16) == 0 ||
+        wsman_response_cache_enabled())
+        return 1;
+    if (wsman_response_cache_init(RESOURCE "=60,http://example.org/x*=60",
+                                  16))
+        return 1;
+    msg = wsman_soap_message_new();
+    msg->charset = "UTF-8";
+    msg->auth_data.username = "wsman";
+
+    /* stored, then replayed for the same selectors in any order */
+    if (get(1, SELECTORS) != 0 || get(2, SELECTORS_SWAPPED) != 1)
+        return 1;
+    if (!response_has("<wsa:RelatesTo>uuid:2</wsa:RelatesTo>") ||
+        response_has("uuid:response") ||
+        !response_has("<Value>42</Value>"))
+        return 1;
+
+    /* other selectors, users and resources miss */
+    if (get(3, OTHER_SELECTORS) != 0 || get(4, OTHER_SELECTORS) != 1)
+        return 1;
+    msg->auth_data.username = "other";
+    if (get(5, SELECTORS) != 0)
+        return 1;
+    msg->auth_data.username = "wsman";
+    if (replay(GET, "http://example.org/uncached", 6, SELECTORS, &miss) ||
+        miss != NULL)
+        return 1;
+    if (replay(GET, "http://example.org/xy", 7, SELECTORS, &miss) ||
+        miss == NULL)
+        return 1;
+    wsman_response_cache_store(miss, msg, NULL);
+
+    /* a Put drops the resource it wrote and nothing else */
+    if (replay(PUT, RESOURCE, 8, SELECTORS_SWAPPED, &miss) || miss == NULL)
+        return 1;
+    wsman_response_cache_store(miss, msg, NULL);
+    if (get(9, SELECTORS) != 0 || get(10, OTHER_SELECTORS) != 1)
+        return 1;
+
+    /* a Get racing a Put is not kept */
+    if (replay(PUT, RESOURCE, 11, SELECTORS, &miss))
+        return 1;
+    wsman_response_cache_store(miss, msg, NULL);
+    if (replay(GET, RESOURCE, 12, SELECTORS, &late) || late == NULL ||
+        replay(PUT, RESOURCE, 13, SELECTORS, &miss))
+        return 1;
+    answer(late, RESPONSE, 12);
+    wsman_response_cache_store(miss, msg, NULL);
+    if (get(14, SELECTORS) != 0)
+        return 1;
+
+    for (i = 0; i < CALLS; i++)
+        if (replay(GET, RESOURCE, i, SELECTORS, &miss) != 1)
+            return 1;
+
+    wsman_response_cache_get_stats(&hits, &misses);
+    printf("%lu hits, %lu misses\n", hits, misses);
+    if (hits != CALLS + 3UL || misses != 7)
+        return 1;
+
+    wsman_response_cache_flush();
+    if (get(15, SELECTORS) != 0)
+        return 1;
+
+    /* only the text of RelatesTo is replaced, not its first copy */
+    if (replay(GET, "http://example.org/xz", 16, SELECTORS, &miss) ||
+        miss == NULL)
+        return 1;
+    answer(miss, ECHO_RESPONSE, 16);
+    if (replay(GET, "http://example.org/xz", 17, SELECTORS, &miss) != 1 ||
+        !response_has("<x:Echo>uuid:16</x:Echo>") ||
+        !response_has("<wsa:RelatesTo>uuid:17</wsa:RelatesTo>"))
+        return 1;
+    wsman_response_cache_shutdown();
+    if (wsman_response_cache_enabled())
+        return 1;
+    msg->charset = NULL;
+    msg->auth_data.username = NULL;
+    wsman_soap_message_destroy(msg);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <u/libu.h>
+#include "wsman-xml.h"
+#include "wsman-trace.h"
+
+/*
+ * Checks the stages, histograms and trace events of request traces.
+ * tests/bench/wsman_microbench.c times timing a stage.
+ */
+
+#define TRACE_FILE "test_trace.json"
+
+#define REQUEST \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+    "xmlns:wsman=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+    "<s:Header><wsa:Action>%s</wsa:Action>" \
+    "<wsman:ResourceURI>http://example.org/resource</wsman:ResourceURI>" \
+    "<wsa:MessageID>uuid:%d</wsa:MessageID></s:Header>" \
+    "<s:Body/></s:Envelope>"
+
+#define GET "http://schemas.xmlsoap.org/ws/2004/09/transfer/Get"
+#define PUT "http://schemas.xmlsoap.org/ws/2004/09/transfer/Put"
+
+static int histograms;
+static int failed;
+
+static void
+request(const char *action, int id)
+{
+    char buf[1024];
+    WsXmlDocH doc;
+    WsmanTrace *trace;
+    unsigned long long t0;
+
+    snprintf(buf, sizeof(buf), REQUEST, action, id);
+    trace = wsman_trace_new(0);
+    t0 = wsman_trace_begin(trace);
+    doc = ws_xml_read_memory(buf, strlen(buf), "UTF-8", 0);
+    wsman_trace_end(trace, WSMAN_TRACE_PARSE, t0);
+    wsman_trace_set_request(trace, doc);
+
+    wsman_trace_set_current(trace);
+    t0 = wsman_trace_begin(trace);
+    /* what a plugin does */
+    if (wsman_trace_current() != trace)
+        failed++;
+    usleep(2000);
+    wsman_trace_end(wsman_trace_current(), WSMAN_TRACE_CIMOM, t0);
+    wsman_trace_end(trace, WSMAN_TRACE_ENDPOINT, t0);
+    wsman_trace_set_current(NULL);
+
+    ws_xml_destroy_doc(doc);
+    wsman_trace_finish(trace, 200);
+}
+
+static void
+check_histogram(const WsmanTraceHistogram *h, void *data)
+{
+    histograms++;
+    if (strcmp(h->resource_uri, "http://example.org/resource") ||
+        (strcmp(h->action, GET) && strcmp(h->action, PUT)))
+        failed++;
+    if (h->count != (strcmp(h->action, GET) ? 1 : 3))
+        failed++;
+    /* every request slept for 2ms in the endpoint */
+    if (h->stage_ns[WSMAN_TRACE_ENDPOINT] < h->count * 2000000ULL ||
+        h->stage_ns[WSMAN_TRACE_CIMOM] > h->stage_ns[WSMAN_TRACE_ENDPOINT] ||
+        h->total_ns < h->stage_ns[WSMAN_TRACE_ENDPOINT])
+        failed++;
+    if (wsman_trace_histogram_quantile(h, 0.5) < 2000000ULL ||
+        wsman_trace_histogram_quantile(h, 0.99) > h->max_ns)
+        failed++;
+    printf("%s: %lu requests, p50 %llu us, max %llu us\n", h->action,
+           h->count, wsman_trace_histogram_quantile(h, 0.5) / 1000,
+           h->max_ns / 1000);
+}
+
+int
+main(int argc, char *argv[])
+{
+    char buf[65536];
+    size_t len;
+    FILE *fp;
+    char *p;
+    int events;
+
+    if (wsman_trace_new(0) != NULL || wsman_trace_current() != NULL)
+        return 1;
+
+    /* every other request goes to the trace file */
+    if (wsman_trace_init(0, TRACE_FILE, 2))
+        return 1;
+    request(GET, 1);
+    request(GET, 2);
+    request(PUT, 3);
+    request(GET, 4);
+    wsman_trace_foreach_histogram(check_histogram, NULL);
+    if (histograms != 2 || failed)
+        return 1;
+    wsman_trace_shutdown();
+    if (wsman_trace_enabled())
+        return 1;
+
+    fp = fopen(TRACE_FILE, "r");
+    if (fp == NULL)
+        return 1;
+    len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    unlink(TRACE_FILE);
+    buf[len] = '\0';
+    if (strncmp(buf, "[\n", 2) || strcmp(buf + len - 3, "\n]\n"))
+        return 1;
+    /* requests 2 and 4, with parse, endpoint and cimom each */
+    for (events = 0, p = buf; (p = strstr(p, "\"ph\":\"X\"")); p++)
+        events++;
+    if (events != 8 || !strstr(buf, "\"id\":\"uuid:2\"") ||
+        !strstr(buf, "\"id\":\"uuid:4\"") || strstr(buf, "\"id\":\"uuid:1\""))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Region allocator: allocations are carved out of a chain of chunks
+ * and released all at once with u_arena_reset() or u_arena_destroy().
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <string.h>
+#include <u/libu.h>
+#include <u/arena.h>
+
+/* keep every returned block suitably aligned for any type */
+#define U_ARENA_ALIGN (sizeof(void *) > sizeof(double) ? \
+		sizeof(void *) : sizeof(double))
+#define U_ARENA_ROUND(sz) (((sz) + U_ARENA_ALIGN - 1) & ~(U_ARENA_ALIGN - 1))
+
+typedef struct u_arena_chunk_s
+{
+    struct u_arena_chunk_s *next;
+    size_t size, used;
+    /* data follows the (aligned) header */
+} u_arena_chunk_t;
+
+#define U_ARENA_HDR U_ARENA_ROUND(sizeof(u_arena_chunk_t))
+#define U_ARENA_DATA(c) ((char *)(c) + U_ARENA_HDR)
+
+struct u_arena_s
+{
+    u_arena_chunk_t *head;      /* chunk currently allocated from */
+    size_t chunk_size;          /* data size of a regular chunk */
+    size_t used;                /* bytes handed out since last reset */
+};
+
+/**
+ *  \defgroup arena Arena
+ *  \{
+ */
+
+static u_arena_chunk_t *arena_chunk_new(size_t size)
+{
+    u_arena_chunk_t *c = u_malloc(U_ARENA_HDR + size);
+
+    if (c) {
+        c->next = NULL;
+        c->size = size;
+        c->used = 0;
+    }
+    return c;
+}
+
+/**
+ * \brief  Create an arena
+ *
+ * \param chunk_size  data size of each chunk, \c 0 for the default
+ *
+ * \return the arena or \c NULL on allocation failure
+ */
+u_arena_t *u_arena_create(size_t chunk_size)
+{
+    u_arena_t *arena = u_zalloc(sizeof(u_arena_t));
+
+    dbg_err_if(arena == NULL);
+
+    arena->chunk_size = U_ARENA_ROUND(chunk_size ? chunk_size :
+            U_ARENA_CHUNK_SIZE);
+    arena->head = arena_chunk_new(arena->chunk_size);
+    dbg_err_if(arena->head == NULL);
+
+    return arena;
+err:
+    u_free(arena);
+    return NULL;
+}
+
+/**
+ * \brief  Release every allocation made from \a arena
+ *
+ * The first regular sized chunk is kept so the arena can be reused
+ * without going back to malloc(3).
+ */
+void u_arena_reset(u_arena_t *arena)
+{
+    u_arena_chunk_t *c, *next, *keep = NULL;
+
+    if (arena == NULL)
+        return;
+
+    for (c = arena->head; c; c = next) {
+        next = c->next;
+        if (keep == NULL && c->size == arena->chunk_size) {
+            keep = c;
+            continue;
+        }
+        u_free(c);
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->head = keep;
+    arena->used = 0;
+}
+
+/** \brief Free \a arena together with all of its chunks */
+void u_arena_destroy(u_arena_t *arena)
+{
+    u_arena_chunk_t *c, *next;
+
+    if (arena == NULL)
+        return;
+
+    for (c = arena->head; c; c = next) {
+        next = c->next;
+        u_free(c);
+    }
+    u_free(arena);
+}
+
+/**
+ * \brief  Allocate \a size bytes from \a arena
+ *
+ * Requests larger than the chunk size get a chunk of their own which is
+ * linked behind the current one, so the remaining space of the current
+ * chunk is not wasted.
+ *
+ * \return the block or \c NULL on allocation failure
+ */
+void *u_arena_alloc(u_arena_t *arena, size_t size)
+{
+    u_arena_chunk_t *c;
+    void *ptr;
+
+    dbg_return_if(arena == NULL, NULL);
+
+    size = U_ARENA_ROUND(size ? size : 1);
+    c = arena->head;
+
+    if (c == NULL || c->size - c->used < size) {
+        if (size > arena->chunk_size) {
+            c = arena_chunk_new(size);
+            dbg_return_if(c == NULL, NULL);
+            if (arena->head) {
+                c->next = arena->head->next;
+                arena->head->next = c;
+            } else {
+                arena->head = c;
+            }
+        } else {
+            c = arena_chunk_new(arena->chunk_size);
+            dbg_return_if(c == NULL, NULL);
+            c->next = arena->head;
+            arena->head = c;
+        }
+    }
+
+    ptr = U_ARENA_DATA(c) + c->used;
+    c->used += size;
+    arena->used += size;
+
+    return ptr;
+}
+
+/** \brief Allocate \a size zero-filled bytes from \a arena */
+void *u_arena_zalloc(u_arena_t *arena, size_t size)
+{
+    void *ptr = u_arena_alloc(arena, size);
+
+    if (ptr)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+/** \brief Duplicate \a str into \a arena */
+char *u_arena_strdup(u_arena_t *arena, const char *str)
+{
+    size_t len;
+    char *ptr;
+
+    if (str == NULL)
+        return NULL;
+
+    len = strlen(str) + 1;
+    if ((ptr = u_arena_alloc(arena, len)) != NULL)
+        memcpy(ptr, str, len);
+    return ptr;
+}
+
+/** \brief Arena counterpart of u_strdup_vprintf() */
+char *u_arena_strdup_vprintf(u_arena_t *arena, const char *format,
+        va_list ap)
+{
+    va_list ap2;
+    int size;
+    char *buffer;
+
+    VA_COPY(ap2, ap);
+    size = vsnprintf(NULL, 0, format, ap2) + 1;
+    va_end(ap2);
+    if (size <= 0)
+        return NULL;
+    if ((buffer = u_arena_alloc(arena, size)) == NULL)
+        return NULL;
+    vsnprintf(buffer, size, format, ap);
+    return buffer;
+}
+
+/** \brief Arena counterpart of u_strdup_printf() */
+char *u_arena_strdup_printf(u_arena_t *arena, const char *format, ...)
+{
+    char *buffer;
+    va_list ap;
+
+    va_start(ap, format);
+    buffer = u_arena_strdup_vprintf(arena, format, ap);
+    va_end(ap);
+    return buffer;
+}
+
+/** \brief Number of bytes handed out by \a arena since the last reset */
+size_t u_arena_used(u_arena_t *arena)
+{
+    return arena ? arena->used : 0;
+}
+
+/**
+ *      \}
+ */
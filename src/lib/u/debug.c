@@ -37,12 +37,63 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+#endif
 
 #include "u/libu.h"
 
+/* messages up to this size are formatted without touching the heap */
+#define DEBUG_STACK_SIZE 512
+
+#ifdef __GNUC__
+#define DEBUG_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define DEBUG_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#else
+#define DEBUG_LOAD(p) (*(volatile int *) (p))
+#define DEBUG_STORE(p, v) (*(volatile int *) (p) = (v))
+#endif
 
 static list_t *handlers = NULL;
 
+/*
+ * Highest level any handler takes, read without a lock by every
+ * debug_full() call so disabled messages are never formatted.
+ */
+static int debug_max_level = DEBUG_LEVEL_ALWAYS - 1;
+
+static void update_max_level(void)
+{
+	lnode_t *iter;
+	debug_handler_t *handler;
+	int max = DEBUG_LEVEL_ALWAYS - 1;
+
+	for (iter = list_first(handlers); iter;
+	     iter = list_next(handlers, iter)) {
+		handler = (debug_handler_t *) iter->list_data;
+		if (handler->level == DEBUG_LEVEL_ALWAYS)
+			max = INT_MAX;
+		else if ((int) handler->level > max)
+			max = handler->level;
+	}
+	/* ALWAYS messages go to every handler */
+	if (list_count(handlers) > 0 && max < DEBUG_LEVEL_ALWAYS)
+		max = DEBUG_LEVEL_ALWAYS;
+	DEBUG_STORE(&debug_max_level, max);
+}
+
+int debug_level_enabled(debug_level_e level)
+{
+	return (int) level <= DEBUG_LOAD(&debug_max_level);
+}
+
 unsigned int
 debug_add_handler(debug_fn fn, debug_level_e level, void *user_data)
 {
@@ -64,10 +115,27 @@ debug_add_handler(debug_fn fn, debug_level_e level, void *user_data)
 
 	new_node = lnode_create(handler);
 	list_append(handlers, new_node);
+	update_max_level();
 
 	return handler->id;
 }
 
+void debug_set_handler_level(unsigned int id, debug_level_e level)
+{
+	lnode_t *iter = list_first(handlers);
+	while (iter) {
+		debug_handler_t *handler =
+		    (debug_handler_t *) iter->list_data;
+
+		if (handler->id == id) {
+			handler->level = level;
+			update_max_level();
+			return;
+		}
+		iter = list_next(handlers, iter);
+	}
+}
+
 void debug_remove_handler(unsigned int id)
 {
 	lnode_t *iter = list_first(handlers);
@@ -78,6 +146,7 @@ void debug_remove_handler(unsigned int id)
 		if (handler->id == id) {
 			list_delete(handlers, iter);
 			lnode_destroy(iter);
+			update_max_level();
 			return;
 		}
 		iter = list_next(handlers, iter);
@@ -87,11 +156,14 @@ void debug_remove_handler(unsigned int id)
 
 void debug_destroy_handlers(void)
 {
+	debug_async_stop();
+	DEBUG_STORE(&debug_max_level, DEBUG_LEVEL_ALWAYS - 1);
 	list_destroy_nodes(handlers);
 	list_destroy(handlers);
+	handlers = NULL;
 }
 
-static void call_handlers(debug_level_e level, char *str)
+static void call_handlers(debug_level_e level, const char *str)
 {
 	lnode_t *iter;
 	debug_handler_t *handler;
@@ -106,22 +178,266 @@ static void call_handlers(debug_level_e level, char *str)
 }
 
 
+#if defined(__GNUC__) && !defined(_WIN32)
+/*
+ * Asynchronous delivery: request threads put formatted messages into a
+ * bounded ring (multiple producers, one consumer, no locks on the way
+ * in) and a thread of its own hands them to the handlers, so slow
+ * syslog or stdio never stalls a request.
+ */
+
+#define DEBUG_SLOT_TEXT 240
+
+typedef struct {
+	size_t seq;
+	debug_level_e level;
+	char *heap;		/* message too long for text */
+	char text[DEBUG_SLOT_TEXT];
+} debug_slot_t;
+
+static debug_slot_t *ring = NULL;
+static size_t ring_mask;
+static size_t ring_head;	/* next slot to fill */
+static size_t ring_tail;	/* next slot to deliver, consumer only */
+static int ring_running = 0;
+static int ring_quit = 0;
+static int ring_users = 0;	/* producers inside ring_put() */
+static int ring_sleeping = 0;
+static unsigned long ring_dropped = 0;
+static pthread_t ring_thread;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+
+/* 0 if the message is queued, -1 if the caller has to deliver it */
+static int ring_put(debug_level_e level, const char *str, size_t len)
+{
+	debug_slot_t *slot;
+	size_t pos, seq;
+	intptr_t diff;
+	int ret = -1;
+
+	__atomic_add_fetch(&ring_users, 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&ring_running, __ATOMIC_SEQ_CST))
+		goto out;
+
+	pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+	for (;;) {
+		slot = &ring[pos & ring_mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (intptr_t) seq - (intptr_t) pos;
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&ring_head, &pos,
+					pos + 1, 1, __ATOMIC_RELAXED,
+					__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/* full: errors and warnings are delivered anyway */
+			if (level > DEBUG_LEVEL_WARNING) {
+				__atomic_add_fetch(&ring_dropped, 1,
+						__ATOMIC_RELAXED);
+				ret = 0;
+			}
+			goto out;
+		} else {
+			pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->level = level;
+	if (len < sizeof(slot->text)) {
+		memcpy(slot->text, str, len + 1);
+		slot->heap = NULL;
+	} else {
+		slot->heap = u_strdup(str);
+	}
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	if (__atomic_load_n(&ring_sleeping, __ATOMIC_RELAXED))
+		pthread_cond_signal(&ring_cond);
+	ret = 0;
+out:
+	__atomic_sub_fetch(&ring_users, 1, __ATOMIC_SEQ_CST);
+	return ret;
+}
+
+static void *ring_consumer(void *arg)
+{
+	debug_slot_t *slot;
+	struct timeval tv;
+	struct timespec ts;
+
+	for (;;) {
+		slot = &ring[ring_tail & ring_mask];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) ==
+				ring_tail + 1) {
+			call_handlers(slot->level,
+				      slot->heap ? slot->heap : slot->text);
+			u_free(slot->heap);
+			slot->heap = NULL;
+			__atomic_store_n(&slot->seq, ring_tail + ring_mask + 1,
+					 __ATOMIC_RELEASE);
+			ring_tail++;
+			continue;
+		}
+		if (__atomic_load_n(&ring_quit, __ATOMIC_SEQ_CST))
+			break;
+
+		/* producers only signal a sleeping consumer; a wakeup lost
+		 * in between costs at most one timeout */
+		pthread_mutex_lock(&ring_mutex);
+		__atomic_store_n(&ring_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) !=
+				ring_tail + 1 &&
+		    !__atomic_load_n(&ring_quit, __ATOMIC_SEQ_CST)) {
+			gettimeofday(&tv, NULL);
+			ts.tv_sec = tv.tv_sec;
+			ts.tv_nsec = tv.tv_usec * 1000 + 50 * 1000000;
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&ring_cond, &ring_mutex, &ts);
+		}
+		__atomic_store_n(&ring_sleeping, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&ring_mutex);
+	}
+	return NULL;
+}
+
+/* a child of fork() has no consumer, it delivers in place */
+static void ring_atfork_child(void)
+{
+	ring_running = 0;
+	ring_users = 0;
+	ring = NULL;
+	pthread_mutex_init(&ring_mutex, NULL);
+	pthread_cond_init(&ring_cond, NULL);
+}
+
+int debug_async_start(unsigned int slots)
+{
+	static int atfork = 0;
+	size_t i, size = 1;
+
+	if (ring != NULL || slots == 0)
+		return -1;
+	if (!atfork && pthread_atfork(NULL, NULL, ring_atfork_child) == 0)
+		atfork = 1;
+	while (size < slots)
+		size <<= 1;
+	ring = u_zalloc(size * sizeof(debug_slot_t));
+	if (ring == NULL)
+		return -1;
+	for (i = 0; i < size; i++)
+		ring[i].seq = i;
+	ring_mask = size - 1;
+	ring_head = ring_tail = 0;
+	ring_quit = 0;
+	ring_dropped = 0;
+	if (pthread_create(&ring_thread, NULL, ring_consumer, NULL) != 0) {
+		u_free(ring);
+		ring = NULL;
+		return -1;
+	}
+	__atomic_store_n(&ring_running, 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+void debug_async_stop(void)
+{
+	if (ring == NULL)
+		return;
+	/* new messages are delivered in place from now on, wait for the
+	 * ones on their way into the ring */
+	__atomic_store_n(&ring_running, 0, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&ring_users, __ATOMIC_SEQ_CST) > 0)
+		sched_yield();
+
+	pthread_mutex_lock(&ring_mutex);
+	__atomic_store_n(&ring_quit, 1, __ATOMIC_SEQ_CST);
+	pthread_cond_signal(&ring_cond);
+	pthread_mutex_unlock(&ring_mutex);
+	pthread_join(ring_thread, NULL);
+
+	u_free(ring);
+	ring = NULL;
+}
+
+unsigned long debug_async_dropped(void)
+{
+	return __atomic_load_n(&ring_dropped, __ATOMIC_RELAXED);
+}
+
+#else
+
+static int ring_put(debug_level_e level, const char *str, size_t len)
+{
+	return -1;
+}
+
+int debug_async_start(unsigned int slots)
+{
+	return -1;
+}
+
+void debug_async_stop(void)
+{
+}
+
+unsigned long debug_async_dropped(void)
+{
+	return 0;
+}
+#endif
+
+
+static void deliver(debug_level_e level, const char *str, size_t len)
+{
+	if (ring_put(level, str, len) != 0)
+		call_handlers(level, str);
+}
+
+/* format into buf if the message fits, else into a u_malloc()ed string */
+static char *debug_vformat(char *buf, size_t size, size_t *len,
+		const char *format, va_list args)
+{
+	va_list copy;
+	char *str;
+	int n;
+
+	va_copy(copy, args);
+	n = vsnprintf(buf, size, format, copy);
+	va_end(copy);
+	if (n >= 0 && (size_t) n < size) {
+		*len = n;
+		return buf;
+	}
+	str = u_strdup_vprintf(format, args);
+	*len = str ? strlen(str) : 0;
+	return str;
+}
+
+
 void debug_full(debug_level_e level, const char *format, ...)
 {
 	va_list args;
+	char buf[DEBUG_STACK_SIZE];
 	char *str;
+	size_t len;
 
-	if (handlers == NULL) {
+	if ((int) level > DEBUG_LOAD(&debug_max_level)) {
 		return;
 	}
 
 	va_start(args, format);
-	str = u_strdup_vprintf(format, args);
+	str = debug_vformat(buf, sizeof(buf), &len, format, args);
 	va_end(args);
+	if (str == NULL)
+		return;
 
-	call_handlers(level, str);
+	deliver(level, str, len);
 
-	u_free(str);
+	if (str != buf)
+		u_free(str);
 }
 
 
@@ -132,21 +448,28 @@ debug_full_verbose(debug_level_e level,
 		   int line, const char *proc, const char *format, ...)
 {
 	va_list args;
+	char buf[DEBUG_STACK_SIZE];
 	char *str;
 	char *body;
+	size_t len;
 
-	if (handlers == NULL) {
+	if ((int) level > DEBUG_LOAD(&debug_max_level)) {
 		return;
 	}
 
 	va_start(args, format);
-	body = u_strdup_vprintf(format, args);
+	body = debug_vformat(buf, sizeof(buf), &len, format, args);
 	va_end(args);
+	if (body == NULL)
+		return;
 	str = u_strdup_printf("[%d] %s:%d(%s) %s",
 			      level, file, line, proc, body);
-	u_free(body);
+	if (body != buf)
+		u_free(body);
+	if (str == NULL)
+		return;
 
-	call_handlers(level, str);
+	deliver(level, str, strlen(str));
 
 	u_free(str);
 }
@@ -0,0 +1,280 @@
+/*
+ * gzip and deflate content codings (RFC 7230 section 4.2) for HTTP
+ * message bodies. Without zlib only the identity coding is available.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include <u/libu.h>
+#include <u/gzip.h>
+
+/**
+ *  \defgroup gzip Gzip
+ *  \{
+ */
+
+/** \brief Non-zero if the library was built with zlib */
+int u_gzip_supported(void)
+{
+#ifdef HAVE_ZLIB
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * \brief  Map a Content-Encoding header value to a coding
+ *
+ * \return \c U_GZIP_IDENTITY for a missing or identity coding, \c -1 for
+ *         a coding this build cannot decode
+ */
+int u_gzip_coding(const char *content_encoding)
+{
+    const char *p = content_encoding;
+    size_t len;
+
+    if (p == NULL)
+        return U_GZIP_IDENTITY;
+    while (isspace((unsigned char) *p))
+        p++;
+    for (len = 0; p[len] && !isspace((unsigned char) p[len]); len++)
+        ;
+    if (len == 0 || (len == 8 && !strncasecmp(p, "identity", len)))
+        return U_GZIP_IDENTITY;
+    if (!u_gzip_supported())
+        return -1;
+    if ((len == 4 && !strncasecmp(p, "gzip", len)) ||
+        (len == 6 && !strncasecmp(p, "x-gzip", len)))
+        return U_GZIP_GZIP;
+    if (len == 7 && !strncasecmp(p, "deflate", len))
+        return U_GZIP_DEFLATE;
+    return -1;
+}
+
+/**
+ * \brief  Pick the coding to answer an Accept-Encoding header with
+ *
+ * gzip is preferred over deflate; codings with a quality of 0 are
+ * ruled out.
+ *
+ * \return \c U_GZIP_GZIP, \c U_GZIP_DEFLATE or \c U_GZIP_IDENTITY
+ */
+int u_gzip_accepted(const char *accept_encoding)
+{
+    const char *p = accept_encoding, *name, *q;
+    size_t len;
+    int gzip = 0, deflate = 0, any = 0, refused;
+
+    if (p == NULL || !u_gzip_supported())
+        return U_GZIP_IDENTITY;
+
+    while (*p) {
+        while (*p == ',' || isspace((unsigned char) *p))
+            p++;
+        name = p;
+        while (*p && *p != ',' && *p != ';' && !isspace((unsigned char) *p))
+            p++;
+        len = p - name;
+
+        refused = 0;
+        while (*p && *p != ',') {
+            if (*p == ';') {
+                q = p + 1;
+                while (isspace((unsigned char) *q))
+                    q++;
+                if ((*q == 'q' || *q == 'Q') && q[1] == '=')
+                    refused = (strtod(q + 2, NULL) <= 0.0);
+            }
+            p++;
+        }
+        if (len == 0)
+            continue;
+
+        if ((len == 4 && !strncasecmp(name, "gzip", len)) ||
+            (len == 6 && !strncasecmp(name, "x-gzip", len)))
+            gzip = refused ? -1 : 1;
+        else if (len == 7 && !strncasecmp(name, "deflate", len))
+            deflate = refused ? -1 : 1;
+        else if (len == 1 && *name == '*')
+            any = refused ? -1 : 1;
+    }
+
+    if (gzip > 0 || (gzip == 0 && any > 0))
+        return U_GZIP_GZIP;
+    if (deflate > 0 || (deflate == 0 && any > 0))
+        return U_GZIP_DEFLATE;
+    return U_GZIP_IDENTITY;
+}
+
+/** \brief Content-Encoding token of \a coding, \c NULL for identity */
+const char *u_gzip_name(int coding)
+{
+    switch (coding) {
+    case U_GZIP_GZIP:
+        return "gzip";
+    case U_GZIP_DEFLATE:
+        return "deflate";
+    }
+    return NULL;
+}
+
+/**
+ * \brief  Compress \a len bytes at \a in
+ *
+ * \param coding  \c U_GZIP_GZIP or \c U_GZIP_DEFLATE (zlib format)
+ * \param level   zlib compression level, 1 (fast) to 9 (small)
+ * \param out     on success a u_malloc()ed buffer with the result
+ * \param outlen  size of \a out
+ *
+ * \return \c 0 on success, \c ~0 on failure
+ */
+int u_gzip_compress(int coding, int level, const char *in, size_t len,
+        char **out, size_t *outlen)
+{
+#ifdef HAVE_ZLIB
+    z_stream z;
+    size_t size;
+    char *buf = NULL;
+    int rc;
+
+    dbg_return_if(out == NULL || outlen == NULL, ~0);
+    dbg_return_if(coding != U_GZIP_GZIP && coding != U_GZIP_DEFLATE, ~0);
+
+    memset(&z, 0, sizeof(z));
+    if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION)
+        level = Z_DEFAULT_COMPRESSION;
+    /* 16 more window bits select the gzip wrapper */
+    dbg_return_if(deflateInit2(&z, level, Z_DEFLATED,
+                coding == U_GZIP_GZIP ? 15 + 16 : 15, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK, ~0);
+
+    size = deflateBound(&z, len);
+    buf = u_malloc(size);
+    dbg_err_if(buf == NULL);
+
+    z.next_in = (Bytef *) in;
+    z.avail_in = len;
+    z.next_out = (Bytef *) buf;
+    z.avail_out = size;
+    rc = deflate(&z, Z_FINISH);
+    dbg_err_if(rc != Z_STREAM_END);
+
+    *out = buf;
+    *outlen = z.total_out;
+    deflateEnd(&z);
+    return 0;
+err:
+    deflateEnd(&z);
+    u_free(buf);
+    return ~0;
+#else
+    return ~0;
+#endif
+}
+
+#ifdef HAVE_ZLIB
+static int gzip_inflate(int window_bits, const char *in, size_t len,
+        size_t max, char **out, size_t *outlen)
+{
+    z_stream z;
+    size_t size = len * 4 + 256;
+    char *buf = NULL, *nbuf;
+    int rc;
+
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, window_bits) != Z_OK)
+        return Z_MEM_ERROR;
+
+    if (max && size > max)
+        size = max;
+    buf = u_malloc(size + 1);
+    if (buf == NULL) {
+        rc = Z_MEM_ERROR;
+        goto out;
+    }
+
+    z.next_in = (Bytef *) in;
+    z.avail_in = len;
+    for (;;) {
+        z.next_out = (Bytef *) buf + z.total_out;
+        z.avail_out = size - z.total_out;
+        rc = inflate(&z, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END)
+            break;
+        if (rc != Z_OK && rc != Z_BUF_ERROR)
+            goto out;
+        if (z.avail_out) {
+            /* ran out of input before the end of the stream */
+            rc = Z_DATA_ERROR;
+            goto out;
+        }
+        if (max && size >= max) {
+            rc = Z_BUF_ERROR;
+            goto out;
+        }
+        size *= 2;
+        if (max && size > max)
+            size = max;
+        if ((nbuf = u_realloc(buf, size + 1)) == NULL) {
+            rc = Z_MEM_ERROR;
+            goto out;
+        }
+        buf = nbuf;
+    }
+
+    /* callers get a terminated string for free */
+    buf[z.total_out] = '\0';
+    *out = buf;
+    *outlen = z.total_out;
+    buf = NULL;
+    rc = Z_OK;
+out:
+    inflateEnd(&z);
+    u_free(buf);
+    return rc;
+}
+#endif
+
+/**
+ * \brief  Uncompress a gzip or deflate coded body
+ *
+ * Both the zlib format mandated for the deflate coding and the raw
+ * deflate data sent by some implementations are accepted.
+ *
+ * \param max     limit for the uncompressed size, \c 0 for none
+ * \param out     on success a u_malloc()ed, '\\0' terminated buffer
+ * \param outlen  size of \a out, not counting the terminator
+ *
+ * \return \c 0 on success, \c ~0 on corrupt data or if the result would
+ *         exceed \a max
+ */
+int u_gzip_uncompress(const char *in, size_t len, size_t max,
+        char **out, size_t *outlen)
+{
+#ifdef HAVE_ZLIB
+    int rc;
+
+    dbg_return_if(out == NULL || outlen == NULL, ~0);
+
+    /* 32 more window bits detect zlib and gzip headers */
+    rc = gzip_inflate(15 + 32, in, len, max, out, outlen);
+    if (rc == Z_DATA_ERROR)
+        rc = gzip_inflate(-15, in, len, max, out, outlen);
+    return rc == Z_OK ? 0 : ~0;
+#else
+    return ~0;
+#endif
+}
+
+/**
+ *      \}
+ */
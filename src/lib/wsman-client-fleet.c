@@ -0,0 +1,518 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Running one operation against many endpoints.
+ *
+ * All requests go through a single asynchronous driver. The fleet keeps
+ * at most max_requests of them in flight and leaves the per host limit
+ * to curl. Requests to be retried wait in a list ordered by the time
+ * they are due; an enumeration goes on with its Pull through the same
+ * list.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#ifndef _WIN32
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-soap-envelope.h"
+#include "wsman-xml.h"
+#include "wsman-client-transport.h"
+#include "wsman-client.h"
+
+typedef struct _WsManFleetEndpoint {
+	WsManClient *cl;
+	int own_client;
+	void *user_data;
+	unsigned int index;
+	WsmanAction action;	/* of the next request */
+	char *context;		/* EnumerationContext of the next Pull */
+	unsigned int attempts;	/* of the current request */
+	double sent;		/* current attempt went out */
+	double due;		/* waiting until then */
+	int failed;
+	/* latency of the last run */
+	double latency_sum;
+	unsigned long responses;
+	struct _WsManFleetEndpoint *next;
+} WsManFleetEndpoint;
+
+struct _WsManFleet {
+	WsManAsync *as;
+	unsigned int max_requests;
+	unsigned int retries;
+	unsigned long backoff;	/* milliseconds */
+	unsigned long max_backoff;
+	unsigned long timeout;
+	WsManFleetEndpoint **endpoints;
+	unsigned int count;
+	unsigned int size;
+	WsManFleetEndpoint *waiting;	/* by due time */
+	unsigned int seed;
+	WsManFleetStats stats;
+};
+
+/* the operation of a run */
+typedef struct {
+	const char *resource_uri;
+	client_opt_t *options;
+	filter_t *filter;
+	const char *method;
+	WsXmlDocH body;
+} FleetOperation;
+
+
+static double
+fleet_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+	{
+		struct timeval tv;
+
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec + tv.tv_usec / 1e6;
+	}
+}
+
+static void
+fleet_wait(WsManFleet *f, WsManFleetEndpoint *ep, double due)
+{
+	WsManFleetEndpoint **p = &f->waiting;
+
+	ep->due = due;
+	while (*p && (*p)->due <= due)
+		p = &(*p)->next;
+	ep->next = *p;
+	*p = ep;
+}
+
+/* delay before the next attempt, in seconds */
+static double
+fleet_backoff(WsManFleet *f, unsigned int attempts)
+{
+	unsigned long delay = f->backoff;
+
+	while (--attempts > 0 && delay < f->max_backoff)
+		delay *= 2;
+	if (delay > f->max_backoff)
+		delay = f->max_backoff;
+	/* spread retries of endpoints which failed together */
+	if (delay > 1)
+		delay = delay / 2 + rand_r(&f->seed) % (delay / 2 + 1);
+	return delay / 1000.0;
+}
+
+static WsXmlDocH
+fleet_create_request(WsManFleetEndpoint *ep, FleetOperation *op)
+{
+	WsXmlDocH request = wsmc_create_request(ep->cl, op->resource_uri,
+			op->options, op->filter, ep->action,
+			(char *) op->method, ep->context);
+	WsXmlNodeH body;
+
+	if (request == NULL || op->body == NULL ||
+			ep->action == WSMAN_ACTION_PULL)
+		return request;
+	if (wsman_is_valid_xml_envelope(op->body)) {
+		body = ws_xml_get_soap_body(op->body);
+		ws_xml_duplicate_tree(ws_xml_get_soap_body(request),
+				ws_xml_get_child(body, 0, NULL, NULL));
+	} else {
+		ws_xml_duplicate_tree(ws_xml_get_soap_body(request),
+				ws_xml_get_doc_root(op->body));
+	}
+	return request;
+}
+
+static void
+fleet_report(WsManFleetEndpoint *ep, WsManAsyncRequest *req,
+		WsXmlDocH response, double latency, int more,
+		wsmc_fleet_callback_t callback, void *data)
+{
+	WsManFleetResult result;
+
+	if (callback == NULL)
+		return;
+	result.index = ep->index;
+	result.client = ep->cl;
+	result.user_data = ep->user_data;
+	result.response = response;
+	result.response_code = req ? wsmc_async_request_get_response_code(req) : 0;
+	result.last_error = req ? wsmc_async_request_get_last_error(req) :
+		ep->cl->last_error;
+	result.fault_string = req ? wsmc_async_request_get_fault_string(req) :
+		ep->cl->fault_string;
+	result.attempts = ep->attempts;
+	result.latency = latency;
+	result.more = more;
+	callback(&result, data);
+}
+
+/* returns 1 if a request is in flight for ep */
+static int
+fleet_send(WsManFleet *f, WsManFleetEndpoint *ep, FleetOperation *op,
+		wsmc_fleet_callback_t callback, void *data)
+{
+	WsXmlDocH request = fleet_create_request(ep, op);
+	WsManAsyncRequest *req = NULL;
+
+	ep->attempts++;
+	ep->sent = fleet_now();
+	if (request) {
+		req = wsmc_async_send(f->as, ep->cl, request, f->timeout,
+				NULL, ep);
+		ws_xml_destroy_doc(request);
+	}
+	if (req == NULL) {
+		ep->failed = 1;
+		fleet_report(ep, NULL, NULL, 0, 0, callback, data);
+		return 0;
+	}
+	f->stats.requests++;
+	return 1;
+}
+
+/*
+ * worth another attempt: a request which never reached the server, or
+ * a read which got no answer or a 5xx without SOAP fault. A Pull may
+ * have moved its EnumerationContext on and writes may have been done
+ * when the answer was lost, they are not sent again.
+ */
+static int
+fleet_should_retry(WsManAsyncRequest *req, WsmanAction action)
+{
+	WS_LASTERR_Code err = wsmc_async_request_get_last_error(req);
+	long code = wsmc_async_request_get_response_code(req);
+
+	switch (err) {
+	case WS_LASTERR_OK:
+	case WS_LASTERR_LOGIN_DENIED:
+		return 0;
+	case WS_LASTERR_COULDNT_RESOLVE_PROXY:
+	case WS_LASTERR_COULDNT_RESOLVE_HOST:
+	case WS_LASTERR_COULDNT_CONNECT:
+		return 1;
+	default:
+		break;
+	}
+	switch (action) {
+	case WSMAN_ACTION_IDENTIFY:
+	case WSMAN_ACTION_ANON_IDENTIFY:
+	case WSMAN_ACTION_TRANSFER_GET:
+	case WSMAN_ACTION_ENUMERATION:
+		return code == 0 || code >= 500;
+	default:
+		return 0;
+	}
+}
+
+/* next EnumerationContext of a page, NULL at the end */
+static char *
+fleet_next_context(WsXmlDocH response)
+{
+	WsXmlNodeH node = ws_xml_get_child(ws_xml_get_soap_body(response),
+			0, NULL, NULL);
+
+	if (node == NULL || ws_xml_get_child(node, 0, XML_NS_ENUMERATION,
+				WSENUM_END_OF_SEQUENCE))
+		return NULL;
+	return wsmc_get_enum_context(response);
+}
+
+static void
+fleet_done(WsManFleet *f, WsManAsyncRequest *req, double now,
+		wsmc_fleet_callback_t callback, void *data)
+{
+	WsManFleetEndpoint *ep = wsmc_async_request_get_user_data(req);
+	double latency = now - ep->sent;
+	WsXmlDocH response = NULL;
+	char *context = NULL;
+
+	if (fleet_should_retry(req, ep->action) &&
+			ep->attempts <= f->retries) {
+		f->stats.retries++;
+		fleet_wait(f, ep, now + fleet_backoff(f, ep->attempts));
+		return;
+	}
+
+	ep->latency_sum += latency;
+	ep->responses++;
+	if (latency > f->stats.latency_max)
+		f->stats.latency_max = latency;
+	if (wsmc_async_request_get_last_error(req) == WS_LASTERR_OK)
+		response = wsmc_async_request_get_response(req);
+	if (response == NULL ||
+			wsmc_async_request_get_response_code(req) != 200)
+		ep->failed = 1;
+	else if (ep->action == WSMAN_ACTION_ENUMERATION ||
+			ep->action == WSMAN_ACTION_PULL)
+		context = fleet_next_context(response);
+
+	fleet_report(ep, req, response, latency, context != NULL,
+			callback, data);
+
+	u_free(ep->context);
+	ep->context = context;
+	if (context) {
+		ep->action = WSMAN_ACTION_PULL;
+		ep->attempts = 0;
+		fleet_wait(f, ep, now);
+	}
+}
+
+WsManFleet *
+wsmc_fleet_create(unsigned int max_requests, unsigned int host_limit)
+{
+	WsManFleet *f = u_zalloc(sizeof(WsManFleet));
+
+	if (f == NULL)
+		return NULL;
+	f->as = wsmc_async_create(max_requests);
+	if (f->as == NULL) {
+		u_free(f);
+		return NULL;
+	}
+	if (host_limit)
+		wsmc_async_set_host_limit(f->as, host_limit);
+	f->max_requests = max_requests ? max_requests : (unsigned int) -1;
+	f->backoff = 100;
+	f->max_backoff = 10000;
+	f->seed = (unsigned int) time(NULL) ^ (unsigned int) getpid();
+	return f;
+}
+
+void
+wsmc_fleet_set_retry(WsManFleet *f, unsigned int retries,
+		unsigned long backoff_ms, unsigned long max_backoff_ms)
+{
+	f->retries = retries;
+	f->backoff = backoff_ms;
+	f->max_backoff = max_backoff_ms > backoff_ms ?
+		max_backoff_ms : backoff_ms;
+}
+
+void
+wsmc_fleet_set_timeout(WsManFleet *f, unsigned long timeout)
+{
+	f->timeout = timeout;
+}
+
+static int
+fleet_add(WsManFleet *f, WsManClient *cl, int own_client, void *user_data)
+{
+	WsManFleetEndpoint *ep, **endpoints;
+
+	if (f->count == f->size) {
+		unsigned int size = f->size ? f->size * 2 : 16;
+
+		endpoints = u_realloc(f->endpoints,
+				size * sizeof(WsManFleetEndpoint *));
+		if (endpoints == NULL)
+			return -1;
+		f->endpoints = endpoints;
+		f->size = size;
+	}
+	ep = u_zalloc(sizeof(WsManFleetEndpoint));
+	if (ep == NULL)
+		return -1;
+	ep->cl = cl;
+	ep->own_client = own_client;
+	ep->user_data = user_data;
+	ep->index = f->count;
+	f->endpoints[f->count] = ep;
+	return f->count++;
+}
+
+int
+wsmc_fleet_add_endpoint(WsManFleet *f, const char *endpoint,
+		void *user_data)
+{
+	WsManClient *cl;
+	int index;
+
+	if (endpoint == NULL || (cl = wsmc_create_from_uri(endpoint)) == NULL)
+		return -1;
+	index = fleet_add(f, cl, 1, user_data);
+	if (index < 0)
+		wsmc_release(cl);
+	return index;
+}
+
+int
+wsmc_fleet_add_client(WsManFleet *f, WsManClient *cl, void *user_data)
+{
+	return cl ? fleet_add(f, cl, 0, user_data) : -1;
+}
+
+unsigned int
+wsmc_fleet_count(WsManFleet *f)
+{
+	return f->count;
+}
+
+WsManClient *
+wsmc_fleet_get_client(WsManFleet *f, unsigned int index)
+{
+	return index < f->count ? f->endpoints[index]->cl : NULL;
+}
+
+int
+wsmc_fleet_run(WsManFleet *f, const char *resource_uri,
+		client_opt_t *options, filter_t *filter,
+		WsmanAction action, const char *method, WsXmlDocH body,
+		wsmc_fleet_callback_t callback, void *data)
+{
+	FleetOperation op = { resource_uri, options, filter, method, body };
+	WsManFleetEndpoint *ep;
+	WsManAsyncRequest *req;
+	unsigned int next = 0, in_flight = 0, i;
+	unsigned long responses = 0;
+	double start = fleet_now(), now, latency_sum = 0;
+	long wait;
+	int failed = 0;
+
+	if (action == WSMAN_ACTION_PULL || action == WSMAN_ACTION_RELEASE)
+		return -1;
+	memset(&f->stats, 0, sizeof(f->stats));
+	for (i = 0; i < f->count; i++) {
+		ep = f->endpoints[i];
+		ep->action = action;
+		ep->attempts = 0;
+		ep->failed = 0;
+		ep->latency_sum = 0;
+		ep->responses = 0;
+	}
+
+	while (next < f->count || in_flight > 0 || f->waiting) {
+		now = fleet_now();
+		/* retries and Pulls first, they hold enumerations open */
+		while (in_flight < f->max_requests && f->waiting &&
+				f->waiting->due <= now) {
+			ep = f->waiting;
+			f->waiting = ep->next;
+			in_flight += fleet_send(f, ep, &op, callback, data);
+		}
+		while (in_flight < f->max_requests && next < f->count) {
+			ep = f->endpoints[next++];
+			in_flight += fleet_send(f, ep, &op, callback, data);
+		}
+
+		wait = 1000;
+		if (f->waiting) {
+			wait = (long) ((f->waiting->due - now) * 1000);
+			if (wait < 0)
+				wait = 0;
+		}
+		if (in_flight == 0) {
+			if (wait > 0)
+				usleep(wait * 1000);
+			continue;
+		}
+		if (wsmc_async_perform(f->as, wait) < 0) {
+			error("fleet: async transfer failed");
+			break;
+		}
+		now = fleet_now();
+		while ((req = wsmc_async_next_done(f->as)) != NULL) {
+			in_flight--;
+			fleet_done(f, req, now, callback, data);
+			wsmc_async_request_release(req);
+		}
+	}
+
+	for (i = 0; i < f->count; i++) {
+		ep = f->endpoints[i];
+		u_free(ep->context);
+		ep->context = NULL;
+		latency_sum += ep->latency_sum;
+		responses += ep->responses;
+		if (ep->failed)
+			failed++;
+	}
+	f->waiting = NULL;
+	f->stats.failures = failed;
+	f->stats.elapsed = fleet_now() - start;
+	if (responses)
+		f->stats.latency_avg = latency_sum / responses;
+	return failed;
+}
+
+void
+wsmc_fleet_get_stats(WsManFleet *f, WsManFleetStats *stats)
+{
+	*stats = f->stats;
+}
+
+double
+wsmc_fleet_get_latency(WsManFleet *f, unsigned int index)
+{
+	WsManFleetEndpoint *ep;
+
+	if (index >= f->count)
+		return 0;
+	ep = f->endpoints[index];
+	return ep->responses ? ep->latency_sum / ep->responses : 0;
+}
+
+void
+wsmc_fleet_release(WsManFleet *f)
+{
+	unsigned int i;
+
+	if (f == NULL)
+		return;
+	wsmc_async_release(f->as);
+	for (i = 0; i < f->count; i++) {
+		if (f->endpoints[i]->own_client)
+			wsmc_release(f->endpoints[i]->cl);
+		u_free(f->endpoints[i]->context);
+		u_free(f->endpoints[i]);
+	}
+	u_free(f->endpoints);
+	u_free(f);
+}
+
+#endif /* _WIN32 */
@@ -63,6 +63,8 @@ static char *auth_methods[] = {
 
 extern void wsmc_handler(WsManClient * cl, WsXmlDocH rqstDoc,
 				 void *user_data);
+extern void wsmc_buffer_handler(WsManClient * cl, const char *buf, int len,
+				 void *user_data);
 
 #ifdef BENCHMARK
 static long long transfer_time = 0;
@@ -101,6 +103,39 @@ int wsman_send_request(WsManClient * cl, WsXmlDocH request)
 	return ret;
 }
 
+int wsman_send_request_buf(WsManClient * cl, const char *buf, int len)
+{
+	int ret = 0;
+#ifdef BENCHMARK
+	struct timeval tv0, tv1;
+	long long t0, t1;
+#endif
+
+	if (wsmc_lock(cl) != 0 ) {
+		error("Client busy");
+		return 1;
+	}
+	wsmc_reinit_conn(cl);
+
+#ifdef BENCHMARK
+	gettimeofday(&tv0, NULL);
+#endif
+
+	wsmc_buffer_handler(cl, buf, len, NULL);
+	if (cl->last_error != WS_LASTERR_OK) {
+		warning("Couldn't send request to client: %s\n", cl->fault_string);
+		ret = 1;
+	}
+#ifdef BENCHMARK
+	gettimeofday(&tv1, NULL);
+	t0 = tv0.tv_sec * 10000000 + tv0.tv_usec;
+	t1 = tv1.tv_sec * 10000000 + tv1.tv_usec;
+	transfer_time += t1 - t0;
+#endif
+	wsmc_unlock(cl);
+	return ret;
+}
+
 #ifdef BENCHMARK
 long long get_transfer_time()
 {
@@ -250,6 +285,67 @@ wsman_auth_type_t wsmc_transport_get_auth_value(WsManClient * cl)
 }
 
 
+unsigned long wsman_transport_get_round_trips(WsManClient *cl)
+{
+	return cl->round_trips;
+}
+
+unsigned long wsman_transport_get_tls_handshakes(WsManClient *cl)
+{
+	return cl->tls_handshakes;
+}
+
+unsigned long wsman_transport_get_tls_resumptions(WsManClient *cl)
+{
+	return cl->tls_resumptions;
+}
+
+const char *wsman_transport_get_response_charset(WsManClient *cl)
+{
+	return cl->response_charset;
+}
+
+void wsman_transport_set_response_buffering(WsManClient * cl, unsigned int arg)
+{
+	cl->connection->unbuffered = !arg;
+}
+
+unsigned int wsman_transport_get_response_buffering(WsManClient *cl)
+{
+	return !cl->connection->unbuffered;
+}
+
+void wsman_transport_set_response_parsing(WsManClient * cl, unsigned int arg)
+{
+	cl->connection->unparsed = !arg;
+}
+
+unsigned int wsman_transport_get_response_parsing(WsManClient *cl)
+{
+	return !cl->connection->unparsed;
+}
+
+void wsman_transport_set_accept_compression(WsManClient * cl, unsigned int arg)
+{
+	cl->accept_compression = arg;
+}
+
+unsigned int wsman_transport_get_accept_compression(WsManClient *cl)
+{
+	return cl->accept_compression;
+}
+
+void wsman_transport_set_request_compression(WsManClient * cl, unsigned long arg)
+{
+	cl->request_compression = arg;
+}
+
+unsigned long wsman_transport_get_request_compression(WsManClient *cl)
+{
+	return cl->request_compression;
+}
+
+
 void wsman_transport_set_verify_peer(WsManClient * cl, unsigned int arg)
 {
 	cl->authentication.verify_peer = arg;
@@ -79,6 +79,48 @@ wsmc_get_conffile(WsManClient *cl)
 {
         return cl->client_config_file;
 }
+
+/* client configuration files, each parsed once per process */
+typedef struct _WsmcConf {
+	char *file;
+	dictionary *ini;	/* NULL if the file could not be read */
+	struct _WsmcConf *next;
+} WsmcConf;
+
+static WsmcConf *conf_files = NULL;
+static pthread_mutex_t conf_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Parsed configuration file of the client, shared with all clients
+ * using the same file
+ * @param cl Client handle
+ * @return dictionary, not to be modified or freed, or NULL
+ */
+dictionary *
+wsmc_get_conf(WsManClient *cl)
+{
+	WsmcConf *conf;
+	dictionary *ini = NULL;
+	char *file = wsmc_get_conffile(cl);
+
+	if (file == NULL)
+		return NULL;
+	pthread_mutex_lock(&conf_mutex);
+	for (conf = conf_files; conf; conf = conf->next) {
+		if (!strcmp(conf->file, file))
+			break;
+	}
+	if (conf == NULL && (conf = u_zalloc(sizeof(WsmcConf))) != NULL) {
+		conf->file = u_strdup(file);
+		conf->ini = iniparser_new(file);
+		conf->next = conf_files;
+		conf_files = conf;
+	}
+	if (conf)
+		ini = conf->ini;
+	pthread_mutex_unlock(&conf_mutex);
+	return ini;
+}
 #endif
 
 
@@ -516,6 +558,20 @@ wsmc_add_selector_epr(client_opt_t *options,
   _wsmc_add_key_value(&(options->selectors), key, NULL, value, false);
 }
 
+void
+wsmc_clear_selectors(client_opt_t *options)
+{
+  _wsmc_kvl_destroy(options->selectors);
+  options->selectors = NULL;
+}
+
+void
+wsmc_clear_properties(client_opt_t *options)
+{
+  _wsmc_kvl_destroy(options->properties);
+  options->properties = NULL;
+}
+
 static void
 _wsmc_add_uri_to_list(list_t **list_ptr, const char *query_string)
 {
@@ -1633,6 +1689,228 @@ wsmc_action_enumerate_and_pull(WsManClient * cl,
 
 
 
+#ifndef _WIN32
+struct _WsManEnumStream {
+	WsManClient *cl;
+	WsManAsync *as;
+	char *resource_uri;
+	client_opt_t *options;
+	filter_t *filter;
+	WsManAsyncRequest *page;	/* response being read */
+	WsXmlReaderH reader;
+	WsManAsyncRequest *next;	/* request in flight */
+	char *context;		/* context not passed on to a request */
+	int failed;
+};
+
+static WsManAsyncRequest *
+enum_stream_send(WsManEnumStream *s, WsmanAction action,
+		const char *context)
+{
+	WsManAsyncRequest *req;
+	WsXmlDocH request = wsmc_create_request(s->cl, s->resource_uri,
+			s->options, s->filter, action, NULL, (void *) context);
+
+	if (request == NULL)
+		return NULL;
+	req = wsmc_async_send(s->as, s->cl, request, 0, NULL, NULL);
+	ws_xml_destroy_doc(request);
+	return req;
+}
+
+static WsManAsyncRequest *
+enum_stream_wait(WsManEnumStream *s)
+{
+	WsManAsyncRequest *req;
+
+	while ((req = wsmc_async_next_done(s->as)) == NULL) {
+		if (wsmc_async_perform(s->as, 1000) < 0 ||
+				wsmc_async_pending(s->as) == 0)
+			return wsmc_async_next_done(s->as);
+	}
+	return req;
+}
+
+/* copy the outcome of req to the client, the way a synchronous request
+ * leaves it */
+static int
+enum_stream_check(WsManEnumStream *s, WsManAsyncRequest *req)
+{
+	WsManClient *cl = s->cl;
+	const char *data;
+	size_t size;
+
+	wsmc_reinit_conn(cl);
+	cl->response_code = wsmc_async_request_get_response_code(req);
+	cl->last_error = wsmc_async_request_get_last_error(req);
+	if (wsmc_async_request_get_fault_string(req))
+		cl->fault_string =
+			u_strdup(wsmc_async_request_get_fault_string(req));
+	if (cl->last_error == WS_LASTERR_OK && cl->response_code == 200)
+		return 1;
+
+	data = wsmc_async_request_get_data(req, &size);
+	if (data)
+		u_buf_append(cl->connection->response, (void *) data, size);
+	return 0;
+}
+
+WsManEnumStream *
+wsmc_enum_stream_open(WsManClient * cl,
+		const char *resource_uri,
+		client_opt_t *options,
+		filter_t *filter)
+{
+	WsManEnumStream *s = u_zalloc(sizeof(WsManEnumStream));
+
+	if (s == NULL) {
+		cl->last_error = WS_LASTERR_OUT_OF_MEMORY;
+		return NULL;
+	}
+	s->cl = cl;
+	s->options = options;
+	s->filter = filter;
+	s->resource_uri = u_strdup(resource_uri);
+	/* one request at a time, the next Pull overlaps reading a page */
+	s->as = wsmc_async_create(1);
+	if (s->as == NULL) {
+		cl->last_error = WS_LASTERR_FAILED_INIT;
+		goto err;
+	}
+	s->next = enum_stream_send(s, WSMAN_ACTION_ENUMERATION, NULL);
+	if (s->next == NULL)
+		goto err;
+	return s;
+err:
+	wsmc_enum_stream_close(s);
+	return NULL;
+}
+
+WsXmlNodeH
+wsmc_enum_stream_next(WsManEnumStream * s)
+{
+	WsXmlNodeH node;
+	const char *data;
+	size_t size;
+	int what;
+
+	while (!s->failed) {
+		if (s->reader == NULL) {
+			if (s->next == NULL)
+				return NULL;
+			s->page = enum_stream_wait(s);
+			s->next = NULL;
+			if (s->page == NULL || !enum_stream_check(s, s->page))
+				break;
+			data = wsmc_async_request_get_data(s->page, &size);
+			s->reader = ws_xml_reader_new(data, size,
+					s->cl->content_encoding);
+			if (s->reader == NULL) {
+				s->cl->last_error = WS_LASTERR_OTHER_ERROR;
+				break;
+			}
+		}
+
+		node = ws_xml_reader_next(s->reader, &what);
+		switch (what) {
+		case WS_XML_READER_ITEM:
+			/* move the Pull in flight along */
+			if (s->next)
+				wsmc_async_perform(s->as, 0);
+			return node;
+		case WS_XML_READER_CONTEXT:
+			if (ws_xml_get_node_text(node) == NULL)
+				break;
+			s->next = enum_stream_send(s, WSMAN_ACTION_PULL,
+					ws_xml_get_node_text(node));
+			if (s->next == NULL) {
+				s->context = u_strdup(ws_xml_get_node_text(node));
+				s->failed = 1;
+			}
+			break;
+		case WS_XML_READER_END:
+			break;
+		case 0:
+			ws_xml_reader_destroy(s->reader);
+			s->reader = NULL;
+			wsmc_async_request_release(s->page);
+			s->page = NULL;
+			break;
+		default:
+			error("could not parse enumeration response");
+			s->cl->last_error = WS_LASTERR_OTHER_ERROR;
+			s->failed = 1;
+			break;
+		}
+	}
+	s->failed = 1;
+	return NULL;
+}
+
+int
+wsmc_enum_stream_failed(WsManEnumStream * s)
+{
+	return s->failed;
+}
+
+void
+wsmc_enum_stream_close(WsManEnumStream * s)
+{
+	WsXmlDocH doc;
+
+	if (s == NULL)
+		return;
+	ws_xml_reader_destroy(s->reader);
+	wsmc_async_request_release(s->page);
+	if (s->next) {
+		WsManAsyncRequest *req = enum_stream_wait(s);
+
+		if (req && wsmc_async_request_get_response_code(req) == 200 &&
+				(doc = wsmc_async_request_get_response(req))) {
+			u_free(s->context);
+			s->context = wsmc_get_enum_context(doc);
+		}
+		wsmc_async_request_release(req);
+	}
+	if (s->context && s->context[0] != 0) {
+		doc = wsmc_action_release(s->cl, s->resource_uri, s->options,
+				s->context);
+		if (doc)
+			ws_xml_destroy_doc(doc);
+	}
+	if (s->as)
+		wsmc_async_release(s->as);
+	u_free(s->context);
+	u_free(s->resource_uri);
+	u_free(s);
+}
+
+int
+wsmc_action_enumerate_and_pull_items(WsManClient * cl,
+		const char *resource_uri,
+		client_opt_t *options,
+		filter_t *filter,
+		WsmcItemCallback callback,
+		void *callback_data)
+{
+	WsXmlNodeH item;
+	int ret;
+	WsManEnumStream *s = wsmc_enum_stream_open(cl, resource_uri,
+			options, filter);
+
+	if (s == NULL)
+		return 0;
+	while ((item = wsmc_enum_stream_next(s)) != NULL) {
+		if (callback(cl, item, callback_data))
+			break;
+	}
+	ret = !wsmc_enum_stream_failed(s);
+	wsmc_enum_stream_close(s);
+	return ret;
+}
+#endif
+
+
 WsXmlDocH
 wsmc_action_enumerate(WsManClient * cl,
 		const char *resource_uri,
@@ -1772,6 +2050,255 @@ WsXmlDocH wsmc_action_renew(WsManClient * cl, const char *resource_uri,
 	return response;
 }
 
+/*
+ * Prepared requests
+ *
+ * The envelope is built and serialized once. With a UTF-8 client the
+ * values which change from one send to the next are slots in that text,
+ * a send copies the text around them and puts new values in. Other
+ * encodings keep the document, set the values there and serialize it
+ * again.
+ */
+
+#define PREPARED_SLOTS 2
+
+typedef struct {
+	size_t offset;		/* value in the serialized template */
+	size_t len;
+	int context;		/* EnumerationContext, else MessageID */
+} PreparedSlot;
+
+struct _WsManPreparedRequest {
+	WsManClient *cl;
+	WsXmlDocH doc;		/* kept when the text cannot be patched */
+	WsXmlNodeH msgid_node;
+	WsXmlNodeH context_node;
+	char *text;		/* serialized template */
+	int len;
+	PreparedSlot slots[PREPARED_SLOTS];
+	int nslots;
+	u_buf_t *out;		/* envelope of the last send */
+	int has_context;
+	int dump;
+};
+
+/* offset of the only occurrence of value in text, -1 if none or more */
+static long
+prepared_find(const char *text, const char *value)
+{
+	const char *p = strstr(text, value);
+
+	if (p == NULL || strstr(p + 1, value) != NULL)
+		return -1;
+	return p - text;
+}
+
+static int
+prepared_add_slot(WsManPreparedRequest *req, const char *value,
+		int context)
+{
+	long offset = prepared_find(req->text, value);
+	int i;
+
+	if (offset < 0)
+		return 0;
+	/* keep the slots in text order */
+	for (i = req->nslots; i > 0 &&
+			req->slots[i - 1].offset > (size_t) offset; i--)
+		req->slots[i] = req->slots[i - 1];
+	req->slots[i].offset = offset;
+	req->slots[i].len = strlen(value);
+	req->slots[i].context = context;
+	req->nslots++;
+	return 1;
+}
+
+/* append value to the envelope, escaped as element content */
+static int
+prepared_append_text(u_buf_t *out, const char *value)
+{
+	const char *p, *esc;
+	int ret = 0;
+
+	for (p = value; *p && ret == 0; value = ++p) {
+		while (*p && *p != '&' && *p != '<' && *p != '>')
+			p++;
+		if (p > value)
+			ret = u_buf_append(out, (void *) value, p - value);
+		if (*p == 0)
+			break;
+		esc = *p == '&' ? "&amp;" : *p == '<' ? "&lt;" : "&gt;";
+		if (ret == 0)
+			ret = u_buf_append(out, (void *) esc, strlen(esc));
+	}
+	return ret;
+}
+
+WsManPreparedRequest *
+wsmc_prepare_request(WsManClient * cl,
+		const char *resource_uri,
+		client_opt_t *options,
+		filter_t *filter,
+		WsmanAction action,
+		const char *method,
+		WsXmlDocH body)
+{
+	WsManPreparedRequest *req;
+	WsXmlNodeH header, node;
+	char marker[100];
+	char *msgid;
+	int has_context = (action == WSMAN_ACTION_PULL ||
+			action == WSMAN_ACTION_RELEASE);
+
+	/* stands for the EnumerationContext until the first send */
+	generate_uuid(marker, sizeof(marker), 0);
+
+	req = u_zalloc(sizeof(WsManPreparedRequest));
+	if (req == NULL)
+		return NULL;
+	req->cl = cl;
+	req->has_context = has_context;
+	req->dump = (options->flags & FLAG_DUMP_REQUEST) == FLAG_DUMP_REQUEST;
+	if (u_buf_create(&req->out) != 0)
+		goto err;
+
+	req->doc = wsmc_create_request(cl, resource_uri, options, filter,
+			action, (char *) method, has_context ? marker : NULL);
+	if (req->doc == NULL)
+		goto err;
+	if (body)
+		handle_resource_request(cl, req->doc, body, NULL,
+				(char *) resource_uri);
+
+	header = ws_xml_get_soap_header(req->doc);
+	req->msgid_node = ws_xml_get_child(header, 0, XML_NS_ADDRESSING,
+			WSA_MESSAGE_ID);
+	if (has_context) {
+		node = ws_xml_get_child(ws_xml_get_soap_body(req->doc), 0,
+				NULL, NULL);
+		req->context_node = ws_xml_get_child(node, 0,
+				XML_NS_ENUMERATION, WSENUM_ENUMERATION_CONTEXT);
+		if (req->context_node == NULL)
+			goto err;
+	}
+
+	ws_xml_dump_memory_enc(req->doc, &req->text, &req->len,
+			cl->content_encoding);
+	if (req->text == NULL)
+		goto err;
+	if (strcasecmp(cl->content_encoding, "UTF-8"))
+		return req;
+
+	msgid = req->msgid_node ? ws_xml_get_node_text(req->msgid_node) : NULL;
+	if ((msgid && !prepared_add_slot(req, msgid, 0)) ||
+			(has_context && !prepared_add_slot(req, marker, 1))) {
+		req->nslots = 0;
+		return req;
+	}
+	ws_xml_destroy_doc(req->doc);
+	req->doc = NULL;
+	req->msgid_node = req->context_node = NULL;
+	return req;
+err:
+	wsmc_prepared_request_release(req);
+	return NULL;
+}
+
+/* serialize the envelope of the next send into req->out */
+static int
+prepared_build(WsManPreparedRequest *req, const char *context)
+{
+	char uuidBuf[100];
+	char *buf = NULL;
+	size_t pos = 0;
+	int i, len = 0, ret = 0;
+
+	generate_uuid(uuidBuf, sizeof(uuidBuf), 0);
+	u_buf_clear(req->out);
+
+	if (req->doc) {
+		if (req->msgid_node)
+			ws_xml_set_node_text(req->msgid_node, uuidBuf);
+		if (req->context_node)
+			ws_xml_set_node_text(req->context_node, (char *) context);
+		ws_xml_dump_memory_enc(req->doc, &buf, &len,
+				req->cl->content_encoding);
+		if (buf == NULL)
+			return 1;
+		ret = u_buf_append(req->out, buf, len);
+		ws_xml_free_memory(buf);
+		return ret;
+	}
+
+	u_buf_reserve(req->out, req->len + 128 +
+			(context ? strlen(context) : 0));
+	for (i = 0; i < req->nslots && ret == 0; i++) {
+		PreparedSlot *slot = &req->slots[i];
+
+		if (slot->offset > pos)
+			ret = u_buf_append(req->out, req->text + pos,
+					slot->offset - pos);
+		if (ret == 0 && slot->context)
+			ret = prepared_append_text(req->out, context);
+		else if (ret == 0)
+			ret = u_buf_append(req->out, uuidBuf, strlen(uuidBuf));
+		pos = slot->offset + slot->len;
+	}
+	if (ret == 0 && (size_t) req->len > pos)
+		ret = u_buf_append(req->out, req->text + pos, req->len - pos);
+	return ret;
+}
+
+WsXmlDocH
+wsmc_prepared_request_send(WsManPreparedRequest * req,
+		const char *context)
+{
+	WsManClient *cl = req->cl;
+
+	if (req->has_context && (context == NULL || context[0] == 0)) {
+		error("No enumeration context ???");
+		return NULL;
+	}
+	if (prepared_build(req, context)) {
+		error("could not build prepared request");
+		return NULL;
+	}
+	if (req->dump && cl->dumpfile) {
+		fwrite(u_buf_ptr(req->out), 1, u_buf_len(req->out),
+				cl->dumpfile);
+		fputc('\n', cl->dumpfile);
+	}
+	if (wsman_send_request_buf(cl, u_buf_ptr(req->out),
+				u_buf_len(req->out)))
+		return NULL;
+	return wsmc_build_envelope_from_response(cl);
+}
+
+const char *
+wsmc_prepared_request_get_data(WsManPreparedRequest * req, size_t *size)
+{
+	if (u_buf_len(req->out)) {
+		*size = u_buf_len(req->out);
+		return u_buf_ptr(req->out);
+	}
+	*size = req->len;
+	return req->text;
+}
+
+void
+wsmc_prepared_request_release(WsManPreparedRequest * req)
+{
+	if (req == NULL)
+		return;
+	if (req->doc)
+		ws_xml_destroy_doc(req->doc);
+	if (req->text)
+		ws_xml_free_memory(req->text);
+	if (req->out)
+		u_buf_free(req->out);
+	u_free(req);
+}
+
 char*
 wsmc_get_enum_context(WsXmlDocH doc)
 {
@@ -1831,6 +2358,12 @@ wsmc_build_envelope_from_response(WsManClient * cl)
 	WsXmlDocH       doc = NULL;
 	u_buf_t        *buffer = cl->connection->response;
 
+	if (cl->connection->response_doc) {
+		/* hand over the document parsed by the transport */
+		doc = cl->connection->response_doc;
+		cl->connection->response_doc = NULL;
+		return doc;
+	}
 	if (!buffer || !u_buf_ptr(buffer)) {
 		error("NULL response");
 		return NULL;
@@ -1857,6 +2390,8 @@ wsmc_release_conn(WsManConnection * conn)
 		u_buf_free(conn->response);
 		conn->response = NULL;
 	}
+	if (conn->response_doc)
+		ws_xml_destroy_doc(conn->response_doc);
 	u_free(conn);
 }
 
@@ -1867,6 +2402,10 @@ wsmc_reinit_conn(WsManClient * cl)
 {
 	u_buf_clear(cl->connection->response);
 	u_buf_clear(cl->connection->request);
+	if (cl->connection->response_doc) {
+		ws_xml_destroy_doc(cl->connection->response_doc);
+		cl->connection->response_doc = NULL;
+	}
 	cl->response_code = 0;
 	cl->last_error = 0;
 	if (cl->fault_string) {
@@ -2029,13 +2568,12 @@ wsmc_create(const char *hostname,
 	}
 #ifndef _WIN32
 	wsmc_set_conffile(wsc, DEFAULT_CLIENT_CONFIG_FILE);
-        ini = iniparser_new(wsmc_get_conffile(wsc));
+        ini = wsmc_get_conf(wsc);
         if (ini) {
           char *user_agent = iniparser_getstr(ini, "client:agent");
           if (user_agent) {
             wsman_transport_set_agent(wsc, user_agent);
           }
-          iniparser_free(ini);
         }
 #endif
 	wsc->serctx = ws_serializer_init();
@@ -2049,6 +2587,7 @@ wsmc_create(const char *hostname,
 	wsc->data.auth_set = 0;
 	wsc->initialized = 0;
 	wsc->transport_timeout = 0;
+	wsc->accept_compression = 1;
 	wsc->content_encoding = u_strdup("UTF-8");
 #ifdef _WIN32
 	wsc->session_handle = 0;
@@ -2124,6 +2663,8 @@ wsmc_release(WsManClient * cl)
 		u_free(cl->content_encoding);
 		cl->content_encoding = NULL;
 	}
+	u_free(cl->response_charset);
+	cl->response_charset = NULL;
 	if (cl->cim_ns) {
 		u_free(cl->cim_ns);
 		cl->cim_ns = NULL;
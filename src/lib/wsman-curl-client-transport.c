@@ -46,7 +46,7 @@
 #include <curl/curl.h>
 #include <curl/easy.h>
 
-#ifdef ENABLE_EVENTING_SUPPORT
+#if defined(ENABLE_EVENTING_SUPPORT) || defined(HAVE_SSL)
 #include <openssl/opensslv.h>
 #include <openssl/ssl.h>
 #endif
@@ -67,13 +67,70 @@
 #ifndef CURLE_SSL_CRL_BADFILE
 	#define CURLE_SSL_CRL_BADFILE 82
 #endif
+#if LIBCURL_VERSION_NUM < 0x70D01
+	#define CURLE_LOGIN_DENIED 67
+#endif
 
 
 extern wsman_auth_request_func_t request_func;
 void wsmc_handler( WsManClient *cl, WsXmlDocH rqstDoc, void* user_data);
+void wsmc_buffer_handler(WsManClient *cl, const char *buf, int len,
+		void *user_data);
 
 static pthread_mutex_t curl_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * TLS sessions and DNS answers are shared by all the handles of the
+ * process, so a new client resumes the TLS session of an earlier one
+ * to the same server instead of doing a full handshake.
+ */
+static CURLSH *curl_share = NULL;
+static unsigned int curl_users = 0;
+static pthread_mutex_t share_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+share_lock(CURL *curl, curl_lock_data data, curl_lock_access access,
+		void *userptr)
+{
+	pthread_mutex_lock(&share_mutex);
+}
+
+static void
+share_unlock(CURL *curl, curl_lock_data data, void *userptr)
+{
+	pthread_mutex_unlock(&share_mutex);
+}
+
+/* curl_global_init() plus the share handle, under curl_mutex */
+static CURLcode
+curl_globals_get(void)
+{
+	CURLcode r = curl_global_init(CURL_GLOBAL_SSL | CURL_GLOBAL_WIN32);
+
+	if (r != CURLE_OK)
+		return r;
+	curl_users++;
+	if (curl_share == NULL && (curl_share = curl_share_init()) != NULL) {
+		curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, share_lock);
+		curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+		curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(curl_share, CURLSHOPT_SHARE,
+				CURL_LOCK_DATA_SSL_SESSION);
+	}
+	return CURLE_OK;
+}
+
+/* counterpart of curl_globals_get(), under curl_mutex */
+static void
+curl_globals_put(void)
+{
+	/* a handle still using the share keeps it alive */
+	if (curl_users && --curl_users == 0 && curl_share &&
+			curl_share_cleanup(curl_share) == CURLSHE_OK)
+		curl_share = NULL;
+	curl_global_cleanup();
+}
+
 
 static long
 reauthenticate(WsManClient *cl,
@@ -148,6 +205,171 @@ REQUEST_PASSWORD:
 }
 
 
+/*
+ * Auth scheme negotiated with an endpoint, shared by all clients of the
+ * process, so that only the first request to a server pays for the 401
+ * round trip. Keyed by endpoint and the auth method the client allows.
+ */
+#define AUTH_CACHE_MAX 256
+
+static pthread_mutex_t auth_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *auth_cache = NULL;
+
+static char *
+auth_cache_key(WsManClient *cl)
+{
+	return u_strdup_printf("%s %s", cl->data.endpoint,
+			cl->authentication.method ? cl->authentication.method : "");
+}
+
+static long
+auth_cache_lookup(WsManClient *cl)
+{
+	char *key = auth_cache_key(cl);
+	hnode_t *hn;
+	long auth_set = 0;
+
+	if (key == NULL)
+		return 0;
+	pthread_mutex_lock(&auth_mutex);
+	if (auth_cache && (hn = hash_lookup(auth_cache, key)) != NULL)
+		auth_set = (long) hnode_get(hn);
+	pthread_mutex_unlock(&auth_mutex);
+	u_free(key);
+	return auth_set;
+}
+
+/* remember auth_set for the endpoint of cl, 0 forgets it */
+static void
+auth_cache_store(WsManClient *cl, long auth_set)
+{
+	char *key = auth_cache_key(cl);
+	hnode_t *hn;
+
+	if (key == NULL)
+		return;
+	pthread_mutex_lock(&auth_mutex);
+	if (auth_cache == NULL)
+		auth_cache = hash_create(AUTH_CACHE_MAX, 0, 0);
+	if (auth_cache == NULL) {
+		u_free(key);
+	} else if ((hn = hash_lookup(auth_cache, key)) != NULL) {
+		hnode_put(hn, (void *) auth_set);
+		u_free(key);
+	} else if (auth_set == 0 || hash_isfull(auth_cache) ||
+			!hash_alloc_insert(auth_cache, key, (void *) auth_set)) {
+		u_free(key);
+	}
+	pthread_mutex_unlock(&auth_mutex);
+}
+
+/*
+ * Pick the auth scheme of a client which has not negotiated one yet:
+ * the one cached for its endpoint, or Basic right away over TLS when
+ * the client only allows Basic. A 401 to a guessed scheme starts the
+ * negotiation over.
+ */
+static void
+auth_guess(WsManClient *cl)
+{
+	if (cl->data.auth_set || !cl->data.user || !cl->data.pwd)
+		return;
+	cl->data.auth_set = auth_cache_lookup(cl);
+	if (cl->data.auth_set == 0 &&
+			wsmc_transport_get_auth_value(cl) == WS_BASIC_AUTH &&
+			cl->data.scheme && !strcasecmp(cl->data.scheme, "https"))
+		cl->data.auth_set = CURLAUTH_BASIC;
+	cl->data.auth_guessed = cl->data.auth_set != 0;
+}
+
+/* the server turned down the guessed scheme, negotiate from scratch */
+static void
+auth_forget(WsManClient *cl)
+{
+	cl->data.auth_guessed = 0;
+	cl->data.auth_set = 0;
+	auth_cache_store(cl, 0);
+}
+
+/* a status line, leaving out interim 1xx responses */
+static int
+is_final_status_line(const char *ptr, size_t len)
+{
+	const char *code;
+
+	if (len <= 12 || strncmp(ptr, "HTTP/", 5))
+		return 0;
+	code = memchr(ptr, ' ', len);
+	return code && code[1] != '1';
+}
+
+/* whether the TLS connection of curl resumed an earlier session */
+static int
+tls_session_reused(CURL *curl)
+{
+#if defined(HAVE_SSL) && LIBCURL_VERSION_NUM >= 0x073000
+	struct curl_tlssessioninfo *info = NULL;
+
+	if (curl_easy_getinfo(curl, CURLINFO_TLS_SSL_PTR, &info) == CURLE_OK &&
+			info && info->backend == CURLSSLBACKEND_OPENSSL &&
+			info->internals)
+		return SSL_session_reused((SSL *) info->internals) ? 1 : 0;
+#endif
+	return 0;
+}
+
+/* account the TLS handshakes done by the last transfer of curl */
+static void
+tls_count(WsManClient *cl, CURL *curl, int reused)
+{
+	long connects = 0;
+
+	if (cl->data.scheme == NULL || strcasecmp(cl->data.scheme, "https"))
+		return;
+	if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) != CURLE_OK ||
+			connects <= 0)
+		return;
+	cl->tls_handshakes += connects;
+	if (reused)
+		cl->tls_resumptions++;
+}
+
+/* charset parameter of the Content-Type of the last transfer of curl */
+static char *
+response_charset(CURL *curl)
+{
+	char *type = NULL, *p;
+	size_t len;
+
+	if (curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &type) != CURLE_OK ||
+			type == NULL)
+		return NULL;
+	for (p = type; *p; p++)
+		if (strncasecmp(p, "charset=", 8) == 0)
+			break;
+	if (*p == '\0')
+		return NULL;
+	p += 8;
+	if (*p == '"')
+		p++;
+	len = strcspn(p, "\"; \t");
+	return len ? u_strndup(p, len) : NULL;
+}
+
+static size_t
+header_handler(char *ptr, size_t size, size_t nmemb, void *data)
+{
+	WsManClient *cl = data;
+	size_t len = size * nmemb;
+
+	if (is_final_status_line(ptr, len)) {
+		cl->round_trips++;
+		if (cl->transport)
+			cl->tls_reused = tls_session_reused(cl->transport);
+	}
+	return len;
+}
+
 static WS_LASTERR_Code
 convert_to_last_error(CURLcode r)
 {
@@ -244,6 +466,58 @@ write_handler( void *ptr, size_t size, size_t nmemb, void *data)
 	return len;
 }
 
+/* where the body of a synchronous response goes */
+typedef struct {
+	CURL *curl;
+	u_buf_t *response;		/* NULL when not buffered */
+	WsXmlPushParserH parser;	/* NULL once the body is not XML */
+	int parse;			/* 0 when only the text is kept */
+	int started;
+} response_sink;
+
+static void
+response_sink_reset(WsManClient *cl, response_sink *sink)
+{
+	if (sink->response)
+		u_buf_clear(sink->response);
+	ws_xml_push_parser_destroy(sink->parser);
+	sink->parser = sink->parse ?
+		ws_xml_push_parser_new(cl->content_encoding) : NULL;
+	sink->started = 0;
+}
+
+/* parse the response while it arrives, the document is complete
+ * together with the transfer */
+static size_t
+response_handler( void *ptr, size_t size, size_t nmemb, void *data)
+{
+	response_sink *sink = data;
+	size_t len;
+
+	len = size * nmemb;
+	if (len == 0)
+		return 0;
+	if (sink->response && u_buf_append(sink->response, ptr, len))
+		return 0;
+	if (!sink->started) {
+		long http_code = 0;
+
+		/* the body of a 401 is replaced by the one of the retry */
+		sink->started = 1;
+		curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &http_code);
+		if (http_code == 401) {
+			ws_xml_push_parser_destroy(sink->parser);
+			sink->parser = NULL;
+		}
+	}
+	if (sink->parser && ws_xml_push_parser_feed(sink->parser, ptr, len)) {
+		ws_xml_push_parser_destroy(sink->parser);
+		sink->parser = NULL;
+	}
+	debug("response_handler: recieved %d bytes", len);
+	return len;
+}
+
 #ifdef ENABLE_EVENTING_SUPPORT
 static int ssl_certificate_thumbprint_verify_callback(X509_STORE_CTX *ctx, void *arg)
 {
@@ -283,7 +557,7 @@ init_curl_transport(WsManClient *cl)
 	CURLcode r = CURLE_OK;
         char *sslhack;
         long sslversion;
-        dictionary *ini = iniparser_new(wsmc_get_conffile(cl));
+        dictionary *ini = wsmc_get_conf(cl);
 
 #define curl_err(str)  debug("Error = %d (%s); %s", \
 		r, curl_easy_strerror(r), str);
@@ -328,6 +602,23 @@ init_curl_transport(WsManClient *cl)
 		goto DONE;
 	}
 
+	r = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_handler);
+	if (r == 0)
+		r = curl_easy_setopt(curl, CURLOPT_HEADERDATA, cl);
+	if (r != 0) {
+		curl_err("Could notcurl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ...)");
+		goto DONE;
+	}
+
+	pthread_mutex_lock(&curl_mutex);
+	if (curl_share)
+		r = curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
+	pthread_mutex_unlock(&curl_mutex);
+	if (r != 0) {
+		curl_err("Could notcurl_easy_setopt(curl, CURLOPT_SHARE, ...)");
+		goto DONE;
+	}
+
 	r = curl_easy_setopt(curl, CURLOPT_PROXYUSERPWD, cl->proxy_data.proxy_auth);
 	if (r != 0) {
 		curl_err("Could notcurl_easy_setopt(curl, CURLOPT_PROXYUSERPWD, ...)");
@@ -426,20 +717,74 @@ init_curl_transport(WsManClient *cl)
           goto DONE;
         }
 
-        iniparser_free(ini);
 	return (void *)curl;
  DONE:
 	cl->last_error = convert_to_last_error(r);
 	curl_easy_cleanup(curl);
-        iniparser_free(ini);
 	return NULL;
 #undef curl_err
 }
 
+/*
+ * Negotiate compressed responses and gzip the request body of len
+ * bytes if the client asks for it. *zbody is set to the compressed
+ * body, which the caller has to post instead and u_free().
+ */
+static CURLcode
+set_content_coding(WsManClient *cl, CURL *curl, struct curl_slist **headers,
+		const char *body, int len, char **zbody, size_t *zlen)
+{
+	CURLcode r;
+
+	*zbody = NULL;
+#if LIBCURL_VERSION_NUM >= 0x071506
+	r = curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING,
+			cl->accept_compression ? "" : NULL);
+#else
+	r = curl_easy_setopt(curl, CURLOPT_ENCODING,
+			cl->accept_compression ? "" : NULL);
+#endif
+	/* curl built without zlib */
+	if (r == CURLE_NOT_BUILT_IN || r == CURLE_UNKNOWN_OPTION)
+		r = CURLE_OK;
+	if (r != CURLE_OK)
+		return r;
+
+	if (cl->request_compression && len > 0 &&
+			(unsigned long) len >= cl->request_compression &&
+			u_gzip_compress(U_GZIP_GZIP, 6, body, len, zbody, zlen) == 0) {
+		debug("compressed request: %d -> %lu bytes", len,
+				(unsigned long) *zlen);
+		*headers = curl_slist_append(*headers, "Content-Encoding: gzip");
+	}
+	return CURLE_OK;
+}
+
 void
 wsmc_handler( WsManClient *cl,
 		WsXmlDocH rqstDoc,
 		void* user_data)
+{
+	char *buf = NULL;
+	int len = 0;
+
+	ws_xml_dump_memory_enc(rqstDoc, &buf, &len, cl->content_encoding);
+	wsmc_buffer_handler(cl, buf, len, user_data);
+#ifdef _WIN32
+	ws_xml_free_memory(buf);
+#else
+	u_free(buf);
+#endif
+}
+
+/*
+ * Send a request envelope serialized in the encoding of the client
+ */
+void
+wsmc_buffer_handler(WsManClient *cl,
+		const char *buf,
+		int len,
+		void *user_data)
 {
 #define curl_err(str)  debug("Error = %d (%s); %s", \
 		r, curl_easy_strerror(r), str);
@@ -450,13 +795,13 @@ wsmc_handler( WsManClient *cl,
 	char *usag = NULL;
 	size_t usag_len = 0;
 	struct curl_slist *headers=NULL;
-	char *buf = NULL;
-	int len;
+	char *zbuf = NULL;
+	size_t zlen = 0;
 	char *soapact_header = NULL;
 	long http_code;
 	long auth_avail = 0;
 	char *_user = NULL, *_pass = NULL;
-	u_buf_t *response = NULL;
+	response_sink sink = { 0 };
 	//char *soapaction;
 	char *tmp_str = NULL;
 
@@ -479,14 +824,19 @@ wsmc_handler( WsManClient *cl,
 		goto DONE;
 	}
 
-	r = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_handler);
+	r = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, response_handler);
 	if (r != CURLE_OK) {
 		cl->fault_string = u_strdup(curl_easy_strerror(r));
 		curl_err("Could not curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ..)");
 		goto DONE;
 	}
-	u_buf_create(&response);
-	r = curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+	sink.curl = curl;
+	if (!con->unbuffered)
+		sink.response = con->response;
+	sink.parse = !con->unparsed;
+	if (sink.parse)
+		sink.parser = ws_xml_push_parser_new(cl->content_encoding);
+	r = curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
 	if (r != CURLE_OK) {
 		cl->fault_string = u_strdup(curl_easy_strerror(r));
 		curl_err("Could not curl_easy_setopt(curl, CURLOPT_WRITEDATA, ..)");
@@ -521,6 +871,13 @@ wsmc_handler( WsManClient *cl,
 	}
 #endif
 
+	r = set_content_coding(cl, curl, &headers, buf, len, &zbuf, &zlen);
+	if (r != CURLE_OK) {
+		cl->fault_string = u_strdup(curl_easy_strerror(r));
+		curl_err("Could not curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ..)");
+		goto DONE;
+	}
+
 	r = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 	if (r != CURLE_OK) {
 		cl->fault_string = u_strdup(curl_easy_strerror(r));
@@ -528,21 +885,14 @@ wsmc_handler( WsManClient *cl,
 		goto DONE;
 	}
 
-	ws_xml_dump_memory_enc(rqstDoc, &buf, &len, cl->content_encoding);
-#if 0
-	int count = 0;
-	while(count < len) {
-		printf("%c",buf[count++]);
-	}
-#endif
 	debug("*****set post buf len = %d******",len);
-	r = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, buf);
+	r = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, zbuf ? zbuf : buf);
 	if (r != CURLE_OK) {
 		cl->fault_string = u_strdup(curl_easy_strerror(r));
 		curl_err("Could not curl_easy_setopt(curl, CURLOPT_POSTFIELDS, ..)");
 		goto DONE;
 	}
-	r = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, len);
+	r = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, zbuf ? (long) zlen : len);
 	if (r != CURLE_OK) {
 		cl->fault_string = u_strdup(curl_easy_strerror(r));
 		curl_err("Could not curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, ..)");
@@ -550,6 +900,7 @@ wsmc_handler( WsManClient *cl,
 	}
 
 	int iDone = 0;
+	auth_guess(cl);
 	while (1) {
 		u_free(_user);
 		u_free(_pass);
@@ -582,7 +933,9 @@ wsmc_handler( WsManClient *cl,
 			curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
 		}
 
+		cl->tls_reused = 0;
 		r = curl_easy_perform(curl);
+		tls_count(cl, curl, cl->tls_reused);
 		if (r != CURLE_OK) {
 			cl->fault_string = u_strdup(curl_easy_strerror(r));
 			curl_err("curl_easy_perform failed");
@@ -621,6 +974,8 @@ wsmc_handler( WsManClient *cl,
 		}
 
 		/* we are here because of authentication required */
+		if (cl->data.auth_guessed)
+			auth_forget(cl);
 		r = curl_easy_getinfo(curl, CURLINFO_HTTPAUTH_AVAIL, &auth_avail);
 		if (r != CURLE_OK) {
 			cl->fault_string = u_strdup(curl_easy_strerror(r));
@@ -630,7 +985,7 @@ wsmc_handler( WsManClient *cl,
 
 		cl->data.auth_set = reauthenticate(cl, cl->data.auth_set, auth_avail,
                         &cl->data.user, &cl->data.pwd);
-                u_buf_clear(response);
+                response_sink_reset(cl, &sink);
                 if (cl->data.auth_set == 0) {
                     /* FIXME: user wants to cancel authentication */
 #if LIBCURL_VERSION_NUM >= 0x70D01
@@ -670,10 +1025,17 @@ wsmc_handler( WsManClient *cl,
         }
 	u_free(mbbuf);
 #endif
-	u_buf_append(con->response, u_buf_ptr(response), u_buf_len(response));
+	if (iDone && sink.parser && sink.started)
+		con->response_doc = ws_xml_push_parser_finish(sink.parser);
+	if (iDone && r == CURLE_OK && cl->data.auth_set) {
+		cl->data.auth_guessed = 0;
+		auth_cache_store(cl, cl->data.auth_set);
+	}
 DONE:
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 	cl->response_code = http_code;
+	u_free(cl->response_charset);
+	cl->response_charset = response_charset(curl);
 	cl->last_error = convert_to_last_error(r);
 
 	debug("curl error code: %d.", r);
@@ -681,17 +1043,13 @@ DONE:
 	debug("cl->last_error code: %d.", cl->last_error);
 
 	curl_slist_free_all(headers);
-	u_buf_free(response);
+	ws_xml_push_parser_destroy(sink.parser);
 	u_free(soapact_header);
 	u_free(usag);
 	u_free(upwd);
 	u_free(_pass);
 	u_free(_user);
-#ifdef _WIN32
-	ws_xml_free_memory(buf);
-#else
-	u_free(buf);
-#endif
+	u_free(zbuf);
 
 	return;
 #undef curl_err
@@ -708,7 +1066,7 @@ int wsmc_transport_init(WsManClient *cl, void *arg)
 		pthread_mutex_unlock(&curl_mutex);
 		return 0;
 	}
-	r = curl_global_init(CURL_GLOBAL_SSL | CURL_GLOBAL_WIN32);
+	r = curl_globals_get();
 	if (r == CURLE_OK) {
 		cl->initialized = 1;
 	}
@@ -727,7 +1085,7 @@ void wsmc_transport_fini(WsManClient *cl)
 		pthread_mutex_unlock(&curl_mutex);
 		return;
 	}
-	curl_global_cleanup();
+	curl_globals_put();
 	cl->initialized = 0;
 	pthread_mutex_unlock(&curl_mutex);
 	return;
@@ -743,3 +1101,703 @@ wsman_transport_close_transport(WsManClient *cl)
 }
 
 
+
+
+/*
+ * Asynchronous requests
+ *
+ * Every request gets an easy handle of its own, configured from its
+ * client like the one of the synchronous transport, and all of them are
+ * driven by one curl multi handle.
+ */
+
+/* 401 answers a request may see before it gives up */
+#define ASYNC_AUTH_RETRIES 3
+
+struct _WsManAsyncRequest {
+	WsManAsync *as;
+	WsManClient *cl;
+	CURL *curl;
+	struct curl_slist *headers;
+	char *body;
+	char *zbody;		/* gzip coded body, if any */
+	char *upwd;
+	u_buf_t *response;
+	WsXmlDocH response_doc;
+	long auth_set;		/* auth scheme the request was sent with */
+	int auth_tries;
+	int tls_reused;		/* connection resumed a TLS session */
+	unsigned long timeout;
+	long response_code;
+	WS_LASTERR_Code last_error;
+	char *fault_string;
+	wsmc_async_callback_t callback;
+	void *user_data;
+	struct _WsManAsyncRequest *next;
+	struct _WsManAsyncRequest *active_prev, *active_next;
+};
+
+struct _WsManAsync {
+	CURLM *multi;
+	unsigned int max_requests;
+	unsigned int running;	/* requests added to the multi handle */
+	unsigned int pending;	/* requests sent and not yet finished */
+	WsManAsyncRequest *active;	/* added to the multi handle */
+	WsManAsyncRequest *queue, *queue_tail;	/* waiting for a slot */
+	WsManAsyncRequest *done, *done_tail;	/* finished, no callback */
+};
+
+
+static void
+async_list_append(WsManAsyncRequest **head, WsManAsyncRequest **tail,
+		WsManAsyncRequest *req)
+{
+	req->next = NULL;
+	if (*tail)
+		(*tail)->next = req;
+	else
+		*head = req;
+	*tail = req;
+}
+
+static WsManAsyncRequest *
+async_list_pop(WsManAsyncRequest **head, WsManAsyncRequest **tail)
+{
+	WsManAsyncRequest *req = *head;
+
+	if (req) {
+		*head = req->next;
+		if (*head == NULL)
+			*tail = NULL;
+		req->next = NULL;
+	}
+	return req;
+}
+
+static void
+async_active_add(WsManAsync *as, WsManAsyncRequest *req)
+{
+	req->active_prev = NULL;
+	req->active_next = as->active;
+	if (as->active)
+		as->active->active_prev = req;
+	as->active = req;
+	as->running++;
+}
+
+static void
+async_active_remove(WsManAsync *as, WsManAsyncRequest *req)
+{
+	if (req->active_prev)
+		req->active_prev->active_next = req->active_next;
+	else
+		as->active = req->active_next;
+	if (req->active_next)
+		req->active_next->active_prev = req->active_prev;
+	req->active_prev = req->active_next = NULL;
+	as->running--;
+}
+
+static size_t
+async_header_handler(char *ptr, size_t size, size_t nmemb, void *data)
+{
+	WsManAsyncRequest *req = data;
+	size_t len = size * nmemb;
+
+	if (is_final_status_line(ptr, len)) {
+		req->cl->round_trips++;
+		req->tls_reused = tls_session_reused(req->curl);
+	}
+	return len;
+}
+
+static void
+async_request_fail(WsManAsyncRequest *req, CURLcode r)
+{
+	req->last_error = convert_to_last_error(r);
+	if (req->fault_string == NULL)
+		req->fault_string = u_strdup(curl_easy_strerror(r));
+}
+
+/*
+ * Set the credentials of the client on the easy handle
+ */
+static CURLcode
+async_request_set_auth(WsManAsyncRequest *req)
+{
+	WsManClient *cl = req->cl;
+	CURLcode r = CURLE_OK;
+	char *user = wsmc_get_user(cl);
+	char *pass = wsmc_get_password(cl);
+
+	req->auth_set = cl->data.auth_set;
+	if (user && pass && cl->data.auth_set) {
+		r = curl_easy_setopt(req->curl, CURLOPT_HTTPAUTH,
+				cl->data.auth_set);
+		if (r == CURLE_OK) {
+			u_free(req->upwd);
+			req->upwd = u_strdup_printf("%s:%s", user, pass);
+			if (req->upwd == NULL)
+				r = CURLE_OUT_OF_MEMORY;
+			else
+				r = curl_easy_setopt(req->curl,
+						CURLOPT_USERPWD, req->upwd);
+		}
+	}
+	u_free(user);
+	u_free(pass);
+	return r;
+}
+
+static CURLcode
+async_request_prepare(WsManAsyncRequest *req, WsXmlDocH rqstDoc)
+{
+	WsManClient *cl = req->cl;
+	CURLcode r;
+	char content_type[64];
+	char *agent, *usag;
+	int len;
+	size_t zlen = 0;
+
+	req->curl = init_curl_transport(cl);
+	if (req->curl == NULL)
+		return CURLE_FAILED_INIT;
+
+	r = curl_easy_setopt(req->curl, CURLOPT_URL, cl->data.endpoint);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, write_handler);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, req->response);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_HEADERFUNCTION,
+			async_header_handler);
+	if (r == CURLE_OK)
+		r = curl_easy_setopt(req->curl, CURLOPT_HEADERDATA, req);
+	if (r != CURLE_OK)
+		return r;
+	if (req->timeout) {
+		r = curl_easy_setopt(req->curl, CURLOPT_TIMEOUT, req->timeout);
+		if (r != CURLE_OK)
+			return r;
+	}
+
+	snprintf(content_type, 64,
+			"Content-Type: application/soap+xml;charset=%s",
+			cl->content_encoding);
+	req->headers = curl_slist_append(req->headers, content_type);
+	agent = wsman_transport_get_agent(cl);
+	usag = u_strdup_printf("User-Agent: %s", agent);
+	u_free(agent);
+	if (usag == NULL)
+		return CURLE_OUT_OF_MEMORY;
+	req->headers = curl_slist_append(req->headers, usag);
+	u_free(usag);
+
+	ws_xml_dump_memory_enc(rqstDoc, &req->body, &len,
+			cl->content_encoding);
+	if (req->body == NULL)
+		return CURLE_OUT_OF_MEMORY;
+	r = set_content_coding(cl, req->curl, &req->headers, req->body, len,
+			&req->zbody, &zlen);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_HTTPHEADER, req->headers);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_POSTFIELDS,
+			req->zbody ? req->zbody : req->body);
+	if (r != CURLE_OK)
+		return r;
+	r = curl_easy_setopt(req->curl, CURLOPT_POSTFIELDSIZE,
+			req->zbody ? (long) zlen : len);
+	if (r != CURLE_OK)
+		return r;
+
+	if (wsman_debug_level_debugged(DEBUG_LEVEL_MESSAGE))
+		curl_easy_setopt(req->curl, CURLOPT_VERBOSE, 1);
+
+	auth_guess(cl);
+	return async_request_set_auth(req);
+}
+
+static int
+async_start(WsManAsync *as, WsManAsyncRequest *req);
+
+/*
+ * The request is done, hand it to its callback or to the done list and
+ * let a queued request take its slot
+ */
+static void
+async_finish(WsManAsync *as, WsManAsyncRequest *req)
+{
+	WsManAsyncRequest *next;
+
+	if (req->curl) {
+		curl_easy_cleanup(req->curl);
+		req->curl = NULL;
+	}
+	as->pending--;
+	if (req->callback) {
+		req->callback(req, req->user_data);
+		wsmc_async_request_release(req);
+	} else {
+		async_list_append(&as->done, &as->done_tail, req);
+	}
+
+	while (as->running < as->max_requests &&
+			(next = async_list_pop(&as->queue, &as->queue_tail))) {
+		if (async_start(as, next))
+			async_finish(as, next);
+	}
+}
+
+static int
+async_start(WsManAsync *as, WsManAsyncRequest *req)
+{
+	CURLMcode mr = curl_multi_add_handle(as->multi, req->curl);
+
+	if (mr != CURLM_OK) {
+		debug("curl_multi_add_handle failed: %s",
+				curl_multi_strerror(mr));
+		req->last_error = WS_LASTERR_FAILED_INIT;
+		req->fault_string = u_strdup(curl_multi_strerror(mr));
+		return 1;
+	}
+	async_active_add(as, req);
+	return 0;
+}
+
+/*
+ * Answer of the server is there. Returns 1 if the request was sent
+ * again with new credentials.
+ */
+static int
+async_request_complete(WsManAsync *as, WsManAsyncRequest *req, CURLcode r)
+{
+	WsManClient *cl = req->cl;
+	long auth_avail = 0;
+
+	tls_count(cl, req->curl, req->tls_reused);
+	req->tls_reused = 0;
+	curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE,
+			&req->response_code);
+	if (r != CURLE_OK) {
+		async_request_fail(req, r);
+		return 0;
+	}
+
+	switch (req->response_code) {
+	case 200:
+	case 400:
+	case 500:
+		req->last_error = WS_LASTERR_OK;
+		if (req->auth_set) {
+			if (req->auth_set == cl->data.auth_set)
+				cl->data.auth_guessed = 0;
+			auth_cache_store(cl, req->auth_set);
+		}
+		return 0;
+	case 401:
+		break;
+	default:
+		req->last_error = WS_LASTERR_OTHER_ERROR;
+		return 0;
+	}
+
+	if (++req->auth_tries > ASYNC_AUTH_RETRIES) {
+		async_request_fail(req, CURLE_LOGIN_DENIED);
+		return 0;
+	}
+	/*
+	 * Another request of the same client may have negotiated the
+	 * scheme meanwhile, only ask again if ours was the latest guess.
+	 */
+	if (cl->data.auth_set == req->auth_set) {
+		r = curl_easy_getinfo(req->curl, CURLINFO_HTTPAUTH_AVAIL,
+				&auth_avail);
+		if (r != CURLE_OK) {
+			async_request_fail(req, r);
+			return 0;
+		}
+		if (cl->data.auth_guessed)
+			auth_forget(cl);
+		cl->data.auth_set = reauthenticate(cl, cl->data.auth_set,
+				auth_avail, &cl->data.user, &cl->data.pwd);
+		if (cl->data.auth_set == 0) {
+			async_request_fail(req, CURLE_LOGIN_DENIED);
+			return 0;
+		}
+	}
+	u_buf_clear(req->response);
+	r = async_request_set_auth(req);
+	if (r != CURLE_OK) {
+		async_request_fail(req, r);
+		return 0;
+	}
+	if (curl_multi_add_handle(as->multi, req->curl) != CURLM_OK) {
+		req->last_error = WS_LASTERR_FAILED_INIT;
+		return 0;
+	}
+	async_active_add(as, req);
+	return 1;
+}
+
+/*
+ * Handle the transfers curl is done with, returns the number of
+ * finished requests
+ */
+static int
+async_collect(WsManAsync *as)
+{
+	CURLMsg *msg;
+	int left, finished = 0;
+	WsManAsyncRequest *req;
+
+	while ((msg = curl_multi_info_read(as->multi, &left)) != NULL) {
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+		req = NULL;
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+				(char **) &req);
+		curl_multi_remove_handle(as->multi, msg->easy_handle);
+		if (req == NULL)
+			continue;
+		async_active_remove(as, req);
+		if (!async_request_complete(as, req, msg->data.result)) {
+			async_finish(as, req);
+			finished++;
+		}
+	}
+	return finished;
+}
+
+/**
+ * Create a driver for asynchronous requests
+ * @param max_requests Requests in flight at the same time, further ones
+ *        are queued. 0 means no limit.
+ * @return driver or NULL
+ */
+WsManAsync *
+wsmc_async_create(unsigned int max_requests)
+{
+	WsManAsync *as;
+	CURLcode r;
+
+	pthread_mutex_lock(&curl_mutex);
+	r = curl_globals_get();
+	pthread_mutex_unlock(&curl_mutex);
+	if (r != CURLE_OK)
+		return NULL;
+	as = u_zalloc(sizeof(WsManAsync));
+	if (as)
+		as->multi = curl_multi_init();
+	if (as == NULL || as->multi == NULL) {
+		u_free(as);
+		pthread_mutex_lock(&curl_mutex);
+		curl_globals_put();
+		pthread_mutex_unlock(&curl_mutex);
+		return NULL;
+	}
+	as->max_requests = max_requests ? max_requests : (unsigned int) -1;
+	return as;
+}
+
+/**
+ * Limit the connections opened to a single host
+ * @param as Driver
+ * @param max_connections Connections per host, 0 means no limit
+ * @return 0 on success
+ */
+int
+wsmc_async_set_host_limit(WsManAsync *as, unsigned int max_connections)
+{
+#if LIBCURL_VERSION_NUM >= 0x071E00
+	return curl_multi_setopt(as->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			(long) max_connections) == CURLM_OK ? 0 : 1;
+#else
+	return 1;
+#endif
+}
+
+/**
+ * Release the driver together with all of its requests, including the
+ * finished ones not fetched yet. No callback is called.
+ * @param as Driver
+ */
+void
+wsmc_async_release(WsManAsync *as)
+{
+	WsManAsyncRequest *req;
+
+	if (as == NULL)
+		return;
+
+	while ((req = as->active) != NULL) {
+		async_active_remove(as, req);
+		curl_multi_remove_handle(as->multi, req->curl);
+		wsmc_async_request_release(req);
+	}
+	while ((req = async_list_pop(&as->queue, &as->queue_tail)))
+		wsmc_async_request_release(req);
+	while ((req = async_list_pop(&as->done, &as->done_tail)))
+		wsmc_async_request_release(req);
+	curl_multi_cleanup(as->multi);
+	u_free(as);
+	pthread_mutex_lock(&curl_mutex);
+	curl_globals_put();
+	pthread_mutex_unlock(&curl_mutex);
+}
+
+/**
+ * Queue a request
+ * @param as Driver
+ * @param cl Client, its endpoint, credentials and transport settings
+ *        are used. It must not be released before the request.
+ * @param request Request document, the caller keeps it
+ * @param timeout Timeout in seconds, 0 for the timeout of the client
+ * @param callback Called from wsmc_async_perform() when the request is
+ *        done, the request is released when it returns. With NULL the
+ *        request is fetched with wsmc_async_next_done().
+ * @param user_data Passed to callback
+ * @return request handle or NULL, see wsmc_get_last_error() of cl
+ */
+WsManAsyncRequest *
+wsmc_async_send(WsManAsync *as, WsManClient *cl, WsXmlDocH request,
+		unsigned long timeout, wsmc_async_callback_t callback,
+		void *user_data)
+{
+	WsManAsyncRequest *req;
+	CURLcode r;
+
+	if (!cl->initialized && wsmc_transport_init(cl, NULL)) {
+		cl->last_error = WS_LASTERR_FAILED_INIT;
+		return NULL;
+	}
+	req = u_zalloc(sizeof(WsManAsyncRequest));
+	if (req == NULL) {
+		cl->last_error = WS_LASTERR_OUT_OF_MEMORY;
+		return NULL;
+	}
+	req->as = as;
+	req->cl = cl;
+	req->timeout = timeout;
+	req->callback = callback;
+	req->user_data = user_data;
+	u_buf_create(&req->response);
+
+	r = async_request_prepare(req, request);
+	if (r != CURLE_OK) {
+		debug("Error = %d (%s); could not prepare request",
+				r, curl_easy_strerror(r));
+		cl->last_error = convert_to_last_error(r);
+		wsmc_async_request_release(req);
+		return NULL;
+	}
+
+	if (as->running < as->max_requests) {
+		if (async_start(as, req)) {
+			cl->last_error = req->last_error;
+			wsmc_async_request_release(req);
+			return NULL;
+		}
+	} else {
+		async_list_append(&as->queue, &as->queue_tail, req);
+	}
+	as->pending++;
+	return req;
+}
+
+/**
+ * Transfer data of the requests in flight, waiting at most timeout_ms
+ * milliseconds for activity if nothing could be done right away.
+ * Callbacks of finished requests are called from here.
+ * @param as Driver
+ * @param timeout_ms Maximum wait, 0 to return immediately
+ * @return number of unfinished requests or -1 on error
+ */
+int
+wsmc_async_perform(WsManAsync *as, long timeout_ms)
+{
+	int running;
+	CURLMcode mr;
+
+	mr = curl_multi_perform(as->multi, &running);
+	if (mr != CURLM_OK && mr != CURLM_CALL_MULTI_PERFORM)
+		goto ERROR;
+	if (async_collect(as) > 0 || as->running == 0 || timeout_ms <= 0)
+		return as->pending;
+
+#if LIBCURL_VERSION_NUM >= 0x071C00
+	mr = curl_multi_wait(as->multi, NULL, 0, (int) timeout_ms, NULL);
+	if (mr != CURLM_OK)
+		goto ERROR;
+#else
+	{
+		fd_set rd, wr, ex;
+		int max_fd = -1;
+		long curl_timeout = -1;
+		struct timeval tv;
+
+		FD_ZERO(&rd);
+		FD_ZERO(&wr);
+		FD_ZERO(&ex);
+		curl_multi_timeout(as->multi, &curl_timeout);
+		if (curl_timeout >= 0 && curl_timeout < timeout_ms)
+			timeout_ms = curl_timeout;
+		if (curl_multi_fdset(as->multi, &rd, &wr, &ex, &max_fd) != CURLM_OK)
+			goto ERROR;
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		if (max_fd >= 0)
+			select(max_fd + 1, &rd, &wr, &ex, &tv);
+		else
+			usleep(timeout_ms > 100 ? 100000 : timeout_ms * 1000);
+	}
+#endif
+	mr = curl_multi_perform(as->multi, &running);
+	if (mr != CURLM_OK && mr != CURLM_CALL_MULTI_PERFORM)
+		goto ERROR;
+	async_collect(as);
+	return as->pending;
+
+ERROR:
+	debug("curl multi error: %s", curl_multi_strerror(mr));
+	return -1;
+}
+
+/**
+ * File descriptors to wait for, for callers running their own select()
+ * loop, see curl_multi_fdset()
+ * @return 0 on success
+ */
+int
+wsmc_async_fdset(WsManAsync *as, fd_set *read_fds, fd_set *write_fds,
+		fd_set *exc_fds, int *max_fd)
+{
+	return curl_multi_fdset(as->multi, read_fds, write_fds, exc_fds,
+			max_fd) == CURLM_OK ? 0 : 1;
+}
+
+/**
+ * Longest wait before wsmc_async_perform() should be called again, in
+ * milliseconds, -1 if there is no timeout pending
+ */
+long
+wsmc_async_timeout(WsManAsync *as)
+{
+	long timeout = -1;
+
+	curl_multi_timeout(as->multi, &timeout);
+	return timeout;
+}
+
+/**
+ * Number of requests sent and not yet finished
+ */
+int
+wsmc_async_pending(WsManAsync *as)
+{
+	return as->pending;
+}
+
+/**
+ * Next finished request without a callback, in order of completion
+ * @return request, to be released with wsmc_async_request_release(),
+ *         or NULL
+ */
+WsManAsyncRequest *
+wsmc_async_next_done(WsManAsync *as)
+{
+	return async_list_pop(&as->done, &as->done_tail);
+}
+
+/**
+ * Response of a finished request, owned by the request
+ * @return response document or NULL
+ */
+WsXmlDocH
+wsmc_async_request_get_response(WsManAsyncRequest *req)
+{
+	if (req->response_doc == NULL && u_buf_len(req->response) > 0) {
+		req->response_doc = ws_xml_read_memory(
+				u_buf_ptr(req->response),
+				u_buf_len(req->response),
+				req->cl->content_encoding, 0);
+		if (req->response_doc == NULL)
+			error("could not create xmldoc from response");
+	}
+	return req->response_doc;
+}
+
+/**
+ * Raw response body of a finished request, owned by the request
+ * @param size Set to the size of the body
+ * @return body, not NUL terminated, or NULL
+ */
+const char *
+wsmc_async_request_get_data(WsManAsyncRequest *req, size_t *size)
+{
+	*size = u_buf_len(req->response);
+	return *size ? (const char *) u_buf_ptr(req->response) : NULL;
+}
+
+long
+wsmc_async_request_get_response_code(WsManAsyncRequest *req)
+{
+	return req->response_code;
+}
+
+WS_LASTERR_Code
+wsmc_async_request_get_last_error(WsManAsyncRequest *req)
+{
+	return req->last_error;
+}
+
+char *
+wsmc_async_request_get_fault_string(WsManAsyncRequest *req)
+{
+	return req->fault_string;
+}
+
+WsManClient *
+wsmc_async_request_get_client(WsManAsyncRequest *req)
+{
+	return req->cl;
+}
+
+void *
+wsmc_async_request_get_user_data(WsManAsyncRequest *req)
+{
+	return req->user_data;
+}
+
+/**
+ * Release a finished request
+ */
+void
+wsmc_async_request_release(WsManAsyncRequest *req)
+{
+	if (req == NULL)
+		return;
+	if (req->curl)
+		curl_easy_cleanup(req->curl);
+	curl_slist_free_all(req->headers);
+	if (req->response_doc)
+		ws_xml_destroy_doc(req->response_doc);
+	u_buf_free(req->response);
+	u_free(req->fault_string);
+	u_free(req->upwd);
+	u_free(req->zbody);
+#ifdef _WIN32
+	ws_xml_free_memory(req->body);
+#else
+	u_free(req->body);
+#endif
+	u_free(req);
+}
@@ -53,6 +53,7 @@
 #include "wsman-xml-serialize.h"
 #include "wsman-faults.h"
 #include "wsman-soap-envelope.h"
+#include "wsman-response-cache.h"
 
 
 /**
@@ -668,6 +669,18 @@ static int process_filters(op_t * op, int inbound, void *opaqueData)
 
 
 
+/**
+ * Run the outbound filters on op->out_doc ahead of time. Used by
+ * stubs which stream the response and need a final header early.
+ * @param op SOAP operation
+ * @return 0 on success, 1 on error.
+ */
+int dispatch_outbound_filters(op_t * op, void *opaqueData)
+{
+	return process_filters(op, 0, opaqueData);
+}
+
+
 static void
 dispatcher_create_fault(SoapH soap, WsmanMessage * msg, WsXmlDocH in_doc)
 {
@@ -696,9 +709,11 @@ dispatcher_create_fault(SoapH soap, WsmanMessage * msg, WsXmlDocH in_doc)
 static int
 process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 {
-	int retVal = 1;
+	int retVal = 1, filtered;
 	char *buf = NULL;
 	int len;
+	unsigned long long t0;
+	WsmanResponseCacheMiss *miss = NULL;
 
 	msg->http_code = WSMAN_STATUS_OK;
 	op->out_doc = NULL;
@@ -709,7 +724,10 @@ process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 		goto GENERATE_FAULT;
 	}
 
-	if (process_filters(op, 1, opaqueData)) {
+	t0 = wsman_trace_begin(msg->trace);
+	filtered = process_filters(op, 1, opaqueData);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_FILTERS_IN, t0);
+	if (filtered) {
 		if (op->out_doc == NULL) {
 			error("doc is null");
 			wsman_set_fault(msg, WSMAN_INTERNAL_ERROR,
@@ -723,7 +741,9 @@ process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 			error("not fault envelope");
 		}
 
+		t0 = wsman_trace_begin(msg->trace);
 		ws_xml_dump_memory_enc(op->out_doc, &buf, &len, msg->charset);
+		wsman_trace_end(msg->trace, WSMAN_TRACE_SERIALIZE, t0);
 		u_buf_set(msg->response, buf, len);
 		ws_xml_destroy_doc(op->out_doc);
 		op->out_doc = NULL;
@@ -731,10 +751,22 @@ process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 		return 1;
 	}
 
+	if (wsman_response_cache_enabled() &&
+	    wsman_response_cache_replay(op->in_doc, msg, op->maxsize, &miss)) {
+		op->streamed = 1;
+		return 0;
+	}
 
+	t0 = wsman_trace_begin(msg->trace);
 	retVal = op->dispatch->serviceCallback((SoapOpH) op,
 					  op->dispatch->serviceData,
 					  opaqueData);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_ENDPOINT, t0);
+	if (op->streamed) {
+		/* response already in msg->response, filters were run by the stub */
+		wsman_response_cache_store(miss, msg, NULL);
+		return 0;
+	}
 	if (op->out_doc == NULL) {
 		// XXX (correct fault?)
 		wsman_set_fault(msg, WSA_DESTINATION_UNREACHABLE,
@@ -743,7 +775,9 @@ process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 		goto GENERATE_FAULT;
 	}
 
+	t0 = wsman_trace_begin(msg->trace);
 	process_filters(op, 0, opaqueData);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_FILTERS_OUT, t0);
 	if (op->out_doc == NULL) {
 		error("doc is null");
 		wsman_set_fault(msg, WSMAN_INTERNAL_ERROR,
@@ -757,14 +791,18 @@ process_inbound_operation(op_t * op, WsmanMessage * msg, void *opaqueData)
 	else {
 		wsman_add_fragement_for_header(op->in_doc, op->out_doc);
 	}
+	t0 = wsman_trace_begin(msg->trace);
 	ws_xml_dump_memory_enc(op->out_doc, &buf, &len, msg->charset);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_SERIALIZE, t0);
 	u_buf_set(msg->response, buf, len);
+	wsman_response_cache_store(miss, msg, op->out_doc);
 	ws_xml_destroy_doc(op->out_doc);
 	op->out_doc = NULL;
 	u_free(buf);
 	return 0;
 
       GENERATE_FAULT:
+	wsman_response_cache_store(miss, msg, NULL);
 	return retVal;
 }
 
@@ -788,8 +826,14 @@ void
 dispatch_inbound_call(SoapH soap, WsmanMessage * msg, void *opaqueData)
 {
 	op_t *op = NULL;
-	WsXmlDocH in_doc = wsman_build_inbound_envelope( msg);
+	WsXmlDocH in_doc;
 	SoapDispatchH dispatch = NULL;
+	unsigned long long t0;
+
+	t0 = wsman_trace_begin(msg->trace);
+	in_doc = wsman_build_inbound_envelope( msg);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_PARSE, t0);
+	wsman_trace_set_request(msg->trace, in_doc);
 	debug("Inbound call...");
 #if 0
         /* debug incoming message */
@@ -819,9 +863,14 @@ dispatch_inbound_call(SoapH soap, WsmanMessage * msg, void *opaqueData)
 		goto DONE;
 	}
 	op->in_doc = in_doc;
+	/* plugins time their backend calls against it */
+	wsman_trace_set_current(msg->trace);
 	process_inbound_operation(op, msg, opaqueData);
+	wsman_trace_set_current(NULL);
 DONE:
+	t0 = wsman_trace_begin(msg->trace);
 	dispatcher_create_fault(soap, msg, in_doc);
+	wsman_trace_end(msg->trace, WSMAN_TRACE_SERIALIZE, t0);
 	destroy_op_entry(op);
 	ws_xml_destroy_doc(in_doc);
 	debug("Inbound call completed");
@@ -48,6 +48,14 @@ int MemEventPoolClearEvent (char *uuid, clearproc proc);
 
 list_t *global_event_list = NULL;
 int max_pull_event_number = 16;
+/* events in all lists, read without the lock of the lists */
+static long event_pool_depth = 0;
+
+#ifdef __GNUC__
+#define EVENT_POOL_DEPTH_ADD(n) __sync_fetch_and_add(&event_pool_depth, (n))
+#else
+#define EVENT_POOL_DEPTH_ADD(n) (event_pool_depth += (n))
+#endif
 
 struct __EventPoolOpSet event_pool_op_set ={MemEventPoolInit, MemEventPoolFinalize, 
 	MemEventPoolCount, MemEventPoolAddEvent, MemEventPoolAddPullEvent,
@@ -58,6 +66,15 @@ EventPoolOpSetH wsman_get_eventpool_opset()
 	return &event_pool_op_set;
 }
 
+long wsman_event_pool_depth(void)
+{
+#ifdef __GNUC__
+	return __sync_fetch_and_add(&event_pool_depth, 0);
+#else
+	return event_pool_depth;
+#endif
+}
+
 int MemEventPoolInit (void *opaqueData) {
 	global_event_list = list_create(-1);
 	if(opaqueData)
@@ -104,6 +121,7 @@ int MemEventPoolAddEvent (char *uuid, WsNotificationInfoH notification) {
 	}
 	node = lnode_create(notification);
 	list_append(entry->event_content_list, node);
+	EVENT_POOL_DEPTH_ADD(1);
 	return 0;
 }
 
@@ -129,6 +147,7 @@ int MemEventPoolAddPullEvent (char *uuid, WsNotificationInfoH notification) {
 		return -1;
 	node = lnode_create(notification);
 	list_append(entry->event_content_list, node);
+	EVENT_POOL_DEPTH_ADD(1);
 	return 0;
 }
 
@@ -151,6 +170,7 @@ int MemEventPoolGetAndDeleteEvent (char *uuid, WsNotificationInfoH *notification
 	list_delete(entry->event_content_list, node);
 	*notification = (WsNotificationInfoH)node->list_data;
 	lnode_destroy(node);
+	EVENT_POOL_DEPTH_ADD(-1);
 	return 0;
 }
 
@@ -179,6 +199,7 @@ int MemEventPoolClearEvent (char *uuid, clearproc proc) {
 		tmp = list_next(entry->event_content_list, node);
 		list_delete(entry->event_content_list, node);
 		lnode_destroy(node);
+		EVENT_POOL_DEPTH_ADD(-1);
 		node = tmp;
 	}
 	list_destroy(entry->event_content_list);
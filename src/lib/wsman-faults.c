@@ -535,6 +535,41 @@ WsmanKnownStatusCode wsman_find_httpcode_for_fault_code( WsmanFaultCodeType faul
 
 }
 
+/* Subcode naming faultCode, NULL if there is none */
+const char *wsman_fault_name(WsmanFaultCodeType faultCode)
+{
+	int i;
+	int nfaults = sizeof (fault_code_table) / sizeof (fault_code_table[0]);
+
+	for (i = 0; i < nfaults; i++) {
+		if (fault_code_table[i].fault_code != faultCode)
+			continue;
+		if (fault_code_table[i].subCode && *fault_code_table[i].subCode)
+			return fault_code_table[i].subCode;
+		return fault_code_table[i].code;
+	}
+	return NULL;
+}
+
+/* Fault named by the subcode of a fault, with or without prefix */
+WsmanFaultCodeType wsman_fault_code_for_name(const char *name)
+{
+	int i;
+	int nfaults = sizeof (fault_code_table) / sizeof (fault_code_table[0]);
+	const char *p;
+
+	if (name == NULL)
+		return WSMAN_UNKNOWN;
+	if ((p = strchr(name, ':')) != NULL)
+		name = p + 1;
+	for (i = 0; i < nfaults; i++) {
+		p = wsman_fault_name(fault_code_table[i].fault_code);
+		if (p && !strcmp(name, p))
+			return fault_code_table[i].fault_code;
+	}
+	return WSMAN_UNKNOWN;
+}
+
 WsXmlDocH
 wsman_generate_fault( WsXmlDocH in_doc,
 		WsmanFaultCodeType faultCode,
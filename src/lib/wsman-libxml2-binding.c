@@ -41,6 +41,7 @@
 #include <ctype.h>
 
 #include <assert.h>
+#include <pthread.h>
 
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
@@ -48,6 +49,8 @@
 
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlwriter.h>
+#include <libxml/xmlreader.h>
 
 
 #include "u/libu.h"
@@ -78,7 +81,9 @@ static void destroy_node_private_data(void *_data)
 static void destroy_tree_private_data(xmlNode * node)
 {
 	while (node) {
-		xmlAttrPtr attr = node->properties;
+		/* text nodes may keep short content in the properties field */
+		xmlAttrPtr attr = node->type == XML_ELEMENT_NODE ?
+			node->properties : NULL;
 
 		if (node->_private) {
 			destroy_node_private_data(node->_private);
@@ -845,43 +850,645 @@ void xml_parser_doc_dump_memory_enc(WsXmlDocH doc, char **buf, int *ptrSize, con
 	return;
 }
 
+/*
+ * Streaming writer: output goes through an xmlTextWriter straight into
+ * a u_buf_t, DOM subtrees are only built for the parts that need them.
+ */
+struct __WsXmlWriter {
+	xmlTextWriterPtr writer;
+	xmlBufferPtr scratch;
+	u_buf_t *out;
+	xmlDocPtr doc;		/* document being streamed */
+};
+
+static int
+xml_parser_writer_out(void *context, const char *buffer, int len)
+{
+	if (len > 0 && u_buf_append((u_buf_t *) context, (void *) buffer, len))
+		return -1;
+	return len;
+}
+
+WsXmlWriterH xml_parser_writer_new(u_buf_t *out, const char *encoding)
+{
+	xmlOutputBufferPtr obuf;
+	WsXmlWriterH w = u_zalloc(sizeof(struct __WsXmlWriter));
+
+	if (w == NULL)
+		return NULL;
+	w->out = out;
+	w->scratch = xmlBufferCreate();
+	obuf = xmlOutputBufferCreateIO(xml_parser_writer_out, NULL, out, NULL);
+	if (w->scratch == NULL || obuf == NULL) {
+		if (obuf)
+			xmlOutputBufferClose(obuf);
+		goto err;
+	}
+	/* the writer owns obuf from now on */
+	w->writer = xmlNewTextWriter(obuf);
+	if (w->writer == NULL) {
+		xmlOutputBufferClose(obuf);
+		goto err;
+	}
+	if (xmlTextWriterStartDocument(w->writer, NULL,
+			encoding ? encoding : "UTF-8", NULL) < 0)
+		goto err;
+	return w;
+err:
+	xml_parser_writer_free(w);
+	return NULL;
+}
+
+void xml_parser_writer_free(WsXmlWriterH w)
+{
+	if (w == NULL)
+		return;
+	if (w->writer)
+		xmlFreeTextWriter(w->writer);
+	if (w->scratch)
+		xmlBufferFree(w->scratch);
+	u_free(w);
+}
+
+static char *
+xml_parser_writer_qname(const xmlChar *prefix, const xmlChar *name)
+{
+	if (prefix == NULL)
+		return u_strdup((const char *) name);
+	return u_strdup_printf("%s:%s", (const char *) prefix,
+			(const char *) name);
+}
+
+int xml_parser_writer_start_node(WsXmlWriterH w, WsXmlNodeH node)
+{
+	xmlNodePtr n = (xmlNodePtr) node;
+	xmlNsPtr ns;
+	xmlAttrPtr attr;
+	char *qname;
+	int ret;
+
+	if (w->doc == NULL)
+		w->doc = n->doc;
+	qname = xml_parser_writer_qname(n->ns ? n->ns->prefix : NULL, n->name);
+	ret = xmlTextWriterStartElement(w->writer, BAD_CAST qname);
+	u_free(qname);
+	if (ret < 0)
+		return 1;
+
+	for (ns = n->nsDef; ns != NULL; ns = ns->next) {
+		qname = xml_parser_writer_qname(BAD_CAST "xmlns", ns->prefix);
+		ret = xmlTextWriterWriteAttribute(w->writer,
+				ns->prefix ? BAD_CAST qname : BAD_CAST "xmlns",
+				ns->href);
+		u_free(qname);
+		if (ret < 0)
+			return 1;
+	}
+	for (attr = n->properties; attr != NULL; attr = attr->next) {
+		xmlChar *value = xmlNodeGetContent((xmlNodePtr) attr);
+
+		qname = xml_parser_writer_qname(attr->ns ? attr->ns->prefix : NULL,
+				attr->name);
+		ret = xmlTextWriterWriteAttribute(w->writer, BAD_CAST qname,
+				value ? value : BAD_CAST "");
+		u_free(qname);
+		xmlFree(value);
+		if (ret < 0)
+			return 1;
+	}
+	return 0;
+}
+
+int xml_parser_writer_end_node(WsXmlWriterH w)
+{
+	return xmlTextWriterEndElement(w->writer) < 0 ? 1 : 0;
+}
+
+/*
+ * Write the subtree rooted at node unless that would take the output
+ * beyond limit bytes (0: no limit). Returns 0 when written, 1 when it
+ * does not fit and -1 on error.
+ */
+int xml_parser_writer_node(WsXmlWriterH w, WsXmlNodeH node, size_t limit)
+{
+	xmlNodePtr n = (xmlNodePtr) node;
+	xmlNodePtr copy = NULL;
+	int ret;
+
+	/*
+	 * Namespaces declared above a node of another document are not in
+	 * scope on the writer, a copy gets them declared on its root.
+	 */
+	if (n->doc != w->doc && n->parent &&
+			n->parent->type == XML_ELEMENT_NODE) {
+		copy = xmlDocCopyNode(n, n->doc, 1);
+		if (copy == NULL)
+			return -1;
+		n = copy;
+	}
+	xmlBufferEmpty(w->scratch);
+	ret = xmlNodeDump(w->scratch, n->doc, n, 0, 0);
+	if (copy)
+		xmlFreeNode(copy);
+	if (ret < 0)
+		return -1;
+	if (limit && xml_parser_writer_offset(w) +
+			xmlBufferLength(w->scratch) > limit)
+		return 1;
+	if (xmlTextWriterWriteRawLen(w->writer, xmlBufferContent(w->scratch),
+			xmlBufferLength(w->scratch)) < 0)
+		return -1;
+	return 0;
+}
+
+/*
+ * Number of bytes produced so far. Any pending start tag is closed
+ * first so the offset is a valid position to cut the output at.
+ */
+size_t xml_parser_writer_offset(WsXmlWriterH w)
+{
+	xmlTextWriterWriteRawLen(w->writer, BAD_CAST "", 0);
+	xmlTextWriterFlush(w->writer);
+	return u_buf_len(w->out);
+}
+
+int xml_parser_writer_end_doc(WsXmlWriterH w)
+{
+	if (xmlTextWriterEndDocument(w->writer) < 0)
+		return 1;
+	return xmlTextWriterFlush(w->writer) < 0 ? 1 : 0;
+}
+
+/*
+ * Pull reader over an enumeration response. Only the item being
+ * returned is expanded; the reader frees it when moving on, so a page
+ * is never held as a whole tree.
+ */
+struct __WsXmlReader {
+	xmlTextReaderPtr reader;
+	struct _WsXmlDoc doc;	/* handle for the reader's partial document */
+	xmlNodePtr current;	/* node last returned */
+	int items_depth;	/* depth of the Items element, -1 outside */
+};
+
+static int
+xml_parser_reader_is(xmlTextReaderPtr reader, const char *name)
+{
+	const char *uri = (const char *) xmlTextReaderConstNamespaceUri(reader);
+
+	if (strcmp((const char *) xmlTextReaderConstLocalName(reader), name))
+		return 0;
+	return uri && (!strcmp(uri, XML_NS_ENUMERATION) ||
+			!strcmp(uri, XML_NS_WS_MAN));
+}
+
+/* the reader frees nodes itself, drop our data of the current one first */
+static void
+xml_parser_reader_release(WsXmlReaderH r)
+{
+	xmlNodePtr next = r->current->next;
+
+	r->current->next = NULL;
+	destroy_tree_private_data(r->current);
+	r->current->next = next;
+	r->current = NULL;
+}
+
+WsXmlReaderH xml_parser_reader_new(const char *buf, size_t size,
+		const char *encoding)
+{
+	WsXmlReaderH r;
+
+	if (!buf || !size)
+		return NULL;
+	r = u_zalloc(sizeof(struct __WsXmlReader));
+	if (r == NULL)
+		return NULL;
+	r->reader = xmlReaderForMemory(buf, (int) size, NULL, encoding,
+			XML_PARSE_NONET | XML_PARSE_NSCLEAN);
+	if (r->reader == NULL) {
+		u_free(r);
+		return NULL;
+	}
+	r->items_depth = -1;
+	return r;
+}
+
+void xml_parser_reader_free(WsXmlReaderH r)
+{
+	if (r->current)
+		xml_parser_reader_release(r);
+	if (r->doc.parserDoc)
+		((xmlDocPtr) r->doc.parserDoc)->_private = NULL;
+	xmlFreeTextReader(r->reader);
+	u_free(r);
+}
+
+WsXmlNodeH xml_parser_reader_next(WsXmlReaderH r, int *what)
+{
+	xmlNodePtr node;
+	int ret;
+
+	*what = 0;
+	if (r->current) {
+		xml_parser_reader_release(r);
+		ret = xmlTextReaderNext(r->reader);
+	} else {
+		ret = xmlTextReaderRead(r->reader);
+	}
+
+	for (; ret == 1; ret = xmlTextReaderRead(r->reader)) {
+		int type = xmlTextReaderNodeType(r->reader);
+		int depth = xmlTextReaderDepth(r->reader);
+
+		if (type == XML_READER_TYPE_END_ELEMENT &&
+				depth == r->items_depth)
+			r->items_depth = -1;
+		if (type != XML_READER_TYPE_ELEMENT)
+			continue;
+
+		if (r->items_depth >= 0 && depth == r->items_depth + 1) {
+			*what = WS_XML_READER_ITEM;
+		} else if (xml_parser_reader_is(r->reader, WSENUM_ITEMS)) {
+			if (!xmlTextReaderIsEmptyElement(r->reader))
+				r->items_depth = depth;
+			continue;
+		} else if (xml_parser_reader_is(r->reader,
+					WSENUM_ENUMERATION_CONTEXT)) {
+			*what = WS_XML_READER_CONTEXT;
+		} else if (xml_parser_reader_is(r->reader,
+					WSENUM_END_OF_SEQUENCE)) {
+			*what = WS_XML_READER_END;
+		} else {
+			continue;
+		}
+
+		node = xmlTextReaderExpand(r->reader);
+		if (node == NULL)
+			break;
+		if (r->doc.parserDoc == NULL) {
+			r->doc.parserDoc = node->doc;
+			node->doc->_private = &r->doc;
+		}
+		r->current = node;
+		return (WsXmlNodeH) node;
+	}
+	if (ret != 0)
+		*what = -1;
+	return NULL;
+}
+
+/* push parser, fed as the document arrives */
+struct __WsXmlPushParser {
+	xmlParserCtxtPtr ctxt;
+	int failed;
+};
+
+WsXmlPushParserH xml_parser_push_new(const char *encoding)
+{
+	WsXmlPushParserH p = u_zalloc(sizeof(struct __WsXmlPushParser));
+
+	if (p == NULL)
+		return NULL;
+	p->ctxt = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
+	if (p->ctxt == NULL) {
+		u_free(p);
+		return NULL;
+	}
+	xmlCtxtUseOptions(p->ctxt, XML_PARSE_NONET | XML_PARSE_NSCLEAN);
+	if (encoding && xmlCtxtResetPush(p->ctxt, NULL, 0, NULL, encoding)) {
+		xml_parser_push_free(p);
+		return NULL;
+	}
+	return p;
+}
+
+int xml_parser_push_chunk(WsXmlPushParserH p, const char *buf, size_t size)
+{
+	if (p->failed)
+		return 1;
+	if (size > 0 && xmlParseChunk(p->ctxt, buf, (int) size, 0))
+		p->failed = 1;
+	return p->failed;
+}
+
+WsXmlDocH xml_parser_push_end(WsXmlPushParserH p)
+{
+	WsXmlDocH Doc;
+	xmlDocPtr xmlDoc;
+
+	if (!p->failed && xmlParseChunk(p->ctxt, NULL, 0, 1))
+		p->failed = 1;
+	xmlDoc = p->ctxt->myDoc;
+	p->ctxt->myDoc = NULL;
+	if (xmlDoc == NULL)
+		return NULL;
+	if (p->failed || !p->ctxt->wellFormed) {
+		xmlFreeDoc(xmlDoc);
+		return NULL;
+	}
+	Doc = (WsXmlDocH) u_zalloc(sizeof(*Doc));
+	if (Doc == NULL) {
+		xmlFreeDoc(xmlDoc);
+		return NULL;
+	}
+	xmlDoc->_private = Doc;
+	Doc->parserDoc = xmlDoc;
+	return Doc;
+}
+
+void xml_parser_push_free(WsXmlPushParserH p)
+{
+	if (p->ctxt->myDoc)
+		xmlFreeDoc(p->ctxt->myDoc);
+	xmlFreeParserCtxt(p->ctxt);
+	u_free(p);
+}
+
+/*
+ * Per thread XPath state: one evaluation context, reused for every
+ * document, and a small LRU cache of compiled expressions.
+ *
+ * Prefixes of a compiled expression are only resolved against the
+ * context at evaluation time, so the expression text alone is the key.
+ */
+#define XPATH_CACHE_SIZE 32
+
+/* the counters are written by their thread only, and read by any */
+#ifdef __GNUC__
+#define XPATH_COUNT(var) \
+	__atomic_store_n(&(var), (var) + 1, __ATOMIC_RELAXED)
+#define XPATH_GET(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#else
+#define XPATH_COUNT(var) ((var)++)
+#define XPATH_GET(var) (var)
+#endif
+
+typedef struct {
+	char *expr;
+	xmlXPathCompExprPtr comp;
+	unsigned long used;
+} xpath_cache_entry;
+
+typedef struct __xpath_cache {
+	xmlXPathContextPtr ctxt;
+	xpath_cache_entry entries[XPATH_CACHE_SIZE];
+	unsigned long tick;
+	unsigned long hits;
+	unsigned long misses;
+	struct __xpath_cache *next;
+} xpath_cache;
+
+static pthread_key_t xpath_cache_key;
+static pthread_once_t xpath_cache_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t xpath_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* all live caches, for the statistics */
+static xpath_cache *xpath_caches = NULL;
+/* counters of the caches of finished threads */
+static unsigned long xpath_cache_hits = 0;
+static unsigned long xpath_cache_misses = 0;
+
+static void
+xpath_cache_free(void *data)
+{
+	xpath_cache *cache = (xpath_cache *) data;
+	xpath_cache **cur;
+	int i;
+
+	pthread_mutex_lock(&xpath_cache_lock);
+	for (cur = &xpath_caches; *cur; cur = &(*cur)->next) {
+		if (*cur == cache) {
+			*cur = cache->next;
+			break;
+		}
+	}
+	xpath_cache_hits += cache->hits;
+	xpath_cache_misses += cache->misses;
+	pthread_mutex_unlock(&xpath_cache_lock);
+
+	for (i = 0; i < XPATH_CACHE_SIZE; i++) {
+		if (cache->entries[i].comp)
+			xmlXPathFreeCompExpr(cache->entries[i].comp);
+		u_free(cache->entries[i].expr);
+	}
+	if (cache->ctxt)
+		xmlXPathFreeContext(cache->ctxt);
+	u_free(cache);
+}
+
+static void
+xpath_cache_init(void)
+{
+	pthread_key_create(&xpath_cache_key, xpath_cache_free);
+}
+
+static xpath_cache *
+xpath_get_cache(void)
+{
+	xpath_cache *cache;
+
+	pthread_once(&xpath_cache_once, xpath_cache_init);
+	cache = (xpath_cache *) pthread_getspecific(xpath_cache_key);
+	if (cache)
+		return cache;
+
+	cache = u_zalloc(sizeof(xpath_cache));
+	if (cache == NULL)
+		return NULL;
+	cache->ctxt = xmlXPathNewContext(NULL);
+	if (cache->ctxt == NULL) {
+		u_free(cache);
+		return NULL;
+	}
+	pthread_setspecific(xpath_cache_key, cache);
+	pthread_mutex_lock(&xpath_cache_lock);
+	cache->next = xpath_caches;
+	xpath_caches = cache;
+	pthread_mutex_unlock(&xpath_cache_lock);
+	return cache;
+}
+
+/*
+ * Compiled form of expression, owned by the cache.
+ */
+static xmlXPathCompExprPtr
+xpath_compile(xpath_cache *cache, const char *expression)
+{
+	xpath_cache_entry *e, *victim = NULL;
+	xmlXPathCompExprPtr comp;
+	int i;
+
+	for (i = 0; i < XPATH_CACHE_SIZE; i++) {
+		e = &cache->entries[i];
+		if (e->expr == NULL) {
+			if (victim == NULL || victim->expr != NULL)
+				victim = e;
+			continue;
+		}
+		if (strcmp(e->expr, expression) == 0) {
+			e->used = ++cache->tick;
+			XPATH_COUNT(cache->hits);
+			return e->comp;
+		}
+		if (victim == NULL ||
+		    (victim->expr != NULL && e->used < victim->used))
+			victim = e;
+	}
+	XPATH_COUNT(cache->misses);
+
+	comp = xmlXPathCompile(BAD_CAST expression);
+	if (comp == NULL)
+		return NULL;
+	if (victim->comp)
+		xmlXPathFreeCompExpr(victim->comp);
+	u_free(victim->expr);
+	victim->expr = u_strdup(expression);
+	if (victim->expr == NULL) {
+		victim->comp = NULL;
+		xmlXPathFreeCompExpr(comp);
+		return NULL;
+	}
+	victim->comp = comp;
+	victim->used = ++cache->tick;
+	return comp;
+}
+
 static void
-register_namespaces(xmlXPathContextPtr ctxt, WsXmlDocH doc,
-		WsXmlNodeH node)
+register_namespaces(xmlXPathContextPtr ctxt, WsXmlNodeH node)
 {
 	xmlNsPtr *nsList, *cur;
-	xmlDocPtr d = (xmlDocPtr) doc->parserDoc;
+	xmlNodePtr n = (xmlNodePtr) node;
 
 
-	nsList = xmlGetNsList(d, (xmlNodePtr) node);
+	if (n == NULL)
+		return;
+	nsList = xmlGetNsList(n->doc, n);
 	if (nsList == NULL) {
 		return;
 	}
 	for (cur = nsList; *cur != NULL; cur++) {
 		if (xmlXPathRegisterNs(ctxt, (*cur)->prefix, (*cur)->href)
 				!= 0) {
-			return;
+			break;
 		}
 	}
 	xmlFree(nsList);
 }
 
+/*
+ * Evaluate expression on doc, with the namespaces in scope at the root
+ * and, if given, at ns_node. The context stays bound to doc until
+ * xpath_release() is called.
+ */
+static xmlXPathObjectPtr
+xpath_eval(xpath_cache *cache, WsXmlDocH doc, WsXmlNodeH ns_node,
+		const char *expression)
+{
+	xmlXPathContextPtr ctxt = cache->ctxt;
+	xmlXPathCompExprPtr comp;
+
+	comp = xpath_compile(cache, expression);
+	if (comp == NULL)
+		return NULL;
+
+	xmlXPathRegisteredNsCleanup(ctxt);
+	ctxt->doc = (xmlDocPtr) doc->parserDoc;
+	ctxt->node = NULL;
+	register_namespaces(ctxt, xml_parser_get_root(doc));
+	if (ns_node)
+		register_namespaces(ctxt, ns_node);
+
+	return xmlXPathCompiledEval(comp, ctxt);
+}
+
+static void
+xpath_release(xpath_cache *cache)
+{
+	xmlXPathRegisteredNsCleanup(cache->ctxt);
+	cache->ctxt->doc = NULL;
+	cache->ctxt->node = NULL;
+}
+
+void xml_parser_xpath_cache_stats(unsigned long *hits,
+		unsigned long *misses)
+{
+	xpath_cache *cache;
+	unsigned long h, m;
+
+	pthread_mutex_lock(&xpath_cache_lock);
+	h = xpath_cache_hits;
+	m = xpath_cache_misses;
+	for (cache = xpath_caches; cache; cache = cache->next) {
+		h += XPATH_GET(cache->hits);
+		m += XPATH_GET(cache->misses);
+	}
+	pthread_mutex_unlock(&xpath_cache_lock);
+	if (hits)
+		*hits = h;
+	if (misses)
+		*misses = m;
+}
+
+
+/*
+ * Evaluate expression with node as context node, the namespaces in
+ * scope at node and, overriding them, those in scope at ns_node, which
+ * may belong to another document.
+ * Returns 1 if the result is true or a non empty node set, 0 if not and
+ * -1 if the expression could not be compiled or evaluated.
+ */
+int xml_parser_xpath_match(WsXmlNodeH node, WsXmlNodeH ns_node,
+		const char *expression)
+{
+	xmlXPathObjectPtr obj;
+	xmlXPathCompExprPtr comp;
+	xmlXPathContextPtr ctxt;
+	xpath_cache *cache;
+	int retval;
+
+	cache = xpath_get_cache();
+	if (cache == NULL) {
+		error("failed while creating xpath context");
+		return -1;
+	}
+	comp = xpath_compile(cache, expression);
+	if (comp == NULL)
+		return -1;
+
+	ctxt = cache->ctxt;
+	xmlXPathRegisteredNsCleanup(ctxt);
+	ctxt->doc = ((xmlNodePtr) node)->doc;
+	ctxt->node = (xmlNodePtr) node;
+	register_namespaces(ctxt, node);
+	if (ns_node)
+		register_namespaces(ctxt, ns_node);
+
+	obj = xmlXPathCompiledEval(comp, ctxt);
+	if (obj) {
+		retval = xmlXPathCastToBoolean(obj) ? 1 : 0;
+		xmlXPathFreeObject(obj);
+	} else {
+		retval = -1;
+	}
+	xpath_release(cache);
+
+	return retval;
+}
+
 
 int xml_parser_check_xpath(WsXmlDocH doc, const char *expression)
 {
 	xmlXPathObject *obj;
 	xmlNodeSetPtr nodeset;
-	xmlXPathContextPtr ctxt;
-	xmlDocPtr d = (xmlDocPtr) doc->parserDoc;
+	xpath_cache *cache;
 	int retval = 0;
 
-	ctxt = xmlXPathNewContext(d);
-	if (ctxt == NULL) {
+	cache = xpath_get_cache();
+	if (cache == NULL) {
 		error("failed while creating xpath context");
 		return 0;
 	}
-	register_namespaces(ctxt, doc, xml_parser_get_root(doc));
-	obj = xmlXPathEvalExpression(BAD_CAST expression, ctxt);
+	obj = xpath_eval(cache, doc, NULL, expression);
 	if (obj) {
 		nodeset = obj->nodesetval;
 		if (nodeset && nodeset->nodeNr > 0) {
@@ -905,7 +1512,7 @@ int xml_parser_check_xpath(WsXmlDocH doc, const char *expression)
 		}
 		xmlXPathFreeObject(obj);
 	}
-	xmlXPathFreeContext(ctxt);
+	xpath_release(cache);
 
 	return retval;
 }
@@ -914,27 +1521,21 @@ int xml_parser_check_xpath(WsXmlDocH doc, const char *expression)
 
 char *xml_parser_get_xpath_value(WsXmlDocH doc, const char *expression)
 {
-	//int i;
 	char *result = NULL;
 	xmlXPathObject *obj;
 	xmlNodeSetPtr nodeset;
-	xmlXPathContextPtr ctxt;
+	xpath_cache *cache;
 	xmlDocPtr d = (xmlDocPtr) doc->parserDoc;
 	WsXmlNodeH body;
 
-	ctxt = xmlXPathNewContext(d);
-	if (ctxt == NULL) {
+	cache = xpath_get_cache();
+	if (cache == NULL) {
 		error("failed while creating xpath context");
 		return NULL;
 	}
 	body = ws_xml_get_soap_body(doc);
-	register_namespaces(ctxt, doc, xml_parser_get_root(doc));
-	if (ws_xml_get_child(body, 0, NULL, NULL)) {
-		register_namespaces(ctxt, doc,
-				ws_xml_get_child(body, 0, NULL, NULL));
-	}
-
-	obj = xmlXPathEvalExpression(BAD_CAST expression, ctxt);
+	obj = xpath_eval(cache, doc, ws_xml_get_child(body, 0, NULL, NULL),
+			expression);
 	if (obj) {
 		nodeset = obj->nodesetval;
 		if (nodeset && nodeset->nodeNr > 0)
@@ -946,7 +1547,7 @@ char *xml_parser_get_xpath_value(WsXmlDocH doc, const char *expression)
 
 		xmlXPathFreeObject(obj);
 	}
-	xmlXPathFreeContext(ctxt);
+	xpath_release(cache);
 
 	return result;
 }
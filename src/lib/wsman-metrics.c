@@ -0,0 +1,570 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Server metrics, see wsman-metrics.h.
+ *
+ * A thread counts into its own metrics_thread block and nobody else
+ * writes to it, so the counters are bumped with plain relaxed stores.
+ * Blocks are never freed while the server runs: the block of a thread
+ * which exits is handed to the next new thread and keeps counting, so
+ * the sums collected only grow.
+ *
+ * metrics_lock guards the list of blocks, the names of the series and
+ * the registered metrics. A thread takes it the first time it sees an
+ * Action and ResourceURI; collecting takes it to walk the blocks.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-soap-envelope.h"
+#include "wsman-event-pool.h"
+#include "wsman-metrics.h"
+
+#define METRICS_SERIES_MAX 256
+#define METRICS_FNS_MAX 32
+#define METRICS_KEY_MAX 1024
+#define METRICS_LINE_MAX 2560
+
+#ifdef __GNUC__
+#define METRICS_ADD(var, n) \
+	__atomic_store_n(&(var), (var) + (n), __ATOMIC_RELAXED)
+#define METRICS_GET(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#else
+#define METRICS_ADD(var, n) ((var) += (n))
+#define METRICS_GET(var) (var)
+#endif
+
+/* upper bounds of the latency buckets, in seconds */
+static const double metrics_bounds[] = {
+	0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+	0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+#define METRICS_BUCKETS (sizeof(metrics_bounds) / sizeof(metrics_bounds[0]))
+
+typedef struct {
+	unsigned long requests;
+	unsigned long long ns;
+	/* requests per bucket, slower ones only in requests */
+	unsigned long buckets[METRICS_BUCKETS];
+} metrics_series;
+
+typedef struct metrics_thread metrics_thread;
+struct metrics_thread {
+	metrics_thread *next;
+	int in_use;
+	int current;		/* series of the request being served */
+	WsmanFaultCodeType fault;	/* fault a plugin answered with */
+	hash_t *index;		/* series by key, read by the owner only */
+	unsigned long faults[WSMAN_UNKNOWN + 1];
+	unsigned long authorized;
+	unsigned long refused;
+	metrics_series *series[METRICS_SERIES_MAX];
+};
+
+typedef struct {
+	char *key;		/* "action resource" */
+	char *labels;		/* escaped, for the output */
+} metrics_name;
+
+typedef struct {
+	const char *name;
+	const char *help;
+	WsmanMetricType type;
+	WsmanMetricFn fn;
+	void *data;
+} metrics_fn;
+
+static int metrics_on = 0;
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static metrics_thread *metrics_threads = NULL;
+static hash_t *metrics_index = NULL;
+static metrics_name metrics_names[METRICS_SERIES_MAX];
+static int metrics_name_count = 0;
+static metrics_fn metrics_fns[METRICS_FNS_MAX];
+static int metrics_fn_count = 0;
+
+static pthread_key_t metrics_key;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+
+
+static void metrics_thread_exit(void *data)
+{
+	metrics_thread *t = (metrics_thread *) data;
+
+	pthread_mutex_lock(&metrics_lock);
+	t->in_use = 0;
+	t->current = -1;
+	pthread_mutex_unlock(&metrics_lock);
+}
+
+static void metrics_key_init(void)
+{
+	pthread_key_create(&metrics_key, metrics_thread_exit);
+}
+
+static metrics_thread *metrics_get_thread(void)
+{
+	metrics_thread *t;
+
+	pthread_once(&metrics_once, metrics_key_init);
+	t = (metrics_thread *) pthread_getspecific(metrics_key);
+	if (t)
+		return t;
+
+	pthread_mutex_lock(&metrics_lock);
+	for (t = metrics_threads; t; t = t->next)
+		if (!t->in_use)
+			break;
+	if (t == NULL && (t = u_zalloc(sizeof(metrics_thread))) != NULL) {
+		t->index = hash_create(METRICS_SERIES_MAX, 0, 0);
+		if (t->index == NULL) {
+			u_free(t);
+			t = NULL;
+		} else {
+			t->next = metrics_threads;
+			metrics_threads = t;
+		}
+	}
+	if (t) {
+		t->in_use = 1;
+		t->current = -1;
+		t->fault = WSMAN_RC_OK;
+	}
+	pthread_mutex_unlock(&metrics_lock);
+	if (t)
+		pthread_setspecific(metrics_key, t);
+	return t;
+}
+
+/* label value as Prometheus wants it */
+static void metrics_escape(char *dst, size_t size, const char *src)
+{
+	size_t len = 0;
+
+	for (; *src && len + 2 < size; src++) {
+		if (*src == '\\' || *src == '"') {
+			dst[len++] = '\\';
+			dst[len++] = *src;
+		} else if (*src == '\n') {
+			dst[len++] = '\\';
+			dst[len++] = 'n';
+		} else {
+			dst[len++] = *src;
+		}
+	}
+	dst[len] = '\0';
+}
+
+/* metrics_lock held */
+static int metrics_intern(const char *key, const char *action,
+		const char *resource)
+{
+	char a[METRICS_KEY_MAX], r[METRICS_KEY_MAX];
+	metrics_name *name;
+	hnode_t *hn;
+
+	hn = hash_lookup(metrics_index, key);
+	if (hn)
+		return (int) (long) hnode_get(hn) - 1;
+	if (metrics_name_count == METRICS_SERIES_MAX)
+		return 0;
+
+	name = &metrics_names[metrics_name_count];
+	metrics_escape(a, sizeof(a), action);
+	metrics_escape(r, sizeof(r), resource);
+	name->key = u_strdup(key);
+	name->labels = u_strdup_printf("action=\"%s\",resource=\"%s\"", a, r);
+	if (name->key == NULL || name->labels == NULL ||
+	    !hash_alloc_insert(metrics_index, name->key,
+			       (void *) (long) (metrics_name_count + 1))) {
+		u_free(name->key);
+		u_free(name->labels);
+		return 0;
+	}
+	return metrics_name_count++;
+}
+
+static int metrics_series_of(metrics_thread *t, const char *action,
+		const char *resource)
+{
+	char key[METRICS_KEY_MAX];
+	char *own = NULL;
+	hnode_t *hn;
+	int i;
+
+	snprintf(key, sizeof(key), "%s %s", action, resource);
+	hn = hash_lookup(t->index, key);
+	if (hn)
+		return (int) (long) hnode_get(hn) - 1;
+
+	pthread_mutex_lock(&metrics_lock);
+	i = metrics_intern(key, action, resource);
+	if (t->series[i] == NULL)
+		t->series[i] = u_zalloc(sizeof(metrics_series));
+	/*
+	 * past METRICS_SERIES_MAX keys go to the first series, they are
+	 * remembered under a copy of their own key owned by the thread
+	 */
+	if (t->series[i] && !hash_isfull(t->index)) {
+		if (strcmp(metrics_names[i].key, key) == 0) {
+			hash_alloc_insert(t->index, metrics_names[i].key,
+					  (void *) (long) (i + 1));
+		} else if ((own = u_strdup(key)) != NULL &&
+			   !hash_alloc_insert(t->index, own,
+					      (void *) (long) (i + 1))) {
+			u_free(own);
+		}
+	}
+	pthread_mutex_unlock(&metrics_lock);
+	return t->series[i] ? i : -1;
+}
+
+/* the series of a request is known once its envelope is parsed */
+static int metrics_inbound_filter(SoapOpH op, void *data, void *opaqueData)
+{
+	WsXmlDocH doc = soap_get_op_doc(op, 1);
+	metrics_thread *t = metrics_get_thread();
+	char *action, *resource;
+	WsXmlNodeH body;
+
+	if (t == NULL || doc == NULL)
+		return 0;
+	action = wsman_get_action(NULL, doc);
+	resource = wsman_get_resource_uri(NULL, doc);
+	if (action == NULL) {
+		/* Identify comes without an Action */
+		body = ws_xml_get_child(ws_xml_get_soap_body(doc), 0, NULL, NULL);
+		if (body)
+			action = ws_xml_get_node_local_name(body);
+	}
+	t->current = metrics_series_of(t, action ? action : "-",
+				       resource ? resource : "-");
+	t->fault = WSMAN_RC_OK;
+	return 0;
+}
+
+/* plugins mostly put their faults into the response themselves */
+static int metrics_outbound_filter(SoapOpH op, void *data, void *opaqueData)
+{
+	WsXmlDocH doc = soap_get_op_doc(op, 0);
+	metrics_thread *t = metrics_get_thread();
+	WsXmlNodeH node;
+	char *value;
+
+	if (t == NULL || doc == NULL || !wsman_is_fault_envelope(doc))
+		return 0;
+	node = ws_xml_get_child(ws_xml_get_soap_body(doc), 0,
+				XML_NS_SOAP_1_2, SOAP_FAULT);
+	node = ws_xml_get_child(node, 0, XML_NS_SOAP_1_2, SOAP_CODE);
+	node = ws_xml_get_child(node, 0, XML_NS_SOAP_1_2, SOAP_SUBCODE);
+	node = ws_xml_get_child(node, 0, XML_NS_SOAP_1_2, SOAP_VALUE);
+	value = ws_xml_get_node_text(node);
+	t->fault = wsman_fault_code_for_name(value);
+	return 0;
+}
+
+static double metrics_enumerations(void *data)
+{
+	SoapH soap = (SoapH) data;
+
+	/* read without u_lock(soap), the count may lag a request behind */
+	return METRICS_GET(soap->cntx->enuminfos->hash_nodecount);
+}
+
+#ifdef ENABLE_EVENTING_SUPPORT
+static double metrics_subscriptions(void *data)
+{
+	SoapH soap = (SoapH) data;
+
+	return METRICS_GET(soap->cntx->subscriptionMemList->list_nodecount);
+}
+
+static double metrics_event_pool(void *data)
+{
+	return wsman_event_pool_depth();
+}
+#endif
+
+/**
+ * Start counting, for requests dispatched by soap
+ * @return 0 on success
+ */
+int wsman_metrics_init(SoapH soap)
+{
+	pthread_mutex_lock(&metrics_lock);
+	if (metrics_index == NULL)
+		metrics_index = hash_create(METRICS_SERIES_MAX, 0, 0);
+	if (metrics_index && metrics_name_count == 0)
+		/* requests which do not get as far as the dispatcher */
+		metrics_intern("- -", "-", "-");
+	pthread_mutex_unlock(&metrics_lock);
+	if (metrics_index == NULL || metrics_name_count == 0)
+		return 1;
+
+	if (soap) {
+		if (!soap_add_filter(soap, metrics_inbound_filter, NULL, 1) ||
+		    !soap_add_filter(soap, metrics_outbound_filter, NULL, 0))
+			return 1;
+		if (soap->cntx && soap->cntx->enuminfos)
+			wsman_metrics_add("wsman_enumeration_contexts",
+					  "Open enumeration contexts.",
+					  WSMAN_METRIC_GAUGE,
+					  metrics_enumerations, soap);
+#ifdef ENABLE_EVENTING_SUPPORT
+		if (soap->cntx && soap->cntx->subscriptionMemList)
+			wsman_metrics_add("wsman_subscriptions",
+					  "Active event subscriptions.",
+					  WSMAN_METRIC_GAUGE,
+					  metrics_subscriptions, soap);
+		wsman_metrics_add("wsman_event_pool_events",
+				  "Events waiting for delivery or a Pull.",
+				  WSMAN_METRIC_GAUGE, metrics_event_pool, NULL);
+#endif
+	}
+	metrics_on = 1;
+	return 0;
+}
+
+int wsman_metrics_enabled(void)
+{
+	return metrics_on;
+}
+
+/**
+ * Export the value returned by fn as metric name
+ * @return 0 on success
+ */
+int wsman_metrics_add(const char *name, const char *help,
+		WsmanMetricType type, WsmanMetricFn fn, void *data)
+{
+	int ret = 1;
+
+	pthread_mutex_lock(&metrics_lock);
+	if (metrics_fn_count < METRICS_FNS_MAX) {
+		metrics_fns[metrics_fn_count].name = name;
+		metrics_fns[metrics_fn_count].help = help;
+		metrics_fns[metrics_fn_count].type = type;
+		metrics_fns[metrics_fn_count].fn = fn;
+		metrics_fns[metrics_fn_count].data = data;
+		metrics_fn_count++;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&metrics_lock);
+	return ret;
+}
+
+/**
+ * Count a request served by this thread
+ * @param fault Fault the request ended with, WSMAN_RC_OK if none or
+ *        if it is to be taken from the response
+ * @param ns Time it took
+ */
+void wsman_metrics_request(WsmanFaultCodeType fault, unsigned long long ns)
+{
+	metrics_thread *t;
+	metrics_series *s;
+	double seconds = ns / 1e9;
+	size_t i;
+
+	if (!metrics_on || (t = metrics_get_thread()) == NULL)
+		return;
+	if (t->current < 0)
+		t->current = metrics_series_of(t, "-", "-");
+	if (t->current >= 0) {
+		s = t->series[t->current];
+		METRICS_ADD(s->requests, 1);
+		METRICS_ADD(s->ns, ns);
+		for (i = 0; i < METRICS_BUCKETS; i++) {
+			if (seconds <= metrics_bounds[i]) {
+				METRICS_ADD(s->buckets[i], 1);
+				break;
+			}
+		}
+	}
+	if (fault == WSMAN_RC_OK)
+		fault = t->fault;
+	if (fault != WSMAN_RC_OK && fault <= WSMAN_UNKNOWN)
+		METRICS_ADD(t->faults[fault], 1);
+	t->current = -1;
+	t->fault = WSMAN_RC_OK;
+}
+
+/**
+ * Count an authentication attempt
+ */
+void wsman_metrics_auth(int authorized)
+{
+	metrics_thread *t;
+
+	if (!metrics_on || (t = metrics_get_thread()) == NULL)
+		return;
+	if (authorized)
+		METRICS_ADD(t->authorized, 1);
+	else
+		METRICS_ADD(t->refused, 1);
+}
+
+static void metrics_printf(u_buf_t *buf, const char *fmt, ...)
+{
+	char line[METRICS_LINE_MAX];
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if (n >= (int) sizeof(line))
+		n = sizeof(line) - 1;
+	u_buf_append(buf, line, n);
+}
+
+static void metrics_header(u_buf_t *buf, const char *name, const char *help,
+		const char *type)
+{
+	metrics_printf(buf, "# HELP %s %s\n# TYPE %s %s\n", name, help,
+		       name, type);
+}
+
+/* metrics_lock held */
+static void metrics_collect_series(u_buf_t *buf)
+{
+	metrics_series sum;
+	metrics_thread *t;
+	unsigned long cumulative;
+	const char *labels;
+	int i;
+	size_t b;
+
+	metrics_header(buf, "wsman_request_duration_seconds",
+		       "Time from receiving a request to its response "
+		       "being ready, by Action and ResourceURI.", "histogram");
+	for (i = 0; i < metrics_name_count; i++) {
+		memset(&sum, 0, sizeof(sum));
+		for (t = metrics_threads; t; t = t->next) {
+			metrics_series *s = t->series[i];
+
+			if (s == NULL)
+				continue;
+			sum.requests += METRICS_GET(s->requests);
+			sum.ns += METRICS_GET(s->ns);
+			for (b = 0; b < METRICS_BUCKETS; b++)
+				sum.buckets[b] += METRICS_GET(s->buckets[b]);
+		}
+		if (sum.requests == 0)
+			continue;
+		labels = metrics_names[i].labels;
+		for (b = 0, cumulative = 0; b < METRICS_BUCKETS; b++) {
+			cumulative += sum.buckets[b];
+			metrics_printf(buf,
+				"wsman_request_duration_seconds_bucket{%s,le=\"%g\"} %lu\n",
+				labels, metrics_bounds[b], cumulative);
+		}
+		metrics_printf(buf,
+			"wsman_request_duration_seconds_bucket{%s,le=\"+Inf\"} %lu\n",
+			labels, sum.requests);
+		metrics_printf(buf, "wsman_request_duration_seconds_sum{%s} %.6f\n",
+			labels, sum.ns / 1e9);
+		metrics_printf(buf, "wsman_request_duration_seconds_count{%s} %lu\n",
+			labels, sum.requests);
+	}
+}
+
+/* metrics_lock held */
+static void metrics_collect_counters(u_buf_t *buf)
+{
+	unsigned long faults, authorized = 0, refused = 0;
+	metrics_thread *t;
+	const char *name;
+	int i;
+
+	metrics_header(buf, "wsman_faults_total",
+		       "Requests answered with a fault, by fault.", "counter");
+	for (i = WSMAN_RC_OK + 1; i <= WSMAN_UNKNOWN; i++) {
+		for (t = metrics_threads, faults = 0; t; t = t->next)
+			faults += METRICS_GET(t->faults[i]);
+		if (faults == 0)
+			continue;
+		name = wsman_fault_name(i);
+		if (name)
+			metrics_printf(buf, "wsman_faults_total{fault=\"%s\"} %lu\n",
+				       name, faults);
+		else
+			metrics_printf(buf, "wsman_faults_total{fault=\"%d\"} %lu\n",
+				       i, faults);
+	}
+
+	for (t = metrics_threads; t; t = t->next) {
+		authorized += METRICS_GET(t->authorized);
+		refused += METRICS_GET(t->refused);
+	}
+	metrics_header(buf, "wsman_auth_total",
+		       "Basic authentication attempts, by result.", "counter");
+	metrics_printf(buf, "wsman_auth_total{result=\"success\"} %lu\n"
+		       "wsman_auth_total{result=\"failure\"} %lu\n",
+		       authorized, refused);
+}
+
+/**
+ * Append all metrics to buf in the Prometheus text format
+ * @return 0 on success
+ */
+int wsman_metrics_collect(u_buf_t *buf)
+{
+	int i;
+
+	if (!metrics_on)
+		return 1;
+	pthread_mutex_lock(&metrics_lock);
+	metrics_collect_series(buf);
+	metrics_collect_counters(buf);
+	for (i = 0; i < metrics_fn_count; i++) {
+		metrics_header(buf, metrics_fns[i].name, metrics_fns[i].help,
+			       metrics_fns[i].type == WSMAN_METRIC_COUNTER ?
+			       "counter" : "gauge");
+		metrics_printf(buf, "%s %.17g\n", metrics_fns[i].name,
+			       metrics_fns[i].fn(metrics_fns[i].data));
+	}
+	pthread_mutex_unlock(&metrics_lock);
+	return 0;
+}
@@ -0,0 +1,820 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Plugin host processes, see wsman-plugin-host.h.
+ *
+ * Every host process has a channel in one shared anonymous mapping: a
+ * header and a buffer holding the request on the way in and the
+ * response on the way out. A host serves one request at a time, so the
+ * channel needs room for one request only. Both sides wait on the state
+ * word, a futex on Linux and polled elsewhere:
+ *
+ *   IDLE -> REQUEST      the daemon wrote a request
+ *   REQUEST -> RESPONSE  the host wrote the response
+ *   RESPONSE -> IDLE     the daemon took it
+ *   any -> DEAD          the supervisor reaped the host
+ *   any -> IDLE          a new host started on the channel
+ *
+ * Within the daemon a channel belongs to one request thread at a time,
+ * handed out under the lock of its plugin_host.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <linux/futex.h>
+#endif
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-soap-message.h"
+#include "wsman-soap-envelope.h"
+#include "wsman-dispatcher.h"
+#include "wsman-plugin-host.h"
+
+#define HOST_IDLE 0
+#define HOST_REQUEST 1
+#define HOST_RESPONSE 2
+#define HOST_DEAD 3
+
+#define HOST_CHARSET_MAX 32
+#define HOST_CONTEXT_MAX 128
+#define HOST_TICK_MS 100
+/* how long a killed host may take to be reaped */
+#define HOST_KILL_GRACE 5
+/* a host dying sooner after its start is restarted after this */
+#define HOST_RESTART_DELAY 1
+/* the listener waits this long for a host, see wsman-plugin-host.h */
+#define HOST_TIMEOUT 5
+/* enumerations tracked per plugin before idle ones are dropped */
+#define HOST_CONTEXTS_MAX 4096
+
+#ifdef __GNUC__
+#define HOST_GET(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define HOST_SET(var, v) __atomic_store_n(&(var), (v), __ATOMIC_RELEASE)
+#else
+#define HOST_GET(var) (var)
+#define HOST_SET(var, v) ((var) = (v))
+#endif
+
+typedef struct {
+	unsigned int state;	/* futex word, HOST_* */
+	unsigned int ready;	/* futex word, a host serves the channel */
+	int pid;
+	int http_code;
+	int fault_code;		/* of the status, for the metrics */
+	int overflow;		/* the response did not fit */
+	size_t len;		/* of the request or response in data */
+	size_t user_len;	/* credentials in front of the request */
+	size_t password_len;
+	char charset[HOST_CHARSET_MAX];
+	char context[HOST_CONTEXT_MAX];	/* EnumerationContext answered */
+	char data[1];
+} host_channel;
+
+typedef struct {
+	char *name;		/* file name of the plugin */
+	WsDispatchInterfaceInfo *ifc;
+	int count;
+	host_channel **channels;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int *busy;		/* channels handed to a request thread */
+	hash_t *contexts;	/* host_context by EnumerationContext */
+} plugin_host;
+
+typedef struct {
+	int index;
+	time_t used;
+} host_context;
+
+static plugin_host *hosts = NULL;
+static int host_groups = 0;
+static host_channel **host_channels = NULL;	/* of all hosts */
+static int host_total = 0;
+static size_t host_data_size;
+static int host_timeout = HOST_TIMEOUT;
+static WsContextH host_cntx = NULL;
+static pid_t supervisor = 0;
+
+/* supervisor only */
+static pid_t *host_pids = NULL;
+static long long *host_started = NULL;	/* ms */
+static volatile sig_atomic_t supervisor_quit = 0;
+
+
+static time_t
+host_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static long long
+host_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void
+host_wait(unsigned int *word, unsigned int val, int ms)
+{
+#ifdef __linux__
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	syscall(SYS_futex, word, FUTEX_WAIT, val, &ts, NULL, 0);
+#else
+	if (HOST_GET(*word) == val)
+		usleep(1000);
+#endif
+}
+
+static void
+host_wake(unsigned int *word)
+{
+#ifdef __linux__
+	syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+
+/*
+ * EnumerationContext of a request, and whether it is a Release
+ */
+static char *
+host_request_context(WsXmlDocH doc, int *release)
+{
+	WsXmlNodeH node = ws_xml_get_soap_body(doc);
+
+	*release = 0;
+	node = ws_xml_get_child(node, 0, NULL, NULL);
+	if (node == NULL)
+		return NULL;
+	*release = ws_xml_is_node_qname(node, XML_NS_ENUMERATION,
+					WSENUM_RELEASE);
+	node = ws_xml_get_child(node, 0, XML_NS_ENUMERATION,
+				WSENUM_ENUMERATION_CONTEXT);
+	return node ? ws_xml_get_node_text(node) : NULL;
+}
+
+/*
+ * EnumerationContext of a response, read off the bytes: the host has
+ * no document for a streamed PullResponse
+ */
+static void
+host_response_context(const char *buf, size_t len, char *context)
+{
+	static const char tag[] = WSENUM_ENUMERATION_CONTEXT;
+	size_t n = sizeof(tag) - 1, i, j;
+
+	context[0] = '\0';
+	for (i = 1; i + n < len; i++) {
+		if (memcmp(buf + i, tag, n) ||
+		    (buf[i - 1] != ':' && buf[i - 1] != '<') ||
+		    (buf[i + n] != '>' && buf[i + n] != ' '))
+			continue;
+		/* a start tag, not wsen:InvalidEnumerationContext or the end */
+		for (j = i - 1; j > 0 && buf[j] != '<' && i - j < 32; j--)
+			;
+		if (buf[j] != '<' || buf[j + 1] == '/')
+			continue;
+		for (j = i + n; j < len && buf[j] != '>'; j++)
+			;
+		if (j >= len || buf[j - 1] == '/')
+			return;
+		for (i = ++j; j < len && buf[j] != '<'; j++)
+			;
+		if (j - i < HOST_CONTEXT_MAX) {
+			memcpy(context, buf + i, j - i);
+			context[j - i] = '\0';
+		}
+		return;
+	}
+}
+
+
+/*
+ * enumerations stay with the host which started them
+ */
+
+static int
+host_affinity_get(plugin_host *h, const char *context)
+{
+	hnode_t *hn;
+	host_context *c;
+	int index = -1;
+
+	pthread_mutex_lock(&h->lock);
+	hn = hash_lookup(h->contexts, context);
+	if (hn) {
+		c = (host_context *) hnode_get(hn);
+		c->used = host_now();
+		index = c->index;
+	}
+	pthread_mutex_unlock(&h->lock);
+	return index;
+}
+
+/* drops the enumerations of host index and the idle ones, under h->lock */
+static void
+host_affinity_purge(plugin_host *h, int index, time_t idle)
+{
+	hscan_t hs;
+	hnode_t *hn;
+	host_context *c;
+	char *key;
+	time_t now = host_now();
+
+	hash_scan_begin(&hs, h->contexts);
+	while ((hn = hash_scan_next(&hs))) {
+		c = (host_context *) hnode_get(hn);
+		if (c->index != index && now - c->used <= idle)
+			continue;
+		key = (char *) hnode_getkey(hn);
+		hash_scan_delfree(h->contexts, hn);
+		u_free(key);
+		u_free(c);
+	}
+}
+
+static void
+host_affinity_drop(plugin_host *h, const char *context)
+{
+	hnode_t *hn;
+	host_context *c;
+	char *key;
+
+	pthread_mutex_lock(&h->lock);
+	hn = hash_lookup(h->contexts, context);
+	if (hn) {
+		c = (host_context *) hnode_get(hn);
+		key = (char *) hnode_getkey(hn);
+		hash_delete_free(h->contexts, hn);
+		u_free(key);
+		u_free(c);
+	}
+	pthread_mutex_unlock(&h->lock);
+}
+
+static void
+host_affinity_set(plugin_host *h, const char *context, int index)
+{
+	hnode_t *hn;
+	host_context *c;
+	char *key;
+	time_t idle = host_cntx->enumIdleTimeout ?
+		2 * host_cntx->enumIdleTimeout : 3600;
+
+	pthread_mutex_lock(&h->lock);
+	hn = hash_lookup(h->contexts, context);
+	if (hn) {
+		c = (host_context *) hnode_get(hn);
+	} else {
+		if (hash_count(h->contexts) >= HOST_CONTEXTS_MAX)
+			host_affinity_purge(h, -1, idle);
+		c = u_malloc(sizeof(host_context));
+		key = u_strdup(context);
+		if (!hash_alloc_insert(h->contexts, key, c)) {
+			u_free(key);
+			u_free(c);
+			c = NULL;
+		}
+	}
+	if (c) {
+		c->index = index;
+		c->used = host_now();
+	}
+	pthread_mutex_unlock(&h->lock);
+}
+
+
+/*
+ * a channel for a request thread, the one given by want if not -1
+ */
+static int
+host_acquire(plugin_host *h, int want)
+{
+	struct timespec ts;
+	host_channel *ch;
+	time_t limit;
+	int i, found = -1;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += host_timeout;
+	pthread_mutex_lock(&h->lock);
+	for (;;) {
+		if (want >= 0) {
+			if (!h->busy[want])
+				found = want;
+		} else {
+			/* a running host first, one being restarted else */
+			for (i = 0; i < h->count; i++) {
+				if (h->busy[i])
+					continue;
+				if (HOST_GET(h->channels[i]->ready)) {
+					found = i;
+					break;
+				}
+				if (found < 0)
+					found = i;
+			}
+		}
+		if (found >= 0 ||
+		    pthread_cond_timedwait(&h->cond, &h->lock, &ts) == ETIMEDOUT)
+			break;
+	}
+	if (found >= 0)
+		h->busy[found] = 1;
+	pthread_mutex_unlock(&h->lock);
+	if (found < 0)
+		return -1;
+
+	ch = h->channels[found];
+	limit = host_now() + host_timeout;
+	while (!HOST_GET(ch->ready) && host_now() < limit)
+		host_wait(&ch->ready, 0, HOST_TICK_MS);
+	if (HOST_GET(ch->ready))
+		return found;
+
+	pthread_mutex_lock(&h->lock);
+	h->busy[found] = 0;
+	pthread_cond_broadcast(&h->cond);
+	pthread_mutex_unlock(&h->lock);
+	return -1;
+}
+
+static void
+host_release(plugin_host *h, int index)
+{
+	pthread_mutex_lock(&h->lock);
+	h->busy[index] = 0;
+	pthread_cond_broadcast(&h->cond);
+	pthread_mutex_unlock(&h->lock);
+}
+
+static int
+host_fault(op_t *op, WsmanFaultCodeType code, const char *reason)
+{
+	WsXmlDocH doc = wsman_generate_fault(op->in_doc, code,
+					     OWSMAN_NO_DETAILS, (char *) reason);
+
+	soap_set_op_doc((SoapOpH) op, doc, 0);
+	return 0;
+}
+
+/*
+ * passes the request of op to a host of h, the response it answers
+ * with goes to the client as it is
+ */
+static int
+host_forward(op_t *op, plugin_host *h)
+{
+	WsmanMessage *msg = op->data;
+	host_channel *ch;
+	char *context;
+	const char *user = msg->auth_data.username;
+	const char *password = msg->auth_data.password;
+	size_t ulen = user ? strlen(user) + 1 : 0;
+	size_t plen = password ? strlen(password) + 1 : 0;
+	size_t len = u_buf_len(msg->request);
+	unsigned int state;
+	int index = -1, release, killed = 0;
+	time_t deadline;
+
+	if (ulen + plen + len > host_data_size)
+		return host_fault(op, WSMAN_ENCODING_LIMIT,
+				  "request too large for the plugin host");
+	context = host_request_context(op->in_doc, &release);
+	if (context)
+		index = host_affinity_get(h, context);
+	if ((index = host_acquire(h, index)) < 0)
+		return host_fault(op, WSMAN_INTERNAL_ERROR,
+				  "plugin host not available");
+	ch = h->channels[index];
+
+	if (ulen)
+		memcpy(ch->data, user, ulen);
+	if (plen)
+		memcpy(ch->data + ulen, password, plen);
+	memcpy(ch->data + ulen + plen, u_buf_ptr(msg->request), len);
+	ch->user_len = ulen;
+	ch->password_len = plen;
+	ch->len = len;
+	strncpy(ch->charset, msg->charset ? msg->charset : "",
+		HOST_CHARSET_MAX - 1);
+	ch->charset[HOST_CHARSET_MAX - 1] = '\0';
+	HOST_SET(ch->state, HOST_REQUEST);
+	host_wake(&ch->state);
+
+	deadline = host_now() + host_timeout;
+	while ((state = HOST_GET(ch->state)) == HOST_REQUEST) {
+		if (host_now() >= deadline) {
+			if (killed)
+				break;
+			error("plugin host %d of %s timed out", ch->pid,
+			      h->name);
+			kill(ch->pid, SIGKILL);
+			killed = 1;
+			deadline = host_now() + HOST_KILL_GRACE;
+		}
+		host_wait(&ch->state, HOST_REQUEST, HOST_TICK_MS);
+	}
+
+	if (state != HOST_RESPONSE) {
+		/* without a supervisor nobody starts a new host */
+		if (state == HOST_REQUEST)
+			HOST_SET(ch->ready, 0);
+		pthread_mutex_lock(&h->lock);
+		host_affinity_purge(h, index, LONG_MAX);
+		pthread_mutex_unlock(&h->lock);
+		host_release(h, index);
+		return host_fault(op, WSMAN_INTERNAL_ERROR,
+				  killed ? "plugin host timed out" :
+				  "plugin host died");
+	}
+
+	if (ch->overflow) {
+		HOST_SET(ch->state, HOST_IDLE);
+		host_release(h, index);
+		return host_fault(op, WSMAN_ENCODING_LIMIT,
+				  "response too large for the plugin host");
+	}
+	u_buf_set(msg->response, ch->data, ch->len);
+	msg->http_code = ch->http_code;
+	msg->status.fault_code = ch->fault_code;
+	op->streamed = 1;
+
+	if (context && (release || strcmp(context, ch->context)))
+		host_affinity_drop(h, context);
+	if (!release && ch->context[0])
+		host_affinity_set(h, ch->context, index);
+	HOST_SET(ch->state, HOST_IDLE);
+	host_release(h, index);
+	return 0;
+}
+
+/*
+ * serviceCallback of a hosted dispatch entry in the daemon; the hosts
+ * keep the entries as they were
+ */
+static int
+host_call(SoapOpH op, void *appData, void *opaqueData)
+{
+	return host_forward((op_t *) op, (plugin_host *) appData);
+}
+
+
+/*
+ * the loop of a host process
+ */
+static void
+host_serve(host_channel *ch, pid_t parent)
+{
+	SoapH soap = ws_context_get_runtime(host_cntx);
+	WsmanMessage *msg;
+	unsigned int state;
+	time_t swept = host_now();
+	char *p;
+	size_t len;
+
+	ch->pid = getpid();
+	HOST_SET(ch->state, HOST_IDLE);
+	HOST_SET(ch->ready, 1);
+	host_wake(&ch->ready);
+	host_wake(&ch->state);
+	debug("plugin host %d started", ch->pid);
+
+	for (;;) {
+		state = HOST_GET(ch->state);
+		if (state != HOST_REQUEST) {
+			host_wait(&ch->state, state, 1000);
+			if (getppid() != parent)
+				break;
+			/* what the auxiliary thread does in the daemon */
+			if (host_now() != swept) {
+				wsman_timeouts_manager(host_cntx, NULL);
+				swept = host_now();
+			}
+			continue;
+		}
+
+		msg = wsman_soap_message_new();
+		p = ch->data;
+		if (ch->user_len)
+			msg->auth_data.username = u_strdup(p);
+		p += ch->user_len;
+		if (ch->password_len)
+			msg->auth_data.password = u_strdup(p);
+		p += ch->password_len;
+		/* parsed straight out of the channel */
+		u_buf_construct(msg->request, p, ch->len, ch->len);
+		if (ch->charset[0])
+			msg->charset = u_strdup(ch->charset);
+		msg->status.fault_code = WSMAN_RC_OK;
+
+		dispatch_inbound_call(soap, msg, NULL);
+		u_buf_steal(msg->request);
+
+		len = u_buf_len(msg->response);
+		ch->overflow = len > host_data_size;
+		ch->len = ch->overflow ? 0 : len;
+		ch->context[0] = '\0';
+		if (!ch->overflow) {
+			memcpy(ch->data, u_buf_ptr(msg->response), len);
+			host_response_context(ch->data, len, ch->context);
+		}
+		ch->http_code = msg->http_code;
+		ch->fault_code = msg->status.fault_code;
+		wsman_soap_message_destroy(msg);
+		HOST_SET(ch->state, HOST_RESPONSE);
+		host_wake(&ch->state);
+	}
+}
+
+static void
+host_spawn(int n)
+{
+	pid_t parent = getpid();
+	pid_t pid = fork();
+
+	if (pid == 0) {
+#ifdef __linux__
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+		signal(SIGTERM, SIG_DFL);
+		signal(SIGINT, SIG_DFL);
+		host_serve(host_channels[n], parent);
+		_exit(0);
+	}
+	if (pid < 0)
+		error("could not start a plugin host: %s", strerror(errno));
+	host_pids[n] = pid;
+	host_started[n] = host_now_ms();
+}
+
+static void
+supervisor_signal(int sig)
+{
+	supervisor_quit = 1;
+}
+
+/*
+ * the loop of the supervisor: starts the hosts and restarts the ones
+ * which die
+ */
+static void
+supervisor_run(void)
+{
+	struct sigaction sa;
+	host_channel *ch;
+	pid_t pid;
+	int n, status;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = supervisor_signal;
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+#ifdef __linux__
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+	host_pids = u_zalloc(host_total * sizeof(pid_t));
+	host_started = u_zalloc(host_total * sizeof(long long));
+	for (n = 0; n < host_total; n++)
+		host_spawn(n);
+
+	while (!supervisor_quit) {
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (n = 0; n < host_total && host_pids[n] != pid; n++)
+			;
+		if (n == host_total)
+			continue;
+		ch = host_channels[n];
+		HOST_SET(ch->ready, 0);
+		HOST_SET(ch->state, HOST_DEAD);
+		host_wake(&ch->state);
+		host_pids[n] = 0;
+		if (supervisor_quit)
+			break;
+		if (WIFSIGNALED(status))
+			error("plugin host %d killed by signal %d", pid,
+			      WTERMSIG(status));
+		else
+			error("plugin host %d exited with %d", pid,
+			      WEXITSTATUS(status));
+		if (host_now_ms() - host_started[n] < HOST_RESTART_DELAY * 1000)
+			sleep(HOST_RESTART_DELAY);
+		host_spawn(n);
+	}
+
+	for (n = 0; n < host_total; n++)
+		if (host_pids[n] > 0)
+			kill(host_pids[n], SIGTERM);
+	while (waitpid(-1, &status, 0) > 0 || errno == EINTR)
+		;
+	_exit(0);
+}
+
+
+static plugin_host *
+host_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < host_groups; i++)
+		if (!strcmp(hosts[i].name, name))
+			return &hosts[i];
+	return NULL;
+}
+
+/*
+ * points the dispatch entries of the endpoints of h to host_call
+ */
+static void
+host_wrap_endpoints(WsManDispatcherInfo *dispInfo, plugin_host *h)
+{
+	WsDispatchEndPointInfo *first = h->ifc->endPoints, *last = first;
+	int i;
+
+	while (last->serviceEndPoint)
+		last++;
+	for (i = 0; i < dispInfo->mapCount; i++) {
+		if (dispInfo->map[i].ep < first || dispInfo->map[i].ep >= last)
+			continue;
+		/* subscriptions live with the event pool of the daemon */
+		switch (dispInfo->map[i].ep->flags & WS_DISP_TYPE_MASK) {
+		case WS_DISP_TYPE_SUBSCRIBE:
+		case WS_DISP_TYPE_UNSUBSCRIBE:
+		case WS_DISP_TYPE_RENEW:
+		case WS_DISP_TYPE_EVT_PULL:
+		case WS_DISP_TYPE_ACK:
+			continue;
+		}
+		dispInfo->map[i].disp->serviceCallback = host_call;
+		dispInfo->map[i].disp->serviceData = h;
+	}
+}
+
+int
+wsman_plugin_host_start(WsContextH cntx, WsManListenerH *listener)
+{
+	char *list = iniparser_getstr(listener->config, "server:plugin_host");
+	WsManDispatcherInfo *dispInfo;
+	hash_t *counts;
+	hscan_t hs;
+	hnode_t *hn;
+	lnode_t *node;
+	plugin_host *h;
+	size_t size;
+	char *map, *name;
+	int i, n;
+
+	if (list == NULL || *list == '\0')
+		return 0;
+	counts = u_parse_list(list);
+	if (counts == NULL || hash_count(counts) == 0) {
+		error("invalid plugin_host: %s", list);
+		if (counts)
+			hash_free(counts);
+		return 1;
+	}
+	host_cntx = cntx;
+	dispInfo = (WsManDispatcherInfo *) cntx->soap->dispatcherData;
+	host_timeout = iniparser_getint(listener->config,
+					"server:plugin_host_timeout", HOST_TIMEOUT);
+	host_data_size = (size_t) iniparser_getint(listener->config,
+					"server:plugin_host_buffer", 4096) * 1024;
+
+	hosts = u_zalloc(hash_count(counts) * sizeof(plugin_host));
+	for (node = list_first(listener->plugins); node;
+	     node = list_next(listener->plugins, node)) {
+		WsManPlugin *p = (WsManPlugin *) node->list_data;
+
+		name = strrchr(p->p_name, '/');
+		name = name ? name + 1 : p->p_name;
+		hn = hash_lookup(counts, name);
+		if (hn == NULL || p->ifc == NULL || host_find(name))
+			continue;
+		n = atoi((char *) hnode_get(hn));
+		if (n <= 0)
+			continue;
+		h = &hosts[host_groups++];
+		h->name = u_strdup(name);
+		h->ifc = (WsDispatchInterfaceInfo *) p->ifc;
+		h->count = n;
+		host_total += n;
+	}
+	hash_scan_begin(&hs, counts);
+	while ((hn = hash_scan_next(&hs)))
+		if (!host_find((char *) hnode_getkey(hn)))
+			error("plugin_host: no plugin %s",
+			      (char *) hnode_getkey(hn));
+	hash_free(counts);
+	if (host_total == 0)
+		return 0;
+
+	size = (sizeof(host_channel) + host_data_size + 63) & ~(size_t) 63;
+	map = mmap(NULL, size * host_total, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		error("could not map the plugin host channels: %s",
+		      strerror(errno));
+		host_total = host_groups = 0;
+		return 1;
+	}
+	host_channels = u_zalloc(host_total * sizeof(host_channel *));
+	for (i = n = 0; i < host_groups; i++) {
+		int j;
+
+		h = &hosts[i];
+		h->channels = &host_channels[n];
+		for (j = 0; j < h->count; j++, n++)
+			host_channels[n] = (host_channel *) (map + n * size);
+		h->busy = u_zalloc(h->count * sizeof(int));
+		h->contexts = hash_create(HASHCOUNT_T_MAX, 0, 0);
+		pthread_mutex_init(&h->lock, NULL);
+		pthread_cond_init(&h->cond, NULL);
+	}
+
+	supervisor = fork();
+	if (supervisor == 0)
+		supervisor_run();
+	if (supervisor < 0) {
+		error("could not start the plugin host supervisor: %s",
+		      strerror(errno));
+		supervisor = 0;
+		return 1;
+	}
+	for (i = 0; i < host_groups; i++) {
+		host_wrap_endpoints(dispInfo, &hosts[i]);
+		message("running plugin %s in %d processes", hosts[i].name,
+			hosts[i].count);
+	}
+	return 0;
+}
+
+void
+wsman_plugin_host_stop(void)
+{
+	if (supervisor <= 0)
+		return;
+	kill(supervisor, SIGTERM);
+	waitpid(supervisor, NULL, 0);
+	supervisor = 0;
+}
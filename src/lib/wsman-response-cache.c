@@ -0,0 +1,662 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Response cache of the dispatcher, see wsman-response-cache.h.
+ *
+ * An entry keeps the serialized response together with where its
+ * MessageID and RelatesTo values are, so a hit is two substitutions
+ * while copying the text. cache_lock guards the entries, the counters
+ * and the generation. Every request which drops entries bumps the
+ * generation and a response is only kept if the generation did not
+ * change while its endpoint ran, so a Get racing a Put does not put
+ * back what the Put changed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+#include "wsman-faults.h"
+#include "wsman-soap-envelope.h"
+#include "wsman-soap-message.h"
+#include "wsman-response-cache.h"
+
+#define CACHE_IDENTIFY		"identify"
+#define CACHE_NO_OFFSET		((size_t) -1)
+
+typedef struct {
+	char *key;
+	char *epr;		/* ResourceURI and selectors */
+	time_t expires;
+	char *body;
+	size_t len;
+	/* the MessageID and RelatesTo values, CACHE_NO_OFFSET if absent */
+	size_t id_off, id_len;
+	size_t rel_off, rel_len;
+} CacheEntry;
+
+typedef struct {
+	char *prefix;
+	size_t len;
+	int ttl;
+} CachePrefix;
+
+struct _WsmanResponseCacheMiss {
+	char *key;		/* NULL for a request dropping entries */
+	char *epr;
+	int whole;		/* drop all entries of the ResourceURI */
+	int ttl;
+	unsigned long generation;
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *cache = NULL;
+static hash_t *cache_ttls = NULL;	/* ResourceURI to seconds */
+static CachePrefix *cache_prefixes = NULL;
+static int cache_prefix_count = 0;
+static int cache_enabled = 0;
+static unsigned long cache_generation = 0;
+static unsigned long cache_hits = 0;
+static unsigned long cache_misses = 0;
+
+
+/* seconds to keep responses for uri, 0 if they are not cached */
+static int cache_ttl(const char *uri)
+{
+	hnode_t *hn;
+	size_t best = 0;
+	int i, ttl = 0;
+
+	if ((hn = hash_lookup(cache_ttls, uri)) != NULL)
+		return (int) (long) hnode_get(hn);
+	for (i = 0; i < cache_prefix_count; i++) {
+		if (cache_prefixes[i].len >= best &&
+		    !strncmp(uri, cache_prefixes[i].prefix,
+			     cache_prefixes[i].len)) {
+			best = cache_prefixes[i].len;
+			ttl = cache_prefixes[i].ttl;
+		}
+	}
+	return ttl;
+}
+
+/* length prefixed, so no value runs into the next */
+static int cache_key_add(u_buf_t *buf, const char *s)
+{
+	char len[24];
+
+	if (s == NULL)
+		s = "";
+	snprintf(len, sizeof(len), "%lu:", (unsigned long) strlen(s));
+	/* u_buf_append() fails for nothing to append */
+	return u_buf_append(buf, len, strlen(len)) ||
+	    (*s && u_buf_append(buf, (void *) s, strlen(s)));
+}
+
+static int cache_compare(const void *a, const void *b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/*
+ * Add the wsman:Selector or wsman:Option children of set, sorted.
+ * @return nonzero if one holds more than text
+ */
+static int cache_key_add_set(u_buf_t *buf, WsXmlNodeH set, const char *name)
+{
+	WsXmlNodeH node;
+	char **items = NULL;
+	int i, count = 0, ret = 1;
+	u_buf_t *item = NULL;
+
+	while (ws_xml_get_child(set, count, XML_NS_WS_MAN, name))
+		count++;
+	if (count == 0)
+		return cache_key_add(buf, "");
+	items = u_zalloc(count * sizeof(char *));
+	if (items == NULL || u_buf_create(&item))
+		goto DONE;
+	for (i = 0; i < count; i++) {
+		node = ws_xml_get_child(set, i, XML_NS_WS_MAN, name);
+		if (ws_xml_get_child_count(node) > 0)
+			goto DONE;
+		u_buf_clear(item);
+		if (cache_key_add(item, ws_xml_find_attr_value(node, NULL,
+							       WSM_NAME)) ||
+		    cache_key_add(item, ws_xml_find_attr_value(node, NULL,
+							       "Type")) ||
+		    cache_key_add(item, ws_xml_get_node_text(node)) ||
+		    u_buf_append(item, "", 1))
+			goto DONE;
+		items[i] = u_strdup(u_buf_ptr(item));
+		if (items[i] == NULL)
+			goto DONE;
+	}
+	qsort(items, count, sizeof(char *), cache_compare);
+	ret = 0;
+	for (i = 0; i < count && ret == 0; i++)
+		ret = cache_key_add(buf, items[i]);
+DONE:
+	if (items) {
+		for (i = 0; i < count; i++)
+			u_free(items[i]);
+		u_free(items);
+	}
+	if (item)
+		u_buf_free(item);
+	return ret;
+}
+
+/* text which serializes unchanged, so it can be copied into the response */
+static int cache_plain(const char *s)
+{
+	for (; *s; s++) {
+		if (*s < 0x21 || *s > 0x7e || strchr("<>&\"'", *s))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * where value is the text of the first element called name in body,
+ * whatever its prefix
+ */
+static int cache_locate(const char *body, size_t len, const char *name,
+		const char *value, size_t *off, size_t *vlen)
+{
+	size_t n, nlen, i, j;
+
+	*off = CACHE_NO_OFFSET;
+	*vlen = 0;
+	if (value == NULL)
+		return 0;
+	n = strlen(value);
+	if (n == 0 || !cache_plain(value))
+		return 1;
+	nlen = strlen(name);
+	for (i = 0; i + 1 + nlen < len; i++) {
+		if (body[i] != '<')
+			continue;
+		for (j = i + 1; j < len && body[j] != ':' && body[j] != '>' &&
+		     body[j] != '/' && !isspace((unsigned char) body[j]); j++)
+			;
+		j = j < len && body[j] == ':' ? j + 1 : i + 1;
+		if (j + nlen >= len || memcmp(body + j, name, nlen) ||
+		    (body[j + nlen] != '>' &&
+		     !isspace((unsigned char) body[j + nlen])))
+			continue;
+		for (j += nlen; j < len && body[j] != '>'; j++)
+			;
+		if (j == len || body[j - 1] == '/')
+			return 1;
+		j++;
+		if (j + n >= len || memcmp(body + j, value, n) ||
+		    body[j + n] != '<')
+			return 1;
+		*off = j;
+		*vlen = n;
+		return 0;
+	}
+	return 1;
+}
+
+/* the response of e with id as MessageID and rel as RelatesTo */
+static int cache_write(CacheEntry *e, u_buf_t *out, const char *id,
+		const char *rel)
+{
+	struct {
+		size_t off, len;
+		const char *text;
+	} sub[2], t;
+	size_t pos = 0;
+	int n = 0, i;
+
+	if (e->id_off != CACHE_NO_OFFSET) {
+		sub[n].off = e->id_off;
+		sub[n].len = e->id_len;
+		sub[n++].text = id;
+	}
+	if (e->rel_off != CACHE_NO_OFFSET) {
+		sub[n].off = e->rel_off;
+		sub[n].len = e->rel_len;
+		sub[n++].text = rel;
+	}
+	if (n == 2 && sub[1].off < sub[0].off) {
+		t = sub[0];
+		sub[0] = sub[1];
+		sub[1] = t;
+	}
+	u_buf_clear(out);
+	for (i = 0; i < n; i++) {
+		if (u_buf_append(out, e->body + pos, sub[i].off - pos) ||
+		    u_buf_append(out, (void *) sub[i].text,
+				 strlen(sub[i].text)))
+			return 1;
+		pos = sub[i].off + sub[i].len;
+	}
+	return u_buf_append(out, e->body + pos, e->len - pos);
+}
+
+/* scanning tells whether hn comes from a running hash_scan_next() */
+static void cache_free_entry(hnode_t *hn, int scanning)
+{
+	CacheEntry *e = (CacheEntry *) hnode_get(hn);
+
+	if (scanning)
+		hash_scan_delfree(cache, hn);
+	else
+		hash_delete_free(cache, hn);
+	u_free(e->key);
+	u_free(e->epr);
+	u_free(e->body);
+	u_free(e);
+}
+
+/* drop the entries of epr, or with whole of the ResourceURI epr starts with */
+static void cache_drop(const char *epr, int whole)
+{
+	size_t len = strlen(epr);
+	hscan_t hs;
+	hnode_t *hn;
+	CacheEntry *e;
+
+	hash_scan_begin(&hs, cache);
+	while ((hn = hash_scan_next(&hs))) {
+		e = (CacheEntry *) hnode_get(hn);
+		if (whole ? !strncmp(e->epr, epr, len) : !strcmp(e->epr, epr))
+			cache_free_entry(hn, 1);
+	}
+	cache_generation++;
+}
+
+/* make room for one entry: drop expired ones, or else the oldest one */
+static void cache_evict(time_t now)
+{
+	hscan_t hs;
+	hnode_t *hn, *oldest = NULL;
+	CacheEntry *e;
+
+	hash_scan_begin(&hs, cache);
+	while ((hn = hash_scan_next(&hs))) {
+		e = (CacheEntry *) hnode_get(hn);
+		if (e->expires <= now) {
+			cache_free_entry(hn, 1);
+		} else if (oldest == NULL ||
+			   e->expires < ((CacheEntry *)
+					 hnode_get(oldest))->expires) {
+			oldest = hn;
+		}
+	}
+	if (hash_isfull(cache) && oldest)
+		cache_free_entry(oldest, 0);
+}
+
+static void cache_free_miss(WsmanResponseCacheMiss *miss)
+{
+	u_free(miss->key);
+	u_free(miss->epr);
+	u_free(miss);
+}
+
+
+/**
+ * Set up caching as given in the response_cache option
+ * @param spec "<ResourceURI>=<seconds>,...", see wsman-response-cache.h
+ * @param size Most responses kept
+ * @return 0 on success
+ */
+int wsman_response_cache_init(const char *spec, int size)
+{
+	hash_t *list;
+	hscan_t hs;
+	hnode_t *hn;
+	char *name;
+	size_t len;
+	int ttl;
+
+	if (spec == NULL || size <= 0)
+		return 1;
+	list = u_parse_list(spec);
+	if (list == NULL) {
+		error("Could not parse response_cache: %s", spec);
+		return 1;
+	}
+	cache_ttls = hash_create(HASHCOUNT_T_MAX, 0, 0);
+	cache = hash_create(size, 0, 0);
+	cache_prefixes = u_zalloc((hash_count(list) + 1) * sizeof(CachePrefix));
+	if (cache_ttls == NULL || cache == NULL || cache_prefixes == NULL) {
+		hash_free(list);
+		wsman_response_cache_shutdown();
+		return 1;
+	}
+
+	hash_scan_begin(&hs, list);
+	while ((hn = hash_scan_next(&hs))) {
+		name = (char *) hnode_getkey(hn);
+		ttl = atoi((char *) hnode_get(hn));
+		len = strlen(name);
+		if (ttl <= 0 || len == 0) {
+			warning("Not caching responses for %s", name);
+			continue;
+		}
+		if (name[len - 1] == '*') {
+			cache_prefixes[cache_prefix_count].prefix =
+			    u_strndup(name, len - 1);
+			cache_prefixes[cache_prefix_count].len = len - 1;
+			cache_prefixes[cache_prefix_count++].ttl = ttl;
+		} else {
+			name = u_strdup(name);
+			if (!hash_alloc_insert(cache_ttls, name,
+					       (void *) (long) ttl))
+				u_free(name);
+		}
+		debug("caching responses for %s for %d seconds",
+		      (char *) hnode_getkey(hn), ttl);
+	}
+	hash_free(list);
+
+	cache_enabled = 1;
+	message("Caching Get and Identify responses (%d entries)", size);
+	return 0;
+}
+
+int wsman_response_cache_enabled(void)
+{
+	return cache_enabled;
+}
+
+void wsman_response_cache_shutdown(void)
+{
+	hscan_t hs;
+	hnode_t *hn;
+	char *name;
+	int i;
+
+	pthread_mutex_lock(&cache_lock);
+	cache_enabled = 0;
+	if (cache) {
+		hash_scan_begin(&hs, cache);
+		while ((hn = hash_scan_next(&hs)))
+			cache_free_entry(hn, 1);
+		hash_destroy(cache);
+		cache = NULL;
+	}
+	if (cache_ttls) {
+		hash_scan_begin(&hs, cache_ttls);
+		while ((hn = hash_scan_next(&hs))) {
+			name = (char *) hnode_getkey(hn);
+			hash_scan_delfree(cache_ttls, hn);
+			u_free(name);
+		}
+		hash_destroy(cache_ttls);
+		cache_ttls = NULL;
+	}
+	for (i = 0; i < cache_prefix_count; i++)
+		u_free(cache_prefixes[i].prefix);
+	u_free(cache_prefixes);
+	cache_prefixes = NULL;
+	cache_prefix_count = 0;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+
+int wsman_response_cache_replay(WsXmlDocH in_doc, WsmanMessage *msg,
+		unsigned long maxsize, WsmanResponseCacheMiss **miss)
+{
+	WsXmlNodeH header = ws_xml_get_soap_header(in_doc);
+	WsmanResponseCacheMiss *m = NULL;
+	char *action, *uri, *msgid, *key = NULL, *epr = NULL;
+	char uuid[100];
+	u_buf_t *buf = NULL;
+	size_t len;
+	hnode_t *hn;
+	CacheEntry *e;
+	time_t now;
+	int identify, get, ttl, whole = 0, hit = 0;
+
+	*miss = NULL;
+	if (!cache_enabled)
+		return 0;
+	identify = wsman_is_identify_request(in_doc);
+	action = ws_xml_get_node_text(ws_xml_get_child(header, 0,
+					XML_NS_ADDRESSING, WSA_ACTION));
+	uri = identify ? CACHE_IDENTIFY :
+	    ws_xml_get_node_text(ws_xml_get_child(header, 0, XML_NS_WS_MAN,
+						  WSM_RESOURCE_URI));
+	if (uri == NULL || (!identify && action == NULL) ||
+	    (ttl = cache_ttl(uri)) <= 0)
+		return 0;
+	get = identify || !strcmp(action, TRANSFER_ACTION_GET);
+	/* enumerations and subscriptions change nothing cached */
+	if (!get && (!strncmp(action, XML_NS_ENUMERATION,
+			      strlen(XML_NS_ENUMERATION)) ||
+		     !strncmp(action, XML_NS_EVENTING,
+			      strlen(XML_NS_EVENTING))))
+		return 0;
+
+	if (u_buf_create(&buf))
+		return 0;
+	if (cache_key_add(buf, uri))
+		goto DONE;
+	if (cache_key_add_set(buf, ws_xml_get_child(header, 0, XML_NS_WS_MAN,
+						    WSM_SELECTOR_SET),
+			      WSM_SELECTOR)) {
+		if (get)
+			goto DONE;
+		/* no telling which EPR it is */
+		u_buf_clear(buf);
+		cache_key_add(buf, uri);
+		whole = 1;
+	}
+	if (u_buf_append(buf, "", 1) || (epr = u_strdup(u_buf_ptr(buf))) == NULL)
+		goto DONE;
+
+	if (!get) {
+		m = u_zalloc(sizeof(WsmanResponseCacheMiss));
+		if (m == NULL)
+			goto DONE;
+		m->epr = epr;
+		m->whole = whole;
+		epr = NULL;
+		pthread_mutex_lock(&cache_lock);
+		cache_drop(m->epr, m->whole);
+		pthread_mutex_unlock(&cache_lock);
+		*miss = m;
+		goto DONE;
+	}
+
+	msgid = ws_xml_get_node_text(ws_xml_get_child(header, 0,
+					XML_NS_ADDRESSING, WSA_MESSAGE_ID));
+	if (msgid && !cache_plain(msgid))
+		goto DONE;
+	u_buf_set_len(buf, u_buf_len(buf) - 1);
+	if (cache_key_add_set(buf, ws_xml_get_child(header, 0, XML_NS_WS_MAN,
+						    WSM_OPTION_SET),
+			      WSM_OPTION) ||
+	    cache_key_add(buf, identify ? CACHE_IDENTIFY : action) ||
+	    cache_key_add(buf, msg->auth_data.username) ||
+	    cache_key_add(buf, msg->charset) ||
+	    cache_key_add(buf, ws_xml_get_node_text(ws_xml_get_child(header,
+				0, XML_NS_WS_MAN, WSM_FRAGMENT_TRANSFER))) ||
+	    cache_key_add(buf, msgid ? "RelatesTo" : "") ||
+	    u_buf_append(buf, "", 1))
+		goto DONE;
+	key = u_buf_steal(buf);
+	if (key == NULL)
+		goto DONE;
+
+	generate_uuid(uuid, sizeof(uuid), 0);
+	now = time(NULL);
+	pthread_mutex_lock(&cache_lock);
+	if ((hn = hash_lookup(cache, key)) != NULL) {
+		e = (CacheEntry *) hnode_get(hn);
+		len = e->len - e->id_len - e->rel_len +
+		    (e->id_off != CACHE_NO_OFFSET ? strlen(uuid) : 0) +
+		    (e->rel_off != CACHE_NO_OFFSET ? strlen(msgid) : 0);
+		if (e->expires <= now) {
+			cache_free_entry(hn, 0);
+		} else if ((maxsize == 0 || len <= maxsize) &&
+			   cache_write(e, msg->response, uuid, msgid) == 0) {
+			cache_hits++;
+			pthread_mutex_unlock(&cache_lock);
+			msg->http_code = WSMAN_STATUS_OK;
+			debug("response to %s from the cache", uri);
+			hit = 1;
+			goto DONE;
+		}
+	}
+	cache_misses++;
+	m = u_zalloc(sizeof(WsmanResponseCacheMiss));
+	if (m) {
+		m->generation = cache_generation;
+		m->ttl = ttl;
+		m->key = key;
+		m->epr = epr;
+		key = epr = NULL;
+		*miss = m;
+	}
+	pthread_mutex_unlock(&cache_lock);
+DONE:
+	u_free(key);
+	u_free(epr);
+	u_buf_free(buf);
+	return hit;
+}
+
+
+void wsman_response_cache_store(WsmanResponseCacheMiss *miss,
+		WsmanMessage *msg, WsXmlDocH out_doc)
+{
+	WsXmlNodeH header;
+	CacheEntry *e = NULL;
+	const char *body;
+	size_t len;
+	time_t now;
+
+	if (miss == NULL)
+		return;
+	if (miss->key == NULL) {
+		/* once more, for Gets which started while it ran */
+		pthread_mutex_lock(&cache_lock);
+		cache_drop(miss->epr, miss->whole);
+		pthread_mutex_unlock(&cache_lock);
+		goto DONE;
+	}
+	if (out_doc == NULL || msg->http_code != WSMAN_STATUS_OK ||
+	    wsman_is_fault_envelope(out_doc))
+		goto DONE;
+	body = u_buf_ptr(msg->response);
+	len = u_buf_len(msg->response);
+	if (body == NULL || len == 0)
+		goto DONE;
+
+	e = u_zalloc(sizeof(CacheEntry));
+	if (e == NULL)
+		goto DONE;
+	header = ws_xml_get_soap_header(out_doc);
+	if (cache_locate(body, len, WSA_MESSAGE_ID,
+			 ws_xml_get_node_text(ws_xml_get_child(header, 0,
+				XML_NS_ADDRESSING, WSA_MESSAGE_ID)),
+			 &e->id_off, &e->id_len) ||
+	    cache_locate(body, len, WSA_RELATES_TO,
+			 ws_xml_get_node_text(ws_xml_get_child(header, 0,
+				XML_NS_ADDRESSING, WSA_RELATES_TO)),
+			 &e->rel_off, &e->rel_len) ||
+	    (e->id_off != CACHE_NO_OFFSET && e->id_off == e->rel_off))
+		goto DONE;
+	e->body = u_malloc(len);
+	if (e->body == NULL)
+		goto DONE;
+	memcpy(e->body, body, len);
+	e->len = len;
+
+	now = time(NULL);
+	pthread_mutex_lock(&cache_lock);
+	if (cache_enabled && miss->generation == cache_generation &&
+	    hash_lookup(cache, miss->key) == NULL) {
+		if (hash_isfull(cache))
+			cache_evict(now);
+		if (!hash_isfull(cache) &&
+		    hash_alloc_insert(cache, miss->key, e)) {
+			e->key = miss->key;
+			e->epr = miss->epr;
+			e->expires = now + miss->ttl;
+			miss->key = miss->epr = NULL;
+			e = NULL;
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+DONE:
+	if (e) {
+		u_free(e->body);
+		u_free(e);
+	}
+	cache_free_miss(miss);
+}
+
+
+void wsman_response_cache_flush(void)
+{
+	hscan_t hs;
+	hnode_t *hn;
+
+	pthread_mutex_lock(&cache_lock);
+	if (cache) {
+		hash_scan_begin(&hs, cache);
+		while ((hn = hash_scan_next(&hs)))
+			cache_free_entry(hn, 1);
+	}
+	cache_generation++;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+
+void wsman_response_cache_get_stats(unsigned long *hits,
+		unsigned long *misses)
+{
+	pthread_mutex_lock(&cache_lock);
+	if (hits)
+		*hits = cache_hits;
+	if (misses)
+		*misses = cache_misses;
+	pthread_mutex_unlock(&cache_lock);
+}
@@ -42,6 +42,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "u/libu.h"
 #include "wsman-xml-api.h"
@@ -92,6 +93,99 @@ cleanup:
 	return;
 }
 
+/*
+ * Response actions of the well known request actions, everything else
+ * goes through the bounded response_actions cache.
+ */
+static const char *known_response_actions[][2] = {
+	{ TRANSFER_ACTION_GET, TRANSFER_ACTION_GET WSFW_RESPONSE_STR },
+	{ TRANSFER_ACTION_PUT, TRANSFER_ACTION_PUT WSFW_RESPONSE_STR },
+	{ TRANSFER_ACTION_CREATE, TRANSFER_ACTION_CREATE WSFW_RESPONSE_STR },
+	{ TRANSFER_ACTION_DELETE, TRANSFER_ACTION_DELETE WSFW_RESPONSE_STR },
+	{ ENUM_ACTION_ENUMERATE, ENUM_ACTION_ENUMERATE WSFW_RESPONSE_STR },
+	{ ENUM_ACTION_PULL, ENUM_ACTION_PULL WSFW_RESPONSE_STR },
+	{ ENUM_ACTION_RELEASE, ENUM_ACTION_RELEASE WSFW_RESPONSE_STR },
+	{ ENUM_ACTION_RENEW, ENUM_ACTION_RENEW WSFW_RESPONSE_STR },
+	{ ENUM_ACTION_GETSTATUS, ENUM_ACTION_GETSTATUS WSFW_RESPONSE_STR },
+	{ EVT_ACTION_SUBSCRIBE, EVT_ACTION_SUBSCRIBE WSFW_RESPONSE_STR },
+	{ EVT_ACTION_UNSUBSCRIBE, EVT_ACTION_UNSUBSCRIBE WSFW_RESPONSE_STR },
+	{ EVT_ACTION_RENEW, EVT_ACTION_RENEW WSFW_RESPONSE_STR },
+	{ EVT_ACTION_PULL, EVT_ACTION_PULL WSFW_RESPONSE_STR },
+	{ EVT_ACTION_GETSTATUS, EVT_ACTION_GETSTATUS WSFW_RESPONSE_STR },
+	{ NULL, NULL }
+};
+
+#define RESPONSE_ACTIONS_MAX 256
+
+/* guards response_actions */
+static pthread_mutex_t response_lock = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *response_actions = NULL;
+/* built once and never modified, responses are copies of it */
+static pthread_once_t response_template_once = PTHREAD_ONCE_INIT;
+static WsXmlDocH response_template = NULL;
+
+/*
+ * Response action for a request action. The returned string lives as
+ * long as the process, NULL means the cache is full and the caller has
+ * to build it.
+ */
+static const char *
+wsman_get_response_action(const char *action)
+{
+	int i;
+	hnode_t *hn;
+	char *resp = NULL;
+
+	for (i = 0; known_response_actions[i][0] != NULL; i++) {
+		if (strcmp(action, known_response_actions[i][0]) == 0)
+			return known_response_actions[i][1];
+	}
+
+	pthread_mutex_lock(&response_lock);
+	if (response_actions == NULL)
+		response_actions = hash_create(RESPONSE_ACTIONS_MAX, 0, 0);
+	if (response_actions == NULL)
+		goto DONE;
+	if ((hn = hash_lookup(response_actions, action)) != NULL) {
+		resp = (char *) hnode_get(hn);
+	} else if (!hash_isfull(response_actions)) {
+		resp = u_strdup_printf("%s%s", action, WSFW_RESPONSE_STR);
+		/* the key is the head of the response string */
+		if (resp && !hash_alloc_insert(response_actions, u_strndup(resp,
+				strlen(action)), resp)) {
+			u_free(resp);
+			resp = NULL;
+		}
+	}
+DONE:
+	pthread_mutex_unlock(&response_lock);
+	return resp;
+}
+
+/*
+ * Envelope with Header, Body and the addressing namespace, which every
+ * response uses, already in place. Copying it only reads it, so it is
+ * shared without a lock.
+ */
+static void
+wsman_build_response_template(void)
+{
+	response_template = ws_xml_create_envelope();
+	if (response_template)
+		ws_xml_define_ns(ws_xml_get_doc_root(response_template),
+				XML_NS_ADDRESSING, NULL, 0);
+}
+
+static WsXmlDocH
+wsman_copy_response_template(void)
+{
+	pthread_once(&response_template_once, wsman_build_response_template);
+	if (response_template == NULL)
+		return NULL;
+	return ws_xml_create_doc_by_import(
+			ws_xml_get_doc_root(response_template));
+}
+
 /**
  * Create a response SOAP envelope
  * @param rqstDoc The XML document of the request
@@ -101,11 +195,12 @@ cleanup:
 WsXmlDocH
 wsman_create_response_envelope(WsXmlDocH rqstDoc, const char *action)
 {
-
-	WsXmlDocH doc = ws_xml_create_envelope();
+	WsXmlDocH doc;
 	WsXmlNodeH dstHeader, srcHeader, srcNode;
+
 	if (wsman_is_identify_request(rqstDoc))
-		return doc;
+		return ws_xml_create_envelope();
+	doc = wsman_copy_response_template();
 	if (!doc)
 		return NULL;
 
@@ -123,18 +218,14 @@ wsman_create_response_envelope(WsXmlDocH rqstDoc, const char *action)
 		if ((srcNode = ws_xml_get_child(srcHeader, 0, XML_NS_ADDRESSING,
 				      WSA_ACTION)) != NULL) {
 			if ((action = ws_xml_get_node_text(srcNode)) != NULL) {
-				size_t len = strlen(action) + sizeof(WSFW_RESPONSE_STR) + 2;
-				char *tmp = (char *) u_malloc(sizeof(char) * len);
-				if (tmp && action) {
-					int ret;
-					ret = snprintf(tmp, len, "%s%s", action, WSFW_RESPONSE_STR);
-					if (ret < 0 ||  ret >= len) {
-						u_free(tmp);
-						return NULL;
-					}
+				const char *resp = wsman_get_response_action(action);
+				if (resp) {
 					ws_xml_add_child(dstHeader, XML_NS_ADDRESSING,
-							 WSA_ACTION, tmp);
-					u_free(tmp);
+							 WSA_ACTION, resp);
+				} else {
+					ws_xml_add_child_format(dstHeader,
+							XML_NS_ADDRESSING, WSA_ACTION,
+							"%s%s", action, WSFW_RESPONSE_STR);
 				}
 			}
 		}
@@ -148,6 +239,78 @@ wsman_create_response_envelope(WsXmlDocH rqstDoc, const char *action)
 	return doc;
 }
 
+static int peek_name_char(char c)
+{
+	return isalnum((unsigned char) c) || c == '_' || c == '-' ||
+	    c == '.' || c == ':';
+}
+
+/* whether xmlns:prefix or, without one, xmlns is declared as ns */
+static int peek_declared(const char *buf, size_t len, const char *prefix,
+		size_t plen, const char *ns)
+{
+	char decl[256];
+	int n;
+
+	n = snprintf(decl, sizeof(decl), "xmlns%s%.*s=\"%s\"",
+		     plen ? ":" : "", (int) plen, prefix, ns);
+	if (n < 0 || n >= (int) sizeof(decl))
+		return 0;
+	if (memmem(buf, len, decl, n))
+		return 1;
+	decl[n - strlen(ns) - 2] = decl[n - 1] = '\'';
+	return memmem(buf, len, decl, n) != NULL;
+}
+
+/**
+ * Tell an Identify request from its UTF-8 text, without parsing it
+ * @param buf Message text
+ * @param len Its length
+ * @return 1 if it is one, 0 if not, -1 if it takes parsing to tell
+ */
+int wsman_peek_identify(const char *buf, size_t len)
+{
+	const char *end = buf + len, *p, *name, *local;
+	size_t n;
+
+	if (buf == NULL || memmem(buf, len, XML_NS_WSMAN_ID,
+				  strlen(XML_NS_WSMAN_ID)) == NULL)
+		return 0;
+	/* the start tag of the Body */
+	for (p = buf; ; p += 4) {
+		p = memmem(p, end - p, "Body", 4);
+		if (p == NULL || p + 4 >= end)
+			return -1;
+		for (name = p; name > buf && peek_name_char(name[-1]); name--)
+			;
+		if (name > buf && name[-1] == '<' &&
+		    (name == p || p[-1] == ':') &&
+		    (p[4] == '>' || isspace((unsigned char) p[4])))
+			break;
+	}
+	p = memchr(p, '>', end - p);
+	if (p == NULL || p[-1] == '/')
+		return -1;
+	/* its first child, anything but plain whitespace before it is left
+	 * to the parser */
+	for (p++; p < end && isspace((unsigned char) *p); p++)
+		;
+	if (p >= end || *p != '<')
+		return -1;
+	for (name = ++p; p < end && peek_name_char(*p); p++)
+		;
+	if (p >= end || (*p != '>' && *p != '/' && !isspace((unsigned char) *p)))
+		return -1;
+	n = p - name;
+	local = memchr(name, ':', n);
+	local = local ? local + 1 : name;
+	if ((size_t) (p - local) != strlen(WSMID_IDENTIFY) ||
+	    memcmp(local, WSMID_IDENTIFY, p - local))
+		return -1;
+	return peek_declared(buf, len, name, local > name ? local - name - 1 : 0,
+			     XML_NS_WSMAN_ID) ? 1 : -1;
+}
+
 /**
  * Check Identify Request
  * @param buf Message buffer
@@ -156,8 +319,18 @@ wsman_create_response_envelope(WsXmlDocH rqstDoc, const char *action)
 int wsman_check_identify(WsmanMessage * msg)
 {
 	int ret = 0;
-	WsXmlDocH doc = ws_xml_read_memory( u_buf_ptr(msg->request),
-					   u_buf_len(msg->request), msg->charset,  0);
+	WsXmlDocH doc;
+
+	/* most requests are told apart without a document */
+	if (msg->charset == NULL || !strcasecmp(msg->charset, "UTF-8")) {
+		ret = wsman_peek_identify(u_buf_ptr(msg->request),
+					  u_buf_len(msg->request));
+		if (ret >= 0)
+			return ret;
+		ret = 0;
+	}
+	doc = ws_xml_read_memory( u_buf_ptr(msg->request),
+				   u_buf_len(msg->request), msg->charset,  0);
 
 	if (doc == NULL) {
 		return 0;
@@ -508,12 +681,15 @@ wsman_create_fault_envelope(WsXmlDocH rqstDoc,
 
 /*
  * Interpret query as XPath
- * 
+ * Only endpoints declaring WS_DISP_XPATH_FILTER accept it, they compile
+ * the expression themselves, see ws_xml_xpath_match()
  */
 
-static int interpretxpath(char **xpath)
+static int interpretxpath(WsEnumerateInfo * enumInfo, char **xpath)
 {
-	return 0;
+	if (!(enumInfo->flags & WSMAN_ENUMINFO_XPATH_CAPABLE))
+		return 0;
+	return (*xpath != NULL && **xpath != '\0');
 }
 
 /*
@@ -605,7 +781,7 @@ int wsman_parse_enum_request(WsContextH cntx,
 			else if(strcmp(filter->dialect, WSM_SELECTOR_FILTER_DIALECT) == 0)
 				enumInfo->flags |= WSMAN_ENUMINFO_SELECTOR;
 			else {
-				if(interpretxpath(&filter->query))
+				if(interpretxpath(enumInfo, &filter->query))
 					enumInfo->flags |= WSMAN_ENUMINFO_XPATH;
 				else {
                                         status->fault_code = WSEN_CANNOT_PROCESS_FILTER;
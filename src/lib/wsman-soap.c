@@ -116,17 +116,30 @@ set_context_val(WsContextH cntx,
 		void *ptr = val;
 
 		if (!no_dup) {
-			if (val && (ptr = u_malloc(size))) {
+			if (cntx->arena)
+				ptr = val ? u_arena_alloc(cntx->arena, size) : NULL;
+			else
+				ptr = val ? u_malloc(size) : NULL;
+			if (ptr)
 				memcpy(ptr, val, size);
-			}
 		}
 		if (ptr || val == NULL) {
 			u_lock(cntx->soap);
 			ws_remove_context_val(cntx, name);
-			if (create_context_entry(cntx->entries, name, ptr)) {
+			if (cntx->arena) {
+				hnode_t *hn = u_arena_alloc(cntx->arena, sizeof(hnode_t));
+				char *key = u_arena_strdup(cntx->arena, name);
+				if (hn && key) {
+					hash_insert(cntx->entries, hnode_init(hn, ptr), key);
+					retVal = 0;
+				}
+			} else if (create_context_entry(cntx->entries, name, ptr)) {
 				retVal = 0;
 			}
 			u_unlock(cntx->soap);
+			/* the copy has no owner if it was not entered */
+			if (retVal && ptr != val && !cntx->arena)
+				u_free(ptr);
 		}
 	} else {
 		error("error setting context value.");
@@ -142,6 +155,27 @@ free_hentry_func(hnode_t * n, void *arg)
 	u_free(n);
 }
 
+/* nodes and keys of arena contexts are released with the arena */
+static void
+free_arena_hentry_func(hnode_t * n, void *arg)
+{
+}
+
+#define ARENA_CONTEXT_CHAINS 16
+
+static hash_t *
+create_arena_hash(u_arena_t *arena)
+{
+	hash_t *h = u_arena_alloc(arena, sizeof(hash_t));
+	hnode_t **table = u_arena_alloc(arena,
+			ARENA_CONTEXT_CHAINS * sizeof(hnode_t *));
+	if (h == NULL || table == NULL)
+		return NULL;
+	hash_init(h, HASHCOUNT_T_MAX, NULL, NULL, table, ARENA_CONTEXT_CHAINS);
+	hash_set_allocator(h, NULL, free_arena_hentry_func, NULL);
+	return h;
+}
+
 
 static void
 remove_locked_enuminfo(WsContextH cntx,
@@ -492,6 +526,34 @@ ws_create_context(SoapH soap)
 	return cntx;
 }
 
+/**
+ * Create a context whose entries and serializer memory come from arena.
+ * Nothing is freed by ws_destroy_context(), the memory goes away with
+ * the arena. The context must stay on the thread owning the arena.
+ * @param soap Soap handle
+ * @param arena Request arena
+ * @return Context or NULL
+ */
+WsContextH
+ws_create_arena_context(SoapH soap, u_arena_t *arena)
+{
+	WsContextH cntx;
+	if (arena == NULL)
+		return ws_create_context(soap);
+	cntx = (WsContextH) u_arena_zalloc(arena, sizeof (*cntx));
+	if (cntx == NULL)
+		return NULL;
+	cntx->arena = arena;
+	cntx->entries = create_arena_hash(arena);
+	cntx->enuminfos = create_arena_hash(arena);
+	cntx->serializercntx = ws_serializer_init_arena(arena);
+	if (!cntx->entries || !cntx->enuminfos || !cntx->serializercntx)
+		return NULL;
+	cntx->owner = 1;
+	cntx->soap = soap;
+	return cntx;
+}
+
 SoapH
 ws_soap_initialize()
 {
@@ -645,6 +707,11 @@ wsman_register_endpoint(WsContextH cntx,
 		action = ep->inAction;
 		callbackProc = wsenum_pull_direct_stub;
 		break;
+	case WS_DISP_TYPE_STREAM_PULL:
+		debug("Registering endpoint for streamed Pull");
+		action = ep->inAction;
+		callbackProc = wsenum_pull_stream_stub;
+		break;
 	case WS_DISP_TYPE_GET:
 		debug("Registering endpoint for Get");
 		action = ep->inAction;
@@ -739,12 +806,10 @@ wsman_identify_stub(SoapOpH op,
 	WsDispatchEndPointInfo *info;
 	XmlSerializerInfo *typeInfo;
 	WsmanStatus    *status;
-	SoapH           soap;
 	WsEndPointGet   endPoint;
 
 	status = u_zalloc(sizeof(WsmanStatus *));
-	soap = soap_get_op_soap(op);
-	cntx = ws_create_ep_context(soap, soap_get_op_doc(op, 1));
+	cntx = ws_create_op_context(op);
 	info = (WsDispatchEndPointInfo *) appData;
 	typeInfo = info->serializationInfo;
 	endPoint = (WsEndPointGet) info->serviceEndPoint;
@@ -785,8 +850,7 @@ ws_transfer_put_stub(SoapOpH op,
 	WsXmlDocH       doc = NULL;
 	void           *outData = NULL;
 	WsmanStatus     status;
-	SoapH           soap = soap_get_op_soap(op);
-	WsContextH   cntx = ws_create_ep_context(soap, soap_get_op_doc(op, 1));
+	WsContextH   cntx = ws_create_op_context(op);
 	WsDispatchEndPointInfo *info = (WsDispatchEndPointInfo *) appData;
 	XmlSerializerInfo *typeInfo = info->serializationInfo;
 	WsEndPointPut   endPoint = (WsEndPointPut) info->serviceEndPoint;
@@ -815,8 +879,7 @@ ws_transfer_put_stub(SoapOpH op,
 	if (doc) {
 		soap_set_op_doc(op, doc, 0);
 	}
-	ws_serializer_free_all(cntx->serializercntx);
-	ws_serializer_cleanup(cntx->serializercntx);
+	ws_destroy_context(cntx);
 	return retVal;
 }
 
@@ -829,9 +892,7 @@ ws_transfer_delete_stub(SoapOpH op,
 			void *opaqueData)
 {
 	WsmanStatus     status;
-	SoapH           soap = soap_get_op_soap(op);
-	WsContextH      cntx = ws_create_ep_context(soap,
-					soap_get_op_doc(op, 1));
+	WsContextH      cntx = ws_create_op_context(op);
 
 	WsDispatchEndPointInfo *info = (WsDispatchEndPointInfo *) appData;
 	WsEndPointGet   endPoint = (WsEndPointGet) info->serviceEndPoint;
@@ -869,8 +930,7 @@ ws_transfer_get_stub(SoapOpH op,
 	WsmanStatus     status;
 
 
-	SoapH       soap = soap_get_op_soap(op);
-	WsContextH  cntx = ws_create_ep_context(soap, soap_get_op_doc(op, 1));
+	WsContextH  cntx = ws_create_op_context(op);
 
 	WsDispatchEndPointInfo *info = (WsDispatchEndPointInfo *) appData;
 	XmlSerializerInfo *typeInfo = info->serializationInfo;
@@ -1001,13 +1061,15 @@ wsenum_enumerate_stub(SoapOpH op,
                 }
         }
 
-	epcntx = ws_create_ep_context(soap, _doc);
+	epcntx = ws_create_op_context(op);
 	wsman_status_init(&status);
 	doc = create_enum_info(op, epcntx, _doc, &enumInfo);
 	if (doc != NULL) {
 		/* wrong enum elements met. Fault message generated */
 		goto DONE;
 	}
+	if (ep->flags & WS_DISP_XPATH_FILTER)
+		enumInfo->flags |= WSMAN_ENUMINFO_XPATH_CAPABLE;
 
 	if (endPoint && (retVal = endPoint(epcntx, enumInfo, &status, opaqueData))) {
                 debug("enumeration fault");
@@ -1141,7 +1203,7 @@ wsenum_pull_stub(SoapOpH op, void *appData,
 		goto DONE;
 	}
 	locked = 1;
-	if ((retVal = endPoint(ws_create_ep_context(soap, _doc),
+	if ((retVal = endPoint(ws_create_op_context(op),
 						enumInfo, &status, opaqueData))) {
 		doc = wsman_generate_fault(_doc, status.fault_code, status.fault_detail_code, NULL);
 		goto DONE;
@@ -1229,7 +1291,7 @@ wsenum_pull_direct_stub(SoapOpH op,
 	if (enumInfo) { //pull things from "enumerate" results
 		locked = 1;
 
-		if ((retVal = endPoint(ws_create_ep_context(soap, _doc),
+		if ((retVal = endPoint(ws_create_op_context(op),
 						enumInfo, &status, opaqueData))) {
 			doc = wsman_generate_fault( _doc, status.fault_code, status.fault_detail_code, NULL);
 //			ws_remove_context_val(soapCntx, cntxName);
@@ -1327,6 +1389,244 @@ cleanup:
 	return retVal;
 }
 
+
+/*
+ * Room kept free for the closing tags and wsen:EndOfSequence when
+ * checking items against the maximum envelope size.
+ */
+#define WSENUM_STREAM_TAIL_SIZE 256
+
+struct __WsPullWriter {
+	WsXmlWriterH writer;
+	WsEnumerateInfo *enumInfo;
+	size_t limit;
+	int max_items;
+	int count;
+	int full;
+};
+
+/**
+ * Write one item of a streamed PullResponse. The item is serialized
+ * right away, so the caller may free it when this returns. The
+ * enumeration index is advanced for every item written, and set back
+ * if the response ends in a fault.
+ * @param writer Writer passed to the WsEndPointPullStream endpoint
+ * @param item Item element, its namespaces must be in scope within its
+ * own document
+ * @return 0 if written, 1 if the response is full and the item has to
+ * be returned by the next pull, -1 on error
+ */
+int
+wsman_pull_writer_add_item(WsPullWriterH writer, WsXmlNodeH item)
+{
+	int ret;
+
+	if (wsman_pull_writer_is_full(writer))
+		return 1;
+	ret = ws_xml_writer_add_node(writer->writer, item, writer->limit);
+	if (ret == 0) {
+		writer->count++;
+		writer->enumInfo->index++;
+	} else if (ret == 1) {
+		writer->full = 1;
+	}
+	return ret;
+}
+
+/**
+ * Check whether another item would go into the response
+ * @param writer Pull writer
+ * @return 1 if wsen:MaxElements or the envelope size has been reached
+ */
+int
+wsman_pull_writer_is_full(WsPullWriterH writer)
+{
+	if (writer->full)
+		return 1;
+	if (writer->max_items > 0 && writer->count >= writer->max_items)
+		writer->full = 1;
+	return writer->full;
+}
+
+int
+wsman_pull_writer_get_count(WsPullWriterH writer)
+{
+	return writer->count;
+}
+
+/**
+ * Pull stub for endpoints writing their items straight into the
+ * response buffer. Only the envelope header is built as a document,
+ * the items are serialized one by one behind it.
+ * @param op SOAP operation
+ * @param appData Endpoint information
+ * @return status
+ */
+int
+wsenum_pull_stream_stub(SoapOpH op,
+		     void *appData,
+			void *opaqueData)
+{
+	WsmanStatus     status;
+	WsXmlDocH       doc = NULL;
+	SoapH           soap = soap_get_op_soap(op);
+	WsContextH      soapCntx = ws_get_soap_context(soap);
+	WsDispatchEndPointInfo *ep = (WsDispatchEndPointInfo *) appData;
+	WsEndPointPullStream endPoint = (WsEndPointPullStream) ep->serviceEndPoint;
+	WsmanMessage   *msg = wsman_get_msg_from_op(op);
+	WsXmlDocH       _doc = soap_get_op_doc(op, 1);
+	WsXmlNodeH      body, response, context, items;
+	WsEnumerateInfo *enumInfo;
+	struct __WsPullWriter pw;
+	size_t          maxsize, ctx_start, ctx_end;
+	unsigned int    index = 0;
+	int             retVal = 0, locked = 0;
+
+	memset(&pw, 0, sizeof(pw));
+	wsman_status_init(&status);
+	enumInfo = get_locked_enuminfo(soapCntx,
+	                               _doc, op, WSENUM_PULL, &status);
+	if (enumInfo == NULL) {
+		error("Invalid enumeration context...");
+		doc = wsman_generate_fault( _doc, status.fault_code, status.fault_detail_code, NULL);
+		goto cleanup;
+	}
+	locked = 1;
+
+	doc = wsman_create_response_envelope( _doc, NULL);
+	if (!doc)
+		goto cleanup;
+	wsman_set_estimated_total(_doc, doc, enumInfo);
+	wsman_add_fragement_for_header(_doc, doc);
+
+	/* the header is written before the endpoint runs, finish it now */
+	soap_set_op_doc(op, doc, 0);
+	if (dispatch_outbound_filters((op_t *) op, opaqueData) ||
+			wsman_is_fault_envelope(soap_get_op_doc(op, 0))) {
+		/* the filters have run, send what they left rather than
+		 * handing it back to the dispatcher, which would run them
+		 * again */
+		char *buf = NULL;
+		int len;
+
+		doc = soap_detach_op_doc(op, 0);
+		if (doc == NULL)
+			doc = wsman_generate_fault(_doc, WSMAN_INTERNAL_ERROR,
+					OWSMAN_NO_DETAILS, NULL);
+		if (doc == NULL)
+			goto cleanup;
+		if (wsman_is_fault_envelope(doc))
+			msg->http_code = wsman_find_httpcode_for_value(doc);
+		ws_xml_dump_memory_enc(doc, &buf, &len, msg->charset);
+		u_buf_set(msg->response, buf, len);
+		u_free(buf);
+		ws_xml_destroy_doc(doc);
+		doc = NULL;
+		((op_t *) op)->streamed = 1;
+		goto cleanup;
+	}
+	doc = soap_detach_op_doc(op, 0);
+
+	body = ws_xml_get_soap_body(doc);
+	response = ws_xml_add_child(body, XML_NS_ENUMERATION,
+			WSENUM_PULL_RESP, NULL);
+	context = ws_xml_add_child(response, XML_NS_ENUMERATION,
+			WSENUM_ENUMERATION_CONTEXT, enumInfo->enumId);
+	items = ws_xml_add_child(response, XML_NS_ENUMERATION,
+			WSENUM_ITEMS, NULL);
+
+	pw.enumInfo = enumInfo;
+	pw.max_items = wsman_get_max_elements(NULL, _doc);
+	pw.writer = ws_xml_writer_new(msg->response, msg->charset);
+	if (pw.writer == NULL ||
+			ws_xml_writer_start_node(pw.writer, ws_xml_get_doc_root(doc)) ||
+			ws_xml_writer_add_node(pw.writer, ws_xml_get_soap_header(doc), 0) ||
+			ws_xml_writer_start_node(pw.writer, body) ||
+			ws_xml_writer_start_node(pw.writer, response)) {
+		goto internal_error;
+	}
+	/* the context is cut out again if the sequence ends here */
+	ctx_start = ws_xml_writer_offset(pw.writer);
+	if (ws_xml_writer_add_node(pw.writer, context, 0))
+		goto internal_error;
+	ctx_end = ws_xml_writer_offset(pw.writer);
+	if (ws_xml_writer_start_node(pw.writer, items))
+		goto internal_error;
+
+	maxsize = wsman_get_maxsize_from_op(op);
+	if (maxsize) {
+		if (maxsize <= ws_xml_writer_offset(pw.writer) +
+				WSENUM_STREAM_TAIL_SIZE) {
+			status.fault_code = WSMAN_ENCODING_LIMIT;
+			status.fault_detail_code = WSMAN_DETAIL_SERVICE_ENVELOPE_LIMIT;
+			goto fault;
+		}
+		pw.limit = maxsize - WSENUM_STREAM_TAIL_SIZE;
+	}
+
+	/* the items written go with the response, on a fault it is
+	 * dropped and the next pull has to start over */
+	index = enumInfo->index;
+	if ((retVal = endPoint(ws_create_op_context(op),
+					enumInfo, &pw, &status, opaqueData))) {
+		if (status.fault_code == WSMAN_RC_OK) {
+			status.fault_code = WSMAN_INTERNAL_ERROR;
+			status.fault_detail_code = OWSMAN_DETAIL_ENDPOINT_ERROR;
+		}
+		goto fault;
+	}
+	if (pw.count == 0 && pw.full) {
+		/* not even the first item fits */
+		status.fault_code = WSMAN_ENCODING_LIMIT;
+		status.fault_detail_code = WSMAN_DETAIL_SERVICE_ENVELOPE_LIMIT;
+		goto fault;
+	}
+	if (ws_xml_writer_end_node(pw.writer))
+		goto internal_error;
+
+	if (enumInfo->totalItems == 0 || enumInfo->index >= enumInfo->totalItems) {
+		WsXmlNodeH eos = ws_xml_add_child(response, XML_NS_ENUMERATION,
+				WSENUM_END_OF_SEQUENCE, NULL);
+		if (ws_xml_writer_add_node(pw.writer, eos, 0) ||
+				ws_xml_writer_end(pw.writer)) {
+			goto internal_error;
+		}
+		memmove((char *) u_buf_ptr(msg->response) + ctx_start,
+			(char *) u_buf_ptr(msg->response) + ctx_end,
+			u_buf_len(msg->response) - ctx_end);
+		u_buf_set_len(msg->response, u_buf_len(msg->response) -
+				(ctx_end - ctx_start));
+		remove_locked_enuminfo(soapCntx, enumInfo);
+		locked = 0;
+		destroy_enuminfo(enumInfo);
+	} else if (ws_xml_writer_end(pw.writer)) {
+		goto internal_error;
+	}
+	ws_xml_destroy_doc(doc);
+	doc = NULL;
+	((op_t *) op)->streamed = 1;
+	goto cleanup;
+
+internal_error:
+	status.fault_code = WSMAN_INTERNAL_ERROR;
+	status.fault_detail_code = OWSMAN_NO_DETAILS;
+fault:
+	u_buf_set_len(msg->response, 0);
+	if (pw.count)
+		enumInfo->index = index;
+	ws_xml_destroy_doc(doc);
+	doc = wsman_generate_fault( _doc, status.fault_code, status.fault_detail_code, NULL);
+cleanup:
+	ws_xml_writer_destroy(pw.writer);
+	if (locked) {
+		unlock_enuminfo(soapCntx, enumInfo);
+	}
+	if (doc) {
+		soap_set_op_doc(op, doc, 0);
+	}
+	return retVal;
+}
+
 static list_t *
 wsman_get_expired_enuminfos(WsContextH cntx)
 {
@@ -1731,7 +2031,7 @@ wse_subscribe_stub(SoapOpH op, void *appData, void *opaqueData)
 	char *buf = NULL;
 	char *expiresstr = NULL;
 	int len;
-	epcntx = ws_create_ep_context(soap, _doc);
+	epcntx = ws_create_op_context(op);
 	wsman_status_init(&status);
 	doc = create_subs_info(op, epcntx, _doc, &subsInfo);
 	if (doc != NULL) {
@@ -1840,7 +2140,7 @@ wse_unsubscribe_stub(SoapOpH op, void *appData, void *opaqueData)
 	WsXmlDocH       _doc = soap_get_op_doc(op, 1);
 	WsContextH      epcntx;
 
-	epcntx = ws_create_ep_context(soap, _doc);
+	epcntx = ws_create_op_context(op);
 	wsman_status_init(&status);
 	header = ws_xml_get_soap_header(_doc);
 	inNode = ws_xml_get_child(header, 0, XML_NS_EVENTING, WSEVENT_IDENTIFIER);
@@ -1919,7 +2219,7 @@ wse_renew_stub(SoapOpH op, void *appData, void *opaqueData)
 
 	WsXmlDocH       _doc = soap_get_op_doc(op, 1);
 	WsContextH      epcntx;
-	epcntx = ws_create_ep_context(soap, _doc);
+	epcntx = ws_create_op_context(op);
 	wsman_status_init(&status);
 	body = ws_xml_get_soap_body(_doc);
 	header = ws_xml_get_soap_header(_doc);
@@ -2372,12 +2672,31 @@ ws_create_ep_context(SoapH soap,
 	return cntx;
 }
 
+/**
+ * Create an endpoint context for the inbound document of op,
+ * allocated from the arena of the operation
+ * @param op Operation handle
+ * @return Context or NULL
+ */
+WsContextH
+ws_create_op_context(SoapOpH op)
+{
+	WsContextH      cntx = ws_create_arena_context(soap_get_op_soap(op),
+					soap_get_op_arena(op));
+	if (cntx)
+		ws_set_context_xml_doc_val(cntx, WSFW_INDOC,
+					soap_get_op_doc(op, 1));
+	return cntx;
+}
+
 
 int
 ws_destroy_context(WsContextH cntx)
 {
 	int             retVal = 1;
-	if (cntx && cntx->owner) {
+	if (cntx && cntx->owner && cntx->arena) {
+		retVal = 0;
+	} else if (cntx && cntx->owner) {
 		ws_clear_context_entries(cntx);
 		ws_clear_context_enuminfos(cntx);
 		ws_serializer_cleanup(cntx->serializercntx);
@@ -2523,6 +2842,15 @@ soap_set_op_doc(SoapOpH op,
 }
 
 
+u_arena_t *
+soap_get_op_arena(SoapOpH op)
+{
+	if (op)
+		return ((op_t *) op)->arena;
+
+	return NULL;
+}
+
 SoapH
 soap_get_op_soap(SoapOpH op)
 {
@@ -2547,7 +2875,8 @@ create_op_entry(SoapH soap,
 	op_t *entry = (op_t *) u_zalloc(sizeof(op_t));
 	if (entry) {
 		entry->dispatch = dispatch;
-		entry->cntx = ws_create_context(soap);
+		entry->arena = u_arena_create(0);
+		entry->cntx = ws_create_arena_context(soap, entry->arena);
 		entry->data = data;
 		// entry->processed_headers = list_create(LISTCOUNT_T_MAX);
 	}
@@ -2581,6 +2910,8 @@ NULL_SOAP:
 	list_destroy_nodes(entry->processed_headers);
 	list_destroy(entry->processed_headers);
 #endif
+	/* releases the contexts and serializer memory of the request at once */
+	u_arena_destroy(entry->arena);
 	u_free(entry);
 }
 
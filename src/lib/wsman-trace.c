@@ -0,0 +1,554 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Request timing, see wsman-trace.h.
+ *
+ * A trace belongs to the thread serving its request, so stages are
+ * added up without locking. Only finishing a trace takes a lock, for the
+ * histograms and the trace event file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-names.h"
+#include "wsman-trace.h"
+
+#define TRACE_MAX_SPANS 32
+#define TRACE_HISTOGRAMS_MAX 1024
+
+typedef struct {
+	WsmanTraceStage stage;
+	unsigned long long begin;
+	unsigned long long end;
+} trace_span;
+
+struct _WsmanTrace {
+	char *message_id;
+	char *resource_uri;
+	char *action;
+	unsigned long tid;
+	unsigned long long start;
+	unsigned long long stage_ns[WSMAN_TRACE_STAGES];
+	unsigned int stage_calls[WSMAN_TRACE_STAGES];
+	int nspans;
+	trace_span spans[TRACE_MAX_SPANS];
+};
+
+static const char *stage_names[WSMAN_TRACE_STAGES] = {
+	"receive", "parse", "filters_in", "endpoint", "cimom",
+	"filters_out", "serialize", "send"
+};
+
+static int trace_enabled = 0;
+static int trace_records = 0;
+static int trace_sample = 1;
+static unsigned long long trace_epoch = 0;
+
+/* histograms, event file and sampling, all under trace_lock */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *trace_histograms = NULL;
+static FILE *trace_fp = NULL;
+static unsigned long trace_seen = 0;
+static unsigned long trace_events = 0;
+
+static pthread_key_t trace_current_key;
+static pthread_once_t trace_current_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * Monotonic time in nanoseconds
+ */
+unsigned long long wsman_trace_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long) tv.tv_sec * 1000000000ULL +
+		tv.tv_usec * 1000ULL;
+#endif
+}
+
+const char *wsman_trace_stage_name(WsmanTraceStage stage)
+{
+	if ((int) stage < 0 || stage >= WSMAN_TRACE_STAGES)
+		return "unknown";
+	return stage_names[stage];
+}
+
+static unsigned long trace_thread_id(void)
+{
+#if defined(__linux__) && defined(SYS_gettid)
+	return (unsigned long) syscall(SYS_gettid);
+#else
+	return (unsigned long) pthread_self();
+#endif
+}
+
+/**
+ * Turn request tracing on
+ * @param log_records Log a timing record for every request
+ * @param trace_file Trace event file to write, NULL for none
+ * @param sample_rate Write one request in sample_rate to trace_file
+ * @return 0 on success
+ */
+int wsman_trace_init(int log_records, const char *trace_file,
+		int sample_rate)
+{
+	pthread_mutex_lock(&trace_lock);
+	if (trace_histograms == NULL)
+		trace_histograms = hash_create(TRACE_HISTOGRAMS_MAX, 0, 0);
+	if (trace_histograms == NULL)
+		goto err;
+	if (trace_file && trace_fp == NULL) {
+		trace_fp = fopen(trace_file, "w");
+		if (trace_fp == NULL) {
+			error("cannot open trace file %s", trace_file);
+			goto err;
+		}
+		fputs("[\n", trace_fp);
+		trace_events = 0;
+	}
+	trace_records = log_records;
+	trace_sample = sample_rate > 0 ? sample_rate : 1;
+	trace_epoch = wsman_trace_now();
+	trace_enabled = 1;
+	pthread_mutex_unlock(&trace_lock);
+	return 0;
+err:
+	pthread_mutex_unlock(&trace_lock);
+	return 1;
+}
+
+int wsman_trace_enabled(void)
+{
+	return trace_enabled;
+}
+
+static void trace_stages_to_buf(const unsigned long long *stage_ns,
+		const unsigned int *stage_calls, unsigned long count,
+		char *buf, size_t size)
+{
+	size_t len = 0;
+	int i, n;
+
+	buf[0] = '\0';
+	for (i = 0; i < WSMAN_TRACE_STAGES && len < size; i++) {
+		if (stage_ns[i] == 0 && (stage_calls == NULL || stage_calls[i] == 0))
+			continue;
+		n = snprintf(buf + len, size - len, " %s_us=%llu",
+			     stage_names[i], stage_ns[i] / count / 1000);
+		if (n < 0)
+			break;
+		len += n;
+		if (stage_calls && i == WSMAN_TRACE_CIMOM && len < size) {
+			n = snprintf(buf + len, size - len, " cimom_calls=%u",
+				     stage_calls[i]);
+			if (n < 0)
+				break;
+			len += n;
+		}
+	}
+}
+
+static void trace_log_histogram(const WsmanTraceHistogram *h, void *data)
+{
+	char stages[256];
+
+	trace_stages_to_buf(h->stage_ns, NULL, h->count, stages,
+			    sizeof(stages));
+	message("latency action=%s resource=%s count=%lu avg_us=%llu "
+		"p50_us=%llu p99_us=%llu max_us=%llu%s",
+		h->action, h->resource_uri, h->count,
+		h->total_ns / h->count / 1000,
+		wsman_trace_histogram_quantile(h, 0.5) / 1000,
+		wsman_trace_histogram_quantile(h, 0.99) / 1000,
+		h->max_ns / 1000, stages);
+}
+
+/**
+ * Log the histograms, close the trace event file and turn tracing off
+ */
+void wsman_trace_shutdown(void)
+{
+	hscan_t hs;
+	hnode_t *hn;
+	char *key;
+
+	if (!trace_enabled)
+		return;
+	wsman_trace_foreach_histogram(trace_log_histogram, NULL);
+
+	pthread_mutex_lock(&trace_lock);
+	trace_enabled = 0;
+	if (trace_fp) {
+		fputs("\n]\n", trace_fp);
+		fclose(trace_fp);
+		trace_fp = NULL;
+	}
+	hash_scan_begin(&hs, trace_histograms);
+	while ((hn = hash_scan_next(&hs))) {
+		key = (char *) hnode_getkey(hn);
+		u_free((void *) hnode_get(hn));
+		hash_scan_delfree(trace_histograms, hn);
+		u_free(key);
+	}
+	hash_destroy(trace_histograms);
+	trace_histograms = NULL;
+	pthread_mutex_unlock(&trace_lock);
+}
+
+/**
+ * Start the trace of a request
+ * @param start When the request came in, 0 for now
+ * @return The trace, NULL if tracing is off
+ */
+WsmanTrace *wsman_trace_new(unsigned long long start)
+{
+	WsmanTrace *trace;
+
+	if (!trace_enabled)
+		return NULL;
+	trace = u_zalloc(sizeof(WsmanTrace));
+	if (trace == NULL)
+		return NULL;
+	trace->start = start ? start : wsman_trace_now();
+	trace->tid = trace_thread_id();
+	return trace;
+}
+
+void wsman_trace_free(WsmanTrace *trace)
+{
+	if (trace == NULL)
+		return;
+	u_free(trace->message_id);
+	u_free(trace->resource_uri);
+	u_free(trace->action);
+	u_free(trace);
+}
+
+static char *trace_header_text(WsXmlNodeH header, const char *ns,
+		const char *name)
+{
+	char *text;
+
+	text = ws_xml_get_node_text(ws_xml_get_child(header, 0, ns, name));
+	return text ? u_strdup(text) : NULL;
+}
+
+/**
+ * Take MessageID, ResourceURI and Action from the request envelope
+ */
+void wsman_trace_set_request(WsmanTrace *trace, WsXmlDocH doc)
+{
+	WsXmlNodeH header, body;
+
+	if (trace == NULL || doc == NULL)
+		return;
+	header = ws_xml_get_soap_header(doc);
+	trace->message_id = trace_header_text(header, XML_NS_ADDRESSING,
+					      WSA_MESSAGE_ID);
+	trace->resource_uri = trace_header_text(header, XML_NS_WS_MAN,
+						WSM_RESOURCE_URI);
+	trace->action = trace_header_text(header, XML_NS_ADDRESSING,
+					  WSA_ACTION);
+	if (trace->action == NULL) {
+		/* Identify comes without an Action */
+		body = ws_xml_get_child(ws_xml_get_soap_body(doc), 0, NULL, NULL);
+		if (body)
+			trace->action = u_strdup(ws_xml_get_node_local_name(body));
+	}
+}
+
+/**
+ * Start timing a stage
+ * @return Time to pass to wsman_trace_end()
+ */
+unsigned long long wsman_trace_begin(WsmanTrace *trace)
+{
+	return trace ? wsman_trace_now() : 0;
+}
+
+/**
+ * Add the time since begin to a stage
+ */
+void wsman_trace_end(WsmanTrace *trace, WsmanTraceStage stage,
+		unsigned long long begin)
+{
+	unsigned long long end;
+
+	if (trace == NULL || (int) stage < 0 || stage >= WSMAN_TRACE_STAGES)
+		return;
+	end = wsman_trace_now();
+	if (begin == 0 || begin > end)
+		begin = end;
+	trace->stage_ns[stage] += end - begin;
+	trace->stage_calls[stage]++;
+	if (trace->nspans < TRACE_MAX_SPANS) {
+		trace_span *span = &trace->spans[trace->nspans++];
+
+		span->stage = stage;
+		span->begin = begin;
+		span->end = end;
+	}
+}
+
+static int trace_bucket(unsigned long long ns)
+{
+	unsigned long long us = ns / 1000;
+	int i = 0;
+
+	while (us && i < WSMAN_TRACE_BUCKETS - 1) {
+		us >>= 1;
+		i++;
+	}
+	return i;
+}
+
+/* trace_lock held */
+static void trace_account(WsmanTrace *trace, unsigned long long total)
+{
+	WsmanTraceHistogram *h;
+	hnode_t *hn;
+	char *key, *names, *sep;
+	int i;
+
+	key = u_strdup_printf("%s %s", trace->action ? trace->action : "-",
+			      trace->resource_uri ? trace->resource_uri : "-");
+	if (key == NULL)
+		return;
+	hn = hash_lookup(trace_histograms, key);
+	if (hn) {
+		h = (WsmanTraceHistogram *) hnode_get(hn);
+		u_free(key);
+	} else {
+		if (hash_isfull(trace_histograms) ||
+		    (h = u_zalloc(sizeof(WsmanTraceHistogram) +
+				  strlen(key) + 1)) == NULL) {
+			u_free(key);
+			return;
+		}
+		/* action and resource behind the histogram, actions have
+		 * no blanks */
+		names = (char *) (h + 1);
+		strcpy(names, key);
+		sep = strchr(names, ' ');
+		*sep = '\0';
+		h->action = names;
+		h->resource_uri = sep + 1;
+		if (!hash_alloc_insert(trace_histograms, key, h)) {
+			u_free(h);
+			u_free(key);
+			return;
+		}
+	}
+	h->count++;
+	h->total_ns += total;
+	if (total > h->max_ns)
+		h->max_ns = total;
+	for (i = 0; i < WSMAN_TRACE_STAGES; i++)
+		h->stage_ns[i] += trace->stage_ns[i];
+	h->buckets[trace_bucket(total)]++;
+}
+
+static void trace_json_string(const char *s)
+{
+	fputc('"', trace_fp);
+	for (; s && *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(trace_fp, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			fprintf(trace_fp, "\\u%04x", *s);
+		else
+			fputc(*s, trace_fp);
+	}
+	fputc('"', trace_fp);
+}
+
+static void trace_event(WsmanTrace *trace, const char *name,
+		unsigned long long begin, unsigned long long end)
+{
+	fprintf(trace_fp, "%s{\"name\":\"%s\",\"cat\":\"wsman\",\"ph\":\"X\","
+		"\"pid\":%d,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f",
+		trace_events++ ? ",\n" : "", name, (int) getpid(), trace->tid,
+		(begin - trace_epoch) / 1000.0, (end - begin) / 1000.0);
+}
+
+/* trace_lock held */
+static void trace_write_events(WsmanTrace *trace, int http_code,
+		unsigned long long end)
+{
+	int i;
+
+	trace_event(trace, "request", trace->start, end);
+	fputs(",\"args\":{\"id\":", trace_fp);
+	trace_json_string(trace->message_id);
+	fputs(",\"action\":", trace_fp);
+	trace_json_string(trace->action);
+	fputs(",\"resource\":", trace_fp);
+	trace_json_string(trace->resource_uri);
+	fprintf(trace_fp, ",\"status\":%d}}", http_code);
+	for (i = 0; i < trace->nspans; i++) {
+		trace_event(trace, stage_names[trace->spans[i].stage],
+			    trace->spans[i].begin, trace->spans[i].end);
+		fputc('}', trace_fp);
+	}
+	fflush(trace_fp);
+}
+
+static void trace_log(WsmanTrace *trace, int http_code,
+		unsigned long long total)
+{
+	char stages[512];
+
+	trace_stages_to_buf(trace->stage_ns, trace->stage_calls, 1, stages,
+			    sizeof(stages));
+	message("trace id=%s action=%s resource=%s status=%d total_us=%llu%s",
+		trace->message_id ? trace->message_id : "-",
+		trace->action ? trace->action : "-",
+		trace->resource_uri ? trace->resource_uri : "-",
+		http_code, total / 1000, stages);
+}
+
+/**
+ * End the trace of a request once its response is sent: account for it,
+ * log and write it as configured, and free it
+ */
+void wsman_trace_finish(WsmanTrace *trace, int http_code)
+{
+	unsigned long long end, total;
+
+	if (trace == NULL)
+		return;
+	end = wsman_trace_now();
+	total = end - trace->start;
+	if (trace_records)
+		trace_log(trace, http_code, total);
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_enabled) {
+		trace_account(trace, total);
+		if (trace_fp && ++trace_seen % trace_sample == 0)
+			trace_write_events(trace, http_code, end);
+	}
+	pthread_mutex_unlock(&trace_lock);
+	wsman_trace_free(trace);
+}
+
+static void trace_current_init(void)
+{
+	pthread_key_create(&trace_current_key, NULL);
+}
+
+/**
+ * Make trace the one of the request this thread works on
+ */
+void wsman_trace_set_current(WsmanTrace *trace)
+{
+	if (!trace_enabled)
+		return;
+	pthread_once(&trace_current_once, trace_current_init);
+	pthread_setspecific(trace_current_key, trace);
+}
+
+/**
+ * Trace of the request this thread works on, NULL if there is none
+ */
+WsmanTrace *wsman_trace_current(void)
+{
+	if (!trace_enabled)
+		return NULL;
+	pthread_once(&trace_current_once, trace_current_init);
+	return (WsmanTrace *) pthread_getspecific(trace_current_key);
+}
+
+/**
+ * Call fn for the histogram of every ResourceURI and Action seen
+ */
+void wsman_trace_foreach_histogram(WsmanTraceHistogramFn fn,
+		void *user_data)
+{
+	hscan_t hs;
+	hnode_t *hn;
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_histograms) {
+		hash_scan_begin(&hs, trace_histograms);
+		while ((hn = hash_scan_next(&hs)))
+			fn((const WsmanTraceHistogram *) hnode_get(hn),
+			   user_data);
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
+
+/**
+ * Upper bound of the latency of the fraction q of requests, in
+ * nanoseconds
+ */
+unsigned long long wsman_trace_histogram_quantile(const WsmanTraceHistogram *h,
+		double q)
+{
+	unsigned long want, seen = 0;
+	unsigned long long bound;
+	int i;
+
+	if (h == NULL || h->count == 0)
+		return 0;
+	want = (unsigned long) (q * h->count + 0.5);
+	if (want == 0)
+		want = 1;
+	for (i = 0; i < WSMAN_TRACE_BUCKETS - 1; i++) {
+		seen += h->buckets[i];
+		if (seen >= want)
+			break;
+	}
+	bound = (1ULL << i) * 1000ULL;
+	return bound < h->max_ns ? bound : h->max_ns;
+}
@@ -697,6 +697,23 @@ DONE:
 	}
 }
 
+/*
+ * WinHTTP wants the request as a document, read it back
+ */
+void
+wsmc_buffer_handler(WsManClient * cl, const char *buf, int len,
+		void *user_data)
+{
+	WsXmlDocH doc = ws_xml_read_memory(buf, len, cl->content_encoding, 0);
+
+	if (doc == NULL) {
+		cl->last_error = WS_LASTERR_OTHER_ERROR;
+		return;
+	}
+	wsmc_handler(cl, doc, user_data);
+	ws_xml_destroy_doc(doc);
+}
+
 // in future change this to return a list of certs...
 BOOL find_cert(const _TCHAR * oid,
 		const _TCHAR * certName,
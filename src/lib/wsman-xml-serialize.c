@@ -70,6 +70,8 @@ struct __WsSerializerContext
 {
 	pthread_mutex_t lock;
 	list_t *WsSerializerAllocList;
+	/* set for request scoped contexts, memory is owned by the arena */
+	u_arena_t *arena;
 };
 
 WsSerializerContextH ws_serializer_init()
@@ -82,12 +84,32 @@ WsSerializerContextH ws_serializer_init()
 		u_free(serializercntx);
 		return NULL;
 	}
+	serializercntx->arena = NULL;
 	u_init_lock(serializercntx);
 	return serializercntx;
 }
 
+/*
+ * Serializer context allocating from a request arena. Single frees are
+ * no-ops, everything is released when the arena is reset. Such a context
+ * must not be shared between threads.
+ */
+WsSerializerContextH ws_serializer_init_arena(u_arena_t *arena)
+{
+	WsSerializerContextH serializercntx = NULL;
+	if (arena == NULL)
+		return ws_serializer_init();
+	serializercntx = u_arena_zalloc(arena, sizeof(struct __WsSerializerContext));
+	if(serializercntx == NULL) return NULL;
+	serializercntx->arena = arena;
+	return serializercntx;
+}
+
 int ws_serializer_cleanup(WsSerializerContextH serctx)
 {
+	if (serctx && serctx->arena) {
+		return 0;
+	}
 	if(serctx && serctx->WsSerializerAllocList) {
 		ws_serializer_free_all(serctx);
                 u_destroy_lock(serctx);
@@ -1904,7 +1926,10 @@ void *ws_serializer_alloc(WsSerializerContextH serctx, int size)
 {
 	WsSerializerMemEntry *ptr = NULL;
 	TRACE_ENTER;
-	if ((ptr = (WsSerializerMemEntry *) u_malloc(sizeof(WsSerializerMemEntry) + size)) != NULL) {
+	if (serctx->arena) {
+		ptr = (WsSerializerMemEntry *) u_arena_alloc(serctx->arena,
+				sizeof(WsSerializerMemEntry) + size);
+	} else if ((ptr = (WsSerializerMemEntry *) u_malloc(sizeof(WsSerializerMemEntry) + size)) != NULL) {
 		lnode_t *node;
 		u_lock(serctx);
 		if ((node = lnode_create(ptr)) == NULL) {
@@ -1925,6 +1950,11 @@ static int do_serializer_free(WsSerializerContextH serctx, void *ptr)
 	lnode_t *node = NULL;
 	lnode_t *node2 = NULL;
 	TRACE_ENTER;
+	if (serctx && serctx->arena) {
+		/* released with the arena */
+		TRACE_EXIT;
+		return 0;
+	}
 	if (serctx) {
 		u_lock(serctx);
 		node = list_first(serctx->WsSerializerAllocList);
@@ -1455,6 +1455,148 @@ void ws_xml_dump_doc(FILE * f, WsXmlDocH doc)
 }
 
 
+WsXmlWriterH ws_xml_writer_new(u_buf_t *out, const char *encoding)
+{
+	if (out == NULL)
+		return NULL;
+	return xml_parser_writer_new(out, encoding);
+}
+
+void ws_xml_writer_destroy(WsXmlWriterH w)
+{
+	xml_parser_writer_free(w);
+}
+
+/**
+ * Write the start tag of node, with its namespace declarations and
+ * attributes, but none of its children
+ * @param w Writer
+ * @param node Element to open
+ * @return 0 on success, 1 on error
+ */
+int ws_xml_writer_start_node(WsXmlWriterH w, WsXmlNodeH node)
+{
+	if (w == NULL || node == NULL)
+		return 1;
+	return xml_parser_writer_start_node(w, node);
+}
+
+int ws_xml_writer_end_node(WsXmlWriterH w)
+{
+	if (w == NULL)
+		return 1;
+	return xml_parser_writer_end_node(w);
+}
+
+/**
+ * Write node and its subtree. Namespaces used in the subtree must be
+ * declared within it or on an element already opened on the writer.
+ * @param w Writer
+ * @param node Element to write
+ * @param limit Maximum output size in bytes, 0 for no limit
+ * @return 0 if written, 1 if it would exceed limit, -1 on error
+ */
+int ws_xml_writer_add_node(WsXmlWriterH w, WsXmlNodeH node, size_t limit)
+{
+	if (w == NULL || node == NULL)
+		return -1;
+	return xml_parser_writer_node(w, node, limit);
+}
+
+/**
+ * Bytes written so far
+ * @param w Writer
+ * @return Offset in the output buffer, a valid position to cut at
+ */
+size_t ws_xml_writer_offset(WsXmlWriterH w)
+{
+	if (w == NULL)
+		return 0;
+	return xml_parser_writer_offset(w);
+}
+
+/**
+ * Close all open elements and flush the remaining output
+ * @param w Writer
+ * @return 0 on success, 1 on error
+ */
+int ws_xml_writer_end(WsXmlWriterH w)
+{
+	if (w == NULL)
+		return 1;
+	return xml_parser_writer_end_doc(w);
+}
+
+/**
+ * Read an Enumerate or Pull response without building its tree
+ * @param buf Response, must stay valid until the reader is destroyed
+ * @param size Size of buf
+ * @param encoding Encoding or NULL
+ * @return reader or NULL
+ */
+WsXmlReaderH ws_xml_reader_new(const char *buf, size_t size,
+		const char *encoding)
+{
+	return xml_parser_reader_new(buf, size, encoding);
+}
+
+/**
+ * Next item, EnumerationContext or EndOfSequence of the response, in
+ * document order. The node and its subtree are valid until the next
+ * call.
+ * @param r Reader
+ * @param what Set to WS_XML_READER_ITEM, WS_XML_READER_CONTEXT or
+ *        WS_XML_READER_END, 0 at the end of the response and -1 on a
+ *        parse error
+ * @return node or NULL
+ */
+WsXmlNodeH ws_xml_reader_next(WsXmlReaderH r, int *what)
+{
+	return xml_parser_reader_next(r, what);
+}
+
+void ws_xml_reader_destroy(WsXmlReaderH r)
+{
+	if (r)
+		xml_parser_reader_free(r);
+}
+
+/**
+ * Create a parser fed with a document as it arrives
+ * @param encoding Encoding overriding the declared one, or NULL
+ * @return parser or NULL
+ */
+WsXmlPushParserH ws_xml_push_parser_new(const char *encoding)
+{
+	return xml_parser_push_new(encoding);
+}
+
+/**
+ * Parse the next chunk of the document
+ * @return 0 on success, 1 once the document is known to be malformed
+ */
+int ws_xml_push_parser_feed(WsXmlPushParserH p, const char *buf,
+		size_t size)
+{
+	return xml_parser_push_chunk(p, buf, size);
+}
+
+/**
+ * Document parsed from the chunks fed so far, owned by the caller
+ * @return document or NULL if it is malformed or incomplete
+ */
+WsXmlDocH ws_xml_push_parser_finish(WsXmlPushParserH p)
+{
+	return xml_parser_push_end(p);
+}
+
+void ws_xml_push_parser_destroy(WsXmlPushParserH p)
+{
+	if (p)
+		xml_parser_push_free(p);
+}
+
+
 WsXmlNsH
 ws_xml_ns_add(WsXmlNodeH node, const char *uri, const char *prefix)
 {
@@ -1474,6 +1616,31 @@ char *ws_xml_get_xpath_value(WsXmlDocH doc, char *expression)
 	return xml_parser_get_xpath_value(doc, expression);
 }
 
+/**
+ * Evaluate an XPath filter on an item
+ * @param node Item, the context node of the expression
+ * @param ns_node Node whose namespaces in scope are used to resolve the
+ *        prefixes of the expression, typically the request's Filter, or NULL
+ * @param expression XPath expression
+ * @return 1 if the item matches, 0 if not, -1 on an invalid expression
+ */
+int ws_xml_xpath_match(WsXmlNodeH node, WsXmlNodeH ns_node,
+		const char *expression)
+{
+	return xml_parser_xpath_match(node, ns_node, expression);
+}
+
+/**
+ * Hits and misses of the compiled XPath expression caches, summed
+ * over all threads
+ * @param hits Where to store the number of hits, may be NULL
+ * @param misses Where to store the number of misses, may be NULL
+ */
+void ws_xml_xpath_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+	xml_parser_xpath_cache_stats(hits, misses);
+}
+
 
 
 WsXmlDocH ws_xml_create_doc_by_import(WsXmlNodeH node)
@@ -69,8 +69,8 @@ START_END_POINTS(CimResource)
   END_POINT_TRANSFER_DIRECT_PUT(CimResource, XML_NS_CIM_CLASS),
   END_POINT_TRANSFER_DIRECT_CREATE(CimResource, XML_NS_CIM_CLASS),
   END_POINT_TRANSFER_DIRECT_DELETE(CimResource, XML_NS_CIM_CLASS),
-  END_POINT_ENUMERATE(CimResource, XML_NS_CIM_CLASS),
-  END_POINT_DIRECT_PULL(CimResource, XML_NS_CIM_CLASS),
+  END_POINT_ENUMERATE_XPATH(CimResource, XML_NS_CIM_CLASS),
+  END_POINT_STREAM_PULL(CimResource, XML_NS_CIM_CLASS),
   END_POINT_RELEASE(CimResource, XML_NS_CIM_CLASS),
 #ifdef ENABLE_EVENTING_SUPPORT
   END_POINT_SUBSCRIBE(CimResource,XML_NS_CIM_CLASS),
@@ -63,6 +63,11 @@ int CimResource_Pull_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
 		WsmanStatus *status,
 		void *opaqueData);
 
+int CimResource_PullStream_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
+		WsPullWriterH writer,
+		WsmanStatus *status,
+		void *opaqueData);
+
 int CimResource_Get_EP(SoapOpH op, void* appData, void *opaqueData);
 
 int CimResource_Custom_EP(SoapOpH op, void* appData, void *opaqueData);
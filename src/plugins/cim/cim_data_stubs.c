@@ -218,7 +218,6 @@ CimResource_Delete_EP( SoapOpH op,
 {
 	WsmanStatus status;
 	CimClientInfo *cimclient = NULL;
-	SoapH soap = soap_get_op_soap(op);
 	WsmanMessage *msg = wsman_get_msg_from_op(op);
 	WsXmlDocH in_doc = NULL;
 	WsXmlDocH doc = NULL;
@@ -227,7 +226,7 @@ CimResource_Delete_EP( SoapOpH op,
 	wsman_status_init(&status);
 
 	in_doc = soap_get_op_doc(op, 1);
-	cntx = ws_create_ep_context(soap, in_doc);
+	cntx = ws_create_op_context(op);
 
 	if (!msg) {
 		status.fault_code = WSMAN_SCHEMA_VALIDATION_ERROR;
@@ -282,10 +281,9 @@ CimResource_Get_EP( SoapOpH op,
 	CimClientInfo *cimclient = NULL;
 	char *fragstr = NULL;
 	WsmanMessage *msg = wsman_get_msg_from_op(op);
-	SoapH soap = soap_get_op_soap(op);
 
 	WsXmlDocH in_doc = soap_get_op_doc(op, 1);
-	WsContextH cntx = ws_create_ep_context(soap, in_doc);
+	WsContextH cntx = ws_create_op_context(op);
 
 	wsman_status_init(&status);
 	if (!msg) {
@@ -352,7 +350,7 @@ CimResource_Custom_EP( SoapOpH op,
 
 	wsman_status_init(&status);
 	in_doc = soap_get_op_doc(op, 1);
-	cntx = ws_create_ep_context(soap_get_op_soap(op), in_doc);
+	cntx = ws_create_op_context(op);
 
 	msg = wsman_get_msg_from_op(op);
 	action = wsman_get_action(cntx, in_doc );
@@ -576,6 +574,47 @@ cleanup:
 	return 0;
 }
 
+int
+CimResource_PullStream_EP( WsContextH cntx,
+		WsEnumerateInfo* enumInfo,
+		WsPullWriterH writer,
+		WsmanStatus *status,
+		void *opaqueData)
+{
+	CimClientInfo *cimclient = NULL;
+	int retVal = 0;
+	debug( "Pull Endpoint Called");
+
+	cimclient = cim_getclient_from_enum_context(enumInfo);
+	if (!cimclient) {
+		status->fault_code = WSA_ENDPOINT_UNAVAILABLE;
+		status->fault_detail_code = 0;
+		retVal = 1;
+		goto cleanup;
+	}
+	cimclient->cntx = cntx;
+
+	if (!verify_class_namespace(cimclient) ) {
+		status->fault_code = WSA_DESTINATION_UNREACHABLE;
+		status->fault_detail_code = WSMAN_DETAIL_INVALID_RESOURCEURI;
+		retVal = 1;
+		goto cleanup;
+	}
+
+	cim_stream_enum_items(cimclient, writer, enumInfo);
+
+cleanup:
+	if ( enumInfo->totalItems == 0 ||
+		enumInfo->index == enumInfo->totalItems) {
+		cim_release_enum_context(enumInfo);
+		if (cimclient) {
+			CimResource_destroy(cimclient);
+		}
+		enumInfo->flags |= WSMAN_ENUMINFO_CIM_CONTEXT_CLEANUP;
+	}
+	return retVal;
+}
+
 int
 CimResource_Create_EP( SoapOpH op,
 		void* appData,
@@ -587,8 +626,7 @@ CimResource_Create_EP( SoapOpH op,
 	WsmanStatus status;
 	char *fragstr = NULL;
 
-	SoapH soap = soap_get_op_soap(op);
-	WsContextH cntx = ws_create_ep_context(soap, soap_get_op_doc(op, 1));
+	WsContextH cntx = ws_create_op_context(op);
 	WsmanMessage *msg = wsman_get_msg_from_op(op);
 	debug( "Create Endpoint Called");
 	wsman_status_init(&status);
@@ -671,8 +709,7 @@ CimResource_Put_EP( SoapOpH op,
 	WsmanMessage *msg;
 	char *fragstr;
 
-	SoapH soap = soap_get_op_soap(op);
-	WsContextH cntx = ws_create_ep_context(soap, soap_get_op_doc(op, 1));
+	WsContextH cntx = ws_create_op_context(op);
 	WsXmlDocH indoc = soap_get_op_doc(op, 1);
 
 	wsman_status_init(&status);
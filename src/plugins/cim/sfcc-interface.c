@@ -51,6 +51,7 @@
 #include "wsman-soap.h"
 #include "wsman-soap-envelope.h"
 #include "wsman-epr.h"
+#include "wsman-trace.h"
 
 #include "sfcc-interface.h"
 #include "cim-interface.h"
@@ -59,6 +60,14 @@
 #define SYSTEMCREATIONCLASSNAME "CIM_ComputerSystem"
 #define SYSTEMNAME "localhost.localdomain"
 
+/* time a round trip to the CIMOM as part of the request being served */
+#define CIMOM_CALL(call) do { \
+	WsmanTrace *trace_ = wsman_trace_current(); \
+	unsigned long long begin_ = wsman_trace_begin(trace_); \
+	call; \
+	wsman_trace_end(trace_, WSMAN_TRACE_CIMOM, begin_); \
+} while (0)
+
 extern char *get_server_port(void);
 
 typedef struct _sfcc_enumcontext {
@@ -902,7 +911,7 @@ cim_get_class(CimClientInfo * client,
 
 	CMCIClient *cc = (CMCIClient *) client->cc;
 	op = newCMPIObjectPath(client->cim_namespace, class, NULL);
-	_class = cc->ft->getClass(cc, op, flags, NULL, &rc);
+	CIMOM_CALL(_class = cc->ft->getClass(cc, op, flags, NULL, &rc));
 
 	debug("getClass() rc=%d, msg=%s",
 			rc.rc, (rc.msg) ? CMGetCharPtr(rc.msg) : "<NULL>");
@@ -1035,6 +1044,67 @@ instance2xml(CimClientInfo * client,
 }
 
 
+/*
+ * Copy the instances of enumArr whose XML representation matches the
+ * XPath filter of the enumeration to fenumArr. Every instance is
+ * rendered into the same scratch document, the compiled expression is
+ * cached by the XPath layer.
+ * return 0 on success
+ */
+static int
+xpath_filter_instances(CimClientInfo * client, WsEnumerateInfo * enumInfo,
+		CMPIArray * enumArr, CMPIArray * fenumArr,
+		WsmanStatus * status)
+{
+	WsXmlDocH scratch;
+	WsXmlNodeH root, item, filter_node = NULL;
+	int idx, fidx = 0, match = 0;
+
+	/* the request's Filter binds the prefixes of the expression */
+	if (client->cntx && client->cntx->indoc) {
+		filter_node = ws_xml_get_soap_body(client->cntx->indoc);
+		filter_node = ws_xml_get_child(filter_node, 0,
+				XML_NS_ENUMERATION, WSENUM_ENUMERATE);
+		filter_node = ws_xml_get_child(filter_node, 0,
+				XML_NS_WS_MAN, WSM_FILTER);
+	}
+	scratch = ws_xml_create_doc(XML_NS_ENUMERATION, WSENUM_ITEMS);
+	if (scratch == NULL) {
+		status->fault_code = WSMAN_INTERNAL_ERROR;
+		status->fault_detail_code = WSMAN_DETAIL_OK;
+		return 1;
+	}
+	root = ws_xml_get_doc_root(scratch);
+
+	for (idx = 0; idx < enumArr->ft->getSize(enumArr, NULL); idx++) {
+		CMPIData d = enumArr->ft->getElementAt(enumArr, idx, NULL);
+		instance2xml(client, d.value.inst, NULL, root, enumInfo);
+		item = xml_parser_node_get(root, XML_LAST_CHILD);
+		if (item == NULL)
+			continue;
+		match = ws_xml_xpath_match(item, filter_node,
+				enumInfo->filter->query);
+		xml_parser_node_remove(item);
+		if (match < 0)
+			break;
+		if (match) {
+			fenumArr->ft->setElementAt(fenumArr, fidx, &d.value, d.type);
+			fidx++;
+		}
+	}
+	ws_xml_destroy_doc(scratch);
+
+	if (match < 0) {
+		debug("invalid XPath filter: %s", enumInfo->filter->query);
+		status->fault_code = WSEN_CANNOT_PROCESS_FILTER;
+		status->fault_detail_code = WSMAN_DETAIL_INVALID_VALUE;
+		return 1;
+	}
+	debug("XPath filter matched %d of %d instances", fidx, idx);
+	return 0;
+}
+
+
 
 /*
  * An operation (for a concrete instance) is given only the abstract base class
@@ -1060,10 +1130,10 @@ cim_get_op_from_enum(CimClientInfo * client,
 	CMPIObjectPath *objectpath =
 		newCMPIObjectPath(client->cim_namespace,
 				client->requested_class, NULL);
-	enumeration =
+	CIMOM_CALL(enumeration =
 		((CMCIClient *) client->cc)->ft->enumInstanceNames(client->cc,
 			objectpath,
-			&rc);
+			&rc));
 	debug("enumInstanceNames rc=%d, msg=%s", rc.rc,
 			(rc.msg) ? CMGetCharPtr(rc.msg) : NULL);
 
@@ -1183,25 +1253,21 @@ cim_enum_instances(CimClientInfo * client,
 	}
 
 	if (enumInfo->flags & WSMAN_ENUMINFO_REF) {
-		enumeration = cc->ft->references(cc, objectpath, filter->resultClass,
-				filter->role, 0, NULL, &rc);
+		CIMOM_CALL(enumeration = cc->ft->references(cc, objectpath, filter->resultClass,
+				filter->role, 0, NULL, &rc));
 	} else if (enumInfo->flags & WSMAN_ENUMINFO_ASSOC) {
-		enumeration = cc->ft->associators(cc, objectpath, filter->assocClass,
+		CIMOM_CALL(enumeration = cc->ft->associators(cc, objectpath, filter->assocClass,
 				filter->resultClass,
 				filter->role,
-				filter->resultRole, 0, NULL, &rc);
+				filter->resultRole, 0, NULL, &rc));
 	} else if (( enumInfo->flags & WSMAN_ENUMINFO_WQL )) {
-		enumeration = cc->ft->execQuery(cc, objectpath, filter->query, "WQL", &rc);
+		CIMOM_CALL(enumeration = cc->ft->execQuery(cc, objectpath, filter->query, "WQL", &rc));
 	} else if (( enumInfo->flags & WSMAN_ENUMINFO_CQL )) {
-		enumeration = cc->ft->execQuery(cc, objectpath, filter->query, get_cim_client_cql(), &rc);
-	} else if (( enumInfo->flags & WSMAN_ENUMINFO_XPATH )) { /* XPath unsupported in Sfcc */
-                status->fault_code = WSEN_CANNOT_PROCESS_FILTER;
-                status->fault_detail_code = WSMAN_DETAIL_NOT_SUPPORTED;
-                goto cleanup;
+		CIMOM_CALL(enumeration = cc->ft->execQuery(cc, objectpath, filter->query, get_cim_client_cql(), &rc));
 	} else {
-		enumeration = cc->ft->enumInstances(cc, objectpath,
+		CIMOM_CALL(enumeration = cc->ft->enumInstances(cc, objectpath,
 				CMPI_FLAG_DeepInheritance,
-				NULL, &rc);
+				NULL, &rc));
 	}
 
 	debug("enumInstances() rc=%d, msg=%s",
@@ -1230,6 +1296,18 @@ cim_enum_instances(CimClientInfo * client,
 				fidx++;
 			}
 		}
+	} else if (enumArr && (enumInfo->flags & WSMAN_ENUMINFO_XPATH)) {
+		/* XPath is unsupported in Sfcc, apply it to the rendered items */
+		CMPIType t = enumArr->ft->getSimpleType(enumArr, NULL);
+		fenumArr = newCMPIArray(0, t , NULL);
+		if (xpath_filter_instances(client, enumInfo, enumArr, fenumArr,
+					status) != 0) {
+			CMRelease(fenumArr);
+			CMRelease(enumeration);
+			if (objectpath)
+				CMRelease(objectpath);
+			goto cleanup;
+		}
 	} else {
 		fenumArr = enumArr;
 	}
@@ -1708,7 +1786,8 @@ invoke_enumerate_class_names(CimClientInfo *client, WsXmlNodeH body, CMPIStatus
         unsigned long flags = client->flags;
         if (client->selectors && hash_lookup(client->selectors, (char *) "DeepInheritance"))
                 flags |= CMPI_FLAG_DeepInheritance;
-	CMPIEnumeration *classnames = cc->ft->enumClassNames(cc, op, flags, rc);
+	CMPIEnumeration *classnames;
+	CIMOM_CALL(classnames = cc->ft->enumClassNames(cc, op, flags, rc));
 
         debug("invoke_enumerate_class_names");
   
@@ -1736,9 +1815,10 @@ invoke_get_class(CimClientInfo *client, WsXmlNodeH body, CMPIStatus *rc)
 {
 	CMPIObjectPath *op = newCMPIObjectPath(client->cim_namespace, client->requested_class, NULL);
 	CMCIClient *cc = (CMCIClient *)client->cc;
-	CMPIConstClass *_class = cc->ft->getClass(cc, op,
+	CMPIConstClass *_class;
+	CIMOM_CALL(_class = cc->ft->getClass(cc, op,
 		client->flags | (CMPI_FLAG_LocalOnly|CMPI_FLAG_IncludeQualifiers|CMPI_FLAG_IncludeClassOrigin),
-		NULL, rc);
+		NULL, rc));
 
         debug("invoke_get_class");
   
@@ -1832,9 +1912,10 @@ cim_invoke_method(CimClientInfo * client,
 		} else  {
 
 			argsout = newCMPIArgs(NULL);
-			CMPIData data = cc->ft->invokeMethod(cc, objectpath,
+			CMPIData data;
+			CIMOM_CALL(data = cc->ft->invokeMethod(cc, objectpath,
 				client->method,
-				argsin, argsout, &rc);
+				argsin, argsout, &rc));
 	  
 			debug("invokeMethod(%s) rc=%d, msg=%s",
 				client->method, rc.rc, (rc.msg) ? CMGetCharPtr(rc.msg) : "<NULL>");
@@ -1899,7 +1980,7 @@ cim_delete_instance_from_enum(CimClientInfo * client, WsmanStatus * status)
 	if ((objectpath = cim_get_op_from_enum(client, status)) != NULL) {
         u_free(status->fault_msg);
         wsman_status_init(status);
-		rc = cc->ft->deleteInstance(cc, objectpath);
+		CIMOM_CALL(rc = cc->ft->deleteInstance(cc, objectpath));
 		if (rc.rc != 0) {
 			cim_to_wsman_status(rc, status);
 		}
@@ -1935,9 +2016,9 @@ cim_get_instance_from_enum(CimClientInfo * client,
 	if ((objectpath = cim_get_op_from_enum(client, status)) != NULL) {
 	        u_free(status->fault_msg);
 	        wsman_status_init(status);
-		instance = cc->ft->getInstance(cc, objectpath,
+		CIMOM_CALL(instance = cc->ft->getInstance(cc, objectpath,
 				CMPI_FLAG_IncludeClassOrigin,
-				NULL, &rc);
+				NULL, &rc));
 		if (rc.rc == 0) {
 			if (instance) {
 				instance2xml(client, instance, fragstr, body, NULL);
@@ -2013,15 +2094,15 @@ cim_put_instance(CimClientInfo * client,
 	if (status->fault_code == 0 && instance ) {
 		CMPIString *opstr = CMObjectPathToString(objectpath, NULL);
 		debug("objectpath: %s", CMGetCharPtr(opstr) );
-		rc = cc->ft->setInstance(cc, objectpath, instance, 0, NULL);
+		CIMOM_CALL(rc = cc->ft->setInstance(cc, objectpath, instance, 0, NULL));
 		debug("modifyInstance() rc=%d, msg=%s", rc.rc,
 				(rc.msg) ? (char *) CMGetCharPtr(rc.msg) : NULL);
 		cim_to_wsman_status(rc, status);
 		if (rc.rc == CMPI_RC_OK) {
 			// return the current representation of the resource
-			instance = cc->ft->getInstance(cc, objectpath,
+			CIMOM_CALL(instance = cc->ft->getInstance(cc, objectpath,
 					CMPI_FLAG_IncludeClassOrigin,
-					NULL, &rc);
+					NULL, &rc));
 			instance2xml(client, instance, fragstr, body, NULL);
 		}
 
@@ -2155,7 +2236,7 @@ cim_create_instance(CimClientInfo * client,
 	create_instance_from_xml(instance, class,
 			resource, fragstr, client->resource_uri, status);
 	if (status->fault_code == 0) {
-		objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc);
+		CIMOM_CALL(objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc));
 		debug("createInstance() rc=%d, msg=%s", rc.rc,
 				(rc.msg) ? CMGetCharPtr(rc.msg) : NULL);
 		if (objectpath_r) {
@@ -2208,7 +2289,7 @@ cim_delete_instance(CimClientInfo * client, WsmanStatus * status)
 			client->requested_class, NULL);
 
 	cim_add_keys(objectpath, client->selectors);
-	rc = cc->ft->deleteInstance(cc, objectpath);
+	CIMOM_CALL(rc = cc->ft->deleteInstance(cc, objectpath));
 	/* Print the results */
 	debug("deleteInstance() rc=%d, msg=%s",
 			rc.rc, (rc.msg) ? CMGetCharPtr(rc.msg) : NULL);
@@ -2248,9 +2329,9 @@ cim_get_instance_from_selectors(CimClientInfo * client,
 			client->requested_class, NULL);
 
 	cim_add_keys(objectpath, client->selectors);
-	instance = cc->ft->getInstance(cc, objectpath,
+	CIMOM_CALL(instance = cc->ft->getInstance(cc, objectpath,
 			CMPI_FLAG_DeepInheritance, NULL,
-			&rc);
+			&rc));
 	/* Print the results */
 	debug("getInstance() rc=%d, msg=%s",
 			rc.rc, (rc.msg) ? CMGetCharPtr(rc.msg) : NULL);
@@ -2281,11 +2362,11 @@ cim_get_indicationfilter_objectpath_from_selectors(CimClientInfo * client,
     if(objectpath) {
         CMPIStatus rc;
         CMCIClient *cc = (CMCIClient *)client->cc;
-        class = cc->ft->getClass(cc,
+        CIMOM_CALL(class = cc->ft->getClass(cc,
                                  objectpath,
                                  CMPI_FLAG_IncludeQualifiers,
                                  NULL,
-                                 &rc);
+                                 &rc));
         if (!class){
             CMRelease(objectpath);
             goto cleanup;
@@ -2407,7 +2488,7 @@ cim_create_indication_filter(CimClientInfo *client, WsSubscribeInfo *subsInfo, W
 		CMAddKey(objectpath, "SourceNamespace",
 				indicationns, CMPI_chars);
 	instance = newCMPIInstance(objectpath, NULL);
-	objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc);
+	CIMOM_CALL(objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc));
 cleanup:
 	/* Print the results */
 	debug("create CIM_IndicationFilter() rc=%d, msg=%s",
@@ -2472,7 +2553,7 @@ cim_create_indication_handler(CimClientInfo *client, WsSubscribeInfo *subsInfo,
 			&value, CMPI_uint16);
 
 
-	objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc);
+	CIMOM_CALL(objectpath_r = cc->ft->createInstance(cc, objectpath, instance, &rc));
 cleanup:
 	/* Print the results */
 	debug("create CIM_IndicationHandlerCIMXML() rc=%d, msg=%s",
@@ -2537,7 +2618,7 @@ cim_create_indication_subscription(CimClientInfo * client, WsSubscribeInfo *subs
 	value.uint16 = 2;
         CMSetProperty(instance, "RepeatNotificationPolicy",
 			&value, CMPI_uint16);
-	instance_r = cc->ft->createInstance(cc, objectpath, instance, &rc);
+	CIMOM_CALL(instance_r = cc->ft->createInstance(cc, objectpath, instance, &rc));
 
 	/* Print the results */
 	debug("create CIM_IndicationSubscription() rc=%d, msg=%s",
@@ -2594,7 +2675,7 @@ cim_update_indication_subscription(CimClientInfo *client, WsSubscribeInfo *subsI
 	instance = newCMPIInstance(objectpath, NULL);
 	CMSetProperty(instance, "subscriptionDuration", &value, CMPI_uint64);
 	char *properties[] = {"subscriptionDuration",NULL};
-	cc->ft->setInstance(cc, objectpath, instance, 0, properties);
+	CIMOM_CALL(cc->ft->setInstance(cc, objectpath, instance, 0, properties));
 cleanup:
 	if (rc.rc == CMPI_RC_ERR_FAILED) {
 		status->fault_code = WSA_ACTION_NOT_SUPPORTED;
@@ -2647,15 +2728,15 @@ cim_delete_indication_subscription(CimClientInfo *client, WsSubscribeInfo *subsI
 	value.ref = objectpath_handler;
 	CMAddKey(objectpath_subscription, "Handler",
 			&value, CMPI_ref);
-	rc = cc->ft->deleteInstance(cc, objectpath_subscription);
+	CIMOM_CALL(rc = cc->ft->deleteInstance(cc, objectpath_subscription));
 	if(rc.rc)
 		goto cleanup;
 	if(!(subsInfo->flags & WSMAN_SUBSCRIPTION_SELECTORSET)) {
-		rc = cc->ft->deleteInstance(cc, objectpath_filter);
+		CIMOM_CALL(rc = cc->ft->deleteInstance(cc, objectpath_filter));
 		if(rc.rc)
 			goto cleanup;
 	}
-	rc = cc->ft->deleteInstance(cc, objectpath_handler);
+	CIMOM_CALL(rc = cc->ft->deleteInstance(cc, objectpath_handler));
 
 cleanup:
 	if (rc.rc == CMPI_RC_ERR_FAILED) {
@@ -2784,7 +2865,7 @@ cim_enum_instancenames(CimClientInfo * client,
 	objectpath =
 		newCMPIObjectPath(client->cim_namespace, class_name, NULL);
 
-	enumeration = cc->ft->enumInstanceNames(cc, objectpath, &rc);
+	CIMOM_CALL(enumeration = cc->ft->enumInstanceNames(cc, objectpath, &rc));
 	debug("enumInstanceNames() rc=%d, msg=%s",
 			rc.rc, (rc.msg) ? CMGetCharPtr(rc.msg) : NULL);
 
@@ -2912,3 +2993,46 @@ cim_get_enum_items(CimClientInfo * client,
 	}
 	enumInfo->pullResultPtr = outdoc;
 }
+
+/*
+ * Like cim_get_enum_items() but every item is handed to the pull
+ * writer as soon as it is built, so only one item is held in memory.
+ */
+void
+cim_stream_enum_items(CimClientInfo * client,
+		WsPullWriterH writer,
+		WsEnumerateInfo * enumInfo)
+{
+	WsXmlDocH itemsdoc;
+	WsXmlNodeH itemsNode, item;
+	int c;
+
+	debug("Total items: %d", enumInfo->totalItems);
+	debug("enum flags: %lu", enumInfo->flags );
+
+	itemsdoc = ws_xml_create_doc(XML_NS_ENUMERATION, WSENUM_ITEMS);
+	if (itemsdoc == NULL)
+		return;
+	itemsNode = ws_xml_get_doc_root(itemsdoc);
+
+	while (enumInfo->index < enumInfo->totalItems &&
+			!wsman_pull_writer_is_full(writer)) {
+		if (enumInfo->flags & WSMAN_ENUMINFO_EPR ) {
+			c = cim_getEprAt(client, enumInfo, itemsNode);
+		} else if (enumInfo->flags & WSMAN_ENUMINFO_OBJEPR) {
+			c = cim_getEprObjAt(client, enumInfo, itemsNode);
+		} else {
+			c = cim_getElementAt(client, enumInfo, itemsNode);
+		}
+		if (!c) {
+			/* cim_getE... failed */
+			break;
+		}
+		item = xml_parser_node_get(itemsNode, XML_LAST_CHILD);
+		/* an item which does not fit is built again by the next pull */
+		if (wsman_pull_writer_add_item(writer, item) != 0)
+			break;
+		xml_parser_node_remove(item);
+	}
+	ws_xml_destroy_doc(itemsdoc);
+}
@@ -105,6 +105,9 @@ void cim_get_enum_items(CimClientInfo * client, WsContextH cntx,
 			WsXmlNodeH node, WsEnumerateInfo * enumInfo,
 			char *namespace, int maxelements, unsigned long maxsize);
 
+void cim_stream_enum_items(CimClientInfo * client, WsPullWriterH writer,
+			WsEnumerateInfo * enumInfo);
+
 void cim_add_epr(CimClientInfo * client, WsXmlNodeH resource,
 		 char *resourceUri, CMPIObjectPath * objectpath);
 
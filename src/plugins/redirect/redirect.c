@@ -11,6 +11,7 @@
 #include "stdio.h"
 #include "string.h"
 #include "ctype.h"
+#include <pthread.h>
 
 #include "u/libu.h"
 
@@ -36,11 +37,40 @@ struct __Redirect_Data
     char *namespace;
     int noverifypeer, noverifyhost;
     int server_port;
+    int connections, idle_timeout, passthrough;
 
 };
 
 static struct __Redirect_Data *redirect_data =NULL;
 
+/*
+ * Clients to the upstream server are kept open between requests, one
+ * pool for each server, port and credentials forwarded. At most
+ * connections clients of a pool are in use at a time, further requests
+ * wait for one of them. Clients unused for idle_timeout seconds are
+ * closed.
+ *
+ * wsmand serves requests on a single thread, which blocks while a
+ * request is forwarded, so a pool has one client in use at most and
+ * connections only bounds the idle clients kept. Requests to the
+ * upstream server are not run in parallel.
+ */
+struct __Redirect_Upstream
+{
+    char *key;
+    RedirectClient **idle;
+    int idle_count;
+    int clients;        /* idle and in use */
+    pthread_cond_t cond;
+};
+typedef struct __Redirect_Upstream RedirectUpstream;
+
+static hash_t *upstreams = NULL;
+static pthread_mutex_t upstreams_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t upstreams_purged;
+
+static void purge_upstreams(int idle_timeout);
+
 SER_START_ITEMS(Redirect)
 SER_END_ITEMS(Redirect);
 
@@ -144,6 +174,15 @@ int init( void *self, void **data )
 void
 cleanup( void  *self, void *data )
 {
+    if (upstreams) {
+	pthread_mutex_lock(&upstreams_lock);
+	purge_upstreams(0);
+	pthread_mutex_unlock(&upstreams_lock);
+	if (hash_isempty(upstreams)) {
+	    hash_destroy(upstreams);
+	    upstreams = NULL;
+	}
+    }
     free(redirect_data);
     return;
 }
@@ -173,6 +212,11 @@ void set_config( void *self, dictionary *config )
 	redirect_data->noverifyhost = iniparser_getint (inc_ini, ":noverifyhost", 0);
 	redirect_data->sslkey = iniparser_getstring (inc_ini, ":sslkey", NULL);
 	redirect_data->cl_cert = iniparser_getstring (inc_ini, ":cl_cert", NULL);		
+	redirect_data->connections = iniparser_getint (inc_ini, ":connections", 4);
+	redirect_data->idle_timeout = iniparser_getint (inc_ini, ":idle_timeout", 60);
+	redirect_data->passthrough = iniparser_getboolean (inc_ini, ":passthrough", 1);
+	if (redirect_data->connections < 1)
+	    redirect_data->connections = 1;
     return;
     }
 
@@ -193,6 +237,11 @@ void set_config( void *self, dictionary *config )
     redirect_data->noverifyhost = iniparser_getint (config, "redirect:noverifyhost", 0);
     redirect_data->sslkey = iniparser_getstring (config, "redirect:sslkey", NULL);
     redirect_data->cl_cert = iniparser_getstring (config, "redirect:cl_cert", NULL);		
+    redirect_data->connections = iniparser_getint (config, "redirect:connections", 4);
+    redirect_data->idle_timeout = iniparser_getint (config, "redirect:idle_timeout", 60);
+    redirect_data->passthrough = iniparser_getboolean (config, "redirect:passthrough", 1);
+    if (redirect_data->connections < 1)
+	redirect_data->connections = 1;
 
 	
 }
@@ -261,6 +310,11 @@ static int get_remote_server_port()
 	return redirect_data->server_port;
 }
 
+int redirect_get_passthrough()
+{
+	return redirect_data->passthrough;
+}
+
 
 WsManClient* setup_redirect_client(WsContextH cntx, char *ws_username, char *ws_password)
 {
@@ -315,3 +369,144 @@ WsManClient* setup_redirect_client(WsContextH cntx, char *ws_username, char *ws_
     return cl; 
 }
 
+
+
+/*
+ * Close the clients idle for longer than idle_timeout seconds, all of
+ * them with 0, and forget the pools without clients. Called with
+ * upstreams_lock held.
+ */
+static void purge_upstreams(int idle_timeout)
+{
+    time_t now = time(NULL);
+    hscan_t hs;
+    hnode_t *hn;
+    RedirectUpstream *up;
+    int i, kept;
+
+    upstreams_purged = now;
+    hash_scan_begin(&hs, upstreams);
+    while ((hn = hash_scan_next(&hs))) {
+	up = (RedirectUpstream *) hnode_get(hn);
+	for (i = 0, kept = 0; i < up->idle_count; i++) {
+	    if (idle_timeout && now - up->idle[i]->used < idle_timeout) {
+		up->idle[kept++] = up->idle[i];
+		continue;
+	    }
+	    wsmc_release(up->idle[i]->cl);
+	    u_free(up->idle[i]);
+	    up->clients--;
+	}
+	up->idle_count = kept;
+	if (up->clients == 0) {
+	    hash_scan_delfree(upstreams, hn);
+	    pthread_cond_destroy(&up->cond);
+	    u_free(up->idle);
+	    u_free(up->key);
+	    u_free(up);
+	}
+    }
+}
+
+/*
+ * Take a client to the upstream server for the credentials of a
+ * request, out of the pool if one is idle.
+ * @return NULL if no client could be created
+ */
+RedirectClient* redirect_client_get(char *ws_username, char *ws_password)
+{
+    char *username = get_remote_username() ? get_remote_username() : ws_username;
+    char *password = get_remote_password() ? get_remote_password() : ws_password;
+    RedirectUpstream *up = NULL;
+    RedirectClient *rc = NULL;
+    WsManClient *cl;
+    hnode_t *hn;
+    char *key;
+
+    /* with the length of the username, ':' in the credentials is no issue */
+    key = u_strdup_printf("%s:%d:%d:%s:%s", get_remote_server(),
+			  get_remote_server_port(),
+			  username ? (int) strlen(username) : 0,
+			  username ? username : "", password ? password : "");
+    if (key == NULL)
+	return NULL;
+
+    pthread_mutex_lock(&upstreams_lock);
+    if (upstreams == NULL)
+	upstreams = hash_create(HASHCOUNT_T_MAX, 0, 0);
+    if (upstreams == NULL)
+	goto err;
+    if (redirect_data->idle_timeout > 0 &&
+	time(NULL) - upstreams_purged >= redirect_data->idle_timeout)
+	purge_upstreams(redirect_data->idle_timeout);
+
+    if ((hn = hash_lookup(upstreams, key)) != NULL) {
+	up = (RedirectUpstream *) hnode_get(hn);
+	u_free(key);
+	key = NULL;
+    } else {
+	up = u_zalloc(sizeof(RedirectUpstream));
+	if (up == NULL)
+	    goto err;
+	up->idle = u_zalloc(redirect_data->connections * sizeof(RedirectClient *));
+	if (up->idle == NULL || !hash_alloc_insert(upstreams, key, up)) {
+	    u_free(up->idle);
+	    u_free(up);
+	    goto err;
+	}
+	up->key = key;
+	key = NULL;
+	pthread_cond_init(&up->cond, NULL);
+    }
+
+    while (up->idle_count == 0 && up->clients >= redirect_data->connections)
+	pthread_cond_wait(&up->cond, &upstreams_lock);
+    if (up->idle_count > 0) {
+	rc = up->idle[--up->idle_count];
+	pthread_mutex_unlock(&upstreams_lock);
+	return rc;
+    }
+
+    /* the pool is not purged while it has clients */
+    up->clients++;
+    pthread_mutex_unlock(&upstreams_lock);
+    cl = setup_redirect_client(NULL, username, password);
+    if (cl && (rc = u_zalloc(sizeof(RedirectClient))) != NULL) {
+	rc->cl = cl;
+	rc->upstream = up;
+	return rc;
+    }
+    if (cl)
+	wsmc_release(cl);
+    pthread_mutex_lock(&upstreams_lock);
+    up->clients--;
+    pthread_cond_signal(&up->cond);
+err:
+    pthread_mutex_unlock(&upstreams_lock);
+    u_free(key);
+    return NULL;
+}
+
+/*
+ * Return a client to its pool. A client whose last request failed in
+ * the transport is closed instead.
+ */
+void redirect_client_put(RedirectClient *rc)
+{
+    RedirectUpstream *up = rc->upstream;
+    int keep = wsmc_get_last_error(rc->cl) == WS_LASTERR_OK;
+
+    pthread_mutex_lock(&upstreams_lock);
+    if (keep) {
+	rc->used = time(NULL);
+	up->idle[up->idle_count++] = rc;
+    } else {
+	up->clients--;
+    }
+    pthread_cond_signal(&up->cond);
+    pthread_mutex_unlock(&upstreams_lock);
+    if (!keep) {
+	wsmc_release(rc->cl);
+	u_free(rc);
+    }
+}
@@ -9,6 +9,8 @@
 #include "wsman-xml-serializer.h"
 #include "wsman-client-transport.h"
 
+#include <time.h>
+
 #define XML_REDIRECT_NS    "http://dummy.com/wbem/wscim/1/cim-schema/2"
 
 
@@ -18,6 +20,17 @@ struct  __RedirectResult
 };
 typedef struct __RedirectResult Redirect;
 
+struct __Redirect_Upstream;
+
+/* A persistent client of the upstream pool, see redirect_client_get() */
+struct __RedirectClient
+{
+	WsManClient *cl;
+	struct __Redirect_Upstream *upstream;
+	time_t used;
+};
+typedef struct __RedirectClient RedirectClient;
+
 // Service endpoint declaration
 int Redirect_Enumerate_EP(WsContextH cntx,
                         WsEnumerateInfo* enumInfo,
@@ -94,4 +107,8 @@ static char* get_remote_cl_cert();
 
 WsManClient* setup_redirect_client (WsContextH cntx, char *username, char *password);
 
+RedirectClient* redirect_client_get (char *username, char *password);
+void redirect_client_put (RedirectClient *rc);
+int redirect_get_passthrough (void);
+
 
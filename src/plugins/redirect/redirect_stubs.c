@@ -22,6 +22,7 @@
 #include "wsman-xml-serializer.h"
 
 #include <wsman-client-transport.h>
+#include <wsman-client.h>
 #include <wsman-debug.h>
 
 #include "wsman-soap-envelope.h"
@@ -37,42 +38,92 @@ char* redirect_fault_msg (char * last_error_string);
 //DEBUG
 static void xml_print( WsXmlDocH doc);
 
+/*
+ * Hand the upstream response to the listener as it was received, when
+ * the dispatcher would not change it: a 200 response whose Content-Type
+ * names the charset of the request, within its MaxEnvelopeSize and
+ * without FragmentTransfer.
+ * The buffers of the client and the message are swapped, not copied.
+ */
+static int redirect_passthrough( op_t *op, WsmanMessage *msg,
+		WsXmlDocH in_doc, WsManClient *cl)
+{
+    WsManConnection *con = cl->connection;
+    const char *charset;
+    u_buf_t *response;
+
+    if (!redirect_get_passthrough() || wsmc_get_response_code(cl) != 200 ||
+	u_buf_len(con->response) == 0)
+	    return 0;
+    /* the listener labels the response with the charset of the request */
+    charset = wsman_transport_get_response_charset(cl);
+    if (charset == NULL ||
+	strcasecmp(msg->charset ? msg->charset : "UTF-8", charset))
+	    return 0;
+    if (op->maxsize && u_buf_len(con->response) > op->maxsize)
+	    return 0;
+    if (ws_xml_get_child(ws_xml_get_soap_header(in_doc), 0,
+			    XML_NS_WS_MAN, WSM_FRAGMENT_TRANSFER))
+	    return 0;
+
+    debug("Redirect Plugin: passing on %d bytes", u_buf_len(con->response));
+    response = msg->response;
+    msg->response = con->response;
+    con->response = response;
+    msg->http_code = WSMAN_STATUS_OK;
+    op->streamed = 1;
+    return 1;
+}
+
 int Redirect_transfer_action ( SoapOpH op,
                 void* appData,
                 void *opaqueData)
 {
     //Same function to be called for Get, Put, Create, Delete Actions
     WsmanMessage *msg = wsman_get_msg_from_op(op);
-    SoapH soap = soap_get_op_soap(op);
     WsXmlDocH in_doc = soap_get_op_doc(op, 1);	
-    WsContextH cntx = ws_create_ep_context(soap, in_doc);
-    WsManClient *cl=NULL;
+    RedirectClient *rc=NULL;
     WsXmlDocH response=NULL;
 
 
+    rc = redirect_client_get(msg->auth_data.username, msg->auth_data.password );
+    if (rc == NULL){
+	soap_set_op_doc(op,
+	    wsman_generate_fault(in_doc, WSMAN_INTERNAL_ERROR, 0, NULL),
+	    0);
+	return 1;
+    }
 
-    debug ("Test Get Endpoint Called"); 
-    cl = setup_redirect_client(cntx, msg->auth_data.username, msg->auth_data.password );
-
-    wsman_send_request(cl,cntx->indoc);
+    /* a response passed on as it is needs no document */
+    wsman_transport_set_response_parsing(rc->cl, !redirect_get_passthrough());
+    wsman_send_request(rc->cl, in_doc);
 
 
-    if (wsmc_get_last_error(cl) != WS_LASTERR_OK ){
+    if (wsmc_get_last_error(rc->cl) != WS_LASTERR_OK ){
 	//CURL/ HTTP errors	
 	soap_set_op_doc(op, 
-	    redirect_generate_fault( cntx->indoc , cl), 
+	    redirect_generate_fault( in_doc , rc->cl), 
 	    0);
-
-	    return 1;
+	redirect_client_put(rc);
+	return 1;
     }
 
+    if (redirect_passthrough((op_t *) op, msg, in_doc, rc->cl)) {
+	redirect_client_put(rc);
+	return 0;
+    }
 
-    response = wsmc_build_envelope_from_response(cl);
-  
-    soap_set_op_doc(op, 
-		ws_xml_duplicate_doc(response), 0);
+    response = wsmc_build_envelope_from_response(rc->cl);
+    redirect_client_put(rc);
+    if (response == NULL) {
+	soap_set_op_doc(op,
+	    wsman_generate_fault(in_doc, WSMAN_INTERNAL_ERROR, 0, NULL),
+	    0);
+	return 1;
+    }
 
-    wsmc_release(cl);
+    /* the response is ours, no need to copy it */
+    soap_set_op_doc(op, response, 0);
 
     return 0;
 }
@@ -115,6 +166,36 @@ int Redirect_Put_EP( SoapOpH op,
 }
 
 
+/*
+ * Forward the request of an enumeration with a pooled client, the
+ * response is parsed as the stubs need its document.
+ * @return NULL with status set on CURL or HTTP errors
+ */
+static RedirectClient* redirect_enum_send(WsContextH cntx,
+		WsEnumerateInfo* enumInfo, WsmanStatus *status)
+{
+    RedirectClient *rc;
+
+    rc = redirect_client_get(enumInfo->auth_data.username, enumInfo->auth_data.password);
+    if (rc == NULL){
+	status->fault_code = WSMAN_INTERNAL_ERROR;
+	status->fault_detail_code = 0;
+	return NULL;
+    }
+    wsman_transport_set_response_parsing(rc->cl, 1);
+    wsman_send_request(rc->cl, cntx->indoc);
+
+    if (wsmc_get_last_error(rc->cl) != WS_LASTERR_OK ){
+	status->fault_code = WSMAN_INTERNAL_ERROR;
+	status->fault_detail_code = 0;
+	status->fault_msg = redirect_fault_msg( wsman_transport_get_last_error_string(  wsmc_get_last_error(rc->cl) )  );
+	redirect_client_put(rc);
+	return NULL;
+    }
+    return rc;
+}
+
+
 int Redirect_Enumerate_EP(WsContextH cntx, 
 			WsEnumerateInfo* enumInfo,
 			WsmanStatus *status, void *opaqueData)
@@ -123,8 +204,7 @@ int Redirect_Enumerate_EP(WsContextH cntx,
     WsXmlNodeH r_header=NULL, r_node=NULL, r_body=NULL, r_opt=NULL;
     WsXmlDocH r_response=NULL;
     char *resource_uri, *remote_enumContext=NULL;
-    int op; 
-    WsManClient *cl=NULL;
+    RedirectClient *rc=NULL;
 
 
     //The redirected Enumeration request must have RequestTotalItemsCountEstimate enabled
@@ -134,9 +214,6 @@ int Redirect_Enumerate_EP(WsContextH cntx,
 	    ws_xml_add_child(r_header, XML_NS_WS_MAN, WSM_REQUEST_TOTAL, NULL);     
 
 
-    cl = setup_redirect_client(cntx,  enumInfo->auth_data.username, enumInfo->auth_data.password);
-
-
     //Set the enumInfo flags based on the indoc. This is required while handling the response in wsenum_eunmerate_stub
     r_body=ws_xml_get_soap_body(cntx->indoc);
     if ( ( r_node = ws_xml_get_child(r_body ,0, XML_NS_ENUMERATION, WSENUM_ENUMERATE )) != NULL )
@@ -147,26 +224,26 @@ int Redirect_Enumerate_EP(WsContextH cntx,
     }
 
 
-    wsman_send_request(cl,cntx->indoc);
-
-    if (wsmc_get_last_error(cl) != WS_LASTERR_OK ){
+    if ( (rc = redirect_enum_send(cntx, enumInfo, status)) == NULL ){
 	//CURL or HTTP errors
 	enumInfo->pullResultPtr = NULL;
-	status->fault_code = WSMAN_INTERNAL_ERROR;
-	status->fault_detail_code = 0;
-	status->fault_msg = redirect_fault_msg( wsman_transport_get_last_error_string(  wsmc_get_last_error(cl) )  );
-            return 1;
+	return 1;
     }
 
+    r_response = wsmc_build_envelope_from_response(rc->cl);
+    redirect_client_put(rc);
 
-
-
-    r_response = wsmc_build_envelope_from_response(cl);
-
+    if (r_response == NULL){
+	enumInfo->pullResultPtr = NULL;
+	status->fault_code = WSMAN_INTERNAL_ERROR;
+	status->fault_detail_code = 0;
+	return 1;
+    }
  
     if (  wsman_is_fault_envelope(r_response)){
         enumInfo->pullResultPtr = NULL;
         wsman_get_fault_status_from_doc(r_response, status);
+	ws_xml_destroy_doc(r_response);
 	return 1;
     }
  
@@ -208,7 +285,6 @@ int Redirect_Enumerate_EP(WsContextH cntx,
 	
     }
     
-    wsmc_release(cl);
     if (remote_enumContext != NULL)
 	free(remote_enumContext);
     
@@ -223,51 +299,51 @@ int Redirect_Release_EP(WsContextH cntx,
 {
 
 
-    WsManClient *cl=NULL;
+    RedirectClient *rc=NULL;
     WsXmlDocH response=NULL;
+    int retVal;
 
 
-    cl = setup_redirect_client(cntx,  enumInfo->auth_data.username, enumInfo->auth_data.password);
-    
-    wsman_send_request(cl,cntx->indoc);
-    if (wsmc_get_last_error(cl) != WS_LASTERR_OK ){
+    if ( (rc = redirect_enum_send(cntx, enumInfo, status)) == NULL ){
 	//just return for now, as the release_stub is not handling the status codes.			
 	return 1;
     }	
 
-    response=wsmc_build_envelope_from_response(cl);
+    response=wsmc_build_envelope_from_response(rc->cl);
+    redirect_client_put(rc);
+    if (response == NULL)
+	return 1;
 
     //The status value is not used in the release stub. So, just return, if fault or not.
-    return wsman_is_fault_envelope(response);
+    retVal = wsman_is_fault_envelope(response);
+    ws_xml_destroy_doc(response);
+    return retVal;
 }
 
 int Redirect_Pull_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
 			WsmanStatus *status, void *opaqueData)
 {
-    WsXmlDocH doc=NULL,response=NULL;
-    WsManClient *cl=NULL;
+    WsXmlDocH response=NULL;
+    RedirectClient *rc=NULL;
     int retVal=0;
 
 
+    if ( (rc = redirect_enum_send(cntx, enumInfo, status)) == NULL ){
+        //CURL or HTTP errors
+        enumInfo->pullResultPtr = NULL;
+        return 1;
+    }
 
 
-    cl = setup_redirect_client( cntx, enumInfo->auth_data.username, enumInfo->auth_data.password);
-
-
-    wsman_send_request(cl,cntx->indoc);
+    response = wsmc_build_envelope_from_response(rc->cl);
+    redirect_client_put(rc);
 
-    if (wsmc_get_last_error(cl) != WS_LASTERR_OK ){
-        //CURL or HTTP errors
+    if (response == NULL){
         enumInfo->pullResultPtr = NULL;
         status->fault_code = WSMAN_INTERNAL_ERROR;
         status->fault_detail_code = 0;
-        status->fault_msg = redirect_fault_msg( wsman_transport_get_last_error_string(  wsmc_get_last_error(cl) )  );
-            return 1;
+        return 1;
     }
-
-
-    response = wsmc_build_envelope_from_response(cl);
-
    
     if ( ! wsman_is_fault_envelope(response) )
 	    enumInfo->pullResultPtr = response;
@@ -276,11 +352,10 @@ int Redirect_Pull_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
 	    //If there a fault, return the status code.
 	    enumInfo->pullResultPtr = NULL;
 	    wsman_get_fault_status_from_doc (response, status);
+	    ws_xml_destroy_doc(response);
 	    retVal=1;
     }
 
-    wsmc_release(cl);
-
     return retVal;
 }
 
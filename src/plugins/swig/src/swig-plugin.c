@@ -170,6 +170,41 @@ static pthread_mutex_t _PLUGIN_INIT_MUTEX = PTHREAD_MUTEX_INITIALIZER;  /* mutex
 static Target_Type _TARGET_MODULE = Target_Null;  /* The target module (aka namespace) */
 
 
+/*
+ * The operations a plugin implements. TargetCall() is passed one of
+ * these, so the targets can resolve the functions once at init instead
+ * of looking them up by name on every request.
+ */
+
+typedef enum {
+    TARGET_OP_IDENTIFY = 0,
+    TARGET_OP_ENUMERATE,
+    TARGET_OP_RELEASE,
+    TARGET_OP_PULL,
+    TARGET_OP_GET,
+    TARGET_OP_CUSTOM,
+    TARGET_OP_PUT,
+    TARGET_OP_CREATE,
+    TARGET_OP_DELETE,
+    TARGET_OP_MAX
+} TargetOp;
+
+static const char *_TARGET_OPS[TARGET_OP_MAX] = {
+    "identify",
+    "enumerate",
+    "release",
+    "pull",
+    "get",
+    "custom",
+    "put",
+    "create",
+    "delete"
+};
+
+/* most arguments an operation is passed */
+#define TARGET_MAX_ARGS 3
+
+
 #if defined(SWIGPYTHON)
 #include "target_python.c"
 #endif
@@ -182,6 +217,18 @@ static Target_Type _TARGET_MODULE = Target_Null;  /* The target module (aka name
 #include "target_perl.c"
 #endif
 
+/*
+ * TARGET_CALL_BEGIN/TARGET_CALL_END enclose the creation of the
+ * arguments and the TargetCall(). A target running plugins in more
+ * than one interpreter defines them to enter the interpreter of the
+ * calling thread.
+ */
+
+#ifndef TARGET_CALL_BEGIN
+#define TARGET_CALL_BEGIN TARGET_THREAD_BEGIN_BLOCK
+#define TARGET_CALL_END TARGET_THREAD_END_BLOCK
+#endif
+
 struct __Swig
 {
         char* xml;
@@ -199,10 +246,10 @@ Swig_Identify_EP( WsContextH cntx )
 {
     int rc;
     Target_Type _context;
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _context = SWIG_NewPointerObj((void*) cntx, SWIGTYPE_p__WS_CONTEXT, OWN);
-    rc = TargetCall(cntx->indoc, _TARGET_MODULE, "identify", 1, _context); 
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(cntx->indoc, TARGET_OP_IDENTIFY, 1, _context); 
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -214,14 +261,14 @@ Swig_Enumerate_EP( WsContextH cntx, WsEnumerateInfo* enumInfo,
     Target_Type _context, _enumInfo;
     Target_Type _status;
     int rc;
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     debug("Swig_Enumerate_EP(cntx %p, enumInfo %p, status %p, opaqueData %p", cntx, enumInfo, status, opaqueData);
     debug("enumInfo.epr_to %s, epr_uri %s", enumInfo->epr_to, enumInfo->epr_uri);
     _context = SWIG_NewPointerObj((void*) cntx, SWIGTYPE_p__WS_CONTEXT, OWN);
     _enumInfo = SWIG_NewPointerObj((void*) enumInfo, SWIGTYPE_p___WsEnumerateInfo, OWN);
     _status = SWIG_NewPointerObj((void*) status, SWIGTYPE_p__WsmanStatus, OWN);
-    rc = TargetCall(cntx->indoc, _TARGET_MODULE, "enumerate", 3, _context, _enumInfo, _status );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(cntx->indoc, TARGET_OP_ENUMERATE, 3, _context, _enumInfo, _status );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -235,12 +282,12 @@ Swig_Release_EP( WsContextH cntx, WsEnumerateInfo* enumInfo,
     Target_Type _enumInfo;
     Target_Type _status;
     int rc;
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _context = SWIG_NewPointerObj((void*) cntx, SWIGTYPE_p__WS_CONTEXT, OWN);
     _enumInfo = SWIG_NewPointerObj((void*) enumInfo, SWIGTYPE_p___WsEnumerateInfo, OWN);
     _status = SWIG_NewPointerObj((void*) status, SWIGTYPE_p__WsmanStatus, OWN);
-    rc = TargetCall(cntx->indoc, _TARGET_MODULE, "release", 3, _context, _enumInfo, _status );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(cntx->indoc, TARGET_OP_RELEASE, 3, _context, _enumInfo, _status );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -254,12 +301,12 @@ Swig_Pull_EP( WsContextH cntx, WsEnumerateInfo* enumInfo,
     Target_Type _enumInfo;
     Target_Type _status;
     int rc;
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _context = SWIG_NewPointerObj((void*) cntx, SWIGTYPE_p__WS_CONTEXT, OWN);
     _enumInfo = SWIG_NewPointerObj((void*) enumInfo, SWIGTYPE_p___WsEnumerateInfo, OWN);
     _status = SWIG_NewPointerObj((void*) status, SWIGTYPE_p__WsmanStatus, OWN);
-    rc = TargetCall(cntx->indoc, _TARGET_MODULE, "pull", 3, _context, _enumInfo, _status );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(cntx->indoc, TARGET_OP_PULL, 3, _context, _enumInfo, _status );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -270,11 +317,11 @@ Swig_Get_EP( SoapOpH op, void* appData, void *opaqueData )
     Target_Type _op;
     int rc;
     WsXmlDocH in_doc = soap_get_op_doc( op, 1 );
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _op = SWIG_NewPointerObj((void*) op, SWIGTYPE_p___SoapOp, OWN);
   
-    rc = TargetCall(in_doc, _TARGET_MODULE, "get", 1, _op );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(in_doc, TARGET_OP_GET, 1, _op );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -285,10 +332,10 @@ Swig_Custom_EP( SoapOpH op, void* appData, void *opaqueData )
     Target_Type _op;
     int rc;
     WsXmlDocH in_doc = soap_get_op_doc( op, 1 );
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _op = SWIG_NewPointerObj((void*) op, SWIGTYPE_p___SoapOp, OWN);
-    rc = TargetCall(in_doc, _TARGET_MODULE, "custom", 1, _op );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(in_doc, TARGET_OP_CUSTOM, 1, _op );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -299,10 +346,10 @@ Swig_Put_EP( SoapOpH op, void* appData, void *opaqueData )
     Target_Type _op;
     int rc;
     WsXmlDocH in_doc = soap_get_op_doc( op, 1 );
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _op = SWIG_NewPointerObj((void*) op, SWIGTYPE_p___SoapOp, OWN);
-    rc = TargetCall(in_doc, _TARGET_MODULE, "put", 1, _op );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(in_doc, TARGET_OP_PUT, 1, _op );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -313,10 +360,10 @@ Swig_Create_EP( SoapOpH op, void* appData, void *opaqueData )
     Target_Type _op;
     int rc;
     WsXmlDocH in_doc = soap_get_op_doc( op, 1 );
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _op = SWIG_NewPointerObj((void*) op, SWIGTYPE_p___SoapOp, OWN);
-    rc = TargetCall(in_doc, _TARGET_MODULE, "create", 1, _op );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(in_doc, TARGET_OP_CREATE, 1, _op );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -328,10 +375,10 @@ Swig_Delete_EP( SoapOpH op, void* appData, void *opaqueData )
     Target_Type _op;
     int rc;
     WsXmlDocH in_doc = soap_get_op_doc( op, 1 );
-    TARGET_THREAD_BEGIN_BLOCK; 
+    TARGET_CALL_BEGIN;
     _op = SWIG_NewPointerObj((void*) op, SWIGTYPE_p___SoapOp, OWN);
-    rc = TargetCall(in_doc, _TARGET_MODULE, "delete", 1, _op );
-    TARGET_THREAD_END_BLOCK;
+    rc = TargetCall(in_doc, TARGET_OP_DELETE, 1, _op );
+    TARGET_CALL_END;
     return rc;
 }
 
@@ -452,6 +499,7 @@ get_endpoints(void *self, void *data_ifc)
 void
 set_config( void *self, dictionary *config )
 {
+    TargetConfigure( self, config );
     return;
 }
 
@@ -44,6 +44,44 @@
 
 static PyThreadState* pluginMainPyThreadState = NULL; 
 
+SWIGEXPORT void SWIG_init(void);
+
+/*
+ * An interpreter running PLUGIN_FILE, with the plugin functions
+ * resolved at init. NULL entries in callables are operations the
+ * plugin does not implement.
+ */
+
+typedef struct {
+    PyThreadState *tstate;   /* thread state Py_NewInterpreter() returned */
+    PyObject *module;
+    PyObject *callables[TARGET_OP_MAX];
+} PyTarget;
+
+/* the thread state of a worker thread in one of the sub-interpreters */
+typedef struct {
+    PyTarget *target;
+    PyThreadState *tstate;
+} PyThreadTarget;
+
+static PyTarget _PY_MAIN;                /* the main interpreter */
+static PyTarget *_PY_POOL = NULL;        /* sub-interpreters, see TargetConfigure */
+static int _PY_POOL_SIZE = 0;
+static unsigned int _PY_POOL_NEXT = 0;   /* round robin, under _PLUGIN_INIT_MUTEX */
+static pthread_key_t _PY_THREAD_KEY;
+
+/*
+ * With sub-interpreters each thread calls into the one it was given on
+ * its first call, so the PyGILState API (main interpreter only) can't
+ * be used around the call.
+ */
+
+static PyGILState_STATE PyTargetEnter(void);
+static void PyTargetLeave(PyGILState_STATE state);
+
+#define TARGET_CALL_BEGIN PyGILState_STATE _target_state = PyTargetEnter()
+#define TARGET_CALL_END PyTargetLeave(_target_state)
+
 /*
  * get Python exception trace -> char
  * 
@@ -167,7 +205,6 @@ PyGlobalInitialize()
   
   Py_SetProgramName(PLUGIN_FILE);
   Py_Initialize();
-  SWIGEXPORT void SWIG_init(void);
   SWIG_init();
   pluginMainPyThreadState = PyGILState_GetThisThreadState();
   PyEval_ReleaseThread(pluginMainPyThreadState); 
@@ -180,47 +217,137 @@ PyGlobalInitialize()
 /*---------------------------------------------------------------*/
 
 /*
- * TargetCall
+ * resolve the plugin functions of target->module
  * 
  * ** must be called while holding the threads lock **
  */
 
+static void
+PyTargetResolve(PyTarget *target)
+{
+    int op;
+
+    for (op = 0; op < TARGET_OP_MAX; op++)
+    {
+        PyObject *pyfunc = PyObject_GetAttrString(target->module, _TARGET_OPS[op]);
+        if (pyfunc == NULL)
+        {
+            PyErr_Clear(); 
+            debug("Python module does not contain \"%s\"", _TARGET_OPS[op]); 
+        }
+        else if (! PyCallable_Check(pyfunc))
+        {
+            debug("Python module attribute \"%s\" is not callable", _TARGET_OPS[op]); 
+            Py_DecRef(pyfunc);
+            pyfunc = NULL;
+        }
+        target->callables[op] = pyfunc;
+    }
+}
+
+
+static void
+PyTargetRelease(PyTarget *target)
+{
+    int op;
+
+    for (op = 0; op < TARGET_OP_MAX; op++)
+    {
+        Py_DecRef(target->callables[op]);
+        target->callables[op] = NULL;
+    }
+    Py_DecRef(target->module);
+    target->module = NULL;
+}
+
+
+static void
+PyThreadTargetFree(void *data)
+{
+    PyThreadTarget *t = (PyThreadTarget *)data;
+
+    if (_TARGET_INIT && _PY_POOL_SIZE > 0)
+    {
+        PyEval_AcquireThread(t->tstate);
+        PyThreadState_Clear(t->tstate);
+        PyThreadState_DeleteCurrent();
+    }
+    u_free(t);
+}
+
+
+/*
+ * the sub-interpreter of the calling thread, NULL without any
+ */
+
+static PyThreadTarget *
+PyThreadTargetGet(void)
+{
+    PyThreadTarget *t;
+
+    if (_PY_POOL_SIZE == 0)
+        return NULL;
+    t = (PyThreadTarget *)pthread_getspecific(_PY_THREAD_KEY);
+    if (t)
+        return t;
+
+    t = (PyThreadTarget *)u_zalloc(sizeof(PyThreadTarget));
+    pthread_mutex_lock(&_PLUGIN_INIT_MUTEX);
+    t->target = &_PY_POOL[_PY_POOL_NEXT++ % _PY_POOL_SIZE];
+    pthread_mutex_unlock(&_PLUGIN_INIT_MUTEX);
+    t->tstate = PyThreadState_New(t->target->tstate->interp);
+    pthread_setspecific(_PY_THREAD_KEY, t);
+    debug("<%d/0x%x> Python: using interpreter %d", getpid(), pthread_self(),
+          (int)(t->target - _PY_POOL));
+    return t;
+}
+
+
+static PyGILState_STATE
+PyTargetEnter(void)
+{
+    PyThreadTarget *t = PyThreadTargetGet();
+
+    if (t == NULL)
+        return PyGILState_Ensure();
+    PyEval_AcquireThread(t->tstate);
+    return PyGILState_LOCKED;
+}
+
+
+static void
+PyTargetLeave(PyGILState_STATE state)
+{
+    PyThreadTarget *t = PyThreadTargetGet();
+
+    if (t == NULL)
+        PyGILState_Release(state);
+    else
+        PyEval_ReleaseThread(t->tstate);
+}
+
+
+/*
+ * TargetCall
+ * 
+ * ** must be called within TARGET_CALL_BEGIN/TARGET_CALL_END **
+ */
+
 static int 
-TargetCall(WsXmlDocH doc, PyObject* instance, 
-                 const char* opname, int nargs, ...)
+TargetCall(WsXmlDocH doc, TargetOp op, int nargs, ...)
 {
     va_list vargs; 
+    const char *opname = _TARGET_OPS[op];
+    PyThreadTarget *t = PyThreadTargetGet();
+    PyTarget *target = t ? t->target : &_PY_MAIN;
     PyObject *pyargs = NULL; 
-    PyObject *pyfunc = NULL; 
+    PyObject *pyfunc = target->callables[op]; 
     PyObject *result = NULL; 
     WsmanStatus status;
     wsman_status_init(&status);
 
+    /* the tuple owns the arguments from here on */
     pyargs = PyTuple_New(nargs); 
-    pyfunc = PyObject_GetAttrString(instance, opname); 
-    if (pyfunc == NULL)
-    {
-        PyErr_Print(); 
-        PyErr_Clear(); 
-        char* str = fmtstr("Python module does not contain \"%s\"", opname); 
-        debug("%s", str); 
-	status.fault_code = WSA_ENDPOINT_UNAVAILABLE;
-	status.fault_detail_code = 0;
-
-        free(str); 
-        goto cleanup; 
-    }
-    if (! PyCallable_Check(pyfunc))
-    {
-        char* str = fmtstr("Python module attribute \"%s\" is not callable", 
-                opname); 
-        debug("%s", str); 
-	status.fault_code = WSA_ENDPOINT_UNAVAILABLE;
-	status.fault_detail_code = 0;
-        free(str); 
-        goto cleanup; 
-    }
-    
     va_start(vargs, nargs); 
     int i; 
     for (i = 0; i < nargs; ++i)
@@ -234,6 +361,14 @@ TargetCall(WsXmlDocH doc, PyObject* instance,
         PyTuple_SET_ITEM(pyargs, i, arg); 
     }
     va_end(vargs); 
+
+    if (pyfunc == NULL)
+    {
+        debug("Python module does not implement \"%s\"", opname); 
+	status.fault_code = WSA_ENDPOINT_UNAVAILABLE;
+	status.fault_detail_code = 0;
+        goto cleanup; 
+    }
     result = PyObject_CallObject(pyfunc, pyargs);
     if (PyErr_Occurred())
     {
@@ -283,7 +418,6 @@ cleanup:
     if (status.fault_code != WSMAN_RC_OK)
       wsman_generate_fault( doc, status.fault_code, status.fault_detail_code, status.fault_msg );
     Py_DecRef(pyargs);
-    Py_DecRef(pyfunc);
     Py_DecRef(result);
  
     return status.fault_code != WSMAN_RC_OK; 
@@ -345,6 +479,9 @@ TargetInitialize(void *self, void **data)
       return -1; 
     }
     *data = _TARGET_MODULE;
+    Py_IncRef(_TARGET_MODULE);
+    _PY_MAIN.module = _TARGET_MODULE;
+    PyTargetResolve(&_PY_MAIN);
   }
   pthread_mutex_unlock(&_PLUGIN_INIT_MUTEX);
   debug("<%d/0x%x> Python: _TARGET_MODULE at %p", getpid(), pthread_self(), _TARGET_MODULE);
@@ -356,6 +493,116 @@ TargetInitialize(void *self, void **data)
 }
 
 
+/*
+ * TargetConfigure
+ * 
+ * [swig]
+ * python_interpreters = <n>
+ * 
+ * starts n sub-interpreters, each importing PLUGIN_FILE on its own.
+ * Worker threads are spread over them round robin, a thread keeps its
+ * interpreter. Without (or with n = 0) all calls run in the main
+ * interpreter.
+ *
+ * The sub-interpreters share the GIL with the main interpreter. A GIL
+ * per interpreter needs Python 3.12 and extension modules with
+ * multi-phase init, which the SWIG module (SWIG_init) is not.
+ */
+
+static void
+TargetConfigure(void *self, dictionary *config)
+{
+    int i, n;
+    PyThreadState *main_tstate;
+    PyGILState_STATE gstate;
+
+    n = config ? iniparser_getint(config, "swig:python_interpreters", 0) : 0;
+    if (n <= 0 || _PY_POOL_SIZE > 0 || _TARGET_MODULE == NULL)
+        return;
+    if (pthread_key_create(&_PY_THREAD_KEY, PyThreadTargetFree))
+    {
+        error("Python: can't create thread key, using the main interpreter");
+        return;
+    }
+
+    _PY_POOL = (PyTarget *)u_zalloc(n * sizeof(PyTarget));
+    gstate = PyGILState_Ensure();
+    main_tstate = PyThreadState_Get();
+    for (i = 0; i < n; i++)
+    {
+        PyTarget *target = &_PY_POOL[i];
+
+        target->tstate = Py_NewInterpreter();
+        if (target->tstate == NULL)
+        {
+            error("Python: can't create sub-interpreter %d", i);
+            break;
+        }
+        SWIG_init();
+        target->module = PyImport_ImportModule(PLUGIN_FILE);
+        if (target->module == NULL)
+        {
+            error("Python: import %s failed in sub-interpreter %d", PLUGIN_FILE, i);
+            PyErr_Print();
+            PyErr_Clear();
+            Py_EndInterpreter(target->tstate);
+            target->tstate = NULL;
+            break;
+        }
+        PyTargetResolve(target);
+    }
+    PyThreadState_Swap(main_tstate);
+    PyGILState_Release(gstate);
+
+    _PY_POOL_SIZE = i;
+    if (_PY_POOL_SIZE == 0)
+    {
+        u_free(_PY_POOL);
+        _PY_POOL = NULL;
+    }
+    message("Python: running %s in %d sub-interpreter(s)", PLUGIN_FILE, _PY_POOL_SIZE);
+}
+
+
+/*
+ * end the sub-interpreters, with the thread states of the worker
+ * threads in them
+ */
+
+static void
+PyPoolCleanup(void)
+{
+    int i;
+    PyThreadState *tstate, *next;
+
+    for (i = 0; i < _PY_POOL_SIZE; i++)
+    {
+        PyTarget *target = &_PY_POOL[i];
+
+        PyEval_AcquireThread(target->tstate);
+        tstate = PyInterpreterState_ThreadHead(target->tstate->interp);
+        for (; tstate; tstate = next)
+        {
+            next = PyThreadState_Next(tstate);
+            if (tstate == target->tstate)
+                continue;
+            PyThreadState_Clear(tstate);
+            PyThreadState_Delete(tstate);
+        }
+        PyTargetRelease(target);
+        Py_EndInterpreter(target->tstate);
+#if PY_VERSION_HEX < 0x030c0000
+        /* the GIL is still held, release it through the main thread state */
+        PyThreadState_Swap(pluginMainPyThreadState);
+        PyEval_ReleaseThread(pluginMainPyThreadState);
+#endif
+    }
+    _PY_POOL_SIZE = 0;
+    u_free(_PY_POOL);
+    _PY_POOL = NULL;
+}
+
+
 /*
  * TargetCleanup
  */
@@ -377,7 +624,10 @@ TargetCleanup(void *self, void *data)
         return;
     }
 
+    PyPoolCleanup();
+
     TARGET_THREAD_BEGIN_BLOCK;
+    PyTargetRelease(&_PY_MAIN);
     Py_DecRef(_TARGET_MODULE);
     TARGET_THREAD_END_BLOCK;
   
@@ -43,6 +43,9 @@
 /* expect 'module <RB_PLUGIN_MODULE>' inside */
 #define PLUGIN_MODULE "Openwsman"
 
+/* the plugin functions, interned at init */
+static ID _TARGET_IDS[TARGET_OP_MAX];
+
 /*
  * load_module
  * separate function for rb_require so it can be wrapped into rb_protect()
@@ -116,7 +119,7 @@ get_exc_trace()
 static int
 RbGlobalInitialize( )
 {
-  int error;
+  int error, op;
 
   if (_TARGET_INIT)
     {
@@ -147,6 +150,10 @@ RbGlobalInitialize( )
       error("Ruby: import '%s' doesn't define module '%s'", PLUGIN_MODULE);
       return -1;
     }  
+  for (op = 0; op < TARGET_OP_MAX; op++)
+    {
+      _TARGET_IDS[op] = rb_intern(_TARGET_OPS[op]);
+    }
   debug("RbGlobalInitialize() succeeded -> module %s @ %p", PLUGIN_MODULE, _TARGET_MODULE); 
   return 0; 
 }
@@ -201,47 +208,37 @@ exit:
 
 /*
  * TargetCall
- * Call function 'opname' with nargs arguments within instance
+ * Call function 'op' with nargs arguments within _TARGET_MODULE
  * 
  * doc: in_doc from context, needed for fault generation
- * instance: module
- * opname: name of method to call
- * nargs: number of arguments
+ * op: operation to call
+ * nargs: number of arguments, at most TARGET_MAX_ARGS
  * ...: arguments as varargs
  * 
  */
 
 static int 
-TargetCall(WsXmlDocH doc, VALUE instance, const char* opname, int nargs, ...)
+TargetCall(WsXmlDocH doc, TargetOp op, int nargs, ...)
 {
   int i; 
-  VALUE *args, result, op = rb_intern(opname);
+  const char *opname = _TARGET_OPS[op];
+  VALUE args[3 + TARGET_MAX_ARGS], result;
   va_list vargs; 
   WsmanStatus status;
   wsman_status_init(&status);
 
-  debug("TargetCall(Ruby): %p.%s", (void *)instance, opname);
+  debug("TargetCall(Ruby): %p.%s", (void *)_TARGET_MODULE, opname);
   
   /* add instance, op and nargs to the args array, so rb_protect can be called */
-  nargs += 3;
-  args = (VALUE *)malloc(nargs * sizeof(VALUE));
-  if (args == NULL)
+  args[0] = _TARGET_MODULE;
+  args[1] = _TARGET_IDS[op];
+  args[2] = (VALUE)nargs;
+  va_start(vargs, nargs);
+  for (i = 0; i < nargs; ++i)
     {
-      error("Out of memory"); 
-      abort();
-    }
-  args[0] = instance;
-  args[1] = op;
-  args[2] = (VALUE)(nargs-3);
-  if (nargs > 3)
-    {
-      va_start(vargs, nargs);
-      for (i = 3; i < nargs; ++i)
-	{
-	  args[i] = va_arg(vargs, VALUE);
-	}
-      va_end(vargs);
+      args[3 + i] = va_arg(vargs, VALUE);
     }
+  va_end(vargs);
 
   
   /* call the Ruby function
@@ -252,7 +249,6 @@ TargetCall(WsXmlDocH doc, VALUE instance, const char* opname, int nargs, ...)
    *   result == Array: pair of CMPIStatus rc(int) and msg(string)
    */
   result = rb_protect(call_plugin, (VALUE)args, &i);
-  free( args );
 
   if (i) /* exception ? */
     {
@@ -324,6 +320,18 @@ TargetCall(WsXmlDocH doc, VALUE instance, const char* opname, int nargs, ...)
 }
 
 
+/*
+ * TargetConfigure
+ * Ruby can run one interpreter per process only, all calls go to it
+ */
+
+static void
+TargetConfigure( void *self, dictionary *config )
+{
+  return;
+}
+
+
 /*
  * TargetCleanup
  */
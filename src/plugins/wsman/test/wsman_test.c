@@ -35,7 +35,7 @@ FINISH_TRANSFER_GET_SELECTORS(WsManTest);
 START_END_POINTS(WsManTest)
     END_POINT_TRANSFER_GET(WsManTest, XML_NS_OPENWSMAN"/test"),
     END_POINT_ENUMERATE(WsManTest, XML_NS_OPENWSMAN"/test"),
-    END_POINT_DIRECT_PULL(WsManTest, XML_NS_OPENWSMAN"/test"),
+    END_POINT_STREAM_PULL(WsManTest, XML_NS_OPENWSMAN"/test"),
     END_POINT_PULL(WsManTest, XML_NS_OPENWSMAN"/test"),
     END_POINT_RELEASE(WsManTest, XML_NS_OPENWSMAN"/test"),
     END_POINT_TRANSFER_PUT(WsManTest, XML_NS_OPENWSMAN"/test"),
@@ -63,6 +63,8 @@ typedef struct __WsManTest WsManTest;
 int WsManTest_Enumerate_EP(WsContextH cntx, WsEnumerateInfo* enumInfo);
 int WsManTest_Release_EP(WsContextH cntx, WsEnumerateInfo* enumInfo);
 int WsManTest_Pull_EP(WsContextH cntx, WsEnumerateInfo* enumInfo);
+int WsManTest_PullStream_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
+		WsPullWriterH writer, WsmanStatus *status, void *opaqueData);
 WsManTest* WsManTest_Put_EP(WsContextH cntx);
 WsManTest* WsManTest_Get_EP (WsContextH cntx);
 int 
@@ -100,6 +100,23 @@ int WsManTest_Pull_EP(WsContextH cntx, WsEnumerateInfo* enumInfo)
 
     return 0;
 }
+
+int WsManTest_PullStream_EP(WsContextH cntx, WsEnumerateInfo* enumInfo,
+		WsPullWriterH writer, WsmanStatus *status, void *opaqueData)
+{
+    int ret = 0;
+    debug( "Streamed Pull Endpoint Called");
+    while (ret == 0 && enumInfo->index < 2) {
+        WsXmlDocH doc = ws_xml_create_doc(XML_NS_OPENWSMAN"/test", "Items");
+        WsXmlNodeH root = ws_xml_get_doc_root(doc);
+        ws_serialize(cntx->serializercntx, root,
+                g_WsManTestArr[enumInfo->index], WsManTest_TypeInfo,
+                "WsManTest", XML_NS_OPENWSMAN"/test", NULL, 1);
+        ret = wsman_pull_writer_add_item(writer, ws_xml_get_child(root, 0, NULL, NULL));
+        ws_xml_destroy_doc(doc);
+    }
+    return ret < 0 ? 1 : 0;
+}
 #ifdef ENABLE_EVENTING_SUPPORT
 int
 WsManTest_EventPoll_EP(WsEventThreadContextH threadcntx)
@@ -82,3 +82,19 @@ char *shttpd_reason_phrase(int code)
     }
     return NULL;
 }
+
+/* Non-zero if the request came over the loopback interface */
+int
+shttpd_is_local_peer(struct shttpd_arg *arg)
+{
+	struct conn *c = (struct conn *)arg->priv;
+
+#ifdef ENABLE_IPV6
+	if (c->sa.u.sa.sa_family == AF_INET6)
+		return (IN6_IS_ADDR_LOOPBACK(&c->sa.u.sin6.sin6_addr) ||
+		    (IN6_IS_ADDR_V4MAPPED(&c->sa.u.sin6.sin6_addr) &&
+		    c->sa.u.sin6.sin6_addr.s6_addr[12] == IN_LOOPBACKNET));
+#endif
+	return (c->sa.u.sa.sa_family == AF_INET &&
+	    (ntohl(c->sa.u.sin.sin_addr.s_addr) >> 24) == IN_LOOPBACKNET);
+}
@@ -5,6 +5,7 @@
 void
 shttpd_get_credentials(struct shttpd_arg *arg, char **user, char **pwd);
 char *shttpd_reason_phrase(int code);
+int shttpd_is_local_peer(struct shttpd_arg *arg);
 
 
 #endif
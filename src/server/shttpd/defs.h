@@ -62,6 +62,9 @@ struct usa {
 	union {
 		struct sockaddr	sa;
 		struct sockaddr_in sin;
+#ifdef ENABLE_IPV6
+		struct sockaddr_in6 sin6;
+#endif
 	} u;
 };
 
@@ -253,6 +256,8 @@ enum {
  */
 struct shttpd_ctx {
 	SSL_CTX		*ssl_ctx;	/* SSL context			*/
+	unsigned long	ssl_handshakes;	/* TLS handshakes completed	*/
+	unsigned long	ssl_resumed;	/* of these, resumed sessions	*/
 
 	struct llhead	registered_uris;/* User urls			*/
 	struct llhead   uri_auths;      /* User auth files              */
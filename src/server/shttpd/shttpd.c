@@ -1300,7 +1300,7 @@ shttpd_poll(struct shttpd_ctx *ctx, int milliseconds)
 		if (!FD_ISSET(l->sock, &read_set))
 			continue;
 		do {
-			sa.len = sizeof(sa.u.sin);
+			sa.len = sizeof(sa.u);
 			if ((sock = accept(l->sock, &sa.u.sa, &sa.len)) != -1)
 				handle_connected_socket(ctx,&sa,sock,l->is_ssl);
 		} while (sock != -1);
@@ -1338,6 +1338,37 @@ shttpd_fini(struct shttpd_ctx *ctx)
 	free(ctx);
 }
 
+/*
+ * TLS handshakes completed so far, and how many of them resumed a
+ * session from the cache or a ticket.
+ */
+void
+shttpd_get_ssl_stats(struct shttpd_ctx *ctx, unsigned long *handshakes,
+		unsigned long *resumed)
+{
+	*handshakes = ctx->ssl_handshakes;
+	*resumed = ctx->ssl_resumed;
+}
+
+/*
+ * Connections open on all workers. Read without locking, so the
+ * count may be off by the connections coming and going meanwhile.
+ */
+int
+shttpd_get_active_connections(struct shttpd_ctx *ctx)
+{
+	struct llhead	*lp;
+	struct worker	*worker;
+	int		n = 0;
+
+	LL_FOREACH(&ctx->workers, lp) {
+		worker = LL_ENTRY(lp, struct worker, link);
+		n += worker->num_conns;
+	}
+
+	return (n);
+}
+
 /*
  * UNIX socketpair() implementation. Why? Because Windows does not have it.
  * Return 0 on success, -1 on error.
@@ -1462,6 +1493,26 @@ set_acl(struct shttpd_ctx *ctx, const char *s)
 }
 
 #ifndef NO_SSL
+/*
+ * Count handshakes as they complete. The session cache statistics of
+ * OpenSSL cannot be used for this, with TLS 1.3 they count a ticket
+ * lookup more than once.
+ */
+static void
+ssl_info_callback(const SSL *ssl, int where, int ret)
+{
+	struct shttpd_ctx *ctx;
+
+	if (!(where & SSL_CB_HANDSHAKE_DONE))
+		return;
+	ctx = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+	if (ctx == NULL)
+		return;
+	ctx->ssl_handshakes++;
+	if (SSL_session_reused((SSL *) ssl))
+		ctx->ssl_resumed++;
+}
+
 /*
  * Dynamically load SSL library. Set up ctx->ssl_ctx pointer.
  */
@@ -1552,6 +1603,23 @@ set_ssl(struct shttpd_ctx *ctx, const char *pem)
 		ssl_disabled_protocols = blank_ptr + 1;
 	}
 
+	/*
+	 * Let clients resume sessions instead of doing a full handshake
+	 * on every connection: server side cache plus stateless tickets.
+	 */
+	SSL_CTX_set_session_id_context(CTX, (const unsigned char *) "openwsman", 9);
+	if (wsmand_options_get_ssl_session_cache_size() > 0) {
+		SSL_CTX_set_session_cache_mode(CTX, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(CTX, wsmand_options_get_ssl_session_cache_size());
+	} else {
+		SSL_CTX_set_session_cache_mode(CTX, SSL_SESS_CACHE_OFF);
+	}
+	SSL_CTX_set_timeout(CTX, wsmand_options_get_ssl_session_timeout());
+	if (!wsmand_options_get_ssl_session_tickets())
+		SSL_CTX_set_options(CTX, SSL_OP_NO_TICKET);
+	SSL_CTX_set_app_data(CTX, ctx);
+	SSL_CTX_set_info_callback(CTX, ssl_info_callback);
+
 	if (ssl_cipher_list) {
           int rc = SSL_CTX_set_cipher_list(CTX, ssl_cipher_list);
           if (rc != 1) {
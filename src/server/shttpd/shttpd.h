@@ -78,6 +78,8 @@ typedef void (*shttpd_callback_t)(struct shttpd_arg *);
  * shttpd_printf	helper function to output data
  * shttpd_handle_error	register custom HTTP error handler
  * shttpd_wakeup	clear SHTTPD_SUSPEND state for the connection
+ * shttpd_get_ssl_stats	TLS handshakes done, and how many were resumed
+ * shttpd_get_active_connections	number of open connections
  */
 
 typedef int (*basic_auth_callback)(char *user, char *passwd);
@@ -104,6 +106,9 @@ void shttpd_handle_error(struct shttpd_ctx *ctx, int status,
 void shttpd_register_ssi_func(struct shttpd_ctx *ctx, const char *name,
 		shttpd_callback_t func, void *const user_data);
 void shttpd_wakeup(const void *priv);
+void shttpd_get_ssl_stats(struct shttpd_ctx *, unsigned long *handshakes,
+		unsigned long *resumed);
+int shttpd_get_active_connections(struct shttpd_ctx *);
 int shttpd_join(struct shttpd_ctx *, fd_set *, fd_set *, int *max_fd);
 int  shttpd_socketpair(int sp[2]);
 
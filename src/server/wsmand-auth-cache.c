@@ -0,0 +1,311 @@
+/*******************************************************************************
+* Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*  - Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+*  - Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+*  - Neither the name of Intel Corp. nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+/*
+ * Cache of basic authentication results.
+ *
+ * Verifying a password is expensive (crypt(3) with a slow hash for the
+ * file authenticator, a full PAM conversation for the PAM one) and
+ * clients polling over keep-alive connections send the same credentials
+ * with every request. Results are kept for a short while, keyed by the
+ * user name and an HMAC of the password under a key which only lives in
+ * the memory of this process, so the cache never holds a password.
+ */
+
+#include "wsman_config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "u/libu.h"
+#include "md5.h"
+#include "wsmand-daemon.h"
+#include "wsmand-auth-cache.h"
+
+typedef struct {
+	char *key;
+	time_t expires;
+	int authorized;
+} AuthCacheEntry;
+
+static pthread_mutex_t auth_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *auth_cache = NULL;
+static WsmandAuthorizeFn auth_fn = NULL;
+static char *auth_watch_file = NULL;
+static struct stat auth_watch_stat;
+static time_t auth_watch_checked = 0;
+static unsigned long auth_generation = 0;
+static unsigned long auth_hits = 0;
+static unsigned long auth_misses = 0;
+static int auth_ttl = 0;
+static int auth_negative_ttl = 0;
+static unsigned char auth_hmac_key[64];
+
+
+static void auth_cache_seed(void)
+{
+	MD5_CTX ctx;
+	size_t n = 0;
+	int fd, i;
+	time_t now = time(NULL);
+	pid_t pid = getpid();
+
+	fd = open("/dev/urandom", O_RDONLY);
+	if (fd >= 0) {
+		ssize_t r;
+		while (n < sizeof(auth_hmac_key) &&
+		       (r = read(fd, auth_hmac_key + n,
+				 sizeof(auth_hmac_key) - n)) > 0)
+			n += r;
+		close(fd);
+	}
+	if (n == sizeof(auth_hmac_key))
+		return;
+
+	debug("no /dev/urandom, deriving the auth cache key");
+	for (i = 0; i < 4; i++) {
+		MD5Init(&ctx);
+		MD5Update(&ctx, auth_hmac_key, sizeof(auth_hmac_key));
+		MD5Update(&ctx, (unsigned char *) &now, sizeof(now));
+		MD5Update(&ctx, (unsigned char *) &pid, sizeof(pid));
+		MD5Update(&ctx, (unsigned char *) &ctx, sizeof(void *));
+		MD5Update(&ctx, (unsigned char *) &i, sizeof(i));
+		MD5Final(auth_hmac_key + 16 * i, &ctx);
+	}
+}
+
+/* "username:hex(HMAC-MD5(key, username \0 password))" */
+static char *auth_cache_key(const char *username, const char *password)
+{
+	MD5_CTX ctx;
+	unsigned char pad[64], inner[16], digest[16];
+	char hex[33];
+	int i;
+
+	for (i = 0; i < 64; i++)
+		pad[i] = auth_hmac_key[i] ^ 0x36;
+	MD5Init(&ctx);
+	MD5Update(&ctx, pad, sizeof(pad));
+	MD5Update(&ctx, (const unsigned char *) username, strlen(username) + 1);
+	MD5Update(&ctx, (const unsigned char *) password, strlen(password));
+	MD5Final(inner, &ctx);
+
+	for (i = 0; i < 64; i++)
+		pad[i] = auth_hmac_key[i] ^ 0x5c;
+	MD5Init(&ctx);
+	MD5Update(&ctx, pad, sizeof(pad));
+	MD5Update(&ctx, inner, sizeof(inner));
+	MD5Final(digest, &ctx);
+
+	for (i = 0; i < 16; i++)
+		sprintf(hex + 2 * i, "%02x", digest[i]);
+	return u_strdup_printf("%s:%s", username, hex);
+}
+
+/* scanning tells whether hn comes from a running hash_scan_next() */
+static void auth_cache_free_entry(hnode_t *hn, int scanning)
+{
+	AuthCacheEntry *e = (AuthCacheEntry *) hnode_get(hn);
+
+	if (scanning)
+		hash_scan_delfree(auth_cache, hn);
+	else
+		hash_delete_free(auth_cache, hn);
+	u_free(e->key);
+	u_free(e);
+}
+
+static void auth_cache_clear(void)
+{
+	hscan_t hs;
+	hnode_t *hn;
+
+	if (auth_cache == NULL)
+		return;
+	hash_scan_begin(&hs, auth_cache);
+	while ((hn = hash_scan_next(&hs)))
+		auth_cache_free_entry(hn, 1);
+	auth_generation++;
+}
+
+/* make room for one entry: drop expired ones, or else the oldest one */
+static void auth_cache_evict(time_t now)
+{
+	hscan_t hs;
+	hnode_t *hn, *oldest = NULL;
+	AuthCacheEntry *e;
+
+	hash_scan_begin(&hs, auth_cache);
+	while ((hn = hash_scan_next(&hs))) {
+		e = (AuthCacheEntry *) hnode_get(hn);
+		if (e->expires <= now) {
+			auth_cache_free_entry(hn, 1);
+		} else if (oldest == NULL ||
+			   e->expires < ((AuthCacheEntry *)
+					 hnode_get(oldest))->expires) {
+			oldest = hn;
+		}
+	}
+	if (hash_isfull(auth_cache) && oldest)
+		auth_cache_free_entry(oldest, 0);
+}
+
+/*
+ * flush the cache if the password file was changed, under the mutex.
+ * The file is looked at once a second, not on every lookup.
+ */
+static void auth_cache_check_watch(time_t now)
+{
+	struct stat st;
+
+	if (auth_watch_file == NULL || now == auth_watch_checked)
+		return;
+	auth_watch_checked = now;
+	if (stat(auth_watch_file, &st) != 0)
+		memset(&st, 0, sizeof(st));
+	if (st.st_mtime != auth_watch_stat.st_mtime ||
+	    st.st_size != auth_watch_stat.st_size ||
+	    st.st_ino != auth_watch_stat.st_ino) {
+		debug("%s changed, flushing auth cache", auth_watch_file);
+		auth_cache_clear();
+		auth_watch_stat = st;
+	}
+}
+
+
+int wsmand_auth_cache_init(WsmandAuthorizeFn fn, const char *watch_file)
+{
+	int size = wsmand_options_get_auth_cache_size();
+
+	auth_ttl = wsmand_options_get_auth_cache_ttl();
+	auth_negative_ttl = wsmand_options_get_auth_cache_negative_ttl();
+	if (fn == NULL || auth_ttl <= 0 || size <= 0)
+		return 0;
+
+	auth_cache = hash_create(size, 0, 0);
+	if (auth_cache == NULL)
+		return 0;
+	auth_fn = fn;
+	auth_cache_seed();
+	if (watch_file) {
+		auth_watch_file = u_strdup(watch_file);
+		if (stat(auth_watch_file, &auth_watch_stat) != 0)
+			memset(&auth_watch_stat, 0, sizeof(auth_watch_stat));
+		auth_watch_checked = time(NULL);
+	}
+	message("Caching basic authentication for %d seconds (%d entries)",
+		auth_ttl, size);
+	return 1;
+}
+
+
+int wsmand_auth_cache_authorize(char *username, char *password)
+{
+	char *key;
+	hnode_t *hn;
+	AuthCacheEntry *e;
+	time_t now = time(NULL);
+	unsigned long generation;
+	int authorized, ttl;
+
+	if (username == NULL || password == NULL)
+		return 0;
+	key = auth_cache_key(username, password);
+	if (key == NULL)
+		return auth_fn(username, password);
+
+	pthread_mutex_lock(&auth_cache_mutex);
+	auth_cache_check_watch(now);
+	if ((hn = hash_lookup(auth_cache, key)) != NULL) {
+		e = (AuthCacheEntry *) hnode_get(hn);
+		if (e->expires > now) {
+			authorized = e->authorized;
+			auth_hits++;
+			pthread_mutex_unlock(&auth_cache_mutex);
+			u_free(key);
+			return authorized;
+		}
+		auth_cache_free_entry(hn, 0);
+	}
+	auth_misses++;
+	generation = auth_generation;
+	pthread_mutex_unlock(&auth_cache_mutex);
+
+	/* verify without holding the lock, crypt(3) and PAM take a while */
+	authorized = auth_fn(username, password);
+
+	ttl = authorized ? auth_ttl : auth_negative_ttl;
+	pthread_mutex_lock(&auth_cache_mutex);
+	if (ttl > 0 && generation == auth_generation &&
+	    hash_lookup(auth_cache, key) == NULL) {
+		if (hash_isfull(auth_cache))
+			auth_cache_evict(now);
+		e = u_malloc(sizeof(AuthCacheEntry));
+		if (e && !hash_isfull(auth_cache)) {
+			e->key = key;
+			e->expires = now + ttl;
+			e->authorized = authorized;
+			if (hash_alloc_insert(auth_cache, e->key, e)) {
+				key = NULL;
+				e = NULL;
+			}
+		}
+		u_free(e);
+	}
+	pthread_mutex_unlock(&auth_cache_mutex);
+	u_free(key);
+	return authorized;
+}
+
+
+void wsmand_auth_cache_flush(void)
+{
+	pthread_mutex_lock(&auth_cache_mutex);
+	auth_cache_clear();
+	pthread_mutex_unlock(&auth_cache_mutex);
+}
+
+
+void wsmand_auth_cache_get_stats(unsigned long *hits, unsigned long *misses)
+{
+	pthread_mutex_lock(&auth_cache_mutex);
+	if (hits)
+		*hits = auth_hits;
+	if (misses)
+		*misses = auth_misses;
+	pthread_mutex_unlock(&auth_cache_mutex);
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+* Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*  - Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+*  - Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+*  - Neither the name of Intel Corp. nor the names of its
+*    contributors may be used to endorse or promote products derived from this
+*    software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*******************************************************************************/
+
+#ifndef __WSMAND_AUTH_CACHE_H__
+#define __WSMAND_AUTH_CACHE_H__
+
+typedef int (*WsmandAuthorizeFn) (char *username, char *password);
+
+/*
+ * Put a cache of verified credentials in front of the basic
+ * authenticator 'fn'. The cache is flushed whenever 'watch_file'
+ * (may be NULL) changes. Returns 0 if caching is disabled in the
+ * configuration.
+ */
+int wsmand_auth_cache_init(WsmandAuthorizeFn fn, const char *watch_file);
+
+/* basic_auth_callback answering from the cache, or asking 'fn' */
+int wsmand_auth_cache_authorize(char *username, char *password);
+
+void wsmand_auth_cache_flush(void);
+
+void wsmand_auth_cache_get_stats(unsigned long *hits, unsigned long *misses);
+
+#endif				/* __WSMAND_AUTH_CACHE_H__ */
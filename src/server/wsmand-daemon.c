@@ -99,6 +99,21 @@ static int max_threads = 1;
 static unsigned long enumIdleTimeout = 100;
 static char *thread_stack_size="0";
 static int max_connections_per_thread=20;
+static int auth_cache_ttl = 0;
+static int auth_cache_negative_ttl = 5;
+static int auth_cache_size = 256;
+static int compression_level = 6;
+static int compression_threshold = 1024;
+static int ssl_session_cache_size = 1024;
+static int ssl_session_timeout = 300;
+static int ssl_session_tickets = 1;
+static int log_queue_size = 0;
+static int trace_requests = 0;
+static char *trace_file = NULL;
+static int trace_sample_rate = 1;
+static int metrics = 0;
+static char *response_cache = NULL;
+static int response_cache_size = 1024;
 
 static char *config_file = NULL;
 
@@ -180,6 +195,21 @@ int wsmand_read_config(dictionary * ini)
 	ssl_cert_file = iniparser_getstr(ini, "server:ssl_cert_file");
         ssl_disabled_protocols = iniparser_getstr(ini, "server:ssl_disabled_protocols");
         ssl_cipher_list = iniparser_getstr(ini, "server:ssl_cipher_list");
+	ssl_session_cache_size =
+	    iniparser_getint(ini, "server:ssl_session_cache_size", 1024);
+	ssl_session_timeout =
+	    iniparser_getint(ini, "server:ssl_session_timeout", 300);
+	ssl_session_tickets =
+	    iniparser_getboolean(ini, "server:ssl_session_tickets", 1);
+	log_queue_size = iniparser_getint(ini, "server:log_queue_size", 0);
+	trace_requests = iniparser_getboolean(ini, "server:trace_requests", 0);
+	trace_file = iniparser_getstr(ini, "server:trace_file");
+	trace_sample_rate =
+	    iniparser_getint(ini, "server:trace_sample_rate", 1);
+	metrics = iniparser_getboolean(ini, "server:metrics", 0);
+	response_cache = iniparser_getstr(ini, "server:response_cache");
+	response_cache_size =
+	    iniparser_getint(ini, "server:response_cache_size", 1024);
 	use_ipv4 = iniparser_getboolean(ini, "server:ipv4", 1);
 #ifdef ENABLE_IPV6
         use_ipv6 = iniparser_getboolean(ini, "server:ipv6", 1);
@@ -206,6 +236,13 @@ int wsmand_read_config(dictionary * ini)
 	uri_subscription_repository = iniparser_getstring(ini, "server:subs_repository", DEFAULT_SUBSCRIPTION_REPOSITORY);
         max_connections_per_thread = iniparser_getint(ini, "server:max_connections_per_thread", iniparser_getint(ini, "server:max_connextions_per_thread", 20));
         thread_stack_size = iniparser_getstring(ini, "server:thread_stack_size", "0");
+	auth_cache_ttl = iniparser_getint(ini, "server:auth_cache_ttl", 0);
+	auth_cache_negative_ttl =
+	    iniparser_getint(ini, "server:auth_cache_negative_ttl", 5);
+	auth_cache_size = iniparser_getint(ini, "server:auth_cache_size", 256);
+	compression_level = iniparser_getint(ini, "server:compression_level", 6);
+	compression_threshold =
+	    iniparser_getint(ini, "server:compression_threshold", 1024);
 #ifdef ENABLE_EVENTING_SUPPORT
 	wsman_server_set_subscription_repos(uri_subscription_repository);
 #endif
@@ -391,6 +428,81 @@ char *wsmand_option_get_basic_authenticator_arg()
 	return basic_authenticator_arg;
 }
 
+int wsmand_options_get_auth_cache_ttl(void)
+{
+	return auth_cache_ttl;
+}
+
+int wsmand_options_get_auth_cache_negative_ttl(void)
+{
+	return auth_cache_negative_ttl;
+}
+
+int wsmand_options_get_auth_cache_size(void)
+{
+	return auth_cache_size;
+}
+
+int wsmand_options_get_ssl_session_cache_size(void)
+{
+	return ssl_session_cache_size;
+}
+
+int wsmand_options_get_ssl_session_timeout(void)
+{
+	return ssl_session_timeout;
+}
+
+int wsmand_options_get_ssl_session_tickets(void)
+{
+	return ssl_session_tickets;
+}
+
+int wsmand_options_get_log_queue_size(void)
+{
+	return log_queue_size;
+}
+
+int wsmand_options_get_trace_requests(void)
+{
+	return trace_requests;
+}
+
+char *wsmand_options_get_trace_file(void)
+{
+	return trace_file;
+}
+
+int wsmand_options_get_trace_sample_rate(void)
+{
+	return trace_sample_rate;
+}
+
+int wsmand_options_get_metrics(void)
+{
+	return metrics;
+}
+
+char *wsmand_options_get_response_cache(void)
+{
+	return response_cache;
+}
+
+int wsmand_options_get_response_cache_size(void)
+{
+	return response_cache_size;
+}
+
+int wsmand_options_get_compression_level(void)
+{
+	return compression_level;
+}
+
+int wsmand_options_get_compression_threshold(void)
+{
+	return compression_threshold;
+}
+
 unsigned long wsmand_options_get_enumIdleTimeout()
 {
 	return enumIdleTimeout;
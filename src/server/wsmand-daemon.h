@@ -39,6 +39,7 @@
 
 #define DEFAULT_SERVICE_PATH "/wsman"
 #define ANON_IDENTIFY_PATH "/wsman-anon/identify"
+#define METRICS_PATH "/metrics"
 #define DEFAULT_CIMINDICATION_PATH "/cimindicationlistener"
 #define DEFAULT_PID_PATH "/var/run/wsmand.pid"
 
@@ -78,6 +79,17 @@ char *wsmand_options_get_ssl_key_file(void);
 char *wsmand_options_get_ssl_cert_file(void);
 char *wsmand_options_get_ssl_disabled_protocols(void);
 char *wsmand_options_get_ssl_cipher_list(void);
+int wsmand_options_get_ssl_session_cache_size(void);
+int wsmand_options_get_ssl_session_timeout(void);
+int wsmand_options_get_ssl_session_tickets(void);
+
+int wsmand_options_get_log_queue_size(void);
+int wsmand_options_get_trace_requests(void);
+char *wsmand_options_get_trace_file(void);
+int wsmand_options_get_trace_sample_rate(void);
+int wsmand_options_get_metrics(void);
+char *wsmand_options_get_response_cache(void);
+int wsmand_options_get_response_cache_size(void);
 int wsmand_options_get_digest(void);
 char *wsmand_options_get_digest_password_file(void);
 char *wsmand_options_get_basic_password_file(void);
@@ -86,6 +98,11 @@ int wsmand_options_get_max_threads(void);
 char *wsmand_default_basic_authenticator(void);
 char *wsmand_option_get_basic_authenticator(void);
 char *wsmand_option_get_basic_authenticator_arg(void);
+int wsmand_options_get_auth_cache_ttl(void);
+int wsmand_options_get_auth_cache_negative_ttl(void);
+int wsmand_options_get_auth_cache_size(void);
+int wsmand_options_get_compression_level(void);
+int wsmand_options_get_compression_threshold(void);
 char *wsmand_options_get_pid_file(void);
 unsigned long wsmand_options_get_enumIdleTimeout(void);
 const char *wsmand_options_get_config_file(void);
@@ -45,6 +45,8 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <assert.h>
+#include <signal.h>
+#include <time.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -67,8 +69,12 @@
 #include "shttpd.h"
 #include "shttpd/adapter.h" /* shttpd_get_credentials() */
 #include "wsman-plugins.h"
+#include "wsman-metrics.h"
+#include "wsman-response-cache.h"
+#include "wsman-plugin-host.h"
 #include "wsmand-listener.h"
 #include "wsmand-daemon.h"
+#include "wsmand-auth-cache.h"
 #include "wsman-server.h"
 #include "wsman-server-api.h"
 #include "wsman-plugins.h"
@@ -101,6 +107,21 @@ typedef struct {
 	int ind;
 } ShttpMessage;
 
+/* an identify file, kept in memory */
+typedef struct {
+	const char *path;
+	pthread_mutex_t lock;
+	u_buf_t *body;		/* NULL if it could not be read */
+	time_t checked;
+	int generation;
+	struct stat st;
+} IdentifyFile;
+
+static IdentifyFile identify_file = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static IdentifyFile anon_identify_file = { .lock = PTHREAD_MUTEX_INITIALIZER };
+/* bumped on SIGHUP */
+static volatile sig_atomic_t identify_generation = 0;
+
 #ifdef SHTTPD_GSS
 char * gss_decrypt(struct shttpd_arg *arg, char *data, int len);
 int gss_encrypt(struct shttpd_arg *arg, char *input, int inlen, char **output, int *outlen);
@@ -138,6 +159,127 @@ char *get_request_encoding(struct shttpd_arg *arg) {
 	return encoding;
 }
 
+/* read f again unless what is kept is still what is on disk */
+static void identify_file_load(IdentifyFile *f)
+{
+	struct stat st;
+	u_buf_t *body = NULL;
+	int found = stat(f->path, &st) == 0;
+
+	if (found && f->body &&
+	    f->generation == identify_generation &&
+	    st.st_mtime == f->st.st_mtime && st.st_size == f->st.st_size &&
+	    st.st_ino == f->st.st_ino)
+		return;
+	f->generation = identify_generation;
+	if (found && u_buf_create(&body) == 0 &&
+	    u_buf_load(body, (char *) f->path) == 0) {
+		debug("loaded %s, %lu bytes", f->path,
+		      (unsigned long) u_buf_len(body));
+		f->st = st;
+	} else {
+		/* once, not for every request until it is back */
+		if (f->body || f->checked == 0)
+			error("Could not read %s", f->path);
+		if (body)
+			u_buf_free(body);
+		body = NULL;
+	}
+	if (f->body)
+		u_buf_free(f->body);
+	f->body = body;
+}
+
+/*
+ * Copy the identify file f into buf. It is looked at on disk at most
+ * once a second and read again once it changed or after a SIGHUP.
+ * @return 0 on success
+ */
+static int identify_file_copy(IdentifyFile *f, u_buf_t *buf)
+{
+	time_t now = time(NULL);
+	int ret = 1;
+
+	if (f->path == NULL)
+		return 1;
+	pthread_mutex_lock(&f->lock);
+	if (f->checked != now || f->generation != identify_generation) {
+		f->checked = now;
+		identify_file_load(f);
+	}
+	if (f->body && u_buf_len(f->body) > 0)
+		ret = u_buf_set(buf, u_buf_ptr(f->body), u_buf_len(f->body));
+	pthread_mutex_unlock(&f->lock);
+	return ret;
+}
+
+void wsmand_identify_reload(void)
+{
+	identify_generation++;
+}
+
+/* limit for the size of a compressed request once uncompressed */
+#define MAX_INFLATED_REQUEST (32 * 1024 * 1024)
+
+/* Replace a gzip or deflate coded request body by the plain one */
+static
+int decode_request_body(struct shttpd_arg *arg, u_buf_t *request) {
+	const char *content_encoding;
+	char *body;
+	size_t len;
+	int coding;
+
+	content_encoding = shttpd_get_header(arg, "Content-Encoding");
+	coding = u_gzip_coding(content_encoding);
+	if (coding == U_GZIP_IDENTITY)
+		return WSMAN_STATUS_OK;
+	if (coding < 0) {
+		debug("unsupported Content-Encoding: %s", content_encoding);
+		return WSMAN_STATUS_UNSUPPORTED_MEDIA_TYPE;
+	}
+	if (u_gzip_uncompress(u_buf_ptr(request), u_buf_len(request),
+			      MAX_INFLATED_REQUEST, &body, &len)) {
+		debug("could not uncompress %s request", content_encoding);
+		return WSMAN_STATUS_BAD_REQUEST;
+	}
+	debug("uncompressed request: %lu -> %lu bytes",
+	      (unsigned long) u_buf_len(request), (unsigned long) len);
+	u_buf_set(request, body, len);
+	u_free(body);
+	return WSMAN_STATUS_OK;
+}
+
+/*
+ * Compress the response if the client accepts it and it is worth it.
+ * Returns the name of the content coding applied or NULL.
+ */
+static
+const char *encode_response_body(struct shttpd_arg *arg, char **response,
+		size_t *len) {
+	int level = wsmand_options_get_compression_level();
+	int coding;
+	char *body;
+	size_t blen;
+
+	if (level <= 0 || *len < (size_t) wsmand_options_get_compression_threshold())
+		return NULL;
+	coding = u_gzip_accepted(shttpd_get_header(arg, "Accept-Encoding"));
+	if (coding == U_GZIP_IDENTITY)
+		return NULL;
+	if (u_gzip_compress(coding, level, *response, *len, &body, &blen))
+		return NULL;
+	if (blen >= *len) {
+		u_free(body);
+		return NULL;
+	}
+	debug("compressed response: %lu -> %lu bytes",
+	      (unsigned long) *len, (unsigned long) blen);
+	u_free(*response);
+	*response = body;
+	*len = blen;
+	return u_gzip_name(coding);
+}
+
 static
 void server_callback(struct shttpd_arg *arg)
 {
@@ -147,6 +289,7 @@ void server_callback(struct shttpd_arg *arg)
 	int k;
 	int status = WSMAN_STATUS_OK;
 	char *request_uri;
+	const char *content_coding = NULL;
 
 	char *fault_reason = NULL;
 	struct state {
@@ -157,11 +300,17 @@ void server_callback(struct shttpd_arg *arg)
 		size_t  len;
 		int     index;
 		int     type;
+		int     status;
+		unsigned long long received;	/* trace marks */
+		unsigned long long sending;
+		WsmanTrace *trace;
 	} *state;
 
 
 	/* If the connection was broken prematurely, cleanup */
 	if ( (arg->flags & SHTTPD_CONNECTION_ERROR ) && arg->state) {
+		state = arg->state;
+		wsman_trace_free(state->trace);
         	free(arg->state);
 		return;
 	} else if ((s = shttpd_get_header(arg, "Content-Length")) == NULL) {
@@ -173,6 +322,8 @@ void server_callback(struct shttpd_arg *arg)
         	arg->state = state = calloc(1, sizeof(*state));
 	        state->cl = strtoul(s, NULL, 10);
 		u_buf_create(&(state->request));
+		if (wsman_trace_enabled() || wsman_metrics_enabled())
+			state->received = wsman_trace_now();
 	}
 
 	state = arg->state;
@@ -206,6 +357,10 @@ void server_callback(struct shttpd_arg *arg)
 
 		/* Here we must handle the initial request */
 		WsmanMessage *wsman_msg = wsman_soap_message_new();
+
+		state->trace = wsman_trace_new(state->received);
+		wsman_trace_end(state->trace, WSMAN_TRACE_RECEIVE, state->received);
+		wsman_msg->trace = state->trace;
 #ifdef SHTTPD_GSS
 	        if(payload == 0) {
 #endif
@@ -213,6 +368,10 @@ void server_callback(struct shttpd_arg *arg)
 				wsman_soap_message_destroy(wsman_msg);
 				goto DONE;
 			}
+			if ( (status = decode_request_body(arg, state->request) ) != WSMAN_STATUS_OK ) {
+				wsman_soap_message_destroy(wsman_msg);
+				goto DONE;
+			}
 			encoding = get_request_encoding(arg);
 
 			u_buf_set(wsman_msg->request, u_buf_ptr(state->request), u_buf_len(state->request));
@@ -236,9 +395,10 @@ void server_callback(struct shttpd_arg *arg)
 		/* Call dispatcher. Real request handling */
 		if (status == WSMAN_STATUS_OK) {
 			/* dispatch if we didn't find out any error */
-			char *idfile = wsmand_options_get_identify_file();
-			if (idfile && wsman_check_identify(wsman_msg) == 1) {
-				if (u_buf_load(wsman_msg->response, idfile)) {
+			if (identify_file.path &&
+			    wsman_check_identify(wsman_msg) == 1) {
+				if (identify_file_copy(&identify_file,
+						       wsman_msg->response)) {
 					dispatch_inbound_call(soap, wsman_msg, NULL);
 					status = wsman_msg->http_code;
 				}
@@ -246,6 +406,9 @@ void server_callback(struct shttpd_arg *arg)
 				dispatch_inbound_call(soap, wsman_msg, NULL);
 				status = wsman_msg->http_code;
 			}
+			if (wsman_metrics_enabled())
+				wsman_metrics_request(wsman_msg->status.fault_code,
+					wsman_trace_now() - state->received);
 		}
 		if (wsman_msg->request) {
 #ifdef SHTTPD_GSS
@@ -319,10 +482,9 @@ void server_callback(struct shttpd_arg *arg)
 #endif
 
 	} else if (strcmp(request_uri, ANON_IDENTIFY_PATH) == 0 ) {
-		char *idfile = wsmand_options_get_anon_identify_file();
 		u_buf_t *id;
 		u_buf_create(&id);
-		if (idfile && u_buf_load(id, idfile) == 0 ) {
+		if (identify_file_copy(&anon_identify_file, id) == 0) {
 			state->len =  u_buf_len(id);;
 			state->response = u_buf_steal(id);
 			state->index = 0;
@@ -346,6 +508,8 @@ DONE:
 		//fault_reason = shttpd_reason_phrase(status);
 	}
 	debug("Response status=%d (%s)", status, fault_reason);
+	state->status = status;
+	state->sending = wsman_trace_begin(state->trace);
 
 	/*
 	 * Here we begin to create the http response.
@@ -375,6 +539,12 @@ DONE:
 		} else {
 			shttpd_printf(arg, "Content-Type: application/soap+xml;charset=%s\r\n", encoding);
 		}
+		if (state->response)
+			content_coding = encode_response_body(arg, &state->response, &state->len);
+		if (content_coding)
+			shttpd_printf(arg, "Content-Encoding: %s\r\n", content_coding);
+		if (wsmand_options_get_compression_level() > 0)
+			shttpd_printf(arg, "Vary: Accept-Encoding\r\n");
     		shttpd_printf(arg, "Content-Length: %d\r\n", state->len);
 #ifdef SHTTPD_GSS
 	}
@@ -402,6 +572,8 @@ CONTINUE:
 		 arg->out.num_bytes += l;
 	}
 
+	wsman_trace_end(state->trace, WSMAN_TRACE_SEND, state->sending);
+	wsman_trace_finish(state->trace, state->status);
 	u_buf_free(state->request);
 	u_free(state->response);
 	u_free(state);
@@ -409,6 +581,136 @@ CONTINUE:
 	return;
 }
 
+/* Prometheus scrapes of the metrics, from the local host only */
+static void metrics_callback(struct shttpd_arg *arg)
+{
+	struct {
+		char    *response;
+		size_t  len;
+		size_t  index;
+	} *state;
+	u_buf_t *buf;
+	size_t k;
+
+	if (arg->flags & SHTTPD_CONNECTION_ERROR) {
+		if ((state = arg->state) != NULL) {
+			u_free(state->response);
+			u_free(state);
+		}
+		return;
+	} else if (arg->state == NULL) {
+		if (!shttpd_is_local_peer(arg)) {
+			shttpd_printf(arg, "HTTP/1.1 403 %s\r\n"
+				      "Content-Length: 0\r\n"
+				      "Connection: Close\r\n\r\n",
+				      shttpd_reason_phrase(403));
+			arg->flags |= SHTTPD_END_OF_OUTPUT;
+			return;
+		}
+		state = NULL;
+		if (u_buf_create(&buf) == 0) {
+			if ((state = u_zalloc(sizeof(*state))) == NULL)
+				u_buf_free(buf);
+		}
+		if (state == NULL) {
+			shttpd_printf(arg, "HTTP/1.1 500 %s\r\n"
+				      "Content-Length: 0\r\n"
+				      "Connection: Close\r\n\r\n",
+				      shttpd_reason_phrase(500));
+			arg->flags |= SHTTPD_END_OF_OUTPUT;
+			return;
+		}
+		wsman_metrics_collect(buf);
+		arg->state = state;
+		state->len = u_buf_len(buf);
+		state->response = u_buf_steal(buf);
+		u_buf_free(buf);
+
+		shttpd_printf(arg, "HTTP/1.1 200 OK\r\n");
+		shttpd_printf(arg, "Server: %s/%s\r\n", PACKAGE_NAME, PACKAGE_VERSION);
+		shttpd_printf(arg, "Content-Type: text/plain; version=0.0.4\r\n");
+		shttpd_printf(arg, "Content-Length: %d\r\n", (int) state->len);
+		shttpd_printf(arg, "Connection: Close\r\n\r\n");
+	}
+
+	state = arg->state;
+	k = arg->out.len - arg->out.num_bytes;
+	if (k > state->len - state->index)
+		k = state->len - state->index;
+	memcpy(arg->out.buf + arg->out.num_bytes, state->response + state->index, k);
+	state->index += k;
+	arg->out.num_bytes += k;
+	if (state->index < state->len)
+		return;
+
+	u_free(state->response);
+	u_free(state);
+	arg->state = NULL;
+	arg->flags |= SHTTPD_END_OF_OUTPUT;
+}
+
+/* basic_callback, counting the results for the metrics */
+static int metrics_basic_callback(char *username, char *password)
+{
+	int authorized = basic_callback(username, password);
+
+	wsman_metrics_auth(authorized);
+	return authorized;
+}
+
+static double metrics_connections(void *data)
+{
+	return shttpd_get_active_connections((struct shttpd_ctx *) data);
+}
+
+static double metrics_auth_cache_hits(void *data)
+{
+	unsigned long hits, misses;
+
+	wsmand_auth_cache_get_stats(&hits, &misses);
+	return hits;
+}
+
+static double metrics_auth_cache_misses(void *data)
+{
+	unsigned long hits, misses;
+
+	wsmand_auth_cache_get_stats(&hits, &misses);
+	return misses;
+}
+
+static double metrics_response_cache_hits(void *data)
+{
+	unsigned long hits, misses;
+
+	wsman_response_cache_get_stats(&hits, &misses);
+	return hits;
+}
+
+static double metrics_response_cache_misses(void *data)
+{
+	unsigned long hits, misses;
+
+	wsman_response_cache_get_stats(&hits, &misses);
+	return misses;
+}
+
+static double metrics_ssl_handshakes(void *data)
+{
+	unsigned long handshakes, resumed;
+
+	shttpd_get_ssl_stats((struct shttpd_ctx *) data, &handshakes, &resumed);
+	return handshakes;
+}
+
+static double metrics_ssl_resumed(void *data)
+{
+	unsigned long handshakes, resumed;
+
+	shttpd_get_ssl_stats((struct shttpd_ctx *) data, &handshakes, &resumed);
+	return resumed;
+}
+
 static void listener_shutdown_handler(void *p)
 {
 	int *a = (int *) p;
@@ -416,6 +718,33 @@ static void listener_shutdown_handler(void *p)
 	*a = 0;
 }
 
+static void ssl_stats_shutdown_handler(void *p)
+{
+	unsigned long handshakes, resumed;
+
+	shttpd_get_ssl_stats((struct shttpd_ctx *) p, &handshakes, &resumed);
+	message("TLS handshakes: %lu, resumed sessions: %lu",
+		handshakes, resumed);
+}
+
+static void trace_shutdown_handler(void *p)
+{
+	wsman_trace_shutdown();
+}
+
+static void response_cache_shutdown_handler(void *p)
+{
+	unsigned long hits, misses;
+
+	wsman_response_cache_get_stats(&hits, &misses);
+	message("Response cache: %lu hits, %lu misses", hits, misses);
+}
+
+static void plugin_host_shutdown_handler(void *p)
+{
+	wsman_plugin_host_stop();
+}
+
 static void protect_uri(struct shttpd_ctx *ctx, char *uri)
 {
 	if (wsmand_options_get_digest_password_file()) {
@@ -425,7 +754,8 @@ static void protect_uri(struct shttpd_ctx *ctx, char *uri)
 	}
 	if (basic_callback) {
 		shttpd_protect_uri(ctx, uri, wsmand_options_get_basic_password_file(),
-						basic_callback, 0);
+				   wsman_metrics_enabled() ?
+				   metrics_basic_callback : basic_callback, 0);
 		debug("Using Basic Authorization %s for %s",
 		      wsmand_option_get_basic_authenticator()?
 		      wsmand_option_get_basic_authenticator() :
@@ -458,6 +788,10 @@ static struct shttpd_ctx *create_shttpd_context(SoapH soap, int port)
 	protect_uri(ctx, wsmand_options_get_service_path());
 	shttpd_register_uri(ctx, ANON_IDENTIFY_PATH,
 			    server_callback, (void *) soap);
+	if (wsman_metrics_enabled()) {
+		message("Serving metrics at %s", METRICS_PATH);
+		shttpd_register_uri(ctx, METRICS_PATH, metrics_callback, NULL);
+	}
 
 #ifdef ENABLE_EVENTING_SUPPORT
 	message("Registered CIM Indication Listener: %s", DEFAULT_CIMINDICATION_PATH "/*");
@@ -526,6 +860,11 @@ static int initialize_basic_authenticator(void)
 	if (init != NULL) {
 		res = init(arg);
 	}
+	/* an absolute argument is the password file of the authenticator */
+	if (res == 0 && wsmand_auth_cache_init(basic_callback,
+			(arg && arg[0] == '/') ? arg : NULL)) {
+		basic_callback = wsmand_auth_cache_authorize;
+	}
       DONE:
 	if (should_return) {
 		u_free(name);
@@ -664,10 +1003,75 @@ WsManListenerH *wsmand_start_server(dictionary * ini)
 	if (!get_server_auth())
 		return listener;
 
+	/* before any thread of the listener is started */
+	if (wsman_plugin_host_start(cntx, listener) == 0)
+		wsmand_shutdown_add_handler(plugin_host_shutdown_handler, NULL);
+
 	wsmand_shutdown_add_handler(listener_shutdown_handler,
 				    &continue_working);
 
+	if ((wsmand_options_get_trace_requests() ||
+	     wsmand_options_get_trace_file()) &&
+	    wsman_trace_init(wsmand_options_get_trace_requests(),
+			     wsmand_options_get_trace_file(),
+			     wsmand_options_get_trace_sample_rate()) == 0)
+		wsmand_shutdown_add_handler(trace_shutdown_handler, NULL);
+
+	if (wsmand_options_get_metrics() && wsman_metrics_init(soap))
+		error("Could not set up the metrics");
+
+	identify_file.path = wsmand_options_get_identify_file();
+	anon_identify_file.path = wsmand_options_get_anon_identify_file();
+	if (identify_file.path) {
+		message("Answering Identify with %s", identify_file.path);
+		identify_file_load(&identify_file);
+	}
+	if (anon_identify_file.path)
+		identify_file_load(&anon_identify_file);
+
+	if (wsmand_options_get_response_cache() &&
+	    wsman_response_cache_init(wsmand_options_get_response_cache(),
+			wsmand_options_get_response_cache_size()) == 0)
+		wsmand_shutdown_add_handler(response_cache_shutdown_handler,
+					    NULL);
+
 	httpd_ctx = create_shttpd_context(soap, port);
+	if (use_ssl)
+		wsmand_shutdown_add_handler(ssl_stats_shutdown_handler,
+					    httpd_ctx);
+	if (wsman_metrics_enabled() && httpd_ctx) {
+		wsman_metrics_add("wsman_http_connections",
+				  "Open HTTP connections.", WSMAN_METRIC_GAUGE,
+				  metrics_connections, httpd_ctx);
+		wsman_metrics_add("wsman_auth_cache_hits_total",
+				  "Basic credentials found in the cache.",
+				  WSMAN_METRIC_COUNTER,
+				  metrics_auth_cache_hits, NULL);
+		wsman_metrics_add("wsman_auth_cache_misses_total",
+				  "Basic credentials checked by the authenticator.",
+				  WSMAN_METRIC_COUNTER,
+				  metrics_auth_cache_misses, NULL);
+		if (wsman_response_cache_enabled()) {
+			wsman_metrics_add("wsman_response_cache_hits_total",
+					  "Responses replayed from the cache.",
+					  WSMAN_METRIC_COUNTER,
+					  metrics_response_cache_hits, NULL);
+			wsman_metrics_add("wsman_response_cache_misses_total",
+					  "Cacheable requests sent to the endpoint.",
+					  WSMAN_METRIC_COUNTER,
+					  metrics_response_cache_misses, NULL);
+		}
+		if (use_ssl) {
+			wsman_metrics_add("wsman_tls_handshakes_total",
+					  "TLS handshakes done.",
+					  WSMAN_METRIC_COUNTER,
+					  metrics_ssl_handshakes, httpd_ctx);
+			wsman_metrics_add("wsman_tls_resumed_total",
+					  "TLS handshakes resuming a session.",
+					  WSMAN_METRIC_COUNTER,
+					  metrics_ssl_resumed, httpd_ctx);
+		}
+	}
 
 	if (wsman_setup_thread(&pattrs) == 0 )
 		return listener;
@@ -40,4 +40,7 @@
 
 WsManListenerH *wsmand_start_server(dictionary * ini);
 
+/* read the identify files again, safe to call from a signal handler */
+void wsmand_identify_reload(void);
+
 #endif				/*SERVER_H_ */
@@ -113,9 +113,31 @@ debug_message_handler(const char *str,
 }
 
 
+static void log_queue_shutdown_handler(void *user_data)
+{
+	unsigned long dropped = debug_async_dropped();
+
+	/* flush the queue while the handlers are still there */
+	debug_async_stop();
+	if (dropped)
+		message("%lu log messages dropped", dropped);
+}
+
 static void initialize_logging(void)
 {
-	debug_add_handler(debug_message_handler, DEBUG_LEVEL_ALWAYS, NULL);
+	int level = wsmand_options_get_debug_level();
+
+	/* register for the levels which are logged, so messages above
+	 * them are dropped before they are formatted */
+	if (wsmand_options_get_syslog_level() > level)
+		level = wsmand_options_get_syslog_level();
+	if (wsmand_options_get_foreground_debug() > 0)
+		level = DEBUG_LEVEL_ALWAYS;
+	debug_add_handler(debug_message_handler, level, NULL);
+
+	if (wsmand_options_get_log_queue_size() > 0 &&
+	    debug_async_start(wsmand_options_get_log_queue_size()) == 0)
+		wsmand_shutdown_add_handler(log_queue_shutdown_handler, NULL);
 
 }				/* initialize_logging */
 
@@ -141,6 +163,7 @@ static void signal_handler(int sig_num)
 
 static void sighup_handler(int sig_num)
 {
+	wsmand_identify_reload();
 	if (wsmand_options_get_debug_level() == 0) {
 		int fd;
 
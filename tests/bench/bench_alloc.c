@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Counts the allocations of a process it is preloaded into:
+ *
+ *   WSMAN_BENCH_ALLOC_FILE=file LD_PRELOAD=bench_alloc.so openwsmand ...
+ *
+ * The count is kept in file, shared with whoever maps it, so that
+ * wsmand_bench can read it while the server runs. Only glibc, which
+ * lets the allocator be reached by its internal names, is supported;
+ * elsewhere nothing is counted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <wsman_config.h>
+#endif
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static unsigned long unshared;
+static unsigned long *allocs = &unshared;
+
+#define COUNT() __atomic_fetch_add(allocs, 1, __ATOMIC_RELAXED)
+
+__attribute__((constructor))
+static void bench_alloc_init(void)
+{
+	const char *file = getenv("WSMAN_BENCH_ALLOC_FILE");
+	void *p;
+	int fd;
+
+	if (file == NULL || (fd = open(file, O_RDWR | O_CREAT, 0644)) < 0)
+		return;
+	if (ftruncate(fd, sizeof(unsigned long)) == 0) {
+		p = mmap(NULL, sizeof(unsigned long), PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED)
+			allocs = p;
+	}
+	close(fd);
+}
+
+void *malloc(size_t size)
+{
+	COUNT();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	COUNT();
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	COUNT();
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	COUNT();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	void *p;
+
+	COUNT();
+	p = __libc_memalign(alignment, size);
+	if (p == NULL)
+		return ENOMEM;
+	*ptr = p;
+	return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	COUNT();
+	return __libc_memalign(alignment, size);
+}
+
+#endif /* __GLIBC__ */
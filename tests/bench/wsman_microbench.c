@@ -0,0 +1,738 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Microbenchmarks of the libwsman primitives a request spends its time
+ * in. Every benchmark runs for as many iterations as fit into the
+ * minimum time and reports the time per iteration:
+ *
+ *   wsman_microbench [-t seconds] [-d data dir] [-j] [name filter]
+ *
+ * -j prints JSON instead of a table, the filter picks the benchmarks
+ * whose name contains it. The data dir is the tests directory of the
+ * source tree.
+ */
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-xml.h"
+#include "wsman-soap.h"
+#include "wsman-soap-envelope.h"
+#include "wsman-xml-serializer.h"
+#include "wsman-xml-serialize.h"
+#include "wsman-epr.h"
+#include "wsman-filter.h"
+#include "wsman-trace.h"
+#include "wsman-metrics.h"
+#include "wsman-soap-message.h"
+#include "wsman-response-cache.h"
+#include "wsman-client-api.h"
+
+#ifndef BENCH_DATA_DIR
+#define BENCH_DATA_DIR "../tests"
+#endif
+
+#define GET_REQUEST \
+	"<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+	"xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+	"xmlns:wsman=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+	"<s:Header><wsa:Action>http://schemas.xmlsoap.org/ws/2004/09/transfer/Get</wsa:Action>" \
+	"<wsman:ResourceURI>http://example.org/resource</wsman:ResourceURI>" \
+	"<wsa:MessageID>uuid:1</wsa:MessageID>" \
+	"<wsman:SelectorSet><wsman:Selector Name=\"A\">1</wsman:Selector>" \
+	"<wsman:Selector Name=\"B\">2</wsman:Selector></wsman:SelectorSet>" \
+	"</s:Header><s:Body/></s:Envelope>"
+
+#define IDENTIFY_REQUEST \
+	"<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+	"xmlns:wsmid=\"http://schemas.dmtf.org/wbem/wsman/identity/1/" \
+	"wsmanidentity.xsd\"><s:Header/><s:Body><wsmid:Identify/></s:Body>" \
+	"</s:Envelope>"
+
+#define CACHED_RESPONSE \
+	"<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+	"xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\">" \
+	"<s:Header><wsa:MessageID>uuid:response</wsa:MessageID>" \
+	"<wsa:RelatesTo>uuid:1</wsa:RelatesTo></s:Header>" \
+	"<s:Body><Value>42</Value></s:Body></s:Envelope>"
+
+#define PULL_ITEM(n) \
+	"<p:CIM_Process xmlns:p=\"http://example.org/CIM_Process\">" \
+	"<p:Handle>" #n "</p:Handle><p:Name>process " #n "</p:Name>" \
+	"</p:CIM_Process>"
+
+#define PULL_RESPONSE \
+	"<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+	"xmlns:wsen=\"http://schemas.xmlsoap.org/ws/2004/09/enumeration\">" \
+	"<s:Header/><s:Body><wsen:PullResponse>" \
+	"<wsen:EnumerationContext>uuid:1</wsen:EnumerationContext><wsen:Items>" \
+	PULL_ITEM(1) PULL_ITEM(2) PULL_ITEM(3) PULL_ITEM(4) \
+	"</wsen:Items></wsen:PullResponse></s:Body></s:Envelope>"
+
+#define EPR_STRING \
+	"http://schema.omc-project.org/wbem/wscim/1/cim-schema/2/" \
+	"CIM_IndicationFilter?Name=OperatingSystemFilter0&" \
+	"CreationClassName=CIM_IndicationFilter&" \
+	"SystemName=localhost.localdomain&" \
+	"SystemCreationClassName=CIM_ComputerSystem"
+
+typedef struct {
+	long n;			/* iterations to run */
+	unsigned long long start;
+} Bench;
+
+typedef struct {
+	const char *name;
+	void (*fn) (Bench *b, void *data);
+	void *data;
+} BenchDef;
+
+/* libwsman_server expects the daemon to provide it */
+int continue_working = 1;
+
+static const char *data_dir = BENCH_DATA_DIR;
+static int failed;
+
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* leave the setup done so far out of the time */
+static void reset_timer(Bench *b)
+{
+	b->start = now();
+}
+
+static char *load(const char *file, size_t *len)
+{
+	char *path = u_strdup_printf("%s/%s", data_dir, file);
+	u_buf_t *buf;
+	char *text = NULL;
+
+	u_buf_create(&buf);
+	if (u_buf_load(buf, path) == 0) {
+		*len = u_buf_len(buf);
+		u_buf_append(buf, "", 1);
+		text = u_buf_steal(buf);
+	} else {
+		fprintf(stderr, "cannot read %s\n", path);
+		failed++;
+	}
+	u_buf_free(buf);
+	u_free(path);
+	return text;
+}
+
+static WsXmlDocH load_doc(const char *file)
+{
+	WsXmlDocH doc = NULL;
+	size_t len;
+	char *text = load(file, &len);
+
+	if (text)
+		doc = ws_xml_read_memory(text, len, "UTF-8", 0);
+	u_free(text);
+	if (text && doc == NULL) {
+		fprintf(stderr, "cannot parse %s\n", file);
+		failed++;
+	}
+	return doc;
+}
+
+static void bm_xml_read(Bench *b, void *data)
+{
+	size_t len;
+	char *text = load(data, &len);
+	long i;
+
+	reset_timer(b);
+	for (i = 0; text && i < b->n; i++)
+		ws_xml_destroy_doc(ws_xml_read_memory(text, len, "UTF-8", 0));
+	u_free(text);
+}
+
+static void bm_xml_dump(Bench *b, void *data)
+{
+	WsXmlDocH doc = load_doc(data);
+	char *buf;
+	int len;
+	long i;
+
+	reset_timer(b);
+	for (i = 0; doc && i < b->n; i++) {
+		ws_xml_dump_memory_enc(doc, &buf, &len, "UTF-8");
+		ws_xml_free_memory(buf);
+	}
+	ws_xml_destroy_doc(doc);
+}
+
+/* the service of tests/serialization/ser1.c */
+struct __Sample_Servie {
+	XML_TYPE_BOOL AcceptPause;
+	XML_TYPE_BOOL AcceptStop;
+	XML_TYPE_STR Caption;
+	XML_TYPE_UINT32 CheckPoint;
+	XML_TYPE_STR CreationClassName;
+	XML_TYPE_STR Description;
+	XML_TYPE_BOOL DesktopInteract;
+	XML_TYPE_STR DisplayName;
+	XML_TYPE_STR ErrorControl;
+	XML_TYPE_UINT32 ExitCode;
+	XML_TYPE_STR InstallDate;
+	XML_TYPE_STR Name;
+	XML_TYPE_STR PathName;
+	XML_TYPE_UINT32 ProcessId;
+	XML_TYPE_UINT32 ServiceSpecificExitCode;
+	XML_TYPE_STR ServiceType;
+	XML_TYPE_BOOL Started;
+	XML_TYPE_STR StartMode;
+	XML_TYPE_STR StartName;
+	XML_TYPE_STR State;
+	XML_TYPE_STR Status;
+	XML_TYPE_STR SystemCreationClassName;
+	XML_TYPE_STR SystemName;
+	XML_TYPE_UINT32 TagId;
+	XML_TYPE_UINT32 WaitHint;
+	XML_TYPE_UINT64 Uint64;
+	XML_TYPE_DYN_ARRAY shorts;
+};
+typedef struct __Sample_Servie Sample_Servie;
+
+#define SERVICE_NS "http://schemas.dmtf.org/wbem/wscim/1/cim-schema/2/CIM_ComputerSystem"
+
+static XML_TYPE_UINT16 myshorts[] = { 5, 11, 14, 19, 27, 36 };
+static SER_TYPEINFO_UINT16;
+
+static Sample_Servie servie = {
+	0, 1, "Caption", 30, "CreationClassName", "Description", 1,
+	"DisplayName", "ErrorControl", 50, "InstallDate", "Name",
+	"PathName", 60, 70, "ServiceType", 0, "StartMode", "StartName",
+	"State", "Status", "SystemCreationClassName", "SystemName", 90,
+	100, 1000000, {6, myshorts}
+};
+
+SER_START_ITEMS(Sample_Servie)
+	SER_BOOL("AcceptPause", 1),
+	SER_BOOL("AcceptStop", 1),
+	SER_STR("Caption", 1),
+	SER_UINT32("CheckPoint", 1),
+	SER_STR("CreationClassName", 1),
+	SER_STR("Description", 1),
+	SER_BOOL("DesktopInteract", 1),
+	SER_NS_STR(SERVICE_NS, "DisplayName", 1),
+	SER_STR("ErrorControl", 1),
+	SER_UINT32("ExitCode", 1),
+	SER_STR("InstallDate", 1),
+	SER_STR("Name", 1),
+	SER_STR("PathName", 1),
+	SER_UINT32("ProcessId", 1),
+	SER_UINT32("ServiceSpecificExitCode", 1),
+	SER_STR("ServiceType", 1),
+	SER_BOOL("Started", 1),
+	SER_STR("StartMode", 1),
+	SER_STR("StartName", 1),
+	SER_STR("State", 1),
+	SER_STR("Status", 1),
+	SER_STR("SystemCreationClassName", 1),
+	SER_STR("SystemName", 1),
+	SER_UINT32("TagId", 1),
+	SER_UINT32("WaitHint", 1),
+	SER_UINT64("Uint64", 1),
+	SER_DYN_ARRAY("shorts", 0, 1000, uint16),
+SER_END_ITEMS(Sample_Servie);
+
+static void bm_serialize(Bench *b, void *data)
+{
+	WsSerializerContextH serctx = ws_serializer_init();
+	WsXmlDocH doc;
+	long i;
+
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		doc = ws_xml_create_doc(NULL, "example");
+		ws_serialize(serctx, ws_xml_get_doc_root(doc), &servie,
+			     Sample_Servie_TypeInfo, "Sample", NULL, NULL, 0);
+		ws_xml_destroy_doc(doc);
+	}
+	ws_serializer_cleanup(serctx);
+}
+
+static void bm_deserialize(Bench *b, void *data)
+{
+	WsSerializerContextH serctx = ws_serializer_init();
+	WsXmlDocH doc = ws_xml_create_doc(NULL, "example");
+	WsXmlNodeH root = ws_xml_get_doc_root(doc);
+	Sample_Servie *s;
+	long i;
+
+	ws_serialize(serctx, root, &servie, Sample_Servie_TypeInfo, "Sample",
+		     NULL, NULL, 0);
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		s = ws_deserialize(serctx, root, Sample_Servie_TypeInfo,
+				   "Sample", NULL, NULL, 0, 0);
+		if (s == NULL || s->ProcessId != servie.ProcessId) {
+			failed++;
+			break;
+		}
+		ws_serializer_free_mem(serctx, s, Sample_Servie_TypeInfo);
+	}
+	ws_xml_destroy_doc(doc);
+	ws_serializer_cleanup(serctx);
+}
+
+static void bm_uuid(Bench *b, void *data)
+{
+	char buf[64];
+	long i;
+
+	for (i = 0; i < b->n; i++)
+		generate_uuid(buf, sizeof(buf), 0);
+}
+
+#define HASH_KEYS 1000
+
+static void bm_hash_lookup(Bench *b, void *data)
+{
+	hash_t *h = hash_create(HASHCOUNT_T_MAX, 0, 0);
+	char *keys[HASH_KEYS];
+	hscan_t hs;
+	hnode_t *hn;
+	long i;
+
+	for (i = 0; i < HASH_KEYS; i++) {
+		keys[i] = u_strdup_printf("uuid:%08lx-0000-0000-0000-%012lx",
+					  i * 7919, i);
+		hash_alloc_insert(h, keys[i], keys[i]);
+	}
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		if (hash_lookup(h, keys[i % HASH_KEYS]) == NULL) {
+			failed++;
+			break;
+		}
+	}
+	hash_scan_begin(&hs, h);
+	while ((hn = hash_scan_next(&hs)))
+		hash_scan_delfree(h, hn);
+	hash_destroy(h);
+	for (i = 0; i < HASH_KEYS; i++)
+		u_free(keys[i]);
+}
+
+/* append and take off again a list of data length */
+static void bm_list(Bench *b, void *data)
+{
+	list_t *l = list_create(LISTCOUNT_T_MAX);
+	long i, j, n = (long) data;
+
+	for (i = 0; i < b->n; i++) {
+		for (j = 0; j < n; j++)
+			list_append(l, lnode_create(NULL));
+		while (!list_isempty(l))
+			lnode_destroy(list_del_first(l));
+	}
+	list_destroy(l);
+}
+
+static void bm_epr_from_string(Bench *b, void *data)
+{
+	long i;
+
+	for (i = 0; i < b->n; i++)
+		epr_destroy(epr_from_string(EPR_STRING));
+}
+
+static void bm_epr_cmp(Bench *b, void *data)
+{
+	epr_t *epr1 = epr_from_string(EPR_STRING);
+	epr_t *epr2 = epr_from_string(EPR_STRING);
+	long i;
+
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		if (epr_cmp(epr1, epr2) != 0) {
+			failed++;
+			break;
+		}
+	}
+	epr_destroy(epr1);
+	epr_destroy(epr2);
+}
+
+static void bm_filter_deserialize(Bench *b, void *data)
+{
+	WsXmlDocH doc = load_doc(data);
+	WsXmlNodeH node;
+	filter_t *filter;
+	long i;
+
+	node = ws_xml_get_child(ws_xml_get_soap_body(doc), 0,
+				XML_NS_ENUMERATION, WSENUM_ENUMERATE);
+	reset_timer(b);
+	for (i = 0; node && i < b->n; i++) {
+		if ((filter = filter_deserialize(node, XML_NS_WS_MAN)) == NULL) {
+			failed++;
+			break;
+		}
+		filter_destroy(filter);
+	}
+	ws_xml_destroy_doc(doc);
+}
+
+static void bm_response_envelope(Bench *b, void *data)
+{
+	WsXmlDocH doc = load_doc(data);
+	long i;
+
+	reset_timer(b);
+	for (i = 0; doc && i < b->n; i++)
+		ws_xml_destroy_doc(wsman_create_response_envelope(doc, NULL));
+	ws_xml_destroy_doc(doc);
+}
+
+static void debug_handler(const char *str, debug_level_e level, void *data)
+{
+	/* what a log file handler does */
+	if (write(*(int *) data, str, strlen(str)) < 0)
+		failed++;
+}
+
+/* a debug() call with no handler, one above debug level, one taking
+ * it, and one taking it from the async ring */
+static void bm_debug(Bench *b, void *data)
+{
+	const char *mode = data;
+	int fd = open("/dev/null", O_WRONLY);
+	long i;
+
+	if (strcmp(mode, "off"))
+		debug_add_handler(debug_handler, strcmp(mode, "filtered") ?
+				  DEBUG_LEVEL_DEBUG : DEBUG_LEVEL_WARNING, &fd);
+	if (!strcmp(mode, "async"))
+		debug_async_start(4096);
+	reset_timer(b);
+	for (i = 0; i < b->n; i++)
+		debug("request %ld: %s for %s", i, "Enumerate",
+		      "http://schemas.dmtf.org/wbem/wscim/1/cim-schema/2/CIM_ComputerSystem");
+	if (!strcmp(mode, "async"))
+		debug_async_stop();
+	if (strcmp(mode, "off"))
+		debug_destroy_handlers();
+	close(fd);
+}
+
+/* timing a stage of a request, with tracing off or on */
+static void bm_trace_stage(Bench *b, void *data)
+{
+	WsmanTrace *trace;
+	unsigned long long t0;
+	long i;
+
+	if (data && wsman_trace_init(0, NULL, 1))
+		failed++;
+	trace = wsman_trace_new(0);
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		t0 = wsman_trace_begin(trace);
+		wsman_trace_end(trace, WSMAN_TRACE_FILTERS_IN, t0);
+	}
+	wsman_trace_free(trace);
+	if (data)
+		wsman_trace_shutdown();
+}
+
+/* counting a request of 1ms, one in ten a fault */
+static void bm_metrics_request(Bench *b, void *data)
+{
+	long i;
+
+	if (wsman_metrics_init(NULL))
+		failed++;
+	reset_timer(b);
+	for (i = 0; i < b->n; i++)
+		wsman_metrics_request(i % 10 ? WSMAN_RC_OK :
+				      WSA_DESTINATION_UNREACHABLE, 1000000);
+}
+
+/* replaying a cached Get response, the request already parsed */
+static void bm_response_cache_hit(Bench *b, void *data)
+{
+	WsXmlDocH in_doc, out_doc;
+	WsmanResponseCacheMiss *miss;
+	WsmanMessage *msg;
+	long i;
+
+	if (wsman_response_cache_init("http://example.org/resource=60", 16))
+		failed++;
+	msg = wsman_soap_message_new();
+	msg->charset = "UTF-8";
+	msg->auth_data.username = "wsman";
+	in_doc = ws_xml_read_memory(GET_REQUEST, strlen(GET_REQUEST), "UTF-8", 0);
+	out_doc = ws_xml_read_memory(CACHED_RESPONSE, strlen(CACHED_RESPONSE),
+				     "UTF-8", 0);
+	if (wsman_response_cache_replay(in_doc, msg, 0, &miss) == 0 && miss) {
+		u_buf_set(msg->response, CACHED_RESPONSE, strlen(CACHED_RESPONSE));
+		msg->http_code = WSMAN_STATUS_OK;
+		wsman_response_cache_store(miss, msg, out_doc);
+	}
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		u_buf_clear(msg->response);
+		if (wsman_response_cache_replay(in_doc, msg, 0, &miss) != 1) {
+			failed++;
+			break;
+		}
+	}
+	ws_xml_destroy_doc(out_doc);
+	ws_xml_destroy_doc(in_doc);
+	msg->charset = NULL;
+	msg->auth_data.username = NULL;
+	wsman_soap_message_destroy(msg);
+	wsman_response_cache_shutdown();
+}
+
+/* telling an Identify request from its text, and from parsing it */
+static void bm_identify_peek(Bench *b, void *data)
+{
+	size_t len = strlen(data);
+	long i;
+
+	reset_timer(b);
+	for (i = 0; i < b->n; i++)
+		if (wsman_peek_identify(data, len) < 0)
+			failed++;
+}
+
+static void bm_identify_parse(Bench *b, void *data)
+{
+	WsXmlDocH doc;
+	size_t len = strlen(data);
+	long i;
+
+	reset_timer(b);
+	for (i = 0; i < b->n; i++) {
+		doc = ws_xml_read_memory(data, len, "UTF-8", 0);
+		if (doc == NULL) {
+			failed++;
+			break;
+		}
+		wsman_is_identify_request(doc);
+		ws_xml_destroy_doc(doc);
+	}
+}
+
+/*
+ * what the string based C++ client API adds to a Get over the document
+ * based one: the payload dumped to a string rather than read in place
+ */
+static void bm_client_payload(Bench *b, void *data)
+{
+	WsXmlDocH doc = load_doc("xml/cim_computersystem_01.xml");
+	WsXmlNodeH payload = NULL;
+	char *buf;
+	size_t n = 0;
+	long i;
+
+	if (doc)
+		payload = ws_xml_get_child(ws_xml_get_soap_body(doc), 0,
+					   NULL, NULL);
+	reset_timer(b);
+	for (i = 0; payload && i < b->n; i++) {
+		if (strcmp(data, "string") == 0) {
+			buf = NULL;
+			wsmc_node_to_buf(payload, &buf);
+			n += buf && strstr(buf, "NameFormat") != NULL;
+			ws_xml_free_memory(buf);
+		} else {
+			n += strlen(ws_xml_get_node_text(
+					ws_xml_get_child(payload, 0, NULL,
+							 "NameFormat")));
+		}
+	}
+	if (doc && n == 0)
+		failed++;
+	ws_xml_destroy_doc(doc);
+}
+
+/* the same for the items of an enumeration page */
+static void bm_client_items(Bench *b, void *data)
+{
+	WsXmlDocH doc = ws_xml_read_memory(PULL_RESPONSE,
+			strlen(PULL_RESPONSE), "UTF-8", 0);
+	WsXmlNodeH items, item;
+	char *buf;
+	size_t n = 0;
+	long i;
+	int j;
+
+	items = ws_xml_get_child(ws_xml_get_child(ws_xml_get_soap_body(doc),
+					0, NULL, NULL),
+				 0, XML_NS_ENUMERATION, WSENUM_ITEMS);
+	reset_timer(b);
+	for (i = 0; items && i < b->n; i++) {
+		for (j = 0; (item = ws_xml_get_child(items, j, NULL, NULL));
+		     j++) {
+			if (strcmp(data, "strings") == 0) {
+				buf = NULL;
+				wsmc_node_to_buf(item, &buf);
+				n += buf ? strlen(buf) : 0;
+				ws_xml_free_memory(buf);
+			} else {
+				n += strlen(ws_xml_get_node_local_name(item));
+			}
+		}
+	}
+	if (items == NULL || n == 0)
+		failed++;
+	ws_xml_destroy_doc(doc);
+}
+
+static BenchDef benchmarks[] = {
+	{ "xml_read/cim_computersystem_01", bm_xml_read, "xml/cim_computersystem_01.xml" },
+	{ "xml_read/cim_computersystem_02", bm_xml_read, "xml/cim_computersystem_02.xml" },
+	{ "xml_read/enum_big", bm_xml_read, "webinject/enum_big.xml" },
+	{ "xml_dump/cim_computersystem_01", bm_xml_dump, "xml/cim_computersystem_01.xml" },
+	{ "xml_dump/cim_computersystem_02", bm_xml_dump, "xml/cim_computersystem_02.xml" },
+	{ "xml_dump/enum_big", bm_xml_dump, "webinject/enum_big.xml" },
+	{ "serialize/Sample_Servie", bm_serialize, NULL },
+	{ "deserialize/Sample_Servie", bm_deserialize, NULL },
+	{ "generate_uuid", bm_uuid, NULL },
+	{ "hash_lookup/1000", bm_hash_lookup, NULL },
+	{ "list/append_delete/10", bm_list, (void *) 10 },
+	{ "list/append_delete/1000", bm_list, (void *) 1000 },
+	{ "epr_from_string", bm_epr_from_string, NULL },
+	{ "epr_cmp", bm_epr_cmp, NULL },
+	{ "filter_deserialize/sample1", bm_filter_deserialize, "filter/sample1.xml" },
+	{ "filter_deserialize/sample3", bm_filter_deserialize, "filter/sample3.xml" },
+	{ "wsman_create_response_envelope/enum_big", bm_response_envelope, "webinject/enum_big.xml" },
+	{ "debug/off", bm_debug, "off" },
+	{ "debug/filtered", bm_debug, "filtered" },
+	{ "debug/sync", bm_debug, "sync" },
+	{ "debug/async", bm_debug, "async" },
+	{ "trace_stage/off", bm_trace_stage, NULL },
+	{ "trace_stage/on", bm_trace_stage, "on" },
+	{ "metrics_request", bm_metrics_request, NULL },
+	{ "response_cache_hit", bm_response_cache_hit, NULL },
+	{ "identify_peek/Identify", bm_identify_peek, IDENTIFY_REQUEST },
+	{ "identify_peek/Get", bm_identify_peek, GET_REQUEST },
+	{ "identify_parse/Identify", bm_identify_parse, IDENTIFY_REQUEST },
+	{ "identify_parse/Get", bm_identify_parse, GET_REQUEST },
+	{ "client_payload/string", bm_client_payload, "string" },
+	{ "client_payload/view", bm_client_payload, "view" },
+	{ "client_items/strings", bm_client_items, "strings" },
+	{ "client_items/view", bm_client_items, "view" }
+};
+
+/* run with more iterations until it takes min_ns, like google-benchmark */
+static double run(BenchDef *def, unsigned long long min_ns, long *iterations)
+{
+	Bench b;
+	unsigned long long ns;
+	double scale;
+
+	for (b.n = 1;; ) {
+		b.start = now();
+		def->fn(&b, def->data);
+		ns = now() - b.start;
+		if (ns >= min_ns || b.n >= 1000000000L || failed)
+			break;
+		scale = ns ? 1.4 * min_ns / ns : 100;
+		if (scale > 100)
+			scale = 100;
+		if (scale < 2)
+			scale = 2;
+		b.n = (long) (b.n * scale);
+	}
+	*iterations = b.n;
+	return (double) ns / b.n;
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 0.5, ns;
+	const char *pattern = NULL;
+	int json = 0, first = 1, c;
+	size_t i;
+	long n;
+
+	while ((c = getopt(argc, argv, "t:d:j")) != -1) {
+		switch (c) {
+		case 't': seconds = atof(optarg); break;
+		case 'd': data_dir = optarg; break;
+		case 'j': json = 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-d data dir] "
+				"[-j] [name filter]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc)
+		pattern = argv[optind];
+
+	if (json)
+		printf("{\n  \"benchmarks\": [\n");
+	else
+		printf("%-44s %12s %14s\n", "Benchmark", "Iterations", "Time");
+	for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+		if (pattern && !strstr(benchmarks[i].name, pattern))
+			continue;
+		ns = run(&benchmarks[i], seconds * 1e9, &n);
+		if (failed) {
+			fprintf(stderr, "%s failed\n", benchmarks[i].name);
+			return 1;
+		}
+		if (json)
+			printf("%s    {\"name\": \"%s\", \"iterations\": %ld, "
+			       "\"ns_per_op\": %.1f}", first ? "" : ",\n",
+			       benchmarks[i].name, n, ns);
+		else
+			printf("%-44s %12ld %11.1f ns\n", benchmarks[i].name,
+			       n, ns);
+		first = 0;
+	}
+	if (json)
+		printf("\n  ]\n}\n");
+	return 0;
+}
@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# Starts openwsmand from a build tree with the test plugin, counting
+# its allocations, runs wsmand_bench against it and stops it again:
+#
+#   wsmand-bench.sh <build dir> [wsmand_bench options]
+#
+# BENCH_PORT selects the port (default 15986), BENCH_ARGS holds more
+# wsmand_bench options. The results are labelled with the commit of the
+# source tree. Nothing but the build tree and the loopback interface is
+# needed.
+#
+
+if [ $# -lt 1 ] || [ ! -d "$1" ]; then
+	echo "usage: $0 <build dir> [wsmand_bench options]" >&2
+	exit 2
+fi
+build=$(cd "$1" && pwd)
+shift
+port=${BENCH_PORT:-15986}
+label=$(cd "$(dirname "$0")" && git describe --always --dirty 2>/dev/null)
+
+find_one() {
+	for f in "$@"; do
+		if [ -f "$f" ]; then
+			echo "$f"
+			return
+		fi
+	done
+}
+
+wsmand=$(find_one "$build/src/server/openwsmand" "$build/src/server/.libs/openwsmand")
+bench=$(find_one "$build/tests/bench/wsmand_bench" "$build/tests/bench/.libs/wsmand_bench")
+alloc=$(find_one "$build/tests/bench/bench_alloc.so" "$build/tests/bench/.libs/bench_alloc.so")
+auth=$(find_one "$build/src/authenticators/file/libwsman_file_auth.so" \
+	"$build/src/authenticators/file/.libs/libwsman_file_auth.so")
+test_plugin=$(find_one "$build/src/plugins/wsman/test/libwsman_test.so" \
+	"$build/src/plugins/wsman/test/.libs/libwsman_test.so")
+identify_plugin=$(find_one "$build/src/plugins/identify/libwsman_identify_plugin.so" \
+	"$build/src/plugins/identify/.libs/libwsman_identify_plugin.so")
+for f in wsmand bench auth test_plugin identify_plugin; do
+	eval v=\$$f
+	if [ -z "$v" ]; then
+		echo "$0: $f not found in $build" >&2
+		exit 1
+	fi
+done
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/wsmand-bench.XXXXXX") || exit 1
+trap '[ -f "$dir/wsmand.pid" ] && kill $(cat "$dir/wsmand.pid") 2>/dev/null; rm -rf "$dir"' EXIT INT TERM
+
+mkdir "$dir/plugins" "$dir/subscriptions"
+ln -s "$test_plugin" "$identify_plugin" "$dir/plugins/"
+# wsman:secret
+echo 'wsman:$6$saltsalt$TVLlQcbpFVof5W3Yz4DTP6gRstiNuHwwTt6GLc1E5n0U0aDehy0S5knV8wiOQSpT0Y77vwPZN.Pq.H91p5hVO1' > "$dir/passwd"
+cat > "$dir/openwsman.conf" <<EOF
+[server]
+port = $port
+ipv4 = yes
+ipv6 = no
+plugin_dir = $dir/plugins
+basic_authenticator = $auth
+basic_authenticator_arg = $dir/passwd
+subs_repository = $dir/subscriptions
+EOF
+
+if [ -n "$alloc" ]; then
+	WSMAN_BENCH_ALLOC_FILE="$dir/allocs" LD_PRELOAD="$alloc" \
+		"$wsmand" -c "$dir/openwsman.conf" -p "$dir/wsmand.pid"
+else
+	"$wsmand" -c "$dir/openwsman.conf" -p "$dir/wsmand.pid"
+fi
+
+i=0
+while [ ! -s "$dir/wsmand.pid" ] && [ $i -lt 50 ]; do
+	sleep 0.1
+	i=$((i + 1))
+done
+if [ ! -s "$dir/wsmand.pid" ]; then
+	echo "$0: openwsmand did not start" >&2
+	exit 1
+fi
+# give the listener time to bind
+sleep 1
+
+"$bench" -P "$port" -s "$(cat "$dir/wsmand.pid")" -l "$label" \
+	${alloc:+-a "$dir/allocs"} $BENCH_ARGS "$@"
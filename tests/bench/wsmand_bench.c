@@ -0,0 +1,492 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,cl
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGclE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Drives a mix of requests against a running server from a number of
+ * client threads for a fixed time and reports throughput, latency
+ * percentiles and, given its pid and the file bench_alloc counts into,
+ * the memory and allocations of the server, as JSON:
+ *
+ *   wsmand_bench [-h host] [-P port] [-u user] [-p password]
+ *                [-c threads] [-d seconds] [-w seconds]
+ *                [-m identify:1,get:4,enumerate:2,subscribe:1]
+ *                [-r resource_uri] [-s server_pid] [-a alloc_file]
+ *                [-l label] [-o output.json]
+ *
+ * An enumerate is an Enumerate and the Pulls up to the end of the
+ * enumeration, a subscribe a pull mode Subscribe and its Unsubscribe;
+ * their latency is the time for all of it. The server side figures are
+ * per HTTP request.
+ */
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-client-api.h"
+#include "wsman-client-transport.h"
+#include "wsman-filter.h"
+
+#define RESOURCE_URI "http://schema.openwsman.org/2006/openwsman/test"
+
+enum {
+	OP_IDENTIFY,
+	OP_GET,
+	OP_ENUMERATE,
+	OP_SUBSCRIBE,
+	OPS
+};
+
+static const char *op_names[OPS] = {
+	"identify", "get", "enumerate", "subscribe"
+};
+
+typedef struct {
+	unsigned long long *ns;	/* latencies */
+	size_t count;
+	size_t size;
+	unsigned long errors;
+	unsigned long messages;	/* HTTP requests */
+} Samples;
+
+typedef struct {
+	WsManClient *cl;
+	unsigned int seed;
+	Samples samples[OPS];
+} Worker;
+
+static const char *host = "localhost";
+static int port = 5985;
+static const char *user = "wsman";
+static const char *password = "secret";
+static const char *resource_uri = RESOURCE_URI;
+static int weights[OPS] = { 1, 4, 2, 1 };
+static int total_weight = 8;
+
+/* window of the measurement, requests outside it are not counted */
+static volatile unsigned long long window_start = ~0ULL;
+static volatile unsigned long long window_end = ~0ULL;
+static volatile int stop = 0;
+
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int parse_mix(const char *mix)
+{
+	char *copy = u_strdup(mix), *item, *save = NULL, *colon;
+	int i, found;
+
+	memset(weights, 0, sizeof(weights));
+	total_weight = 0;
+	for (item = strtok_r(copy, ",", &save); item;
+	     item = strtok_r(NULL, ",", &save)) {
+		colon = strchr(item, ':');
+		if (colon)
+			*colon++ = '\0';
+		for (i = 0, found = 0; i < OPS; i++) {
+			if (strcmp(item, op_names[i]) == 0) {
+				weights[i] = colon ? atoi(colon) : 1;
+				total_weight += weights[i];
+				found = 1;
+			}
+		}
+		if (!found) {
+			fprintf(stderr, "unknown operation %s\n", item);
+			u_free(copy);
+			return 1;
+		}
+	}
+	u_free(copy);
+	return total_weight <= 0;
+}
+
+static int pick_op(Worker *w)
+{
+	int r = rand_r(&w->seed) % total_weight, i;
+
+	for (i = 0; i < OPS - 1; i++) {
+		if (r < weights[i])
+			break;
+		r -= weights[i];
+	}
+	return i;
+}
+
+static int response_ok(Worker *w, WsXmlDocH doc)
+{
+	return doc && wsmc_get_response_code(w->cl) == 200;
+}
+
+static int run_enumerate(Worker *w, client_opt_t *options,
+		unsigned long *messages)
+{
+	WsXmlDocH doc;
+	char *context;
+	int ok;
+
+	doc = wsmc_action_enumerate(w->cl, resource_uri, options, NULL);
+	(*messages)++;
+	ok = response_ok(w, doc);
+	context = ok ? wsmc_get_enum_context(doc) : NULL;
+	ws_xml_destroy_doc(doc);
+	while (context && *context) {
+		doc = wsmc_action_pull(w->cl, resource_uri, options, NULL,
+				       context);
+		(*messages)++;
+		u_free(context);
+		ok = response_ok(w, doc);
+		context = ok ? wsmc_get_enum_context(doc) : NULL;
+		ws_xml_destroy_doc(doc);
+	}
+	u_free(context);
+	return ok;
+}
+
+static int run_subscribe(Worker *w, client_opt_t *options,
+		unsigned long *messages)
+{
+	filter_t *filter;
+	WsXmlDocH doc;
+	char *id = NULL, *context;
+	int ok;
+
+	filter = filter_create_simple(WSM_WQL_FILTER_DIALECT,
+				      "select * from CIM_ProcessIndication");
+	options->delivery_mode = WSMAN_DELIVERY_PULL;
+	options->expires = 600;
+	doc = wsmc_action_subscribe(w->cl, resource_uri, options, filter);
+	(*messages)++;
+	ok = response_ok(w, doc);
+	if (ok)
+		id = ws_xml_get_xpath_value(doc, "/s:Envelope/s:Body/"
+			"wse:SubscribeResponse/wse:SubscriptionManager/"
+			"wsa:ReferenceParameters/wse:Identifier");
+	ws_xml_destroy_doc(doc);
+	filter_destroy(filter);
+	if (id == NULL)
+		return 0;
+
+	/* the reference parameters go into the header as they are */
+	context = u_strdup_printf("<ReferenceParameters><wse:%s xmlns:wse=\"%s\">"
+				  "%s</wse:%s></ReferenceParameters>",
+				  WSEVENT_IDENTIFIER, XML_NS_EVENTING, id,
+				  WSEVENT_IDENTIFIER);
+	doc = wsmc_action_unsubscribe(w->cl, resource_uri, options, context);
+	(*messages)++;
+	ok = response_ok(w, doc);
+	ws_xml_destroy_doc(doc);
+	u_free(context);
+	u_free(id);
+	return ok;
+}
+
+static int run_op(Worker *w, int op, unsigned long *messages)
+{
+	client_opt_t *options = wsmc_options_init();
+	WsXmlDocH doc = NULL;
+	int ok = 0;
+
+	switch (op) {
+	case OP_IDENTIFY:
+		doc = wsmc_action_identify(w->cl, options);
+		(*messages)++;
+		ok = response_ok(w, doc);
+		break;
+	case OP_GET:
+		doc = wsmc_action_get(w->cl, resource_uri, options);
+		(*messages)++;
+		ok = response_ok(w, doc);
+		break;
+	case OP_ENUMERATE:
+		ok = run_enumerate(w, options, messages);
+		break;
+	case OP_SUBSCRIBE:
+		ok = run_subscribe(w, options, messages);
+		break;
+	}
+	ws_xml_destroy_doc(doc);
+	wsmc_options_destroy(options);
+	return ok;
+}
+
+static void add_sample(Samples *s, unsigned long long ns)
+{
+	unsigned long long *grown;
+
+	if (s->count == s->size) {
+		s->size = s->size ? s->size * 2 : 1024;
+		grown = u_realloc(s->ns, s->size * sizeof(*s->ns));
+		if (grown == NULL)
+			return;
+		s->ns = grown;
+	}
+	s->ns[s->count++] = ns;
+}
+
+static void *worker(void *data)
+{
+	Worker *w = data;
+	unsigned long long start, end;
+	unsigned long messages;
+	int op, ok;
+
+	while (!stop) {
+		op = pick_op(w);
+		messages = 0;
+		start = now();
+		ok = run_op(w, op, &messages);
+		end = now();
+		if (start < window_start || end > window_end)
+			continue;
+		w->samples[op].messages += messages;
+		if (ok)
+			add_sample(&w->samples[op], end - start);
+		else
+			w->samples[op].errors++;
+	}
+	return NULL;
+}
+
+/* kB of VmRSS or VmHWM of pid, -1 if unknown */
+static long read_memory(int pid, const char *field)
+{
+	char path[64], line[256];
+	size_t len = strlen(field);
+	long kb = -1;
+	FILE *fp;
+
+	if (pid <= 0)
+		return -1;
+	snprintf(path, sizeof(path), "/proc/%d/status", pid);
+	if ((fp = fopen(path, "r")) == NULL)
+		return -1;
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, field, len) == 0 && line[len] == ':') {
+			kb = atol(line + len + 1);
+			break;
+		}
+	}
+	fclose(fp);
+	return kb;
+}
+
+static volatile unsigned long *map_allocs(const char *file)
+{
+	void *p;
+	int fd;
+
+	if (file == NULL || (fd = open(file, O_RDONLY)) < 0)
+		return NULL;
+	p = mmap(NULL, sizeof(unsigned long), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *) a;
+	unsigned long long y = *(const unsigned long long *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double quantile_us(const Samples *s, double q)
+{
+	size_t i;
+
+	if (s->count == 0)
+		return 0;
+	i = (size_t) (q * s->count);
+	if (i >= s->count)
+		i = s->count - 1;
+	return s->ns[i] / 1000.0;
+}
+
+static void print_samples(FILE *out, Samples *s, double seconds)
+{
+	qsort(s->ns, s->count, sizeof(*s->ns), compare_ns);
+	fprintf(out, "\"requests\": %lu, \"errors\": %lu, "
+		"\"messages\": %lu, \"requests_per_second\": %.1f, "
+		"\"latency_us\": {\"p50\": %.1f, \"p99\": %.1f, "
+		"\"p999\": %.1f, \"max\": %.1f}",
+		(unsigned long) s->count, s->errors, s->messages,
+		s->count / seconds, quantile_us(s, 0.5), quantile_us(s, 0.99),
+		quantile_us(s, 0.999), quantile_us(s, 1));
+}
+
+static void merge(Samples *to, const Samples *from)
+{
+	size_t i;
+
+	for (i = 0; i < from->count; i++)
+		add_sample(to, from->ns[i]);
+	to->errors += from->errors;
+	to->messages += from->messages;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-h host] [-P port] [-u user] "
+		"[-p password] [-c threads] [-d seconds] [-w seconds] "
+		"[-m mix] [-r resource_uri] [-s server_pid] "
+		"[-a alloc_file] [-l label] [-o output.json]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	int threads = 8, duration = 10, warmup = 1, pid = 0, i, op, c;
+	const char *mix = NULL, *alloc_file = NULL, *label = "";
+	const char *output = NULL;
+	volatile unsigned long *allocs;
+	unsigned long allocs_start = 0, allocs_end = 0;
+	long rss_start, rss_end;
+	Samples total[OPS], all;
+	pthread_t *tids;
+	Worker *workers;
+	double seconds;
+	FILE *out;
+
+	while ((c = getopt(argc, argv, "h:P:u:p:c:d:w:m:r:s:a:l:o:")) != -1) {
+		switch (c) {
+		case 'h': host = optarg; break;
+		case 'P': port = atoi(optarg); break;
+		case 'u': user = optarg; break;
+		case 'p': password = optarg; break;
+		case 'c': threads = atoi(optarg); break;
+		case 'd': duration = atoi(optarg); break;
+		case 'w': warmup = atoi(optarg); break;
+		case 'm': mix = optarg; break;
+		case 'r': resource_uri = optarg; break;
+		case 's': pid = atoi(optarg); break;
+		case 'a': alloc_file = optarg; break;
+		case 'l': label = optarg; break;
+		case 'o': output = optarg; break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (threads <= 0 || duration <= 0 || (mix && parse_mix(mix))) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	/* clients are set up before the threads, transport init is not MT safe */
+	workers = u_zalloc(threads * sizeof(Worker));
+	tids = u_zalloc(threads * sizeof(pthread_t));
+	for (i = 0; i < threads; i++) {
+		workers[i].cl = wsmc_create(host, port, "/wsman", "http", user,
+					    password);
+		if (workers[i].cl == NULL || wsmc_transport_init(workers[i].cl, NULL))
+			return 1;
+		workers[i].seed = i + 1;
+	}
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, worker, &workers[i]);
+
+	allocs = map_allocs(alloc_file);
+	sleep(warmup);
+	rss_start = read_memory(pid, "VmRSS");
+	if (allocs)
+		allocs_start = *allocs;
+	window_start = now();
+	sleep(duration);
+	window_end = now();
+	if (allocs)
+		allocs_end = *allocs;
+	rss_end = read_memory(pid, "VmRSS");
+	stop = 1;
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	seconds = (window_end - window_start) / 1e9;
+
+	memset(total, 0, sizeof(total));
+	memset(&all, 0, sizeof(all));
+	for (op = 0; op < OPS; op++) {
+		for (i = 0; i < threads; i++)
+			merge(&total[op], &workers[i].samples[op]);
+		merge(&all, &total[op]);
+	}
+
+	out = output ? fopen(output, "w") : stdout;
+	if (out == NULL) {
+		perror(output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"label\": \"%s\",\n  \"threads\": %d,\n"
+		"  \"seconds\": %.3f,\n  ", label, threads, seconds);
+	print_samples(out, &all, seconds);
+	fprintf(out, ",\n  \"operations\": {\n");
+	for (op = 0, c = 0; op < OPS; op++) {
+		if (weights[op] == 0)
+			continue;
+		fprintf(out, "%s    \"%s\": {\"weight\": %d, ", c++ ? ",\n" : "",
+			op_names[op], weights[op]);
+		print_samples(out, &total[op], seconds);
+		fprintf(out, "}");
+	}
+	fprintf(out, "\n  },\n  \"server\": {\"pid\": %d, \"rss_kb_start\": %ld, "
+		"\"rss_kb_end\": %ld, \"rss_kb_peak\": %ld", pid, rss_start,
+		rss_end, read_memory(pid, "VmHWM"));
+	if (allocs)
+		fprintf(out, ", \"allocs\": %lu, \"allocs_per_request\": %.1f",
+			allocs_end - allocs_start, all.messages ?
+			(double) (allocs_end - allocs_start) / all.messages : 0);
+	fprintf(out, "}\n}\n");
+	if (out != stdout)
+		fclose(out);
+
+	for (i = 0; i < threads; i++) {
+		for (op = 0; op < OPS; op++)
+			u_free(workers[i].samples[op].ns);
+		wsmc_release(workers[i].cl);
+	}
+	for (op = 0; op < OPS; op++)
+		u_free(total[op].ns);
+	u_free(all.ns);
+	u_free(workers);
+	u_free(tids);
+	return all.count == 0;
+}
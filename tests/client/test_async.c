@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+
+#include "wsman-client.h"
+#include "wsman-client-transport.h"
+
+#define REQUESTS 8
+#define TEST_RESOURCE "http://schema.openwsman.org/2006/openwsman/test"
+
+
+typedef struct {
+	const char *server;
+	int port;
+	const char *path;
+	const char *scheme;
+	const char *username;
+	const char *password;
+} ServerData;
+
+
+ServerData sd[] = {
+	{"localhost", 5985, "/wsman", "http", "wsman", "secret"}
+};
+
+static int answered = 0;
+
+static void done(WsManAsyncRequest *req, void *data)
+{
+	WsXmlDocH doc = wsmc_async_request_get_response(req);
+	char *xp;
+
+	if (doc == NULL)
+		return;
+	xp = ws_xml_get_xpath_value(doc,
+		"/s:Envelope/s:Body/wsmid:IdentifyResponse/wsmid:ProtocolVersion");
+	if (xp && strcmp(xp, XML_NS_WS_MAN) == 0)
+		answered++;
+	u_free(xp);
+}
+
+
+static int pages(WsManClient *cl, WsXmlDocH doc, void *data)
+{
+	WsXmlNodeH node = ws_xml_get_child(ws_xml_get_soap_body(doc), 0,
+			NULL, NULL);
+
+	node = ws_xml_get_child(node, 0, NULL, WSENUM_ITEMS);
+	*(int *) data += ws_xml_get_child_count(node);
+	return 0;
+}
+
+static int items(WsManClient *cl, WsXmlNodeH item, void *data)
+{
+	(*(int *) data)++;
+	return 0;
+}
+
+static int first_item(WsManClient *cl, WsXmlNodeH item, void *data)
+{
+	(*(int *) data)++;
+	return 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	WsManClient *cl;
+	WsManAsync *as;
+	WsXmlDocH request;
+	client_opt_t *options;
+	int i, failed = 0;
+
+	if (getenv("OPENWSMAN_TEST_PORT")) {
+		sd[0].port = atoi(getenv("OPENWSMAN_TEST_PORT"));
+	}
+
+	printf("Test 1: Testing asynchronous Identify requests:");
+	cl = wsmc_create(sd[0].server,
+			sd[0].port,
+			sd[0].path,
+			sd[0].scheme,
+			sd[0].username,
+			sd[0].password);
+	wsmc_transport_init(cl, NULL);
+	options = wsmc_options_init();
+	/* at most two in flight, the rest is queued */
+	as = wsmc_async_create(2);
+
+	request = wsmc_create_request(cl, NULL, options, NULL,
+			WSMAN_ACTION_IDENTIFY, NULL, NULL);
+	for (i = 0; i < REQUESTS; i++) {
+		if (wsmc_async_send(as, cl, request, 10, done, NULL) == NULL)
+			break;
+	}
+	while (wsmc_async_perform(as, 1000) > 0)
+		;
+
+	if (answered == 0) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		failed++;
+	} else if (answered == REQUESTS) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		failed++;
+	}
+
+	ws_xml_destroy_doc(request);
+	wsmc_async_release(as);
+
+	printf("Test 2: Testing streaming enumeration:");
+	{
+		int expected = 0, streamed = 0, first = 0;
+
+		/* one item per Pull so that Pulls overlap */
+		options->max_elements = 1;
+		wsmc_action_enumerate_and_pull(cl, TEST_RESOURCE, options,
+				NULL, pages, &expected);
+		if (expected == 0 || wsmc_get_response_code(cl) != 200) {
+			printf("\t\033[22;31mUNRESOLVED\033[m\n");
+			failed++;
+		} else if (wsmc_action_enumerate_and_pull_items(cl,
+					TEST_RESOURCE, options, NULL,
+					items, &streamed) &&
+				streamed == expected &&
+				wsmc_action_enumerate_and_pull_items(cl,
+					TEST_RESOURCE, options, NULL,
+					first_item, &first) &&
+				first == 1) {
+			printf("\t\033[22;32mPASSED\033[m\n");
+		} else {
+			printf("\t\033[22;31mFAILED\033[m\n");
+			failed++;
+		}
+	}
+	wsmc_options_destroy(options);
+	wsmc_release(cl);
+	return failed;
+}
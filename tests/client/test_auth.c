@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+
+#include "wsman-client.h"
+#include "wsman-client-transport.h"
+
+
+typedef struct {
+	const char *server;
+	int port;
+	const char *path;
+	const char *scheme;
+	const char *username;
+	const char *password;
+} ServerData;
+
+
+ServerData sd[] = {
+	{"localhost", 5985, "/wsman", "http", "wsman", "secret"},
+	{"localhost", 5985, "/wsman", "http", "wsman", "wrong"}
+};
+
+
+/* HTTP round trips of an Identify request, -1 if it failed */
+static int identify(WsManClient *cl)
+{
+	unsigned long before = wsman_transport_get_round_trips(cl);
+	client_opt_t *options = wsmc_options_init();
+	WsXmlDocH doc = wsmc_action_identify(cl, options);
+	int ret = -1;
+
+	if (doc && wsmc_get_response_code(cl) == 200)
+		ret = wsman_transport_get_round_trips(cl) - before;
+	if (doc)
+		ws_xml_destroy_doc(doc);
+	wsmc_options_destroy(options);
+	return ret;
+}
+
+static WsManClient *client(int i)
+{
+	WsManClient *cl = wsmc_create(sd[i].server,
+			sd[i].port,
+			sd[i].path,
+			sd[i].scheme,
+			sd[i].username,
+			sd[i].password);
+	wsmc_transport_init(cl, NULL);
+	wsman_transport_set_auth_method(cl, "basic");
+	return cl;
+}
+
+
+int main(int argc, char** argv)
+{
+	WsManClient *cl, *cl2;
+	int first, second, other, failed = 0;
+
+	if (getenv("OPENWSMAN_TEST_PORT")) {
+		sd[0].port = sd[1].port = atoi(getenv("OPENWSMAN_TEST_PORT"));
+	}
+
+	printf("Test 1: Testing round trips of authenticated requests:");
+	cl = client(0);
+	first = identify(cl);
+	second = identify(cl);
+	/* another client of the same endpoint */
+	cl2 = client(0);
+	other = identify(cl2);
+	wsmc_release(cl2);
+
+	if (first < 0) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		failed++;
+	} else if (first == 2 && second == 1 && other == 1) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m (%d %d %d)\n",
+				first, second, other);
+		failed++;
+	}
+
+	printf("Test 2: Testing wrong password with a cached scheme:");
+	cl2 = client(1);
+	other = identify(cl2);
+	if (first < 0) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		failed++;
+	} else if (other == -1 &&
+			wsmc_get_last_error(cl2) == WS_LASTERR_LOGIN_DENIED &&
+			identify(cl) == 1) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		failed++;
+	}
+	wsmc_release(cl2);
+
+	wsmc_release(cl);
+	return failed;
+}
@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------
+//
+//  Copyright (C) Red Hat, Inc., 2015.
+//
+//  File:       test_cpp.cpp
+//
+//  License:    BSD-3-Clause
+//
+//  Contents:   Checks the document based C++ client API against the string
+//              based one, tests/bench/wsman_microbench.c times both.
+//              The exit status is the number of tests which did not pass.
+//
+//----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "OpenWsmanClient.h"
+
+using namespace WsmanClientNamespace;
+
+#define RESOURCE_URI "http://schema.openwsman.org/2006/openwsman/test"
+
+static int failures = 0;
+
+static void result(bool passed)
+{
+	if (passed) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		failures++;
+	}
+}
+
+int main(void)
+{
+	const char *port = getenv("OPENWSMAN_TEST_PORT");
+	OpenWsmanClient client("localhost", port ? atoi(port) : 5985, "/wsman",
+			"http", "basic", "wsman", "secret");
+	WsmanOptions options;
+	WsmanDocument doc;
+	size_t n;
+	int i;
+
+	try {
+		printf("Test 1: Testing Identify into a document:");
+		string xml = client.Identify();
+		client.Identify(doc);
+		WsmanNode payload = doc.Payload();
+		result(payload.Name() == "IdentifyResponse" &&
+			!payload.Child("ProductVendor").Text().empty() &&
+			doc.Xml(payload).str() == xml);
+
+		printf("Test 2: Testing optimized enumeration items:");
+		vector<string> plain, optimized;
+		client.Enumerate(RESOURCE_URI, plain, options);
+		WsmanOptions opt(FLAG_ENUMERATION_OPTIMIZATION);
+		opt.getOptions()->max_elements = 2;
+		client.Enumerate(RESOURCE_URI, optimized, opt);
+		n = 0;
+		{
+			EnumerationItems items(client, RESOURCE_URI, opt);
+			for (EnumerationItems::iterator it = items.begin();
+			     it != items.end(); ++it)
+				if (it.xml().str() == plain[n])
+					n++;
+		}
+		result(!plain.empty() && optimized == plain &&
+			n == plain.size());
+
+		printf("Test 3: Testing reused options:");
+		bool passed = true;
+		for (i = 0; i < 3 && passed; i++) {
+			options.clearSelectors();
+			options.addSelector("Instance", i ? "1" : "0");
+			client.Get(RESOURCE_URI, options, doc);
+			passed = !doc.empty();
+		}
+		result(passed &&
+			list_count(options.getOptions()->selectors) == 1);
+	} catch (GeneralWsmanException &e) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n\t%s\n", e.what());
+		failures++;
+	}
+	return failures;
+}
@@ -0,0 +1,247 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*
+ * Runs against a server with the test plugin in two host processes,
+ * plugin_host = libwsman_test.so=2, see wsmand-test.sh.
+ */
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+
+#include "wsman-client.h"
+#include "wsman-client-transport.h"
+
+
+#define RESOURCE_URI "http://schema.openwsman.org/2006/openwsman/test"
+#define HOSTS 2
+
+typedef struct {
+	const char *server;
+	int port;
+	const char *path;
+	const char *scheme;
+	const char *username;
+	const char *password;
+} ServerData;
+
+
+ServerData sd[] = {
+	{"localhost", 5985, "/wsman", "http", "wsman", "secret"}
+};
+
+static WsManClient *cl;
+static client_opt_t *options;
+
+
+/* the children of parent, the oldest first */
+static int children(pid_t parent, pid_t *pids, int max)
+{
+	DIR *dir = opendir("/proc");
+	struct dirent *de;
+	char path[64];
+	FILE *f;
+	int pid, ppid, i, n = 0;
+
+	if (dir == NULL)
+		return 0;
+	while ((de = readdir(dir)) != NULL) {
+		if ((pid = atoi(de->d_name)) <= 0)
+			continue;
+		snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+		if ((f = fopen(path, "r")) == NULL)
+			continue;
+		/* the name is in parentheses and has no ') ' in it here */
+		if (fscanf(f, "%*d (%*[^)]) %*c %d", &ppid) == 1 &&
+		    ppid == parent && n < max) {
+			for (i = n++; i > 0 && pids[i - 1] > pid; i--)
+				pids[i] = pids[i - 1];
+			pids[i] = pid;
+		}
+		fclose(f);
+	}
+	closedir(dir);
+	return n;
+}
+
+/* the plugin hosts, children of the supervisor the server forked */
+static int plugin_hosts(pid_t *pids)
+{
+	pid_t supervisor;
+	char *server = getenv("OPENWSMAN_TEST_PID");
+
+	if (server == NULL || children(atoi(server), &supervisor, 1) != 1)
+		return 0;
+	return children(supervisor, pids, HOSTS);
+}
+
+/* waits up to 10s for the hosts to be n and not to include gone */
+static int wait_hosts(pid_t *pids, int n, pid_t gone)
+{
+	int i, k, found;
+
+	for (i = 0; i < 100; i++) {
+		found = plugin_hosts(pids);
+		for (k = 0; k < found && pids[k] != gone; k++)
+			;
+		if (found == n && k == found)
+			return 1;
+		usleep(100000);
+	}
+	return 0;
+}
+
+static int answered(WsXmlDocH response)
+{
+	return response && wsmc_get_response_code(cl) == 200 &&
+		!wsmc_check_for_fault(response);
+}
+
+/* the context of a new enumeration, NULL if it failed */
+static char *enumerate(void)
+{
+	WsXmlDocH response = wsmc_action_enumerate(cl, RESOURCE_URI, options,
+			NULL);
+	char *context = answered(response) ?
+		wsmc_get_enum_context(response) : NULL;
+
+	if (response)
+		ws_xml_destroy_doc(response);
+	return context;
+}
+
+/* pulls the enumeration through, returns the items or -1 on a fault */
+static int pull(char *context)
+{
+	WsXmlDocH response;
+	int items = 0;
+
+	while (context && context[0]) {
+		response = wsmc_action_pull(cl, RESOURCE_URI, options, NULL,
+				context);
+		wsmc_free_enum_context(context);
+		context = NULL;
+		if (!answered(response)) {
+			items = -1;
+		} else {
+			items++;
+			context = wsmc_get_enum_context(response);
+		}
+		if (response)
+			ws_xml_destroy_doc(response);
+	}
+	wsmc_free_enum_context(context);
+	return items;
+}
+
+static void result(int ok, int *failed)
+{
+	if (wsmc_get_last_error(cl) != WS_LASTERR_OK) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		(*failed)++;
+	} else if (ok) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		(*failed)++;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	WsXmlDocH response;
+	pid_t pids[HOSTS], killed;
+	char *context;
+	int ok, failed = 0;
+
+	if (getenv("OPENWSMAN_TEST_PORT")) {
+		sd[0].port = atoi(getenv("OPENWSMAN_TEST_PORT"));
+	}
+
+	cl = wsmc_create(sd[0].server, sd[0].port, sd[0].path, sd[0].scheme,
+			sd[0].username, sd[0].password);
+	wsmc_transport_init(cl, NULL);
+	options = wsmc_options_init();
+	options->max_elements = 1;
+
+	printf("Test 1: Testing a Get answered by a plugin host:");
+	ok = wait_hosts(pids, HOSTS, 0);
+	response = wsmc_action_get(cl, RESOURCE_URI, options);
+	ok = ok && answered(response);
+	if (response)
+		ws_xml_destroy_doc(response);
+	result(ok, &failed);
+
+	printf("Test 2: Testing an enumeration pulled from its host:");
+	context = enumerate();
+	ok = context != NULL && pull(context) > 0;
+	result(ok, &failed);
+
+	printf("Test 3: Testing a host being restarted:");
+	/*
+	 * Requests go to the first host which is idle. Killed within a
+	 * second of being started, it is restarted a second later, so the
+	 * next enumeration goes to the other host and its Pulls only
+	 * succeed if they follow it there once the first is back.
+	 */
+	killed = pids[0];
+	ok = wait_hosts(pids, HOSTS, 0) && kill(killed, SIGKILL) == 0 &&
+		wait_hosts(pids, HOSTS, killed);
+	killed = pids[HOSTS - 1];
+	ok = ok && kill(killed, SIGKILL) == 0 &&
+		wait_hosts(pids, HOSTS - 1, killed);
+	/* the supervisor marks the host down right after reaping it */
+	usleep(100000);
+	context = ok ? enumerate() : NULL;
+	ok = context != NULL && wait_hosts(pids, HOSTS, killed) &&
+		pull(context) > 0;
+	response = wsmc_action_get(cl, RESOURCE_URI, options);
+	ok = ok && answered(response);
+	if (response)
+		ws_xml_destroy_doc(response);
+	result(ok, &failed);
+
+	wsmc_options_destroy(options);
+	wsmc_release(cl);
+	return failed;
+}
@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * Copyright (C) 2004-2006 Intel Corp. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of Intel Corp. nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL Intel Corp. OR THE CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#include "wsman_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "u/libu.h"
+#include "wsman-xml-api.h"
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+
+#include "wsman-client.h"
+#include "wsman-client-transport.h"
+
+
+#define RESOURCE_URI "http://schema.openwsman.org/2006/openwsman/test"
+
+typedef struct {
+	const char *server;
+	int port;
+	const char *path;
+	const char *scheme;
+	const char *username;
+	const char *password;
+} ServerData;
+
+
+ServerData sd[] = {
+	{"localhost", 5985, "/wsman", "http", "wsman", "secret"}
+};
+
+
+/* the response relates to the MessageID the request was sent with */
+static int relates_to_request(WsManPreparedRequest *req, WsXmlDocH response)
+{
+	size_t size;
+	const char *data = wsmc_prepared_request_get_data(req, &size);
+	WsXmlNodeH node = ws_xml_get_child(ws_xml_get_soap_header(response),
+			0, XML_NS_ADDRESSING, WSA_RELATES_TO);
+	char *relates_to = ws_xml_get_node_text(node);
+	char *msgid;
+
+	if (relates_to == NULL)
+		return 0;
+	msgid = u_strdup_printf(">%s</wsa:MessageID>", relates_to);
+	if (msgid == NULL)
+		return 0;
+	/* the envelope is '\0' terminated */
+	data = strstr(data, msgid);
+	u_free(msgid);
+	return data != NULL;
+}
+
+/* the envelope parses and carries the MessageID and the context */
+static int envelope_has(WsManPreparedRequest *req, const char *msgid,
+		const char *context)
+{
+	size_t size;
+	const char *data = wsmc_prepared_request_get_data(req, &size);
+	WsXmlDocH doc = ws_xml_read_memory(data, size, "UTF-8", 0);
+	WsXmlNodeH node;
+	int ok;
+
+	if (doc == NULL)
+		return 0;
+	node = ws_xml_get_child(ws_xml_get_soap_header(doc), 0,
+			XML_NS_ADDRESSING, WSA_MESSAGE_ID);
+	ok = node && (msgid == NULL ||
+			strcmp(ws_xml_get_node_text(node), msgid) != 0);
+	if (context) {
+		node = ws_xml_get_child(ws_xml_get_soap_body(doc), 0,
+				XML_NS_ENUMERATION, WSENUM_PULL);
+		node = ws_xml_get_child(node, 0, XML_NS_ENUMERATION,
+				WSENUM_ENUMERATION_CONTEXT);
+		ok = ok && node &&
+			strcmp(ws_xml_get_node_text(node), context) == 0;
+	}
+	ws_xml_destroy_doc(doc);
+	return ok;
+}
+
+
+int main(int argc, char** argv)
+{
+	WsManClient *cl;
+	WsManPreparedRequest *req;
+	client_opt_t *options;
+	WsXmlDocH response;
+	char *context, *last = NULL;
+	int i, ok, items, failed = 0;
+
+	if (getenv("OPENWSMAN_TEST_PORT")) {
+		sd[0].port = atoi(getenv("OPENWSMAN_TEST_PORT"));
+	}
+
+	cl = wsmc_create(sd[0].server, sd[0].port, sd[0].path, sd[0].scheme,
+			sd[0].username, sd[0].password);
+	wsmc_transport_init(cl, NULL);
+	options = wsmc_options_init();
+
+	printf("Test 1: Testing a prepared Get sent repeatedly:");
+	req = wsmc_prepare_request(cl, RESOURCE_URI, options, NULL,
+			WSMAN_ACTION_TRANSFER_GET, NULL, NULL);
+	ok = req != NULL;
+	for (i = 0; ok && i < 3; i++) {
+		char *msgid;
+		size_t size;
+
+		response = wsmc_prepared_request_send(req, NULL);
+		ok = response && wsmc_get_response_code(cl) == 200 &&
+			relates_to_request(req, response);
+		/* every send gets a MessageID of its own */
+		msgid = strstr(wsmc_prepared_request_get_data(req, &size),
+				"uuid:");
+		if (ok && last && msgid && !strncmp(last, msgid, 41))
+			ok = 0;
+		u_free(last);
+		last = msgid ? u_strndup(msgid, 41) : NULL;
+		if (response)
+			ws_xml_destroy_doc(response);
+	}
+	u_free(last);
+	wsmc_prepared_request_release(req);
+	if (wsmc_get_last_error(cl) != WS_LASTERR_OK) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		failed++;
+	} else if (ok) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		failed++;
+	}
+
+	printf("Test 2: Testing a prepared Pull through an enumeration:");
+	wsmc_set_action_option(options, FLAG_ENUMERATION_OPTIMIZATION);
+	options->max_elements = 1;
+	response = wsmc_action_enumerate(cl, RESOURCE_URI, options, NULL);
+	context = response ? wsmc_get_enum_context(response) : NULL;
+	items = 0;
+	ok = context != NULL;
+	if (response)
+		ws_xml_destroy_doc(response);
+	req = wsmc_prepare_request(cl, RESOURCE_URI, options, NULL,
+			WSMAN_ACTION_PULL, NULL, NULL);
+	ok = ok && req != NULL && wsmc_prepared_request_send(req, NULL) == NULL;
+	while (ok && context && context[0]) {
+		response = wsmc_prepared_request_send(req, context);
+		wsmc_free_enum_context(context);
+		context = NULL;
+		ok = response && wsmc_get_response_code(cl) == 200 &&
+			relates_to_request(req, response);
+		if (ok) {
+			items++;
+			context = wsmc_get_enum_context(response);
+		}
+		if (response)
+			ws_xml_destroy_doc(response);
+	}
+	wsmc_free_enum_context(context);
+	wsmc_prepared_request_release(req);
+	if (wsmc_get_last_error(cl) != WS_LASTERR_OK) {
+		printf("\t\033[22;31mUNRESOLVED\033[m\n");
+		failed++;
+	} else if (ok && items > 0) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m (%d items)\n", items);
+		failed++;
+	}
+
+	wsmc_options_destroy(options);
+	wsmc_release(cl);
+
+	printf("Test 3: Testing the envelope of a prepared Pull:");
+	/* nothing listens there, the envelope is patched all the same */
+	cl = wsmc_create(sd[0].server, 1, sd[0].path, sd[0].scheme,
+			sd[0].username, sd[0].password);
+	wsmc_transport_init(cl, NULL);
+	options = wsmc_options_init();
+	req = wsmc_prepare_request(cl, RESOURCE_URI, options, NULL,
+			WSMAN_ACTION_PULL, NULL, NULL);
+	ok = req != NULL;
+	if (ok) {
+		size_t size;
+
+		ok = envelope_has(req, NULL, NULL);
+		last = strstr(wsmc_prepared_request_get_data(req, &size),
+				"uuid:");
+		last = last ? u_strndup(last, 41) : NULL;
+		/* a longer context, then a shorter one */
+		ok = ok && last &&
+			wsmc_prepared_request_send(req, "uuid:a-rather-long-context") == NULL &&
+			envelope_has(req, last, "uuid:a-rather-long-context") &&
+			wsmc_prepared_request_send(req, "uuid:c") == NULL &&
+			envelope_has(req, last, "uuid:c");
+		u_free(last);
+		wsmc_prepared_request_release(req);
+	}
+	if (ok) {
+		printf("\t\033[22;32mPASSED\033[m\n");
+	} else {
+		printf("\t\033[22;31mFAILED\033[m\n");
+		failed++;
+	}
+	wsmc_options_destroy(options);
+	wsmc_release(cl);
+	return failed;
+}
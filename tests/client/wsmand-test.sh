@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# Starts openwsmand from a build tree with the test plugin, runs one
+# client test against it and stops it again:
+#
+#   wsmand-test.sh [-o option=value]... <build dir> <port> <test> [test arguments]
+#
+# Every -o adds an option to the [server] section of the configuration.
+# The test finds the server through OPENWSMAN_TEST_PORT and its process
+# through OPENWSMAN_TEST_PID, and exits with the number of tests which
+# did not pass, which is what this script exits with. Nothing but the
+# build tree and the loopback interface is needed, as for
+# tests/bench/wsmand-bench.sh.
+#
+
+options=
+while [ "$1" = "-o" ] && [ $# -gt 1 ]; do
+	options="$options$2
+"
+	shift 2
+done
+
+if [ $# -lt 3 ] || [ ! -d "$1" ]; then
+	echo "usage: $0 [-o option=value]... <build dir> <port> <test> [test arguments]" >&2
+	exit 2
+fi
+build=$(cd "$1" && pwd)
+port=$2
+shift 2
+
+find_one() {
+	for f in "$@"; do
+		if [ -f "$f" ]; then
+			echo "$f"
+			return
+		fi
+	done
+}
+
+wsmand=$(find_one "$build/src/server/openwsmand" "$build/src/server/.libs/openwsmand")
+auth=$(find_one "$build/src/authenticators/file/libwsman_file_auth.so" \
+	"$build/src/authenticators/file/.libs/libwsman_file_auth.so")
+test_plugin=$(find_one "$build/src/plugins/wsman/test/libwsman_test.so" \
+	"$build/src/plugins/wsman/test/.libs/libwsman_test.so")
+identify_plugin=$(find_one "$build/src/plugins/identify/libwsman_identify_plugin.so" \
+	"$build/src/plugins/identify/.libs/libwsman_identify_plugin.so")
+for f in wsmand auth test_plugin identify_plugin; do
+	eval v=\$$f
+	if [ -z "$v" ]; then
+		echo "$0: $f not found in $build" >&2
+		exit 1
+	fi
+done
+
+dir=$(mktemp -d "${TMPDIR:-/tmp}/wsmand-test.XXXXXX") || exit 1
+trap '[ -f "$dir/wsmand.pid" ] && kill $(cat "$dir/wsmand.pid") 2>/dev/null; rm -rf "$dir"' EXIT INT TERM
+
+mkdir "$dir/plugins" "$dir/subscriptions"
+ln -s "$test_plugin" "$identify_plugin" "$dir/plugins/"
+# wsman:secret
+echo 'wsman:$6$saltsalt$TVLlQcbpFVof5W3Yz4DTP6gRstiNuHwwTt6GLc1E5n0U0aDehy0S5knV8wiOQSpT0Y77vwPZN.Pq.H91p5hVO1' > "$dir/passwd"
+cat > "$dir/openwsman.conf" <<EOF
+[server]
+port = $port
+ipv4 = yes
+ipv6 = no
+plugin_dir = $dir/plugins
+basic_authenticator = $auth
+basic_authenticator_arg = $dir/passwd
+subs_repository = $dir/subscriptions
+$options
+EOF
+
+"$wsmand" -c "$dir/openwsman.conf" -p "$dir/wsmand.pid"
+
+i=0
+while [ ! -s "$dir/wsmand.pid" ] && [ $i -lt 50 ]; do
+	sleep 0.1
+	i=$((i + 1))
+done
+if [ ! -s "$dir/wsmand.pid" ]; then
+	echo "$0: openwsmand did not start" >&2
+	exit 1
+fi
+# give the listener time to bind
+sleep 1
+
+OPENWSMAN_TEST_PORT=$port OPENWSMAN_TEST_PID=$(cat "$dir/wsmand.pid") "$@"
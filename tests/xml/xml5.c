@@ -0,0 +1,82 @@
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "u/libu.h"
+
+
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+#include "wsman-xml-api.h"
+
+#include "wsman-debug.h"
+
+#define TEST_NS "http://schema.openwsman.org/2006/openwsman/test"
+
+
+static void initialize_logging(void)
+{
+        debug_add_handler(wsman_debug_message_handler, DEBUG_LEVEL_ALWAYS,
+                          NULL);
+}
+
+int debug_level = 0;
+
+int main(void)
+{
+    int i, ret = 0;
+    u_buf_t *buf;
+    WsXmlWriterH w;
+    WsXmlDocH doc, items, out;
+    WsXmlNodeH node;
+
+    if (debug_level) {
+        initialize_logging();
+        wsman_debug_set_level(debug_level);
+    }
+
+    u_buf_create(&buf);
+    doc = ws_xml_create_envelope();
+    w = ws_xml_writer_new(buf, "UTF-8");
+    if (w == NULL)
+        return 1;
+    if (ws_xml_writer_start_node(w, ws_xml_get_doc_root(doc)) ||
+            ws_xml_writer_add_node(w, ws_xml_get_soap_header(doc), 0) ||
+            ws_xml_writer_start_node(w, ws_xml_get_soap_body(doc)))
+        return 1;
+
+    /* items live below a parent declaring their namespace */
+    items = ws_xml_create_doc(TEST_NS, "Items");
+    for (i = 0; i < 10; i++) {
+        node = ws_xml_add_child_format(ws_xml_get_doc_root(items),
+                TEST_NS, "Item", "item %d", i);
+        ret = ws_xml_writer_add_node(w, node, 300);
+        if (ret)
+            break;
+    }
+    printf("items written: %d, offset: %lu\n", i,
+            (unsigned long) ws_xml_writer_offset(w));
+    /* the limit has to cut the sequence short */
+    if (ret != 1 || i == 0 || ws_xml_writer_offset(w) > 300)
+        return 1;
+    if (ws_xml_writer_end(w))
+        return 1;
+    ws_xml_writer_destroy(w);
+
+    printf("%s\n", (char *) u_buf_ptr(buf));
+    out = ws_xml_read_memory(u_buf_ptr(buf), u_buf_len(buf), "UTF-8", 0);
+    if (out == NULL)
+        return 1;
+    node = ws_xml_get_soap_body(out);
+    if (ws_xml_get_child_count_by_qname(node, TEST_NS, "Item") != i)
+        return 1;
+
+    ws_xml_destroy_doc(out);
+    ws_xml_destroy_doc(items);
+    ws_xml_destroy_doc(doc);
+    u_buf_free(buf);
+    return 0;
+}
@@ -0,0 +1,139 @@
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "u/libu.h"
+
+
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+#include "wsman-xml-api.h"
+
+#include "wsman-debug.h"
+
+#define FAULT_XPATH "/s:Envelope/s:Body/s:Fault/s:Code/s:Value"
+
+/* same fault, the second one binds the soap namespace to another prefix */
+static const char *faults[] = {
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\">"
+    "<s:Header/><s:Body><s:Fault><s:Code><s:Value>s:Sender</s:Value>"
+    "</s:Code></s:Fault></s:Body></s:Envelope>",
+    "<env:Envelope xmlns:env=\"http://www.w3.org/2003/05/soap-envelope\" "
+    "xmlns:s=\"urn:not-soap\">"
+    "<env:Header/><env:Body><env:Fault><env:Code><env:Value>s:Receiver"
+    "</env:Value></env:Code></env:Fault></env:Body></env:Envelope>"
+};
+
+
+/* an item and the Filter of the request, with its own prefix */
+static const char *item_xml =
+    "<Items><n1:CIM_Foo xmlns:n1=\"urn:cim-foo\"><n1:Name>a</n1:Name>"
+    "<n1:Size>12</n1:Size></n1:CIM_Foo></Items>";
+static const char *filter_xml =
+    "<w:Filter xmlns:w=\"urn:wsman\" xmlns:p=\"urn:cim-foo\"/>";
+
+
+static void initialize_logging(void)
+{
+        debug_add_handler(wsman_debug_message_handler, DEBUG_LEVEL_ALWAYS,
+                          NULL);
+}
+
+int debug_level = 0;
+
+static int check(int i, const char *expected)
+{
+    int ret = 0;
+    char *value;
+    WsXmlDocH doc = ws_xml_read_memory(faults[i], strlen(faults[i]),
+            NULL, 0);
+
+    if (doc == NULL)
+        return 1;
+    value = ws_xml_get_xpath_value(doc, FAULT_XPATH);
+    if (expected == NULL)
+        ret = value != NULL;
+    else
+        ret = value == NULL || strcmp(value, expected) != 0;
+    u_free(value);
+    ws_xml_destroy_doc(doc);
+    return ret;
+}
+
+static int check_match(void)
+{
+    int ret = 0;
+    WsXmlDocH items = ws_xml_read_memory(item_xml, strlen(item_xml),
+            NULL, 0);
+    WsXmlDocH filter = ws_xml_read_memory(filter_xml, strlen(filter_xml),
+            NULL, 0);
+    WsXmlNodeH item;
+
+    if (items == NULL || filter == NULL)
+        return 1;
+    item = ws_xml_get_child(ws_xml_get_doc_root(items), 0, NULL, NULL);
+    if (ws_xml_xpath_match(item, ws_xml_get_doc_root(filter),
+                "p:Size > 10 and p:Name = 'a'") != 1)
+        ret = 1;
+    if (ws_xml_xpath_match(item, ws_xml_get_doc_root(filter),
+                "self::p:CIM_Foo[p:Name = 'b']") != 0)
+        ret = 1;
+    if (ws_xml_xpath_match(item, NULL, "p:Name[") != -1)
+        ret = 1;
+    ws_xml_destroy_doc(items);
+    ws_xml_destroy_doc(filter);
+    return ret;
+}
+
+static void *worker(void *arg)
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        if (check(0, "s:Sender"))
+            return (void *)1;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    int i;
+    pthread_t t;
+    void *ret;
+    unsigned long hits, misses;
+
+    if (debug_level) {
+        initialize_logging();
+        wsman_debug_set_level(debug_level);
+    }
+
+    for (i = 0; i < 10; i++) {
+        if (check(0, "s:Sender"))
+            return 1;
+    }
+    /* prefixes are resolved against the document, not the cache */
+    if (check(1, NULL))
+        return 1;
+    ws_xml_xpath_cache_stats(&hits, &misses);
+    printf("hits: %lu, misses: %lu\n", hits, misses);
+    if (misses != 1 || hits != 10)
+        return 1;
+
+    /* the thread gets a cache of its own */
+    if (pthread_create(&t, NULL, worker, NULL) ||
+            pthread_join(t, &ret) || ret != NULL)
+        return 1;
+    ws_xml_xpath_cache_stats(&hits, &misses);
+    printf("hits: %lu, misses: %lu\n", hits, misses);
+    if (misses != 2 || hits != 19)
+        return 1;
+
+    return check_match();
+}
@@ -0,0 +1,159 @@
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "u/libu.h"
+
+
+#include "wsman-soap.h"
+#include "wsman-xml.h"
+#include "wsman-xml-api.h"
+
+#include "wsman-debug.h"
+
+#define ENV_START \
+    "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\" " \
+    "xmlns:n=\"http://schemas.xmlsoap.org/ws/2004/09/enumeration\" " \
+    "xmlns:w=\"http://schemas.dmtf.org/wbem/wsman/1/wsman.xsd\">" \
+    "<s:Header/><s:Body>"
+#define ENV_END "</s:Body></s:Envelope>"
+
+/* a Pull response and an optimized Enumerate response */
+static const char *pull_xml =
+    ENV_START "<n:PullResponse>"
+    "<n:EnumerationContext>uuid:1234</n:EnumerationContext>"
+    "<n:Items>"
+    "<p:CIM_Foo xmlns:p=\"urn:cim-foo\"><p:Name>a</p:Name></p:CIM_Foo>"
+    "<p:CIM_Foo xmlns:p=\"urn:cim-foo\"><p:Name>b</p:Name>"
+    "<p:Items>not an item</p:Items></p:CIM_Foo>"
+    "<p:CIM_Foo xmlns:p=\"urn:cim-foo\"><p:Name>c</p:Name></p:CIM_Foo>"
+    "</n:Items></n:PullResponse>" ENV_END;
+
+static const char *enum_xml =
+    ENV_START "<n:EnumerateResponse>"
+    "<n:EnumerationContext>uuid:5678</n:EnumerationContext>"
+    "<w:Items><p:CIM_Foo xmlns:p=\"urn:cim-foo\"><p:Name>d</p:Name>"
+    "</p:CIM_Foo></w:Items><w:EndOfSequence/>"
+    "</n:EnumerateResponse>" ENV_END;
+
+
+static void initialize_logging(void)
+{
+        debug_add_handler(wsman_debug_message_handler, DEBUG_LEVEL_ALWAYS,
+                          NULL);
+}
+
+int debug_level = 0;
+
+/* names of the items, the context and 'E' for EndOfSequence */
+static int check(const char *xml, const char *expected)
+{
+    char seen[64] = "";
+    WsXmlNodeH node;
+    int what;
+    WsXmlReaderH r = ws_xml_reader_new(xml, strlen(xml), NULL);
+
+    if (r == NULL)
+        return 1;
+    while ((node = ws_xml_reader_next(r, &what)) != NULL) {
+        char *text;
+
+        switch (what) {
+        case WS_XML_READER_ITEM:
+            text = ws_xml_get_node_text(ws_xml_get_child(node, 0,
+                        "urn:cim-foo", "Name"));
+            if (ws_xml_get_node_doc(node) == NULL)
+                return 1;
+            break;
+        case WS_XML_READER_CONTEXT:
+            text = ws_xml_get_node_text(node);
+            break;
+        default:
+            text = "E";
+            break;
+        }
+        strncat(seen, text ? text : "?", sizeof(seen) - strlen(seen) - 1);
+    }
+    ws_xml_reader_destroy(r);
+    if (what != 0 || strcmp(seen, expected)) {
+        printf("expected '%s', read '%s'\n", expected, seen);
+        return 1;
+    }
+    return 0;
+}
+
+/* feeding a response in small chunks gives the same document */
+static int check_push(const char *xml, size_t chunk)
+{
+    size_t off, len = strlen(xml);
+    char *buf1, *buf2;
+    int len1, len2, ret;
+    WsXmlDocH doc1, doc2;
+    WsXmlPushParserH p = ws_xml_push_parser_new("UTF-8");
+
+    if (p == NULL)
+        return 1;
+    for (off = 0; off < len; off += chunk) {
+        if (ws_xml_push_parser_feed(p, xml + off,
+                    len - off < chunk ? len - off : chunk))
+            return 1;
+    }
+    doc1 = ws_xml_push_parser_finish(p);
+    ws_xml_push_parser_destroy(p);
+    doc2 = ws_xml_read_memory(xml, len, "UTF-8", 0);
+    if (doc1 == NULL || doc2 == NULL)
+        return 1;
+    ws_xml_dump_memory_enc(doc1, &buf1, &len1, "UTF-8");
+    ws_xml_dump_memory_enc(doc2, &buf2, &len2, "UTF-8");
+    ret = len1 != len2 || memcmp(buf1, buf2, len1);
+    ws_xml_free_memory(buf1);
+    ws_xml_free_memory(buf2);
+    ws_xml_destroy_doc(doc1);
+    ws_xml_destroy_doc(doc2);
+    return ret;
+}
+
+int main(void)
+{
+    int what;
+    WsXmlReaderH r;
+    WsXmlPushParserH p;
+
+    if (debug_level) {
+        initialize_logging();
+        wsman_debug_set_level(debug_level);
+    }
+
+    if (check(pull_xml, "uuid:1234abc"))
+        return 1;
+    if (check(enum_xml, "uuid:5678dE"))
+        return 1;
+
+    /* truncated response */
+    r = ws_xml_reader_new(pull_xml, strlen(pull_xml) / 2, NULL);
+    if (r == NULL)
+        return 1;
+    while (ws_xml_reader_next(r, &what) != NULL)
+        ;
+    ws_xml_reader_destroy(r);
+    if (what != -1)
+        return 1;
+
+    if (check_push(pull_xml, 7) || check_push(enum_xml, 4096))
+        return 1;
+
+    /* incomplete document */
+    p = ws_xml_push_parser_new(NULL);
+    if (p == NULL || ws_xml_push_parser_feed(p, pull_xml, strlen(pull_xml) / 2))
+        return 1;
+    if (ws_xml_push_parser_finish(p) != NULL)
+        return 1;
+    ws_xml_push_parser_destroy(p);
+
+    return 0;
+}
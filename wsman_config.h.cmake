@@ -229,6 +229,11 @@
 #define HAVE_SSL 1
 #endif
 
+/* Defined if zlib is available for HTTP compression */
+#if @HAVE_ZLIB@
+#define HAVE_ZLIB 1
+#endif
+
 /* Define to 1 if you have the <stdarg.h> header file. */
 #if @HAVE_STDARG_H@
 #define HAVE_STDARG_H 1